@@ -30,7 +30,7 @@
 #include "CaretOMP.h"
 #include "FileInformation.h"
 #include "CaretPointer.h"
-#include "dot_wrapper.h"
+#include "DotBlockKernel.h"
 #include <fstream>
 #include <utility>
 #include <algorithm>
@@ -223,11 +223,13 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             cacheRow(i);
         }
     }
+    vector<int> chunkRows;
     for (int startrow = 0; startrow < numRows; startrow += numCacheRows)
     {
         int endrow = startrow + numCacheRows;
         if (endrow > numRows) endrow = numRows;
         outRows.resize(endrow - startrow);
+        chunkRows.clear();
         for (int i = startrow; i < endrow; ++i)
         {
             if (!cacheFullInput)
@@ -238,38 +240,9 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             {
                 outRows[i - startrow] = CaretArray<float>(numRows);
             }
+            chunkRows.push_back(i);
         }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
-        {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
-            }
-            for (int j = startrow; j < endrow; ++j)
-            {
-                if (myrow >= startrow && myrow < endrow)//check whether we are in the output memory area
-                {
-                    if (j >= myrow)//if so, only compute one half, and store both places
-                    {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(j, cacheRrs, true);
-                        outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[myrow - startrow][j] = outRows[j - startrow][myrow];
-                    }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(j, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                }
-            }
-        }
+        computeChunk(chunkRows, outRows, fisherZ);
         for (int i = startrow; i < endrow; ++i)
         {
             myCiftiOut->setRow(outRows[i - startrow], i);
@@ -409,13 +382,13 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             cacheRow(i);
         }
     }
-    CaretArray<int> indexReverse(numRows, -1);
+    vector<int> chunkRows;
     for (int startrow = 0; startrow < numSelected; startrow += numCacheRows)
     {
         int endrow = startrow + numCacheRows;
         if (endrow > numSelected) endrow = numSelected;
         outRows.resize(endrow - startrow);
-        int curRow = 0;//because we can't trust the order threads hit the critical section
+        chunkRows.clear();
         for (int i = startrow; i < endrow; ++i)
         {
             if (!cacheFullInput)
@@ -426,42 +399,12 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             {
                 outRows[i - startrow] = CaretArray<float>(numRows);
             }
-            indexReverse[ciftiIndexList[i].first] = i;
-        }
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
-        {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
-            }
-            for (int j = startrow; j < endrow; ++j)
-            {
-                if (indexReverse[myrow] != -1)//check if we are on a row that is in the output memory range
-                {
-                    if (indexReverse[myrow] <= j)//if so, only compute one of the elements, then store it both places
-                    {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
-                        outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[indexReverse[myrow] - startrow][ciftiIndexList[j].first] = outRows[j - startrow][myrow];
-                    }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                }
-            }
+            chunkRows.push_back(ciftiIndexList[i].first);
         }
+        computeChunk(chunkRows, outRows, fisherZ);
         for (int i = startrow; i < endrow; ++i)
         {
             myCiftiOut->setRow(outRows[i - startrow], ciftiIndexList[i].second);
-            indexReverse[ciftiIndexList[i].first] = -1;
         }
         if (!cacheFullInput)
         {
@@ -517,38 +460,25 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
     AlgorithmCiftiCorrelation(myProgObj, myCifti, myCiftiOut, leftRoiPtr, rightRoiPtr, cerebRoiPtr, volRoiPtr, weights, fisherZ, memLimitGB, noDemean, covariance);//HACK: pass through our progress object
 }
 
-float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ)
+namespace
 {
-    double r;
-    if (row1 == row2 && !m_covariance)
+    //output tiles are this many rows on a side, the inner cache blocking is done in DotBlockKernel
+    const int CORR_TILE_SIZE = 64;
+    
+    //rows read at a time when the input doesn't fit in the cache
+    int streamBatchRows()
     {
-        r = 1.0;//short circuit for same row
-    } else {
-        if (m_weightedMode)
-        {
-            int numWeights = (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
-            double accum = dsdot(row1, row2, numWeights);//these have already had the weighted row means subtracted out, and weights applied
-            if (m_covariance)
-            {
-                if (m_binaryWeights)
-                {
-                    r = accum / numWeights;
-                } else {
-                    r = accum / rrs1;//NOTE: will equal rrs2 as it only depends on weights, and is not square root
-                }
-            } else {
-                r = accum / (rrs1 * rrs2);//as do these
-            }
-        } else {
-            double accum = dsdot(row1, row2, m_numCols);//these have already had the row means subtracted out
-            if (m_covariance)
-            {
-                r = accum / m_numCols;
-            } else {
-                r = accum / (rrs1 * rrs2);
-            }
-        }
+#ifdef CARET_OMP
+        return CORR_TILE_SIZE * omp_get_max_threads();//enough tiles to keep every thread busy for each batch
+#else
+        return CORR_TILE_SIZE;
+#endif
     }
+}
+
+float AlgorithmCiftiCorrelation::finishValue(const double& dotValue, const bool& fisherZ)
+{
+    double r = dotValue;//rows have already been demeaned and scaled by doScale, so the dot product is the final value before clamping
     if (!m_covariance)
     {
         if (fisherZ)
@@ -564,6 +494,105 @@ float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1,
     return r;
 }
 
+void AlgorithmCiftiCorrelation::computeChunk(const vector<int>& chunkRows, vector<CaretArray<float> >& outRows, const bool& fisherZ)
+{//chunkRows must all be cached, computes every row of the input against each of them
+    const int numRows = m_inputCifti->getNumberOfRows();
+    const int chunkSize = (int)chunkRows.size();
+    vector<const float*> chunkPtrs(chunkSize);
+    vector<char> inChunk(numRows, 0);
+    for (int i = 0; i < chunkSize; ++i)
+    {
+        chunkPtrs[i] = getCachedRow(chunkRows[i]);
+        inChunk[chunkRows[i]] = 1;
+    }
+    computeTiles(chunkPtrs, chunkRows, chunkPtrs, chunkRows, true, outRows, fisherZ);//the chunk against itself is symmetric
+    vector<int> restRows;
+    bool restCached = true;
+    for (int i = 0; i < numRows; ++i)
+    {
+        if (!inChunk[i])
+        {
+            restRows.push_back(i);
+            if (m_rowInfo[i].m_cacheIndex == -1) restCached = false;
+        }
+    }
+    const int numRest = (int)restRows.size();
+    if (numRest == 0) return;
+    const int batchSize = (restCached ? numRest : streamBatchRows());
+    vector<float> batchStorage;
+    if (!restCached) batchStorage.resize((int64_t)batchSize * m_numCols);
+    vector<const float*> batchPtrs;
+    vector<int> batchRows;
+    for (int batchStart = 0; batchStart < numRest; batchStart += batchSize)
+    {
+        int batchEnd = batchStart + batchSize;
+        if (batchEnd > numRest) batchEnd = numRest;
+        batchRows.assign(restRows.begin() + batchStart, restRows.begin() + batchEnd);
+        batchPtrs.resize(batchEnd - batchStart);
+        for (int i = 0; i < batchEnd - batchStart; ++i)
+        {
+            if (restCached)
+            {
+                batchPtrs[i] = getCachedRow(batchRows[i]);
+            } else {//read sequentially, outside the parallel section
+                float* rowPtr = batchStorage.data() + (int64_t)i * m_numCols;
+                loadRow(batchRows[i], rowPtr);
+                batchPtrs[i] = rowPtr;
+            }
+        }
+        computeTiles(chunkPtrs, chunkRows, batchPtrs, batchRows, false, outRows, fisherZ);
+    }
+}
+
+void AlgorithmCiftiCorrelation::computeTiles(const vector<const float*>& rowPtrs, const vector<int>& rowIndices,
+                                             const vector<const float*>& colPtrs, const vector<int>& colIndices,
+                                             const bool& symmetric, vector<CaretArray<float> >& outRows, const bool& fisherZ)
+{//output row i is rowIndices[i], which is also the position of that row in colIndices when symmetric is true
+    const int numOutRows = (int)rowIndices.size(), numOutCols = (int)colIndices.size();
+    const int rowLength = getRowLength();
+    const int numRowTiles = (numOutRows + CORR_TILE_SIZE - 1) / CORR_TILE_SIZE, numColTiles = (numOutCols + CORR_TILE_SIZE - 1) / CORR_TILE_SIZE;
+    vector<pair<int, int> > tileList;
+    for (int rowTile = 0; rowTile < numRowTiles; ++rowTile)
+    {
+        for (int colTile = (symmetric ? rowTile : 0); colTile < numColTiles; ++colTile)//when symmetric, only compute the upper triangle of tiles, and store both places
+        {
+            tileList.push_back(pair<int, int>(rowTile, colTile));
+        }
+    }
+    const int numTiles = (int)tileList.size();
+#pragma omp CARET_PAR
+    {
+        vector<double> tileOut(CORR_TILE_SIZE * CORR_TILE_SIZE);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int t = 0; t < numTiles; ++t)
+        {
+            const int rowStart = tileList[t].first * CORR_TILE_SIZE, colStart = tileList[t].second * CORR_TILE_SIZE;
+            const int tileRows = min(CORR_TILE_SIZE, numOutRows - rowStart), tileCols = min(CORR_TILE_SIZE, numOutCols - colStart);
+            const bool mirror = symmetric && tileList[t].first != tileList[t].second;
+            DotBlockKernel::compute(rowPtrs.data() + rowStart, tileRows, colPtrs.data() + colStart, tileCols, rowLength, tileOut.data(), CORR_TILE_SIZE);
+            for (int i = 0; i < tileRows; ++i)
+            {
+                const int outRow = rowStart + i, rowIndex = rowIndices[outRow];
+                for (int j = 0; j < tileCols; ++j)
+                {
+                    const int colIndex = colIndices[colStart + j];
+                    double dotValue = tileOut[i * CORR_TILE_SIZE + j];
+                    if (rowIndex == colIndex && !m_covariance)
+                    {
+                        dotValue = 1.0;//short circuit for same row
+                    }
+                    float value = finishValue(dotValue, fisherZ);
+                    outRows[outRow][colIndex] = value;
+                    if (mirror)
+                    {
+                        outRows[colStart + j][rowIndex] = value;
+                    }
+                }
+            }
+        }
+    }
+}
+
 void AlgorithmCiftiCorrelation::init(const CiftiFile* input, const vector<float>* weights, const bool& noDemean, const bool& covariance)
 {
     m_noDemean = noDemean;
@@ -617,18 +646,25 @@ void AlgorithmCiftiCorrelation::cacheRow(const int& ciftiIndex)
         m_rowCache[m_cacheUsed].m_row.resize(m_numCols);
     }
     m_rowCache[m_cacheUsed].m_ciftiIndex = ciftiIndex;
-    float* myPtr = m_rowCache[m_cacheUsed].m_row.data();
-    m_inputCifti->getRow(myPtr, ciftiIndex);
-    if (!m_rowInfo[ciftiIndex].m_haveCalculated)
-    {
-        computeRowStats(myPtr, m_rowInfo[ciftiIndex].m_mean, m_rowInfo[ciftiIndex].m_rootResidSqr);
-        m_rowInfo[ciftiIndex].m_haveCalculated = true;
-    }
-    doSubtract(myPtr, m_rowInfo[ciftiIndex].m_mean);
+    loadRow(ciftiIndex, m_rowCache[m_cacheUsed].m_row.data());
     m_rowInfo[ciftiIndex].m_cacheIndex = m_cacheUsed;
     ++m_cacheUsed;
 }
 
+void AlgorithmCiftiCorrelation::loadRow(const int& ciftiIndex, float* rowOut)
+{//NOTE: not thread safe, both because of the row info and because of reading from the input
+    CaretAssertVectorIndex(m_rowInfo, ciftiIndex);
+    m_inputCifti->getRow(rowOut, ciftiIndex);
+    RowInfo& myInfo = m_rowInfo[ciftiIndex];
+    if (!myInfo.m_haveCalculated)
+    {
+        computeRowStats(rowOut, myInfo.m_mean, myInfo.m_rootResidSqr);
+        myInfo.m_haveCalculated = true;
+    }
+    doSubtract(rowOut, myInfo.m_mean);
+    doScale(rowOut, myInfo.m_rootResidSqr);
+}
+
 void AlgorithmCiftiCorrelation::clearCache()
 {
     for (int i = 0; i < m_cacheUsed; ++i)
@@ -638,30 +674,24 @@ void AlgorithmCiftiCorrelation::clearCache()
     m_cacheUsed = 0;
 }
 
-const float* AlgorithmCiftiCorrelation::getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached)
+const float* AlgorithmCiftiCorrelation::getCachedRow(const int& ciftiIndex)
 {
-    float* ret;
     CaretAssertVectorIndex(m_rowInfo, ciftiIndex);
-    if (m_rowInfo[ciftiIndex].m_cacheIndex != -1)
+    int cacheIndex = m_rowInfo[ciftiIndex].m_cacheIndex;
+    if (cacheIndex == -1)
     {
-        ret = m_rowCache[m_rowInfo[ciftiIndex].m_cacheIndex].m_row.data();
-    } else {
-        CaretAssert(!mustBeCached);
-        if (mustBeCached)//largely so it doesn't give warning about unused when compiled in release
-        {
-            throw AlgorithmException("something very bad happened, notify the developers");
-        }
-        ret = getTempRow();
-        m_inputCifti->getRow(ret, ciftiIndex);
-        if (!m_rowInfo[ciftiIndex].m_haveCalculated)
-        {
-            computeRowStats(ret, m_rowInfo[ciftiIndex].m_mean, m_rowInfo[ciftiIndex].m_rootResidSqr);
-            m_rowInfo[ciftiIndex].m_haveCalculated = true;
-        }
-        doSubtract(ret, m_rowInfo[ciftiIndex].m_mean);
+        throw AlgorithmException("something very bad happened, notify the developers");
     }
-    rootResidSqr = m_rowInfo[ciftiIndex].m_rootResidSqr;
-    return ret;
+    return m_rowCache[cacheIndex].m_row.data();
+}
+
+int AlgorithmCiftiCorrelation::getRowLength()
+{
+    if (m_weightedMode)
+    {
+        return (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
+    }
+    return m_numCols;
 }
 
 void AlgorithmCiftiCorrelation::computeRowStats(const float* row, float& mean, float& rootResidSqr)
@@ -710,7 +740,7 @@ void AlgorithmCiftiCorrelation::computeRowStats(const float* row, float& mean, f
             {
                 accum += m_weights[i];
             }
-            rootResidSqr = accum;//repurpose this variable to store the weight sum - NOTE: don't take sqrt in case negative sum (whatever that means), so must not divide by both in correlate() in covariance mode
+            rootResidSqr = accum;//repurpose this variable to store the weight sum - NOTE: don't take sqrt in case negative sum (whatever that means), so doScale must not treat it as a root in covariance mode
         }
     } else {
         if (m_weightedMode)
@@ -745,8 +775,7 @@ void AlgorithmCiftiCorrelation::computeRowStats(const float* row, float& mean, f
 
 void AlgorithmCiftiCorrelation::doSubtract(float* row, const float& mean)
 {
-    if (m_noDemean) return;//skip subtracting zero from everything
-    if (m_weightedMode)
+    if (m_weightedMode)//always need to compact the row for weights, even if mean is zero
     {
         int weightsize = (int)m_weightIndexes.size();
         if (m_binaryWeights)
@@ -762,6 +791,7 @@ void AlgorithmCiftiCorrelation::doSubtract(float* row, const float& mean)
             }
         }
     } else {
+        if (m_noDemean) return;//skip subtracting zero from everything
         for (int i = 0; i < m_numCols; ++i)
         {
             row[i] -= mean;
@@ -769,28 +799,26 @@ void AlgorithmCiftiCorrelation::doSubtract(float* row, const float& mean)
     }
 }
 
-float* AlgorithmCiftiCorrelation::getTempRow()
-{
-#ifdef CARET_OMP
-    int oldsize = (int)m_tempRows.size();
-    int threadNum = omp_get_thread_num();
-    if (threadNum >= oldsize)
+void AlgorithmCiftiCorrelation::doScale(float* row, const float& rootResidSqr)
+{//fold the denominator into the rows, so that the blocked dot products give the final value directly
+    const int rowLength = getRowLength();
+    double scale;
+    if (m_covariance)
     {
-        m_tempRows.resize(threadNum + 1);
-        for (int i = oldsize; i <= threadNum; ++i)
+        if (m_weightedMode && !m_binaryWeights && rootResidSqr > 0.0f)//this is actually the weight sum in covariance mode, see computeRowStats
         {
-            m_tempRows[i] = CaretArray<float>(m_numCols);
+            scale = 1.0 / sqrt((double)rootResidSqr);
+        } else {//a sum that isn't positive has no square root, use the count instead, like unweighted covariance
+            scale = 1.0 / sqrt((double)max(rowLength, 1));
         }
+    } else {
+        scale = 1.0 / rootResidSqr;//zero residual gives inf, and 0 * inf gives NaN, like dividing the dot product by zero did
     }
-    return m_tempRows[threadNum].getArray();
-#else
-    if (m_tempRows.size() == 0)
+    const float fscale = scale;
+    for (int i = 0; i < rowLength; ++i)
     {
-        m_tempRows.resize(1);
-        m_tempRows[0] = CaretArray<float>(m_numCols);
+        row[i] *= fscale;
     }
-    return m_tempRows[0].getArray();
-#endif
 }
 
 int AlgorithmCiftiCorrelation::numRowsForMem(const float& memLimitGB, bool& cacheFullInput)
@@ -799,10 +827,11 @@ int AlgorithmCiftiCorrelation::numRowsForMem(const float& memLimitGB, bool& cach
     int inrowBytes = m_numCols * sizeof(float), outrowBytes = numRows * sizeof(float);
     int64_t targetBytes = (int64_t)(memLimitGB * 1024 * 1024 * 1024);
     if (m_inputCifti->isInMemory()) targetBytes -= numRows * m_numCols * 4;//count in-memory input against the total too
+    targetBytes -= (int64_t)inrowBytes * streamBatchRows();//rows read from the file during a pass, when the input isn't fully cached
 #ifdef CARET_OMP
-    targetBytes -= inrowBytes * omp_get_max_threads();
+    targetBytes -= CORR_TILE_SIZE * CORR_TILE_SIZE * sizeof(double) * omp_get_max_threads();//output tile scratch
 #else
-    targetBytes -= inrowBytes;//1 row in memory that isn't a reference to cache
+    targetBytes -= CORR_TILE_SIZE * CORR_TILE_SIZE * sizeof(double);
 #endif
     targetBytes -= numRows * sizeof(RowInfo);//storage for mean, stdev, and info about caching
     int64_t perRowBytes = inrowBytes + outrowBytes;//cache and memory collation for output rows
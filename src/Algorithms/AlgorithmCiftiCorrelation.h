@@ -48,7 +48,6 @@ namespace caret {
         };
         std::vector<CacheRow> m_rowCache;
         std::vector<RowInfo> m_rowInfo;
-        std::vector<CaretArray<float> > m_tempRows;//reuse return values in getRow instead of reallocating
         std::vector<float> m_weights;
         std::vector<int> m_weightIndexes;
         bool m_binaryWeights, m_weightedMode, m_noDemean, m_covariance;
@@ -56,12 +55,18 @@ namespace caret {
         int m_numCols;
         const CiftiFile* m_inputCifti;//so that accesses work through the cache functions
         void cacheRow(const int& ciftiIndex);
+        void loadRow(const int& ciftiIndex, float* rowOut);
         void computeRowStats(const float* row, float& mean, float& rootResidSqr);
         void doSubtract(float* row, const float& mean);
+        void doScale(float* row, const float& rootResidSqr);
         void clearCache();
-        const float* getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached = false);
-        float* getTempRow();
-        float correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ);
+        const float* getCachedRow(const int& ciftiIndex);
+        int getRowLength();
+        float finishValue(const double& dotValue, const bool& fisherZ);
+        void computeChunk(const std::vector<int>& chunkRows, std::vector<CaretArray<float> >& outRows, const bool& fisherZ);
+        void computeTiles(const std::vector<const float*>& rowPtrs, const std::vector<int>& rowIndices,
+                          const std::vector<const float*>& colPtrs, const std::vector<int>& colIndices,
+                          const bool& symmetric, std::vector<CaretArray<float> >& outRows, const bool& fisherZ);
         void init(const CiftiFile* input, const std::vector<float>* weights, const bool& noDemean, const bool& covariance);
         int numRowsForMem(const float& memLimitGB, bool& cacheFullInput);
     protected:
@@ -290,14 +290,7 @@ AlgorithmCiftiCreateDenseScalar::AlgorithmCiftiCreateDenseScalar(ProgressObject*
         }
     }
     vector<CiftiBrainModelsMap::VolumeMap> volMap = myDenseMap.getFullVolumeMap();//we don't need to know which voxel is from which structure
-    for (int64_t i = 0; i < (int)volMap.size(); ++i)
-    {
-        for (int t = 0; t < numMaps; ++t)
-        {
-            temprow[t] = myVol->getValue(volMap[i].m_ijk, t);
-        }
-        myCiftiOut->setRow(temprow, volMap[i].m_ciftiIndex);
-    }
+    AlgorithmCiftiCreateDenseTimeseries::setVolumeRows(myCiftiOut, myVol, volMap, numMaps);
 }
 
 float AlgorithmCiftiCreateDenseScalar::getAlgorithmInternalWeight()
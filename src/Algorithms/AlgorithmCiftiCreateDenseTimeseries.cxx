@@ -30,6 +30,7 @@
 #include "StructureEnum.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <map>
 #include <vector>
 #include <cmath>
@@ -280,13 +281,37 @@ AlgorithmCiftiCreateDenseTimeseries::AlgorithmCiftiCreateDenseTimeseries(Progres
         }
     }
     vector<CiftiBrainModelsMap::VolumeMap> volMap = myDenseMap.getFullVolumeMap();//we don't need to know which voxel is from which structure
-    for (int64_t i = 0; i < (int)volMap.size(); ++i)
+    setVolumeRows(myCiftiOut, myVol, volMap, numMaps);
+}
+
+void AlgorithmCiftiCreateDenseTimeseries::setVolumeRows(CiftiFile* myCiftiOut, const VolumeFile* myVol, const vector<CiftiBrainModelsMap::VolumeMap>& volMap, const int& numMaps)
+{
+    const int64_t numVoxels = (int64_t)volMap.size();
+    if (numVoxels == 0 || numMaps < 1) return;
+    CaretAssert(myVol != NULL);
+    vector<int64_t> frameIndices(numVoxels);
+    for (int64_t i = 0; i < numVoxels; ++i)
+    {
+        frameIndices[i] = myVol->getIndex(volMap[i].m_ijk);
+    }
+    const int64_t BLOCK_FLOATS = 1 << 26;//256MB of scratch at most, a paged volume reads each frame once per block
+    const int64_t blockVoxels = max((int64_t)1, min(numVoxels, BLOCK_FLOATS / numMaps));
+    vector<float> voxelBlock(blockVoxels * numMaps);
+    for (int64_t start = 0; start < numVoxels; start += blockVoxels)
     {
+        const int64_t end = min(numVoxels, start + blockVoxels);
         for (int t = 0; t < numMaps; ++t)
         {
-            temprow[t] = myVol->getValue(volMap[i].m_ijk, t);
+            const float* frame = myVol->getFrame(t);
+            for (int64_t i = start; i < end; ++i)
+            {
+                voxelBlock[(i - start) * numMaps + t] = frame[frameIndices[i]];
+            }
+        }
+        for (int64_t i = start; i < end; ++i)
+        {
+            myCiftiOut->setRow(voxelBlock.data() + (i - start) * numMaps, volMap[i].m_ciftiIndex);
         }
-        myCiftiOut->setRow(temprow, volMap[i].m_ciftiIndex);
     }
 }
 
@@ -27,6 +27,7 @@
 #include "CiftiSeriesMap.h"
 
 #include <map>
+#include <vector>
 
 namespace caret {
     
@@ -59,6 +60,8 @@ namespace caret {
         static CiftiBrainModelsMap makeDenseMapping(const VolumeFile* myVol = NULL,
                                      const VolumeFile* myVolLabel = NULL,
                                      const std::map<StructureEnum::Enum, SurfParam> surfParams = std::map<StructureEnum::Enum, SurfParam>());
+        ///write the rows for voxels, reading each frame of the volume once per block of voxels rather than once per voxel, which matters for paged volumes
+        static void setVolumeRows(CiftiFile* myCiftiOut, const VolumeFile* myVol, const std::vector<CiftiBrainModelsMap::VolumeMap>& volMap, const int& numMaps);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
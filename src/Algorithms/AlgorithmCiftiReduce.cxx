@@ -22,10 +22,13 @@
 #include "AlgorithmException.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "MultiDimIterator.h"
+#include "ReductionAccumulator.h"
 #include "ReductionOperation.h"
 
+#include <algorithm>
 #include <vector>
 
 using namespace caret;
@@ -92,79 +95,144 @@ void AlgorithmCiftiReduce::useParameters(OperationParameters* myParams, Progress
     }
 }
 
-AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const CiftiFile* ciftiIn, const ReductionEnum::Enum& myReduce, CiftiFile* ciftiOut,
-                                           const bool& onlyNumeric, const int& direction) : AbstractAlgorithm(myProgObj)
+namespace
 {
-    LevelProgress myProgress(myProgObj);
-    CaretAssert(direction >= 0);
-    const CiftiXML& inputXML = ciftiIn->getCiftiXML();
-    CiftiXML myOutXML = inputXML;
-    if (direction >= myOutXML.getNumberOfDimensions()) throw AlgorithmException("specified reduction direction doesn't exist in input cifti file");
-    CiftiScalarsMap newMap;
-    newMap.setLength(1);
-    newMap.setMapName(0, ReductionEnum::toName(myReduce));
-    myOutXML.setMap(direction, newMap);
-    ciftiOut->setCiftiXML(myOutXML);
-    vector<int64_t> inDims = inputXML.getDimensions();
-    if (direction == CiftiXML::ALONG_ROW)
+    struct RowReducer
     {
-        if (inDims[0] == 1 && ! ReductionOperation::isLengthOneReasonable(myReduce))
+        ReductionEnum::Enum type;
+        bool onlyNumeric, excludeOutliers;
+        float sigmaBelow, sigmaAbove;
+        
+        float reduce(const float* data, const int64_t& numElems) const
         {
-            CaretLogWarning("-cifti-reduce is being used for a length=1 reduction on file '" + ciftiIn->getFileName() + "'");
+            if (excludeOutliers) return ReductionOperation::reduceExcludeDev(data, numElems, type, sigmaBelow, sigmaAbove);
+            if (onlyNumeric) return ReductionOperation::reduceOnlyNumeric(data, numElems, type);
+            return ReductionOperation::reduce(data, numElems, type);
         }
-        vector<float> scratchInRow(inDims[0]);
-        for (MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end())); !iter.atEnd(); ++iter)
-        {// + 1 to exclude row dimension, because getRow/setRow
-            ciftiIn->getRow(scratchInRow.data(), *iter);
-            float result = -1;
-            if (onlyNumeric)
-            {
-                result = ReductionOperation::reduceOnlyNumeric(scratchInRow.data(), inDims[0], myReduce);
-            } else {
-                result = ReductionOperation::reduce(scratchInRow.data(), inDims[0], myReduce);
-            }
-            ciftiOut->setRow(&result, *iter);//if reducing along row, length of output row is 1
+        
+        bool canAccumulate() const
+        {//outlier exclusion needs the mean and stdev before it can start
+            return !excludeOutliers && ReductionAccumulator::canAccumulate(type);
         }
-    } else {
-        if (inDims[direction] == 1 && ! ReductionOperation::isLengthOneReasonable(myReduce))
-        {
-            CaretLogWarning("-cifti-reduce is being used for a length=1 reduction on file '" + ciftiIn->getFileName() + "'");
-        }
-        vector<vector<float> > scratchInRows(inDims[direction], vector<float>(inDims[0]));
-        vector<float> outRow(inDims[0]), reduceScratch(inDims[direction]);//reduction isn't along row, so out rows will be same length as in rows
-        vector<int64_t> otherDims = inDims;
-        otherDims.erase(otherDims.begin() + direction);//direction isn't 0
-        otherDims.erase(otherDims.begin());//remove row direction because getRow/setRow
-        for (MultiDimIterator<int64_t> iter(otherDims); !iter.atEnd(); ++iter)
+    };
+    
+    //number of rows to read before each parallel pass, the block is kept to tens of megabytes
+    int64_t getRowBlockSize(const int64_t& rowLength)
+    {
+        const int64_t BLOCK_BYTES = 64 << 20;
+        return max((int64_t)1, min((int64_t)1024, BLOCK_BYTES / (max(rowLength, (int64_t)1) * (int64_t)sizeof(float))));
+    }
+    
+    //reduce numVectors contiguous vectors in parallel, an error is rethrown after the loop for the lowest failing vector, as a serial loop would have
+    void reduceContiguous(const RowReducer& reducer, const float* data, const int64_t& numVectors, const int64_t& length, float* resultsOut)
+    {
+        int64_t errorIndex = -1;
+        AString errorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic, 16)
+        for (int64_t i = 0; i < numVectors; ++i)
         {
-            vector<int64_t> indexvec = *iter;
-            indexvec.insert(indexvec.begin() + direction - 1, -1);//dummy value in place of reduce direction
-            for (int64_t i = 0; i < inDims[direction]; ++i)
+            try
             {
-                indexvec[direction - 1] = i;
-                ciftiIn->getRow(scratchInRows[i].data(), indexvec);
+                resultsOut[i] = reducer.reduce(data + i * length, length);
+            } catch (const CaretException& e) {
+#pragma omp critical
+                {
+                    if (errorIndex == -1 || i < errorIndex)
+                    {
+                        errorIndex = i;
+                        errorMessage = e.whatString();
+                    }
+                }
             }
-            for (int64_t i = 0; i < inDims[0]; ++i)
+        }
+        if (errorIndex != -1) throw AlgorithmException(errorMessage);
+    }
+    
+    void reduceCifti(const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const RowReducer& reducer, const int& direction)
+    {
+        vector<int64_t> inDims = ciftiIn->getDimensions();
+        const int64_t rowLength = inDims[0];
+        const int64_t blockSize = getRowBlockSize(rowLength);
+        vector<float> blockData(blockSize * rowLength);
+        if (direction == CiftiXML::ALONG_ROW)
+        {//read a block of rows, then reduce them in parallel
+            vector<float> results(blockSize);
+            vector<vector<int64_t> > blockIndices;
+            MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end()));// + 1 to exclude row dimension, because getRow/setRow
+            while (!iter.atEnd())
             {
-                for (int64_t j = 0; j < inDims[direction]; ++j)
-                {//need reduction input in contiguous array
-                    reduceScratch[j] = scratchInRows[j][i];
+                blockIndices.clear();
+                for (; !iter.atEnd() && (int64_t)blockIndices.size() < blockSize; ++iter)
+                {
+                    ciftiIn->getRow(blockData.data() + blockIndices.size() * rowLength, *iter);
+                    blockIndices.push_back(*iter);
                 }
-                if (onlyNumeric)
+                reduceContiguous(reducer, blockData.data(), (int64_t)blockIndices.size(), rowLength, results.data());
+                for (size_t i = 0; i < blockIndices.size(); ++i)
                 {
-                    outRow[i] = ReductionOperation::reduceOnlyNumeric(reduceScratch.data(), inDims[direction], myReduce);
-                } else {
-                    outRow[i] = ReductionOperation::reduce(reduceScratch.data(), inDims[direction], myReduce);
+                    ciftiOut->setRow(&(results[i]), blockIndices[i]);//if reducing along row, length of output row is 1
                 }
             }
-            indexvec[direction - 1] = 0;//only one element along reduce output direction
-            ciftiOut->setRow(outRow.data(), indexvec);
+        } else {
+            const int64_t reduceLength = inDims[direction];
+            vector<float> outRow(rowLength);//reduction isn't along row, so out rows will be same length as in rows
+            vector<const float*> rowPointers(blockSize);
+            for (int64_t k = 0; k < blockSize; ++k)
+            {
+                rowPointers[k] = blockData.data() + k * rowLength;
+            }
+            vector<int64_t> otherDims = inDims;
+            otherDims.erase(otherDims.begin() + direction);//direction isn't 0
+            otherDims.erase(otherDims.begin());//remove row direction because getRow/setRow
+            for (MultiDimIterator<int64_t> iter(otherDims); !iter.atEnd(); ++iter)
+            {
+                vector<int64_t> indexvec = *iter;
+                indexvec.insert(indexvec.begin() + direction - 1, -1);//dummy value in place of reduce direction
+                if (reducer.canAccumulate())
+                {//stream the rows through per-element accumulators, only one block of rows is in memory
+                    ReductionAccumulator accumulator(reducer.type, rowLength, reducer.onlyNumeric);
+                    for (int64_t blockStart = 0; blockStart < reduceLength; blockStart += blockSize)
+                    {
+                        const int64_t blockCount = min(blockSize, reduceLength - blockStart);
+                        for (int64_t k = 0; k < blockCount; ++k)
+                        {
+                            indexvec[direction - 1] = blockStart + k;
+                            ciftiIn->getRow(blockData.data() + k * rowLength, indexvec);
+                        }
+                        accumulator.addRows(rowPointers.data(), blockCount);
+                    }
+                    accumulator.getResults(outRow.data());
+                } else {//order statistics and outlier exclusion need all values for an output element at once, so transpose the rows as they are read
+                    vector<float> transposed(rowLength * reduceLength);
+                    for (int64_t blockStart = 0; blockStart < reduceLength; blockStart += blockSize)
+                    {
+                        const int64_t blockCount = min(blockSize, reduceLength - blockStart);
+                        for (int64_t k = 0; k < blockCount; ++k)
+                        {
+                            indexvec[direction - 1] = blockStart + k;
+                            ciftiIn->getRow(blockData.data() + k * rowLength, indexvec);
+                        }
+#pragma omp CARET_PARFOR schedule(static)
+                        for (int64_t i = 0; i < rowLength; ++i)
+                        {
+                            float* transposedOut = transposed.data() + i * reduceLength + blockStart;
+                            for (int64_t k = 0; k < blockCount; ++k)
+                            {
+                                transposedOut[k] = blockData[k * rowLength + i];
+                            }
+                        }
+                    }
+                    reduceContiguous(reducer, transposed.data(), rowLength, reduceLength, outRow.data());
+                }
+                indexvec[direction - 1] = 0;//only one element along reduce output direction
+                ciftiOut->setRow(outRow.data(), indexvec);
+            }
         }
     }
 }
 
 AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const CiftiFile* ciftiIn, const ReductionEnum::Enum& myReduce, CiftiFile* ciftiOut,
-                                           const float& sigmaBelow, const float& sigmaAbove, const int& direction) : AbstractAlgorithm(myProgObj)
+                                           const bool& onlyNumeric, const int& direction) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     CaretAssert(direction >= 0);
@@ -177,42 +245,39 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
     myOutXML.setMap(direction, newMap);
     ciftiOut->setCiftiXML(myOutXML);
     vector<int64_t> inDims = inputXML.getDimensions();
-    if (direction == CiftiXML::ALONG_ROW)
+    if (inDims[direction] == 1 && ! ReductionOperation::isLengthOneReasonable(myReduce))
     {
-        vector<float> scratchInRow(inDims[0]);
-        for (MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end())); !iter.atEnd(); ++iter)
-        {// + 1 to exclude row dimension, because getRow/setRow
-            ciftiIn->getRow(scratchInRow.data(), *iter);
-            float result = ReductionOperation::reduceExcludeDev(scratchInRow.data(), inDims[0], myReduce, sigmaBelow, sigmaAbove);
-            ciftiOut->setRow(&result, *iter);//if reducing along row, length of output row is 1
-        }
-    } else {
-        vector<vector<float> > scratchInRows(inDims[direction], vector<float>(inDims[0]));
-        vector<float> outRow(inDims[0]), reduceScratch(inDims[direction]);//reduction isn't along row, so out rows will be same length as in rows
-        vector<int64_t> otherDims = inDims;
-        otherDims.erase(otherDims.begin() + direction);//direction isn't 0
-        otherDims.erase(otherDims.begin());//remove row direction because getRow/setRow
-        for (MultiDimIterator<int64_t> iter(otherDims); !iter.atEnd(); ++iter)
-        {
-            vector<int64_t> indexvec = *iter;
-            indexvec.insert(indexvec.begin() + direction - 1, -1);//dummy value in place of reduce direction
-            for (int64_t i = 0; i < inDims[direction]; ++i)
-            {
-                indexvec[direction - 1] = i;
-                ciftiIn->getRow(scratchInRows[i].data(), indexvec);
-            }
-            for (int64_t i = 0; i < inDims[0]; ++i)
-            {
-                for (int64_t j = 0; j < inDims[direction]; ++j)
-                {//need reduction input in contiguous array
-                    reduceScratch[j] = scratchInRows[j][i];
-                }
-                outRow[i] = ReductionOperation::reduceExcludeDev(reduceScratch.data(), inDims[direction], myReduce, sigmaBelow, sigmaAbove);
-            }
-            indexvec[direction - 1] = 0;//only one element along reduce output direction
-            ciftiOut->setRow(outRow.data(), indexvec);
-        }
+        CaretLogWarning("-cifti-reduce is being used for a length=1 reduction on file '" + ciftiIn->getFileName() + "'");
     }
+    RowReducer myReducer;
+    myReducer.type = myReduce;
+    myReducer.onlyNumeric = onlyNumeric;
+    myReducer.excludeOutliers = false;
+    myReducer.sigmaBelow = 0.0f;
+    myReducer.sigmaAbove = 0.0f;
+    reduceCifti(ciftiIn, ciftiOut, myReducer, direction);
+}
+
+AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const CiftiFile* ciftiIn, const ReductionEnum::Enum& myReduce, CiftiFile* ciftiOut,
+                                           const float& sigmaBelow, const float& sigmaAbove, const int& direction) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    CaretAssert(direction >= 0);
+    const CiftiXML& inputXML = ciftiIn->getCiftiXML();
+    CiftiXML myOutXML = inputXML;
+    if (direction >= myOutXML.getNumberOfDimensions()) throw AlgorithmException("specified reduction direction doesn't exist in input cifti file");
+    CiftiScalarsMap newMap;
+    newMap.setLength(1);
+    newMap.setMapName(0, ReductionEnum::toName(myReduce));
+    myOutXML.setMap(direction, newMap);
+    ciftiOut->setCiftiXML(myOutXML);
+    RowReducer myReducer;
+    myReducer.type = myReduce;
+    myReducer.onlyNumeric = false;
+    myReducer.excludeOutliers = true;
+    myReducer.sigmaBelow = sigmaBelow;
+    myReducer.sigmaAbove = sigmaAbove;
+    reduceCifti(ciftiIn, ciftiOut, myReducer, direction);
 }
 
 float AlgorithmCiftiReduce::getAlgorithmInternalWeight()
@@ -23,6 +23,7 @@
 #include "AlgorithmCiftiSeparate.h"
 #include "AlgorithmException.h"
 #include "CaretLogger.h"
+#include "CaretPerfTrace.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
 #include "GiftiLabelTable.h"
@@ -450,6 +451,7 @@ void AlgorithmCiftiReplaceStructure::useParameters(OperationParameters* myParams
 AlgorithmCiftiReplaceStructure::AlgorithmCiftiReplaceStructure(ProgressObject* myProgObj, CiftiFile* ciftiInOut, const int myDir,
                                                                const StructureEnum::Enum myStruct, const MetricFile* metricIn) : AbstractAlgorithm(myProgObj)
 {
+    CARET_PERF_SCOPE("cifti replace structure");
     LevelProgress myProgress(myProgObj);
     const CiftiXML& myXML = ciftiInOut->getCiftiXML();
     if (myXML.getNumberOfDimensions() != 2) throw AlgorithmException("replace structure only supported on 2D cifti");
@@ -510,6 +512,7 @@ AlgorithmCiftiReplaceStructure::AlgorithmCiftiReplaceStructure(ProgressObject* m
                                                                const StructureEnum::Enum myStruct, const LabelFile* labelIn,
                                                                const bool discardUnusedLabels, const bool errorOnLabelConflict) : AbstractAlgorithm(myProgObj)
 {
+    CARET_PERF_SCOPE("cifti replace structure");
     LevelProgress myProgress(myProgObj);
     const CiftiXML& myXML = ciftiInOut->getCiftiXML();
     if (myXML.getNumberOfDimensions() != 2) throw AlgorithmException("replace structure only supported on 2D cifti");
@@ -661,6 +664,7 @@ AlgorithmCiftiReplaceStructure::AlgorithmCiftiReplaceStructure(ProgressObject* m
                                                                const StructureEnum::Enum myStruct, const VolumeFile* volIn, const bool fromCropped,
                                                                const bool discardUnusedLabels, const bool errorOnLabelConflict) : AbstractAlgorithm(myProgObj)
 {
+    CARET_PERF_SCOPE("cifti replace structure");
     const CiftiXML& myXML = ciftiInOut->getCiftiXML();
     if (myDir != CiftiXML::ALONG_ROW && myDir != CiftiXML::ALONG_COLUMN) throw AlgorithmException("direction not supported in cifti replace structure");
     if (myXML.getNumberOfDimensions() != 2) throw AlgorithmException("replace structure only supported on 2D cifti");
@@ -847,6 +851,7 @@ AlgorithmCiftiReplaceStructure::AlgorithmCiftiReplaceStructure(ProgressObject* m
                                                                const VolumeFile* volIn, const bool fromCropped,
                                                                const bool discardUnusedLabels, const bool errorOnLabelConflict): AbstractAlgorithm(myProgObj)
 {
+    CARET_PERF_SCOPE("cifti replace structure");
     const CiftiXML& myXML = ciftiInOut->getCiftiXML();
     if (myXML.getNumberOfDimensions() != 2) throw AlgorithmException("replace structure only supported on 2D cifti");
     LevelProgress myProgress(myProgObj);
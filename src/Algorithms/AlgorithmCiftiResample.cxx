@@ -29,6 +29,7 @@
 #include "AlgorithmMetricResample.h"
 #include "AlgorithmVolumeAffineResample.h"
 #include "AlgorithmVolumeWarpfieldResample.h"
+#include "CaretPerfTrace.h"
 #include "CiftiFile.h"
 #include "LabelFile.h"
 #include "MetricFile.h"
@@ -1076,6 +1077,7 @@ void AlgorithmCiftiResample::processSurfaceComponent(const CiftiFile* myCiftiIn,
                                                      const MetricFile* curAreas, const MetricFile* newAreas,
                                                      const AlgorithmMetricDilate::Method& surfDilateMethod, const float& surfDilateExponent, const bool surfLegacyCutoff)
 {
+    CARET_PERF_SCOPE("cifti resample surface structure");
     const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
     if (myInputXML.getMappingType(1 - direction) == CiftiMappingType::LABELS)
     {
@@ -1136,6 +1138,7 @@ void AlgorithmCiftiResample::processVolume(const CiftiFile* myCiftiIn, const int
                                                     CiftiFile* myCiftiOut, const float& voldilatemm, const VolumeFile* warpfield, const FloatMatrix* affine,
                                                     const AlgorithmVolumeDilate::Method& volDilateMethod, const float& volDilateExponent, const bool volLegacyCutoff)
 {
+    CARET_PERF_SCOPE("cifti resample volume structure");
     VolumeFile origData, origDilate, origROI, ROIDilate, *origProcess, *ROIProcess;
     origProcess = &origData;
     ROIProcess = &origROI;
@@ -21,6 +21,7 @@
 #include "AlgorithmCiftiSeparate.h"
 #include "AlgorithmException.h"
 #include "CaretLogger.h"
+#include "CaretPerfTrace.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
 #include "GiftiLabelTable.h"
@@ -201,6 +202,7 @@ void AlgorithmCiftiSeparate::useParameters(OperationParameters* myParams, Progre
 AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const CiftiFile* ciftiIn, const int& myDir,
                                                const StructureEnum::Enum& myStruct, MetricFile* metricOut, MetricFile* roiOut) : AbstractAlgorithm(myProgObj)
 {
+    CARET_PERF_SCOPE("cifti separate");
     LevelProgress myProgress(myProgObj);
     const CiftiXML& myXML = ciftiIn->getCiftiXML();
     if (myXML.getNumberOfDimensions() != 2) throw AlgorithmException("cifti separate only supported on 2D cifti");
@@ -292,6 +294,7 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
 AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const CiftiFile* ciftiIn, const int& myDir,
                                                const StructureEnum::Enum& myStruct, LabelFile* labelOut, MetricFile* roiOut) : AbstractAlgorithm(myProgObj)
 {
+    CARET_PERF_SCOPE("cifti separate");
     LevelProgress myProgress(myProgObj);
     const CiftiXML& myXML = ciftiIn->getCiftiXML();
     if (myXML.getNumberOfDimensions() != 2) throw AlgorithmException("cifti separate only supported on 2D cifti");
@@ -430,6 +433,7 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
                                                const StructureEnum::Enum& myStruct, VolumeFile* volOut, int64_t offsetOut[3],
                                                VolumeFile* roiOut, const bool& cropVol) : AbstractAlgorithm(myProgObj)
 {
+    CARET_PERF_SCOPE("cifti separate");
     LevelProgress myProgress(myProgObj);
     const CiftiXML& myXML = ciftiIn->getCiftiXML();
     if (myXML.getNumberOfDimensions() != 2) throw AlgorithmException("cifti separate only supported on 2D cifti");
@@ -530,6 +534,7 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
 AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const CiftiFile* ciftiIn, const int& myDir, VolumeFile* volOut, int64_t offsetOut[3],
                                                VolumeFile* roiOut, const bool& cropVol, VolumeFile* labelOut): AbstractAlgorithm(myProgObj)
 {
+    CARET_PERF_SCOPE("cifti separate");
     LevelProgress myProgress(myProgObj);
     const CiftiXML& myXML = ciftiIn->getCiftiXML();
     if (myXML.getNumberOfDimensions() != 2) throw AlgorithmException("cifti separate only supported on 2D cifti");
@@ -27,13 +27,154 @@
 #include "VolumeFile.h"
 #include "SurfaceFile.h"
 #include "AlgorithmCiftiSeparate.h"
-#include "AlgorithmCiftiReplaceStructure.h"
+#include "CaretAssert.h"
+#include "CaretPointer.h"
+#include "CiftiBrainModelsMap.h"
+#include "MetricSmoothingObject.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    //how many maps to have in memory per structure, dconn rows are read this many at a time
+    const int MAP_BLOCK_SIZE = 4 * MetricSmoothingObject::COLUMN_BLOCK_SIZE;
+    
+    struct SurfaceStructInfo
+    {
+        vector<int64_t> ciftiIndices, targets;//targets are vertex numbers
+        int32_t numNodes;
+        CaretPointer<MetricFile> roi;
+        CaretPointer<MetricSmoothingObject> smoother;
+    };
+    
+    struct VolumeStructInfo
+    {
+        vector<int64_t> ciftiIndices, targets;//targets are frame indices within the cropped volume
+        int64_t dims[3];
+        vector<vector<float> > sform;
+        CaretPointer<VolumeFile> roi;
+    };
+    
+    void initVolumeInfo(VolumeStructInfo& info, const vector<CiftiBrainModelsMap::VolumeMap>& myMap, const int64_t offset[3], const vector<float>& roiData)
+    {
+        vector<int64_t> newdims(info.dims, info.dims + 3);
+        info.roi.grabNew(new VolumeFile(newdims, info.sform));
+        info.roi->setValueAllVoxels(0.0f);
+        for (int64_t i = 0; i < (int64_t)myMap.size(); ++i)
+        {
+            int64_t thisvoxel[3] = { myMap[i].m_ijk[0] - offset[0], myMap[i].m_ijk[1] - offset[1], myMap[i].m_ijk[2] - offset[2] };
+            info.ciftiIndices.push_back(myMap[i].m_ciftiIndex);
+            info.targets.push_back(info.roi->getIndex(thisvoxel));
+            info.roi->setValue((roiData.empty() ? 1.0f : roiData[myMap[i].m_ciftiIndex]), thisvoxel);
+        }
+    }
+    
+    //value of member k in map m is dataIn[memberOffsets[k] + m * mapStride], same layout for dataOut
+    void smoothSurfaceMaps(const SurfaceStructInfo& info, const float* dataIn, float* dataOut, const vector<int64_t>& memberOffsets, const int64_t& mapStride,
+                           const int& numMaps, const float& kernel, const bool& fixZeros)
+    {
+        int64_t numMembers = (int64_t)info.targets.size();
+        if (!(kernel > 0.0f))
+        {
+            for (int m = 0; m < numMaps; ++m)
+            {
+                for (int64_t k = 0; k < numMembers; ++k)
+                {
+                    dataOut[memberOffsets[k] + m * mapStride] = dataIn[memberOffsets[k] + m * mapStride];
+                }
+            }
+            return;
+        }
+        MetricFile metricIn, metricOut;
+        metricIn.setNumberOfNodesAndColumns(info.numNodes, numMaps);
+        metricOut.setNumberOfNodesAndColumns(info.numNodes, numMaps);
+        vector<float> scratch(info.numNodes, 0.0f);
+        for (int m = 0; m < numMaps; ++m)
+        {
+            for (int64_t k = 0; k < numMembers; ++k)
+            {
+                scratch[info.targets[k]] = dataIn[memberOffsets[k] + m * mapStride];
+            }
+            metricIn.setValuesForColumn(m, scratch.data());
+        }
+        info.smoother->smoothColumns(&metricIn, 0, numMaps, &metricOut, info.roi, 0, fixZeros);
+        for (int m = 0; m < numMaps; ++m)
+        {
+            const float* outCol = metricOut.getValuePointerForColumn(m);
+            for (int64_t k = 0; k < numMembers; ++k)
+            {
+                dataOut[memberOffsets[k] + m * mapStride] = outCol[info.targets[k]];
+            }
+        }
+    }
+    
+    void smoothVolumeMaps(const VolumeStructInfo& info, const float* dataIn, float* dataOut, const vector<int64_t>& memberOffsets, const int64_t& mapStride,
+                          const int& numMaps, const float& kernel, const bool& fixZeros)
+    {
+        int64_t numMembers = (int64_t)info.targets.size();
+        if (!(kernel > 0.0f))
+        {
+            for (int m = 0; m < numMaps; ++m)
+            {
+                for (int64_t k = 0; k < numMembers; ++k)
+                {
+                    dataOut[memberOffsets[k] + m * mapStride] = dataIn[memberOffsets[k] + m * mapStride];
+                }
+            }
+            return;
+        }
+        vector<int64_t> newdims(info.dims, info.dims + 3);
+        if (numMaps > 1) newdims.push_back(numMaps);
+        VolumeFile volIn(newdims, info.sform), volOut;
+        vector<float> scratch(info.dims[0] * info.dims[1] * info.dims[2], 0.0f);
+        for (int m = 0; m < numMaps; ++m)
+        {
+            for (int64_t k = 0; k < numMembers; ++k)
+            {
+                scratch[info.targets[k]] = dataIn[memberOffsets[k] + m * mapStride];
+            }
+            volIn.setFrame(scratch.data(), m);
+        }
+        AlgorithmVolumeSmoothing(NULL, &volIn, kernel, &volOut, info.roi, fixZeros);
+        for (int m = 0; m < numMaps; ++m)
+        {
+            const float* outFrame = volOut.getFrame(m);
+            for (int64_t k = 0; k < numMembers; ++k)
+            {
+                dataOut[memberOffsets[k] + m * mapStride] = outFrame[info.targets[k]];
+            }
+        }
+    }
+    
+    //for brainordinates down the column, only the rows of one structure need to be in memory
+    template<typename T>
+    void smoothStructureRows(const T& info, const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const int64_t& rowSize, const float& kernel, const bool& fixZeros,
+                             void (*smoothFunc)(const T&, const float*, float*, const vector<int64_t>&, const int64_t&, const int&, const float&, const bool&))
+    {
+        int64_t numMembers = (int64_t)info.ciftiIndices.size();
+        vector<float> inRows(numMembers * rowSize), outRows(numMembers * rowSize);
+        vector<int64_t> memberOffsets(numMembers);
+        for (int64_t k = 0; k < numMembers; ++k)
+        {
+            memberOffsets[k] = k * rowSize;
+            ciftiIn->getRow(inRows.data() + k * rowSize, info.ciftiIndices[k]);
+        }
+        for (int64_t firstMap = 0; firstMap < rowSize; firstMap += MAP_BLOCK_SIZE)
+        {
+            int blockCount = (int)min((int64_t)MAP_BLOCK_SIZE, rowSize - firstMap);
+            smoothFunc(info, inRows.data() + firstMap, outRows.data() + firstMap, memberOffsets, 1, blockCount, kernel, fixZeros);
+        }
+        for (int64_t k = 0; k < numMembers; ++k)
+        {
+            ciftiOut->setRow(outRows.data() + k * rowSize, info.ciftiIndices[k]);
+        }
+    }
+}
+
 AString AlgorithmCiftiSmoothing::getCommandSwitch()
 {
     return "-cifti-smoothing";
@@ -263,59 +404,93 @@ AlgorithmCiftiSmoothing::AlgorithmCiftiSmoothing(ProgressObject* myProgObj, cons
         }
     }
     myCiftiOut->setCiftiXML(myXML);
+    const CiftiBrainModelsMap& myBrainMap = myCifti->getCiftiXML().getBrainModelsMap(myDir);
+    vector<float> roiData;
+    if (roiCifti != NULL)
+    {//the roi only uses its first map, and we know its brain models match
+        roiData.resize(roiCifti->getNumberOfRows());
+        roiCifti->getColumn(roiData.data(), 0);
+    }
+    vector<SurfaceStructInfo> surfInfo(surfaceList.size());
     for (int whichStruct = 0; whichStruct < (int)surfaceList.size(); ++whichStruct)
     {
         auto result = surfParams.find(surfaceList[whichStruct]);
         CaretAssert(result != surfParams.end()); //we already checked that these are all present, but assert anyway
         const SurfaceFile* mySurf = result->second.surface;
         const MetricFile* myAreas = result->second.correctedAreas;
-        MetricFile myMetric, myRoi, myMetricOut;
-        AlgorithmCiftiSeparate(NULL, myCifti, myDir, surfaceList[whichStruct], &myMetric, &myRoi);
-        if (surfKern > 0.0f)
+        SurfaceStructInfo& thisInfo = surfInfo[whichStruct];
+        vector<CiftiBrainModelsMap::SurfaceMap> myMap = myBrainMap.getSurfaceMap(surfaceList[whichStruct]);
+        thisInfo.numNodes = mySurf->getNumberOfNodes();
+        for (int64_t i = 0; i < (int64_t)myMap.size(); ++i)
         {
-            if (roiCifti != NULL)
-            {//due to above testing, we know the structure mask is the same, so just overwrite the ROI from the mask
-                AlgorithmCiftiSeparate(NULL, roiCifti, CiftiXMLOld::ALONG_COLUMN, surfaceList[whichStruct], &myRoi);
+            thisInfo.ciftiIndices.push_back(myMap[i].m_ciftiIndex);
+            thisInfo.targets.push_back(myMap[i].m_surfaceNode);
+        }
+        if (surfKern > 0.0f)
+        {//build the smoothing weights once per structure, instead of once per separated metric
+            thisInfo.roi.grabNew(new MetricFile());
+            thisInfo.roi->setNumberOfNodesAndColumns(thisInfo.numNodes, 1);
+            thisInfo.roi->initializeColumn(0, 0.0f);
+            for (int64_t i = 0; i < (int64_t)myMap.size(); ++i)
+            {
+                thisInfo.roi->setValue(myMap[i].m_surfaceNode, 0, (roiCifti != NULL ? roiData[myMap[i].m_ciftiIndex] : 1.0f));
             }
-            AlgorithmMetricSmoothing(NULL, mySurf, &myMetric, surfKern, &myMetricOut, &myRoi, false, fixZerosSurf, -1, myAreas);
-            AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, surfaceList[whichStruct], &myMetricOut);
-        } else {
-            AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, surfaceList[whichStruct], &myMetric);
+            const float* areaData = NULL;
+            if (myAreas != NULL) areaData = myAreas->getValuePointerForColumn(0);
+            thisInfo.smoother.grabNew(new MetricSmoothingObject(mySurf, surfKern, thisInfo.roi, MetricSmoothingObject::GEO_GAUSS_AREA, areaData));
         }
     }
+    vector<VolumeStructInfo> volInfo;
     if (mergedVolume)
     {
-        VolumeFile myVol, myRoi, myVolOut;
-        int64_t offset[3];
-        AlgorithmCiftiSeparate(NULL, myCifti, myDir, &myVol, offset, &myRoi, true);
-        if (volKern > 0.0f)
+        if (!volumeList.empty())
         {
-            if (roiCifti != NULL)
-            {//due to above testing, we know the structure mask is the same, so just overwrite the ROI from the mask
-                AlgorithmCiftiSeparate(NULL, roiCifti, CiftiXMLOld::ALONG_COLUMN, &myRoi, offset, NULL, true);
-            }
-            AlgorithmVolumeSmoothing(NULL, &myVol, volKern, &myVolOut, &myRoi, fixZerosVol);
-            AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, &myVolOut, true);
-        } else {
-            AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, &myVol, true);
+            volInfo.resize(1);
+            int64_t offset[3];
+            AlgorithmCiftiSeparate::getCroppedVolSpaceAll(myCifti, myDir, volInfo[0].dims, volInfo[0].sform, offset);
+            initVolumeInfo(volInfo[0], myBrainMap.getFullVolumeMap(), offset, roiData);
         }
     } else {
+        volInfo.resize(volumeList.size());
         for (int whichStruct = 0; whichStruct < (int)volumeList.size(); ++whichStruct)
         {
-            VolumeFile myVol, myRoi, myVolOut;
             int64_t offset[3];
-            AlgorithmCiftiSeparate(NULL, myCifti, myDir, volumeList[whichStruct], &myVol, offset, &myRoi, true);
-            if (volKern > 0.0f)
+            AlgorithmCiftiSeparate::getCroppedVolSpace(myCifti, myDir, volumeList[whichStruct], volInfo[whichStruct].dims, volInfo[whichStruct].sform, offset);
+            initVolumeInfo(volInfo[whichStruct], myBrainMap.getVolumeStructureMap(volumeList[whichStruct]), offset, roiData);
+        }
+    }
+    const int64_t numRows = myCifti->getNumberOfRows(), rowSize = myCifti->getNumberOfColumns();
+    if (myDir == CiftiXMLOld::ALONG_ROW)
+    {//each row is a map, so read a block of rows, smooth every structure, and write the block out
+        vector<float> inBlock(MAP_BLOCK_SIZE * rowSize), outBlock(MAP_BLOCK_SIZE * rowSize, 0.0f);
+        for (int64_t firstRow = 0; firstRow < numRows; firstRow += MAP_BLOCK_SIZE)
+        {
+            int blockCount = (int)min((int64_t)MAP_BLOCK_SIZE, numRows - firstRow);
+            for (int i = 0; i < blockCount; ++i)
             {
-                if (roiCifti != NULL)
-                {//due to above testing, we know the structure mask is the same, so just overwrite the ROI from the mask
-                    AlgorithmCiftiSeparate(NULL, roiCifti, CiftiXMLOld::ALONG_COLUMN, volumeList[whichStruct], &myRoi, offset, NULL, true);
-                }
-                AlgorithmVolumeSmoothing(NULL, &myVol, volKern, &myVolOut, &myRoi, fixZerosVol);
-                AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, volumeList[whichStruct], &myVolOut, true);
-            } else {
-                AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, volumeList[whichStruct], &myVol, true);
+                myCifti->getRow(inBlock.data() + i * rowSize, firstRow + i);
             }
+            for (int whichStruct = 0; whichStruct < (int)surfInfo.size(); ++whichStruct)
+            {
+                smoothSurfaceMaps(surfInfo[whichStruct], inBlock.data(), outBlock.data(), surfInfo[whichStruct].ciftiIndices, rowSize, blockCount, surfKern, fixZerosSurf);
+            }
+            for (int whichStruct = 0; whichStruct < (int)volInfo.size(); ++whichStruct)
+            {
+                smoothVolumeMaps(volInfo[whichStruct], inBlock.data(), outBlock.data(), volInfo[whichStruct].ciftiIndices, rowSize, blockCount, volKern, fixZerosVol);
+            }
+            for (int i = 0; i < blockCount; ++i)
+            {
+                myCiftiOut->setRow(outBlock.data() + i * rowSize, firstRow + i);
+            }
+        }
+    } else {//each row is a brainordinate, so read only the rows of one structure at a time, and smooth them a block of maps at a time
+        for (int whichStruct = 0; whichStruct < (int)surfInfo.size(); ++whichStruct)
+        {
+            smoothStructureRows(surfInfo[whichStruct], myCifti, myCiftiOut, rowSize, surfKern, fixZerosSurf, smoothSurfaceMaps);
+        }
+        for (int whichStruct = 0; whichStruct < (int)volInfo.size(); ++whichStruct)
+        {
+            smoothStructureRows(volInfo[whichStruct], myCifti, myCiftiOut, rowSize, volKern, fixZerosVol, smoothVolumeMaps);
         }
     }
 }
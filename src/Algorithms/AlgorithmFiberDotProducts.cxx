@@ -123,7 +123,7 @@ AlgorithmFiberDotProducts::AlgorithmFiberDotProducts(ProgressObject* myProgObj,
         }
     }
     if (coordIndices.size() == 0) throw AlgorithmException("no fiber samples passed the <max-dist> and <direction> tests");
-    CaretPointLocator myLocator(coordsInside.data(), coordIndices.size());//build the locator
+    CaretPointLocator myLocator(coordsInside.data(), coordIndices.size(), CaretPointLocator::STATIC_TREE);//build the locator
     int numNodes = mySurf->getNumberOfNodes();
     myDotProdOut->setNumberOfNodesAndColumns(numNodes, numFibers);
     myFSampOut->setNumberOfNodesAndColumns(numNodes, numFibers);
@@ -162,8 +162,8 @@ AlgorithmLabelToVolumeMapping::AlgorithmLabelToVolumeMapping(ProgressObject* myP
     myVolOut->reinitialize(myVolSpace, numCols, 1, SubvolumeAttributes::LABEL);
     const int64_t* dims = myVolSpace.getDims();
     const int64_t frameSize = dims[0] * dims[1] * dims[2];
-    vector<int32_t> voxelToVertex(frameSize);
-    CaretPointer<const CaretPointLocator> myLocator = mySurf->getPointLocator();
+    vector<int64_t> voxelToVertex(frameSize);
+    vector<float> voxelCoords(frameSize * 3);
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int64_t k = 0; k < dims[2]; ++k)
     {
@@ -171,12 +171,12 @@ AlgorithmLabelToVolumeMapping::AlgorithmLabelToVolumeMapping(ProgressObject* myP
         {
             for (int64_t i = 0; i < dims[0]; ++i)
             {
-                float voxelCoord[3];
-                myVolSpace.indexToSpace(i, j, k, voxelCoord);
-                voxelToVertex[myVolSpace.getIndex(i, j, k)] = myLocator->closestPointLimited(voxelCoord, nearDist);
+                myVolSpace.indexToSpace(i, j, k, voxelCoords.data() + myVolSpace.getIndex(i, j, k) * 3);
             }
         }
     }
+    mySurf->getPointLocator()->closestPoints(voxelCoords.data(), frameSize, voxelToVertex.data(), nearDist);
+    vector<float>().swap(voxelCoords);
     vector<float> scratchFrame(frameSize, 0.0f);
     for (int i = 0; i < numCols; ++i)
     {
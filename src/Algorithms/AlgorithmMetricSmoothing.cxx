@@ -28,6 +28,7 @@
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -210,16 +211,25 @@ AlgorithmMetricSmoothing::AlgorithmMetricSmoothing(ProgressObject* myProgObj, co
         myMetricOut->setStructure(mySurf->getStructure());
         for (int32_t col = 0; col < numCols; ++col)
         {
-            myProgress.setTask("Smoothing Column " + AString::number(col));
             myMetricOut->setColumnName(col, myMetric->getColumnName(col) + ", smooth " + AString::number(myKernel));
             *(myMetricOut->getPaletteColorMapping(col)) = *(myMetric->getPaletteColorMapping(col));//copy the palette settings
-            if (myRoi != NULL && matchRoiColumns)
+        }
+        if (myRoi != NULL && matchRoiColumns)
+        {
+            for (int32_t col = 0; col < numCols; ++col)
             {
+                myProgress.setTask("Smoothing Column " + AString::number(col));
                 mySmoothObj->smoothColumn(myMetric, col, myMetricOut, col, myRoi, col, fixZeros);
-            } else {
-                mySmoothObj->smoothColumn(myMetric, col, myMetricOut, col, myRoi, 0, fixZeros);
+                myProgress.reportProgress(precomputeWeightWork + ((float)col + 1) / numCols);
+            }
+        } else {//the roi is the same for every column, so smooth several columns at once
+            for (int32_t col = 0; col < numCols; col += MetricSmoothingObject::COLUMN_BLOCK_SIZE)
+            {
+                int32_t blockCount = min((int32_t)MetricSmoothingObject::COLUMN_BLOCK_SIZE, numCols - col);
+                myProgress.setTask("Smoothing Columns " + AString::number(col) + " to " + AString::number(col + blockCount - 1));
+                mySmoothObj->smoothColumns(myMetric, col, blockCount, myMetricOut, myRoi, 0, fixZeros);
+                myProgress.reportProgress(precomputeWeightWork + ((float)col + blockCount) / numCols);
             }
-            myProgress.reportProgress(precomputeWeightWork + ((float)col + 1) / numCols);
         }
     } else {
         myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
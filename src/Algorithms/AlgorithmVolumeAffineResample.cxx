@@ -22,6 +22,7 @@
 #include "AffineFile.h"
 #include "AlgorithmException.h"
 #include "CaretLogger.h"
+#include "CaretPerfTrace.h"
 #include "CaretOMP.h"
 #include "NiftiIO.h"
 #include "Vector3D.h"
@@ -104,6 +105,7 @@ void AlgorithmVolumeAffineResample::useParameters(OperationParameters* myParams,
 AlgorithmVolumeAffineResample::AlgorithmVolumeAffineResample(ProgressObject* myProgObj, const VolumeFile* inVol, const FloatMatrix& myAffine,
                                                              const int64_t refDims[3], const vector<vector<float> >& refSform, const VolumeFile::InterpType& myMethod, VolumeFile* outVol) : AbstractAlgorithm(myProgObj)
 {
+    CARET_PERF_SCOPE("volume resample");
     LevelProgress myProgress(myProgObj);
     int64_t affRows, affColumns;
     myAffine.getDimensions(affRows, affColumns);
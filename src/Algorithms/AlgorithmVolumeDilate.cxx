@@ -256,7 +256,7 @@ namespace
         }
         if (!toReplace.empty())
         {
-            CaretPointLocator locator(validPoints);
+            CaretPointLocator locator(validPoints, CaretPointLocator::STATIC_TREE);
 #pragma omp CARET_PARFOR schedule(dynamic)
             for (int64_t whichVoxel = 0; whichVoxel < (int64_t)toReplace.size(); ++whichVoxel)
             {
@@ -140,7 +140,7 @@ namespace
                 }
             }
         }
-        CaretPointLocator myLocator(coordList.data(), coordList.size() / 3);
+        CaretPointLocator myLocator(coordList.data(), coordList.size() / 3, CaretPointLocator::STATIC_TREE);
         for (int64_t k = 0; k < myDims[2]; ++k)
         {
             for (int64_t j = 0; j < myDims[1]; ++j)
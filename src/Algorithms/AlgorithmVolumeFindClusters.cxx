@@ -235,7 +235,7 @@ namespace
                     biggestCoords.push_back(thisCoord[1]);
                     biggestCoords.push_back(thisCoord[2]);
                 }
-                myLocator.grabNew(new CaretPointLocator(biggestCoords.data(), biggestCoords.size()));
+                myLocator.grabNew(new CaretPointLocator(biggestCoords.data(), biggestCoords.size() / 3, CaretPointLocator::STATIC_TREE));
             }
             for (size_t i = 0; i < clusters.size(); ++i)
             {
@@ -185,7 +185,7 @@ AlgorithmVolumeGradient::AlgorithmVolumeGradient(ProgressObject* myProgObj, cons
                             Vector3D gradient;
                             if (myRoi == NULL || myRoi->getValue(i, j, k) > 0.0f)
                             {
-                                float curval = processVol->getValue(i, j, k, s, c);
+                                float curval = inFrame[volIn->getIndex(i, j, k)];
                                 FloatMatrix regress = FloatMatrix::zeros(4, 5);
                                 regress[3][3] = 1;//count the center voxel in case neighbors are missing (displacement and valdiff are zero, cancelling all other terms)
                                 int dircheck = 0;
@@ -430,7 +430,7 @@ AlgorithmVolumeGradient::AlgorithmVolumeGradient(ProgressObject* myProgObj, cons
                         Vector3D gradient;
                         if (myRoi == NULL || myRoi->getValue(i, j, k) > 0.0f)
                         {
-                            float curval = processVol->getValue(i, j, k, useSubvol, c);
+                            float curval = inFrame[volIn->getIndex(i, j, k)];
                             FloatMatrix regress = FloatMatrix::zeros(4, 5);
                             regress[3][3] = 1;//count the center voxel in case neighbors are missing (displacement and valdiff are zero, cancelling all other terms)
                             int dircheck = 0;
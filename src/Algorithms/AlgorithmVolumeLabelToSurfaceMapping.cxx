@@ -247,6 +247,7 @@ AlgorithmVolumeLabelToSurfaceMapping::AlgorithmVolumeLabelToSurfaceMapping(Progr
                 frameRemap = cumulativeTable.append(*tempTable);
             }
             myLabelOut->setColumnName(i, myVolume->getMapName(i));
+            const float* frame = myVolume->getFrame(i);//one frame per loop, so paged volumes don't lock per voxel
 #pragma omp CARET_PARFOR
             for (int64_t node = 0; node < numNodes; ++node)
             {
@@ -254,7 +255,7 @@ AlgorithmVolumeLabelToSurfaceMapping::AlgorithmVolumeLabelToSurfaceMapping(Progr
                 map<int32_t, float> totals;
                 for (int v = 0; v < (int)weightRef.size(); ++v)
                 {
-                    int32_t voxKey = (int32_t)floor(myVolume->getValue(weightRef[v].ijk, i) + 0.5f);
+                    int32_t voxKey = (int32_t)floor(frame[myVolume->getIndex(weightRef[v].ijk)] + 0.5f);
                     map<int32_t, float>::iterator iter = totals.find(voxKey);
                     if (iter == totals.end())
                     {//floats don't initialize to 0
@@ -293,6 +294,7 @@ AlgorithmVolumeLabelToSurfaceMapping::AlgorithmVolumeLabelToSurfaceMapping(Progr
         }
         *(myLabelOut->getLabelTable()) = *tempTable;
         myLabelOut->setColumnName(0, myVolume->getMapName(mySubVol));
+        const float* frame = myVolume->getFrame(mySubVol);
 #pragma omp CARET_PARFOR
         for (int64_t node = 0; node < numNodes; ++node)
         {//for simplicity, assume all values in the volume file are in the label table
@@ -300,7 +302,7 @@ AlgorithmVolumeLabelToSurfaceMapping::AlgorithmVolumeLabelToSurfaceMapping(Progr
             map<int32_t, float> totals;
             for (int v = 0; v < (int)weightRef.size(); ++v)
             {
-                int32_t voxKey = (int32_t)floor(myVolume->getValue(weightRef[v].ijk, mySubVol) + 0.5f);
+                int32_t voxKey = (int32_t)floor(frame[myVolume->getIndex(weightRef[v].ijk)] + 0.5f);
                 map<int32_t, float>::iterator iter = totals.find(voxKey);
                 if (iter == totals.end())
                 {//floats don't initialize to 0
@@ -25,11 +25,13 @@
 
 namespace caret {
     
+    class TfceMergeTree;
+    
     class AlgorithmVolumeTFCE : public AbstractAlgorithm
     {
         AlgorithmVolumeTFCE();
-        void processFrame(const VolumeFile* inVol, const int64_t& b, const int64_t& c, float* outData, const float* roiData, const float& param_e, const float& param_h);
-        void tfce(const VolumeFile* inVol, const int64_t& b, const int64_t& c, double* accumData, const float* roiData, const float& param_e, const float& param_h, const bool& negate);
+        void processFrames(const VolumeFile* inVol, const int64_t& firstSubvol, const int64_t& numSubvols, VolumeFile* outVol,
+                           const float* roiData, const TfceMergeTree& myTree, const float& param_e, const float& param_h);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
@@ -23,6 +23,7 @@
 
 #include "CaretAssert.h"
 #include "CaretOMP.h"
+#include "CaretPerfTrace.h"
 #include "FloatMatrix.h"
 #include "MathFunctions.h"
 #include "MetricFile.h"
@@ -35,12 +36,18 @@
 #include "AlgorithmSurfaceToSurface3dDistance.h"
 #include "AlgorithmCreateSignedDistanceVolume.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int FRAME_BLOCK_SIZE = 16;//frames mapped together by the precomputed weight methods
+}
+
 AString AlgorithmVolumeToSurfaceMapping::getCommandSwitch()
 {
     return "-volume-to-surface-mapping";
@@ -465,85 +472,26 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
             weightsOut->setValue(vertexWeights[i].weight, vertexWeights[i].ijk);
         }
     }
-    CaretArray<float> myScratchArray(numNodes);
-    float* myScratch = myScratchArray.getArray();
-    if (mySubVol == -1)
+    int64_t startVol = 0, endVol = myVolDims[3];
+    if (mySubVol > -1)
+    {
+        startVol = mySubVol;
+        endVol = mySubVol + 1;
+    }
+    for (int64_t i = startVol; i < endVol; ++i)
     {
-        for (int64_t i = 0; i < myVolDims[3]; ++i)
-        {
-            for (int64_t j = 0; j < myVolDims[4]; ++j)
-            {
-                int64_t thisCol = i * myVolDims[4] + j;
-                AString metricLabel = myVolume->getMapName(i);
-                if (myVolDims[4] != 1)
-                {
-                    metricLabel += " component " + AString::number(j);
-                }
-                metricLabel += " ribbon constrained";
-                myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                        if (thisCol == 0 && badVertices != NULL)
-                        {
-                            badVertScratch[node] = 1.0f;
-                        }
-                    }
-                }
-                myMetricOut->setValuesForColumn(thisCol, myScratch);
-            }
-        }
-    } else {
         for (int64_t j = 0; j < myVolDims[4]; ++j)
         {
-            AString metricLabel = myVolume->getMapName(mySubVol);
+            AString metricLabel = myVolume->getMapName(i);
             if (myVolDims[4] != 1)
             {
                 metricLabel += " component " + AString::number(j);
             }
             metricLabel += " ribbon constrained";
-            int64_t thisCol = j;
-            myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t node = 0; node < numNodes; ++node)
-            {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                        if (badVertices != NULL)
-                        {
-                            badVertScratch[node] = 1.0f;
-                        }
-                    }
-            }
-            myMetricOut->setValuesForColumn(thisCol, myScratch);
+            myMetricOut->setColumnName((i - startVol) * myVolDims[4] + j, metricLabel);
         }
     }
+    mapFramesSparse(myWeights, myVolume, startVol, endVol, myMetricOut, true, (badVertices != NULL ? badVertScratch.data() : NULL));
     if (badVertices != NULL)
     {
         badVertices->setValuesForColumn(0, badVertScratch.data());
@@ -741,58 +689,142 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
     myMetricOut->setStructure(mySurface->getStructure());
     vector<vector<VoxelWeight> > myWeights;
     precomputeWeightsMyelin(myWeights, mySurface, roiVol, thickness, sigma, oldCutoffBug);
-    vector<float> myScratch(numNodes);
-    if (mySubVol == -1)
+    int64_t startVol = 0, endVol = myVolDims[3];
+    if (mySubVol > -1)
+    {
+        startVol = mySubVol;
+        endVol = mySubVol + 1;
+    }
+    for (int64_t i = startVol; i < endVol; ++i)
     {
-        for (int64_t i = 0; i < myVolDims[3]; ++i)
-        {
-            for (int64_t j = 0; j < myVolDims[4]; ++j)
-            {
-                int64_t thisCol = i * myVolDims[4] + j;
-                AString metricLabel = myVolume->getMapName(i);
-                if (myVolDims[4] != 1)
-                {
-                    metricLabel += " component " + AString::number(j);
-                }
-                metricLabel += " myelin style";
-                myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    double accum = 0.0;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        accum += myWeights[node][voxel].weight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);//weights have already been normalized in precompute, for this method
-                    }
-                    myScratch[node] = accum;
-                }
-                myMetricOut->setValuesForColumn(thisCol, myScratch.data());
-            }
-        }
-    } else {
         for (int64_t j = 0; j < myVolDims[4]; ++j)
         {
-            AString metricLabel = myVolume->getMapName(mySubVol);
+            AString metricLabel = myVolume->getMapName(i);
             if (myVolDims[4] != 1)
             {
                 metricLabel += " component " + AString::number(j);
             }
             metricLabel += " myelin style";
-            int64_t thisCol = j;
-            myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t node = 0; node < numNodes; ++node)
+            myMetricOut->setColumnName((i - startVol) * myVolDims[4] + j, metricLabel);
+        }
+    }
+    mapFramesSparse(myWeights, myVolume, startVol, endVol, myMetricOut, false, NULL);//weights have already been normalized in precompute, for this method
+}
+
+void AlgorithmVolumeToSurfaceMapping::mapFramesSparse(const vector<vector<VoxelWeight> >& myWeights, const VolumeFile* myVolume, const int64_t& startVol, const int64_t& endVol,
+                                                      MetricFile* myMetricOut, const bool& divideByWeightSum, float* badVertScratch)
+{//same arithmetic, in the same order, as mapping one frame at a time with getValue, but each voxel is gathered once per block of frames rather than once per vertex per frame
+    CARET_PERF_SCOPE("volume to surface weighted mapping");
+    vector<int64_t> myVolDims;
+    myVolume->getDimensions(myVolDims);
+    const VolumeSpace& volSpace = myVolume->getVolumeSpace();
+    const int64_t numNodes = (int64_t)myWeights.size();
+    vector<int64_t> rowStarts(numNodes + 1, 0);
+    for (int64_t node = 0; node < numNodes; ++node)
+    {
+        rowStarts[node + 1] = rowStarts[node] + (int64_t)myWeights[node].size();
+    }
+    const int64_t numWeights = rowStarts[numNodes];
+    vector<float> weights(numWeights);
+    vector<int64_t> weightVoxels(numWeights);
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t node = 0; node < numNodes; ++node)
+    {
+        const vector<VoxelWeight>& nodeWeights = myWeights[node];
+        for (int64_t j = 0; j < (int64_t)nodeWeights.size(); ++j)
+        {
+            weights[rowStarts[node] + j] = nodeWeights[j].weight;
+            weightVoxels[rowStarts[node] + j] = volSpace.getIndex(nodeWeights[j].ijk);
+        }
+    }
+    vector<int64_t> usedVoxels = weightVoxels;//compact list of the voxels with any weight, so a block of frames only copies the ribbon
+    sort(usedVoxels.begin(), usedVoxels.end());
+    usedVoxels.erase(unique(usedVoxels.begin(), usedVoxels.end()), usedVoxels.end());
+    const int64_t numUsed = (int64_t)usedVoxels.size();
+    vector<int32_t> columns(numWeights);
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t j = 0; j < numWeights; ++j)
+    {
+        columns[j] = (int32_t)(lower_bound(usedVoxels.begin(), usedVoxels.end(), weightVoxels[j]) - usedVoxels.begin());
+    }
+    vector<int64_t>().swap(weightVoxels);
+    const int64_t numFrames = (endVol - startVol) * myVolDims[4];
+    const int width = (int)min(numFrames, (int64_t)FRAME_BLOCK_SIZE);
+    vector<float> interleaved(numUsed * width);//voxel-major copy of the block, so all values of a voxel are in one cache line
+    vector<vector<float> > scratchOut(width, vector<float>(numNodes));
+    for (int64_t blockStart = 0; blockStart < numFrames; blockStart += width)
+    {
+        const int blockCount = (int)min((int64_t)width, numFrames - blockStart);
+        for (int f = 0; f < blockCount; ++f)
+        {
+            const float* frame = myVolume->getFrame(startVol + (blockStart + f) / myVolDims[4], (blockStart + f) % myVolDims[4]);//only one frame pointer in use at a time, for paged volumes
+#pragma omp CARET_PARFOR schedule(static)
+            for (int64_t u = 0; u < numUsed; ++u)
+            {
+                interleaved[u * width + f] = frame[usedVoxels[u]];
+            }
+        }
+#pragma omp CARET_PARFOR schedule(dynamic, 64)
+        for (int64_t node = 0; node < numNodes; ++node)
+        {
+            const int64_t rowEnd = rowStarts[node + 1];
+            if (divideByWeightSum)
             {
-                double accum = 0.0;
-                int numVoxels = (int)myWeights[node].size();
-                for (int voxel = 0; voxel < numVoxels; ++voxel)
+                float sum[FRAME_BLOCK_SIZE], totalWeight = 0.0f;
+                for (int f = 0; f < blockCount; ++f)
+                {
+                    sum[f] = 0.0f;
+                }
+                for (int64_t j = rowStarts[node]; j < rowEnd; ++j)
+                {
+                    const float thisWeight = weights[j];
+                    const float* values = interleaved.data() + (int64_t)columns[j] * width;
+                    totalWeight += thisWeight;
+                    for (int f = 0; f < blockCount; ++f)
+                    {
+                        sum[f] += thisWeight * values[f];
+                    }
+                }
+                if (totalWeight != 0.0f)
+                {
+                    for (int f = 0; f < blockCount; ++f)
+                    {
+                        scratchOut[f][node] = sum[f] / totalWeight;
+                    }
+                } else {
+                    for (int f = 0; f < blockCount; ++f)
+                    {
+                        scratchOut[f][node] = 0.0f;
+                    }
+                    if (badVertScratch != NULL)
+                    {
+                        badVertScratch[node] = 1.0f;
+                    }
+                }
+            } else {
+                double accum[FRAME_BLOCK_SIZE];
+                for (int f = 0; f < blockCount; ++f)
                 {
-                    accum += myWeights[node][voxel].weight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);//weights have already been normalized in precompute, for this method
+                    accum[f] = 0.0;
+                }
+                for (int64_t j = rowStarts[node]; j < rowEnd; ++j)
+                {
+                    const float thisWeight = weights[j];
+                    const float* values = interleaved.data() + (int64_t)columns[j] * width;
+                    for (int f = 0; f < blockCount; ++f)
+                    {
+                        accum[f] += thisWeight * values[f];
+                    }
+                }
+                for (int f = 0; f < blockCount; ++f)
+                {
+                    scratchOut[f][node] = accum[f];
                 }
-                myScratch[node] = accum;
             }
-            myMetricOut->setValuesForColumn(thisCol, myScratch.data());
+        }
+        for (int f = 0; f < blockCount; ++f)
+        {
+            myMetricOut->setValuesForColumn(blockStart + f, scratchOut[f].data());
         }
     }
 }
@@ -38,6 +38,8 @@ namespace caret {
                                             const MetricFile* thickness, const float& sigma, const bool& oldCutoffBug);
         static void precomputeWeightsRibbon(std::vector<std::vector<VoxelWeight> >& myWeights, const VolumeSpace& volSpace, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
                                             const float* roiFrame, const bool roiWeights, const int& subdivisions, const bool& thinColumns, const SurfaceFile* gaussSurf, const float& gaussScale);
+        static void mapFramesSparse(const std::vector<std::vector<VoxelWeight> >& myWeights, const VolumeFile* myVolume, const int64_t& startVol, const int64_t& endVol,
+                                    MetricFile* myMetricOut, const bool& divideByWeightSum, float* badVertScratch);
         enum Method
         {
             TRILINEAR,
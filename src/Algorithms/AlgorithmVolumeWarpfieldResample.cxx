@@ -22,6 +22,7 @@
 #include "AlgorithmException.h"
 
 #include "CaretLogger.h"
+#include "CaretPerfTrace.h"
 #include "CaretOMP.h"
 #include "NiftiIO.h"
 #include "Vector3D.h"
@@ -102,6 +103,7 @@ void AlgorithmVolumeWarpfieldResample::useParameters(OperationParameters* myPara
 AlgorithmVolumeWarpfieldResample::AlgorithmVolumeWarpfieldResample(ProgressObject* myProgObj, const VolumeFile* inVol, const VolumeFile* warpfield,
                                                                    const int64_t refDims[3], const vector<vector<float> >& refSform, const VolumeFile::InterpType& myMethod, VolumeFile* outVol) : AbstractAlgorithm(myProgObj)
 {
+    CARET_PERF_SCOPE("volume resample");
     LevelProgress myProgress(myProgObj);
     vector<int64_t> warpDims;
     warpfield->getDimensions(warpDims);
@@ -63,6 +63,7 @@
 #include "CiftiParcelScalarFile.h"
 #include "CiftiScalarDataSeriesFile.h"
 #include "CziImageFile.h"
+#include "DataFilePrefetcher.h"
 #include "DisplayPropertiesAnnotation.h"
 #include "DisplayPropertiesAnnotationTextSubstitution.h"
 #include "DisplayPropertiesBorders.h"
@@ -591,6 +592,7 @@ Brain::resetBrain(const ResetBrainKeepSceneFiles keepSceneFiles,
 {
     m_isSpecFileBeingRead = false;
     m_activeScene = NULL;
+    DataFilePrefetcher::stopPrefetching();
     SessionManager::get()->resetSceneWithChartOld();
     SessionManager::get()->resetSceneWithMprOld();
     
@@ -6579,6 +6581,45 @@ Brain::updateAfterFilesAddedOrRemoved()
     m_annotationTextSubstitutionLayerSet->updateContent();
 }
 
+/**
+ * Start decoding, in the background, the files selected in a spec file
+ * so that reading them, in order, overlaps decoding of the files that
+ * follow.  Palette files are never prefetched, so reading them first
+ * (as spec file loading does) does not change the order.
+ *
+ * @param specFile
+ *    The spec file.
+ * @param filesAlreadyLoaded
+ *    Spec file entries for files that are already loaded and not read.
+ */
+void
+Brain::startPrefetchingSpecFileDataFiles(const SpecFile* specFile,
+                                         const std::map<const SpecFileDataFile*, CaretDataFile*>& filesAlreadyLoaded)
+{
+    CaretAssert(specFile);
+    
+    std::vector<std::pair<AString, DataFileTypeEnum::Enum>> filesToRead;
+    const int32_t numFileGroups = specFile->getNumberOfDataFileTypeGroups();
+    for (int32_t ig = 0; ig < numFileGroups; ig++) {
+        const SpecFileDataFileTypeGroup* group = specFile->getDataFileTypeGroupByIndex(ig);
+        const DataFileTypeEnum::Enum dataFileType = group->getDataFileType();
+        if ( ! DataFilePrefetcher::isPrefetchingSupported(dataFileType)) {
+            continue;
+        }
+        const int32_t numFiles = group->getNumberOfFiles();
+        for (int32_t iFile = 0; iFile < numFiles; iFile++) {
+            const SpecFileDataFile* fileInfo = group->getFileInformation(iFile);
+            if (fileInfo->isLoadingSelected()
+                && (filesAlreadyLoaded.find(fileInfo) == filesAlreadyLoaded.end())) {
+                filesToRead.push_back(std::make_pair(convertFilePathNameToAbsolutePathName(fileInfo->getFileName()),
+                                                     dataFileType));
+            }
+        }
+    }
+    
+    DataFilePrefetcher::startPrefetching(filesToRead);
+}
+
 /**
  * Load the data files selected in a spec file.
  * @param readSpecFileDataFilesEvent
@@ -6641,6 +6682,9 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
                                        "Starting to read selected files");
     EventManager::get()->sendEvent(progressUpdate.getPointer());
 
+    startPrefetchingSpecFileDataFiles(sf,
+                                      std::map<const SpecFileDataFile*, CaretDataFile*>());
+
     /*
      * Note: Need to read palette first since some of the individual file
      * reading routines update palette coloring when file is read
@@ -6698,6 +6742,8 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
         }
     }
     
+    DataFilePrefetcher::stopPrefetching();
+    
     m_specFile->clearModified();
     
     if (errorMessage.isEmpty() == false) {
@@ -6906,6 +6952,14 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
     m_nonModifiedFilesForRestoringScene.clear();
     
     
+    /*
+     * Files from a scene on the network are read from the network
+     */
+    if ( ! sceneFileOnNetwork) {
+        startPrefetchingSpecFileDataFiles(specFileToLoad,
+                                          specFilesEntryToNonModifiedFile);
+    }
+    
     /*
      * Load new files and add existing files that were previously loaded.
      */
@@ -6986,6 +7040,8 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
         }
     }
     
+    DataFilePrefetcher::stopPrefetching();
+    
     m_isSpecFileBeingRead = false;
     
     if (m_paletteFile != NULL) {
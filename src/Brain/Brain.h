@@ -21,6 +21,7 @@
  */
 /*LICENSE_END*/
 
+#include <map>
 #include <memory>
 #include <vector>
 #include <stdint.h>
@@ -117,6 +118,7 @@ namespace caret {
     class SceneFile;
     class SelectionManager;
     class SpecFile;
+    class SpecFileDataFile;
     class Surface;
     class SurfaceFile;
     class SurfaceProjectedItem;
@@ -579,6 +581,9 @@ namespace caret {
                           const ResetBrainKeepSceneFiles keepSceneFile,
                           const ResetBrainKeepSpecFile keepSpecFile);
         
+        void startPrefetchingSpecFileDataFiles(const SpecFile* specFile,
+                                               const std::map<const SpecFileDataFile*, CaretDataFile*>& filesAlreadyLoaded);
+        
         void resetBrain(const ResetBrainKeepSceneFiles keepSceneFiles,
                         const ResetBrainKeepSpecFile keepSpecFile);
         
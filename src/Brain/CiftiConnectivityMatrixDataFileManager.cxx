@@ -23,6 +23,8 @@
 #include "CiftiConnectivityMatrixDataFileManager.h"
 #undef __CIFTI_CONNECTIVITY_MATRIX_DATA_FILE_MANAGER_DECLARE__
 
+#include <algorithm>
+
 #include "Brain.h"
 #include "CaretAssert.h"
 #include "CiftiConnectivityMatrixParcelFile.h"
@@ -38,6 +40,7 @@
 #include "ScenePrimitiveArray.h"
 #include "Surface.h"
 #include "SurfaceFile.h"
+#include "TopologyHelper.h"
 
 using namespace caret;
 
@@ -319,6 +322,36 @@ CiftiConnectivityMatrixDataFileManager::loadDataForSurfaceNode(Brain* brain,
     
     if (haveData) {
         EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+        
+        /*
+         * While the user drags across the surface, the next vertex
+         * identified is usually one of the nearby vertices, so start
+         * reading their rows in the background.
+         */
+        std::vector<int32_t> nearbyNodeIndices;
+        CaretPointer<TopologyHelper> topologyHelper = surfaceFile->getTopologyHelper();
+        const std::vector<int32_t>& neighbors = topologyHelper->getNodeNeighbors(nodeIndex);
+        std::vector<int32_t> neighborsToDepth;
+        topologyHelper->getNodeNeighborsToDepth(nodeIndex,
+                                                2,
+                                                neighborsToDepth);
+        nearbyNodeIndices.insert(nearbyNodeIndices.end(),
+                                 neighbors.begin(),
+                                 neighbors.end());
+        for (const int32_t neighborIndex : neighborsToDepth) {
+            if ((neighborIndex != nodeIndex)
+                && (std::find(neighbors.begin(), neighbors.end(), neighborIndex) == neighbors.end())) {
+                nearbyNodeIndices.push_back(neighborIndex);
+            }
+        }
+        
+        for (CiftiMappableConnectivityMatrixDataFile* cmf : ciftiMatrixFiles) {
+            if ( ! cmf->isEmpty()) {
+                cmf->prefetchDataForSurfaceNodes(surfaceFile->getNumberOfNodes(),
+                                                 surfaceFile->getStructure(),
+                                                 nearbyNodeIndices);
+            }
+        }
     }
     
     return haveData;
@@ -1195,6 +1195,14 @@ SessionManager::restoreFromScene(const SceneAttributes* sceneAttributes,
         CaretAssert(scene);
         
         const SceneClass* guiManagerClass = scene->getClassWithName("guiManager");
+        if (guiManagerClass == NULL) {
+            sceneAttributes->addToErrorMessage("Scene \""
+                                               + scene->getName()
+                                               + "\" is missing its guiManager class.  The scene file may have been "
+                                               "modified or could not be read.");
+            m_sceneRestorationInProgressFlag = false;
+            return;
+        }
         if (guiManagerClass->getName() != "guiManager") {
             sceneAttributes->addToErrorMessage("Top level scene class should be guiManager but it is: "
                                                + guiManagerClass->getName());
@@ -81,6 +81,7 @@ namespace caret
         std::vector<VolumeMap> getFullVolumeMap() const;
         std::vector<VolumeMap> getVolumeStructureMap(const StructureEnum::Enum& structure) const;
         const VolumeSpace& getVolumeSpace() const;
+        bool hasVolumeSpace() const { return m_haveVolumeSpace; }//can be true without any voxels
         int64_t getSurfaceNumberOfNodes(const StructureEnum::Enum& structure) const;
         std::vector<StructureEnum::Enum> getSurfaceStructureList() const;
         std::vector<StructureEnum::Enum> getVolumeStructureList() const;
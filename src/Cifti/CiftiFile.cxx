@@ -18,19 +18,34 @@
  */
 /*LICENSE_END*/
 
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QRegularExpression>
+#include <QStandardPaths>
 #include "CiftiFile.h"
 
 #include "ByteOrderEnum.h"
+#include "ByteSwapping.h"
 #include "CaretAssert.h"
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
+#include "CaretMutex.h"
+#include "CaretPerfTrace.h"
+#include "CiftiXMLCache.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
 #include "MultiDimArray.h"
 #include "MultiDimIterator.h"
 #include "NiftiIO.h"
 
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+
 using namespace std;
 using namespace caret;
 
@@ -51,6 +66,8 @@ namespace
         const CiftiXML& getCiftiXML() const { return m_xml; }
         QString getFilename() const { return m_nifti.getFilename(); }
         bool isSwapped() const { return m_nifti.getHeader().isSwapped(); }
+        const NiftiHeader& getHeader() const { return m_nifti.getHeader(); }
+        const vector<int64_t>& getMatrixDims() const { return m_matrixDims; }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
         void close();
@@ -64,11 +81,66 @@ namespace
         CiftiMemoryImpl(const CiftiXML& xml);
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const { return m_array.get(1, indexSelect); }
         bool isInMemory() const { return true; }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
     };
     
+    //read-only access to uncompressed files through a memory map, doesn't need a mutex or seeking, so rows can be read from multiple threads at once
+    class CiftiMappedImpl : public CiftiFile::ReadImplInterface
+    {
+        QFile m_file;
+        const uchar* m_data;//start of the matrix data, not the start of the file
+        vector<int64_t> m_matrixDims;
+        int16_t m_dataType;
+        bool m_swapped, m_doScale, m_directFloat;
+        double m_mult, m_offset;
+        CiftiMappedImpl();
+        int64_t getRowStart(const vector<int64_t>& indexSelect) const;//in elements
+        void convertElements(float* dataOut, const int64_t& start, const int64_t& count, const int64_t& stride) const;
+        template<typename T>
+        void convertTyped(float* dataOut, const int64_t& start, const int64_t& count, const int64_t& stride) const;
+    public:
+        static CiftiMappedImpl* tryMap(const CiftiOnDiskImpl& onDisk);//returns NULL if the file can't be mapped
+        void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
+        void getColumn(float* dataOut, const int64_t& index) const;
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
+        QString getFilename() const { return m_file.fileName(); }
+        bool isSwapped() const { return m_swapped; }
+    };
+    
+    //2D only: wraps an on-disk reader, and serves getColumn from a transposed (column-major) copy of the matrix in a separate cache file
+    //the cache file is opened on the first getColumn, it is reused if it matches the size and modification time of the cifti file, otherwise it is rebuilt by reading all rows once
+    class CiftiColumnCacheImpl : public CiftiFile::ReadImplInterface
+    {
+        CaretPointer<CiftiFile::ReadImplInterface> m_source;
+        QString m_sourceFilename, m_cacheFilename;
+        mutable CaretMutex m_cacheMutex;
+        mutable QFile m_cacheFile;
+        mutable const float* m_columnData;
+        mutable bool m_cacheOpenTried;
+        int64_t m_numRows, m_numCols;
+        struct CacheHeader
+        {//native endian, a cache written on a machine with different endianness won't match the dimensions, so it gets rebuilt
+            char magic[8];
+            int64_t numRows, numCols, sourceSize, sourceModified;
+        };
+        CiftiColumnCacheImpl();
+        bool headerMatches(const CacheHeader& header) const;
+        void fillHeader(CacheHeader& header) const;
+        void openCache() const;
+        void buildCache() const;
+    public:
+        static const char CACHE_MAGIC[8];
+        static const char CACHE_FILE_PATTERN[];
+        CiftiColumnCacheImpl(const CaretPointer<CiftiFile::ReadImplInterface>& source, const QString& sourceFilename, const vector<int64_t>& dims, const QString& cacheFilename);
+        void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const { m_source->getRow(dataOut, indexSelect, tolerateShortRead); }
+        void getColumn(float* dataOut, const int64_t& index) const;
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const { return m_source->getRowPointer(indexSelect); }
+        const CiftiFile::ReadImplInterface* getSource() const { return m_source; }
+    };
+    
     class CiftiXnatImpl : public CiftiFile::ReadImplInterface
     {
         CiftiXML m_xml;//because we need to parse it to check the dimensions anyway
@@ -100,8 +172,74 @@ namespace
         return (endian == CiftiFile::ANY);
     }
     
+    //on-disk reading may be done by either CiftiOnDiskImpl or CiftiMappedImpl, returns false if neither
+    bool getOnDiskReadInfo(const CiftiFile::ReadImplInterface* impl, QString& filenameOut, bool& swappedOut)
+    {
+        const CiftiOnDiskImpl* onDiskImpl = dynamic_cast<const CiftiOnDiskImpl*>(impl);
+        if (onDiskImpl != NULL)
+        {
+            filenameOut = onDiskImpl->getFilename();
+            swappedOut = onDiskImpl->isSwapped();
+            return true;
+        }
+        const CiftiMappedImpl* mappedImpl = dynamic_cast<const CiftiMappedImpl*>(impl);
+        if (mappedImpl != NULL)
+        {
+            filenameOut = mappedImpl->getFilename();
+            swappedOut = mappedImpl->isSwapped();
+            return true;
+        }
+        const CiftiColumnCacheImpl* cacheImpl = dynamic_cast<const CiftiColumnCacheImpl*>(impl);
+        if (cacheImpl != NULL)
+        {
+            return getOnDiskReadInfo(cacheImpl->getSource(), filenameOut, swappedOut);
+        }
+        return false;
+    }
+    
+    //update the modification time of an open file, so that removing files by modification time removes the least recently used ones
+    void touchFile(QFile& myFile)
+    {
+        bool touched = false;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        touched = myFile.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+#endif
+        if (!touched)
+        {//rewriting the magic in place changes nothing but the modification time
+            QFile rewriteFile(myFile.fileName());
+            if (!rewriteFile.open(QIODevice::ReadWrite) || rewriteFile.write(CiftiColumnCacheImpl::CACHE_MAGIC, sizeof(CiftiColumnCacheImpl::CACHE_MAGIC)) != (qint64)sizeof(CiftiColumnCacheImpl::CACHE_MAGIC))
+            {
+                CaretLogFine("unable to update modification time of column cache file '" + myFile.fileName() + "'");
+            }
+        }
+    }
+    
+    //remove the least recently used column cache files in a directory until they fit in the limit, never the file in use
+    void enforceColumnCacheSizeLimit(const QString& directory, const QString& keepFilename)
+    {
+        const int64_t maxBytes = CiftiFile::getColumnCacheLimit();
+        if (maxBytes <= 0) return;
+        QFileInfoList entries = QDir(directory).entryInfoList(QStringList() << CiftiColumnCacheImpl::CACHE_FILE_PATTERN, QDir::Files, QDir::Time | QDir::Reversed);//least recently used first
+        const QString keepPath = QFileInfo(keepFilename).absoluteFilePath();
+        int64_t total = 0;
+        for (int i = 0; i < entries.size(); ++i)
+        {
+            total += entries[i].size();
+        }
+        for (int i = 0; i < entries.size() && total > maxBytes; ++i)
+        {
+            if (entries[i].absoluteFilePath() == keepPath) continue;
+            if (QFile::remove(entries[i].absoluteFilePath()))
+            {
+                total -= entries[i].size();
+            }
+        }
+    }
+    
 }
 
+int64_t CiftiFile::s_columnCacheMaxBytes = 0;
+
 CiftiFile::ReadImplInterface::~ReadImplInterface()
 {
 }
@@ -119,11 +257,17 @@ CiftiFile::CiftiFile(const QString& fileName)
 
 void CiftiFile::openFile(const QString& fileName)
 {
+    CARET_PERF_SCOPE("cifti open");
     close();//to make sure it closes everything first, even if the open throws
     CaretPointer<CiftiOnDiskImpl> newRead(new CiftiOnDiskImpl(FileInformation(fileName).getAbsoluteFilePath()));//this constructor opens existing file read-only
     m_readingImpl = newRead;//it should be noted that if the constructor throws (if the file isn't readable), new guarantees the memory allocated for the object will be freed
     m_xml = newRead->getCiftiXML();
     newRead->dropXML();//save some memory, we don't need 2 copies of the xml - figure out if there is a better way to prevent copies
+    CiftiMappedImpl* newMapped = CiftiMappedImpl::tryMap(*newRead);
+    if (newMapped != NULL)
+    {
+        m_readingImpl.grabNew(newMapped);//the NiftiIO file handle is closed when newRead goes out of scope
+    }
     m_xmlBroken = false;
     m_dims = m_xml.getDimensions();
     m_onDiskVersion = m_xml.getParsedVersion();
@@ -182,16 +326,19 @@ void CiftiFile::setWritingDataTypeAndScaling(const int16_t& type, const double&
 
 void CiftiFile::writeFile(const QString& fileName, const CiftiVersion& writingVersion, const ENDIAN& endian)
 {
+    CARET_PERF_SCOPE("cifti write");
     if (m_readingImpl == NULL || m_dims.empty()) throw DataFileException("writeFile called on uninitialized CiftiFile");
     if (m_xmlBroken) throw DataFileException("can't write cifti file when XML mappings have been forgotten");
     bool writeSwapped = shouldSwap(endian);
     FileInformation myInfo(fileName);
     QString canonicalFilename = myInfo.getCanonicalFilePath();//NOTE: returns EMPTY STRING for nonexistant file
-    const CiftiOnDiskImpl* testImpl = dynamic_cast<CiftiOnDiskImpl*>(m_readingImpl.getPointer());
+    QString readingFilename;
+    bool readingSwapped = false;
+    bool readingOnDisk = getOnDiskReadInfo(m_readingImpl.getPointer(), readingFilename, readingSwapped);
     bool collision = false, hadWriter = (m_writingImpl != NULL);
-    if (testImpl != NULL && canonicalFilename != "" && FileInformation(testImpl->getFilename()).getCanonicalFilePath() == canonicalFilename)
+    if (readingOnDisk && canonicalFilename != "" && FileInformation(readingFilename).getCanonicalFilePath() == canonicalFilename)
     {//empty string test is so that we don't say collision if both are nonexistant - could happen if file is removed/unlinked while reading on some filesystems
-        if (m_onDiskVersion == writingVersion && !m_xml.mutablesModified() && (dontRewrite(endian) || writeSwapped == testImpl->isSwapped())) return;//don't need to copy to itself
+        if (m_onDiskVersion == writingVersion && !m_xml.mutablesModified() && (dontRewrite(endian) || writeSwapped == readingSwapped)) return;//don't need to copy to itself
         collision = true;//we need to copy to memory temporarily
         CaretPointer<WriteImplInterface> tempMemory(new CiftiMemoryImpl(m_xml));
         copyImplData(m_readingImpl, tempMemory, m_dims);
@@ -234,6 +381,7 @@ void CiftiFile::close()
 void CiftiFile::convertToInMemory()
 {
     if (isInMemory()) return;
+    CARET_PERF_SCOPE("cifti read to memory");
     m_writingFile = "";//make sure it doesn't do on-disk when set...() is called
     if (m_readingImpl == NULL) return;//not set up yet
     CaretPointer<WriteImplInterface> tempWrite(new CiftiMemoryImpl(m_xml));//if we get an error while reading, free the memory immediately, and don't leave m_readingImpl and m_writingImpl pointing to different things
@@ -267,6 +415,64 @@ void CiftiFile::getColumn(float* dataOut, const int64_t& index) const
     m_readingImpl->getColumn(dataOut, index);
 }
 
+const float* CiftiFile::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowPointer called on uninitialized CiftiFile");
+    if (m_readingImpl == NULL) return NULL;
+    return m_readingImpl->getRowPointer(indexSelect);
+}
+
+const float* CiftiFile::getRowPointer(const int64_t& index) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowPointer called on uninitialized CiftiFile");
+    if (m_dims.size() != 2) throw DataFileException("getRowPointer with single index called on non-2D CiftiFile");
+    if (m_readingImpl == NULL) return NULL;
+    vector<int64_t> tempvec(1, index);
+    return m_readingImpl->getRowPointer(tempvec);
+}
+
+bool CiftiFile::enableColumnCache(const QString& cacheFileName)
+{
+    if (m_readingImpl == NULL || m_dims.size() != 2 || m_dims[0] < 2) return false;//single column files already read columns quickly
+    if (m_writingImpl != NULL) return false;//data may change
+    if (dynamic_cast<CiftiColumnCacheImpl*>(m_readingImpl.getPointer()) != NULL) return true;
+    QString readingFilename;
+    bool readingSwapped = false;
+    if (!getOnDiskReadInfo(m_readingImpl.getPointer(), readingFilename, readingSwapped)) return false;//in memory or remote
+    QString useName = cacheFileName;
+    if (useName == "")
+    {//never write next to the data file, use the user's cache directory if possible, otherwise the temp directory
+        QString canonicalName = FileInformation(readingFilename).getCanonicalFilePath();
+        //the name doesn't depend on the modification time, so a modified file replaces its old cache file rather than leaving it behind
+        QString cacheName = "wb_" + QCryptographicHash::hash(canonicalName.toUtf8(), QCryptographicHash::Md5).toHex() + ".colcache";
+        QString userCacheDir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+        QDir cacheDir(userCacheDir + "/workbench/column_cache");
+        if (userCacheDir != "" && cacheDir.mkpath("."))
+        {
+            useName = cacheDir.filePath(cacheName);
+        } else {
+            useName = QDir::temp().filePath(cacheName);
+        }
+    }
+    m_readingImpl.grabNew(new CiftiColumnCacheImpl(m_readingImpl, readingFilename, m_dims, useName));
+    return true;
+}
+
+void CiftiFile::setColumnCacheLimit(const int64_t& maxBytes)
+{
+    s_columnCacheMaxBytes = maxBytes;
+}
+
+int64_t CiftiFile::getColumnCacheLimit()
+{
+    return s_columnCacheMaxBytes;
+}
+
+bool CiftiFile::isColumnCacheEnabled()
+{
+    return s_columnCacheMaxBytes > 0;
+}
+
 void CiftiFile::setCiftiXML(const CiftiXML& xml, const bool useOldMetadata)
 {
     if (xml.getNumberOfDimensions() == 0) throw DataFileException("setCiftiXML called with 0-dimensional CiftiXML");
@@ -400,10 +606,11 @@ void CiftiFile::verifyWriteImpl()
         if (m_xmlBroken) throw DataFileException("can't write file when XML mappings have been forgotten");
         if (m_readingImpl != NULL)
         {
-            CiftiOnDiskImpl* testImpl = dynamic_cast<CiftiOnDiskImpl*>(m_readingImpl.getPointer());
-            if (testImpl != NULL)
+            QString readingFilename;
+            bool readingSwapped = false;
+            if (getOnDiskReadInfo(m_readingImpl.getPointer(), readingFilename, readingSwapped))
             {
-                QString canonicalCurrent = FileInformation(testImpl->getFilename()).getCanonicalFilePath();//returns "" if nonexistant, if unlinked while open
+                QString canonicalCurrent = FileInformation(readingFilename).getCanonicalFilePath();//returns "" if nonexistant, if unlinked while open
                 if (canonicalCurrent != "" && canonicalCurrent == FileInformation(m_writingFile).getCanonicalFilePath())//these were already absolute
                 {
                     convertToInMemory();//save existing data in memory before we clobber file
@@ -508,7 +715,7 @@ CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename)
     if (whichExt == -1) throw DataFileException("no cifti extension found in file '" + filename + "'");
     try
     {
-        m_xml.readXML(QByteArray(myHeader.m_extensions[whichExt]->m_bytes.data(), myHeader.m_extensions[whichExt]->m_bytes.size()));//CiftiXML should be under 2GB
+        CiftiXMLCache::readXML(m_xml, QByteArray::fromRawData(myHeader.m_extensions[whichExt]->m_bytes.data(), myHeader.m_extensions[whichExt]->m_bytes.size()));//CiftiXML should be under 2GB
     } catch (CaretException& e) {
         throw DataFileException("XML parsing error in cifti file '" + filename + "': " + e.whatString());
     } catch (exception& e) {//use a different message for std::exception, as this probably isn't from our code
@@ -723,14 +930,7 @@ void CiftiOnDiskImpl::getColumn(float* dataOut, const int64_t& index) const
     if (m_matrixDims[0] > 1)
     {
         CaretLogFine("getColumn called on CiftiOnDiskImpl with multiple columns, this will be slow");//generate logging messages at a low priority
-        vector<int64_t> indexSelect(2);
-        indexSelect[0] = index;
-        int64_t colLength = m_matrixDims[1];
-        for (int64_t i = 0; i < colLength; ++i)//assume if they really want getColumn on disk, they don't want their pagecache obliterated, so read it 1 element at a time
-        {
-            indexSelect[1] = i;
-            m_nifti.readData(dataOut + i, 4, indexSelect);//4 means just the 4 reserved dimensions, so 1 element of the matrix
-        }
+        m_nifti.readStrided(dataOut, index, m_matrixDims[1], m_matrixDims[0]);//reads nearby elements in bounded batches, rather than seeking to every element
     } else {//special case for single-column cifti
         m_nifti.readData(dataOut, 6, vector<int64_t>());
     }
@@ -756,6 +956,313 @@ void CiftiOnDiskImpl::setColumn(const float* dataIn, const int64_t& index)
     }
 }
 
+CiftiMappedImpl::CiftiMappedImpl()
+{
+    m_data = NULL;
+    m_dataType = NIFTI_TYPE_FLOAT32;
+    m_swapped = false;
+    m_doScale = false;
+    m_directFloat = false;
+    m_mult = 1.0;
+    m_offset = 0.0;
+}
+
+CiftiMappedImpl* CiftiMappedImpl::tryMap(const CiftiOnDiskImpl& onDisk)
+{
+    QString filename = onDisk.getFilename();
+    if (filename.endsWith(".gz")) return NULL;//compressed, CaretBinaryFile uses zlib for these
+    if (sizeof(void*) < 8) return NULL;//don't try to use up the address space of a 32-bit process
+    const NiftiHeader& myHeader = onDisk.getHeader();
+    int bytesPerElem = 0;
+    switch (myHeader.getDataType())
+    {
+        case NIFTI_TYPE_UINT8:
+        case NIFTI_TYPE_INT8:
+            bytesPerElem = 1;
+            break;
+        case NIFTI_TYPE_UINT16:
+        case NIFTI_TYPE_INT16:
+            bytesPerElem = 2;
+            break;
+        case NIFTI_TYPE_UINT32:
+        case NIFTI_TYPE_INT32:
+        case NIFTI_TYPE_FLOAT32:
+            bytesPerElem = 4;
+            break;
+        case NIFTI_TYPE_UINT64:
+        case NIFTI_TYPE_INT64:
+        case NIFTI_TYPE_FLOAT64:
+            bytesPerElem = 8;
+            break;
+        default://multi-component types are rejected when opening, leave anything unusual to NiftiIO
+            return NULL;
+    }
+    CaretPointer<CiftiMappedImpl> ret(new CiftiMappedImpl());//in case anything below throws
+    ret->m_matrixDims = onDisk.getMatrixDims();
+    int64_t numElems = 1;
+    for (int i = 0; i < (int)ret->m_matrixDims.size(); ++i)
+    {
+        numElems *= ret->m_matrixDims[i];
+    }
+    ret->m_file.setFileName(filename);
+    if (!ret->m_file.open(QIODevice::ReadOnly)) return NULL;
+    const int64_t dataOffset = myHeader.getDataOffset(), dataBytes = numElems * bytesPerElem;
+    if (ret->m_file.size() < dataOffset + dataBytes) return NULL;//NiftiIO checks this when opening, but the file could have changed since
+    ret->m_data = ret->m_file.map(dataOffset, dataBytes);
+    if (ret->m_data == NULL)
+    {
+        CaretLogFine("unable to memory map cifti file '" + filename + "', falling back to reading through the file");
+        return NULL;
+    }
+    ret->m_dataType = myHeader.getDataType();
+    ret->m_swapped = myHeader.isSwapped();
+    ret->m_doScale = myHeader.getDataScaling(ret->m_mult, ret->m_offset);
+    ret->m_directFloat = (ret->m_dataType == NIFTI_TYPE_FLOAT32 && !ret->m_swapped && !ret->m_doScale && ((uintptr_t)ret->m_data) % sizeof(float) == 0);
+    return ret.releasePointer();
+}
+
+int64_t CiftiMappedImpl::getRowStart(const vector<int64_t>& indexSelect) const
+{//same math as NiftiIO::readData, but without the 4 reserved dimensions
+    CaretAssert(indexSelect.size() + 1 == m_matrixDims.size());
+    int64_t numDimSkip = m_matrixDims[0], numSkip = 0;
+    for (int curDim = 1; curDim < (int)m_matrixDims.size(); ++curDim)
+    {
+        CaretAssert(indexSelect[curDim - 1] >= 0 && indexSelect[curDim - 1] < m_matrixDims[curDim]);
+        numSkip += indexSelect[curDim - 1] * numDimSkip;
+        numDimSkip *= m_matrixDims[curDim];
+    }
+    return numSkip;
+}
+
+template<typename T>
+void CiftiMappedImpl::convertTyped(float* dataOut, const int64_t& start, const int64_t& count, const int64_t& stride) const
+{//uses only stack scratch space, so this is safe to call from multiple threads
+    if (CaretPerfTrace::isEnabled()) CaretPerfTrace::addBytesRead(getFilename(), count * sizeof(T));
+    const int64_t CHUNK_SIZE = 1024;
+    T scratch[CHUNK_SIZE];
+    for (int64_t base = 0; base < count; base += CHUNK_SIZE)
+    {
+        const int64_t chunkCount = min(CHUNK_SIZE, count - base);
+        if (stride == 1)
+        {
+            memcpy(scratch, m_data + (start + base) * sizeof(T), chunkCount * sizeof(T));//mapped data may not be aligned for T
+        } else {
+            for (int64_t i = 0; i < chunkCount; ++i)
+            {
+                memcpy(scratch + i, m_data + (start + (base + i) * stride) * sizeof(T), sizeof(T));
+            }
+        }
+        if (m_swapped) ByteSwapping::swapArray(scratch, chunkCount);
+        if (m_doScale)
+        {
+            for (int64_t i = 0; i < chunkCount; ++i)
+            {
+                dataOut[base + i] = (float)(m_offset + m_mult * (long double)scratch[i]);//same conversion as NiftiIO
+            }
+        } else {
+            for (int64_t i = 0; i < chunkCount; ++i)
+            {
+                dataOut[base + i] = (float)scratch[i];
+            }
+        }
+    }
+}
+
+void CiftiMappedImpl::convertElements(float* dataOut, const int64_t& start, const int64_t& count, const int64_t& stride) const
+{
+    switch (m_dataType)
+    {
+        case NIFTI_TYPE_UINT8:
+            convertTyped<uint8_t>(dataOut, start, count, stride);
+            break;
+        case NIFTI_TYPE_INT8:
+            convertTyped<int8_t>(dataOut, start, count, stride);
+            break;
+        case NIFTI_TYPE_UINT16:
+            convertTyped<uint16_t>(dataOut, start, count, stride);
+            break;
+        case NIFTI_TYPE_INT16:
+            convertTyped<int16_t>(dataOut, start, count, stride);
+            break;
+        case NIFTI_TYPE_UINT32:
+            convertTyped<uint32_t>(dataOut, start, count, stride);
+            break;
+        case NIFTI_TYPE_INT32:
+            convertTyped<int32_t>(dataOut, start, count, stride);
+            break;
+        case NIFTI_TYPE_UINT64:
+            convertTyped<uint64_t>(dataOut, start, count, stride);
+            break;
+        case NIFTI_TYPE_INT64:
+            convertTyped<int64_t>(dataOut, start, count, stride);
+            break;
+        case NIFTI_TYPE_FLOAT32:
+            convertTyped<float>(dataOut, start, count, stride);
+            break;
+        case NIFTI_TYPE_FLOAT64:
+            convertTyped<double>(dataOut, start, count, stride);
+            break;
+        default:
+            CaretAssert(0);
+            throw DataFileException("internal error, tell the developers what you just tried to do");
+    }
+}
+
+void CiftiMappedImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect, const bool&) const
+{
+    const int64_t rowStart = getRowStart(indexSelect), rowLength = m_matrixDims[0];
+    if (m_directFloat)
+    {
+        memcpy(dataOut, m_data + rowStart * sizeof(float), rowLength * sizeof(float));
+        if (CaretPerfTrace::isEnabled()) CaretPerfTrace::addBytesRead(getFilename(), rowLength * sizeof(float));
+    } else {
+        convertElements(dataOut, rowStart, rowLength, 1);
+    }
+}
+
+void CiftiMappedImpl::getColumn(float* dataOut, const int64_t& index) const
+{
+    CaretAssert(m_matrixDims.size() == 2);//otherwise this shouldn't be called
+    CaretAssert(index >= 0 && index < m_matrixDims[0]);
+    convertElements(dataOut, index, m_matrixDims[1], m_matrixDims[0]);//the page cache does the work that getColumn on CiftiOnDiskImpl has to do with seeks
+}
+
+const float* CiftiMappedImpl::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    if (!m_directFloat) return NULL;
+    return ((const float*)m_data) + getRowStart(indexSelect);
+}
+
+const char CiftiColumnCacheImpl::CACHE_MAGIC[8] = { 'W', 'B', 'C', 'O', 'L', 'C', '0', '1' };
+const char CiftiColumnCacheImpl::CACHE_FILE_PATTERN[] = "wb_*.colcache";
+
+CiftiColumnCacheImpl::CiftiColumnCacheImpl(const CaretPointer<CiftiFile::ReadImplInterface>& source, const QString& sourceFilename, const vector<int64_t>& dims, const QString& cacheFilename)
+{
+    CaretAssert(dims.size() == 2);
+    m_source = source;
+    m_sourceFilename = sourceFilename;
+    m_cacheFilename = cacheFilename;
+    m_numCols = dims[0];
+    m_numRows = dims[1];
+    m_columnData = NULL;
+    m_cacheOpenTried = false;
+}
+
+void CiftiColumnCacheImpl::fillHeader(CacheHeader& header) const
+{
+    QFileInfo sourceInfo(m_sourceFilename);
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.numRows = m_numRows;
+    header.numCols = m_numCols;
+    header.sourceSize = sourceInfo.size();
+    header.sourceModified = sourceInfo.lastModified().toMSecsSinceEpoch();
+}
+
+bool CiftiColumnCacheImpl::headerMatches(const CacheHeader& header) const
+{
+    CacheHeader expected;
+    fillHeader(expected);
+    return memcmp(header.magic, expected.magic, sizeof(CACHE_MAGIC)) == 0 && header.numRows == expected.numRows && header.numCols == expected.numCols &&
+           header.sourceSize == expected.sourceSize && header.sourceModified == expected.sourceModified;
+}
+
+void CiftiColumnCacheImpl::openCache() const
+{
+    CacheHeader existing;
+    bool valid = false;
+    m_cacheFile.setFileName(m_cacheFilename);
+    if (m_cacheFile.open(QIODevice::ReadOnly))
+    {
+        valid = (m_cacheFile.read((char*)&existing, sizeof(CacheHeader)) == (qint64)sizeof(CacheHeader) && headerMatches(existing) &&
+                 m_cacheFile.size() == (qint64)(sizeof(CacheHeader) + m_numRows * m_numCols * sizeof(float)));
+        if (valid)
+        {
+            touchFile(m_cacheFile);
+        } else {
+            m_cacheFile.close();
+        }
+    }
+    if (!valid)
+    {
+        buildCache();
+        m_cacheFile.setFileName(m_cacheFilename);
+        if (!m_cacheFile.open(QIODevice::ReadOnly)) throw DataFileException("failed to open column cache file '" + m_cacheFilename + "'");
+        enforceColumnCacheSizeLimit(QFileInfo(m_cacheFilename).absolutePath(), m_cacheFilename);
+    }
+    m_columnData = (const float*)m_cacheFile.map(sizeof(CacheHeader), m_numRows * m_numCols * sizeof(float));
+    if (m_columnData == NULL) throw DataFileException("failed to memory map column cache file '" + m_cacheFilename + "'");
+}
+
+void CiftiColumnCacheImpl::buildCache() const
+{
+    QString tempFilename = m_cacheFilename + ".tmp" + QString::number(QCoreApplication::applicationPid());//so an interrupted build never looks like a valid cache, and concurrent builds don't write into each others' files
+    QFile tempFile(tempFilename);
+    if (!tempFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) throw DataFileException("failed to create column cache file '" + tempFilename + "'");
+    CacheHeader header;
+    fillHeader(header);
+    bool ok = (tempFile.write((const char*)&header, sizeof(CacheHeader)) == (qint64)sizeof(CacheHeader)) && tempFile.resize(sizeof(CacheHeader) + m_numRows * m_numCols * sizeof(float));
+    const int64_t BLOCK_BYTES = 1 << 26;//transpose 64MB of rows at a time, so each column gets written as one contiguous piece per block
+    const int64_t blockRows = max(int64_t(1), min(m_numRows, BLOCK_BYTES / (int64_t)(m_numCols * sizeof(float))));
+    vector<float> rowScratch(m_numCols), transposed(blockRows * m_numCols);
+    vector<int64_t> indexSelect(1);
+    for (int64_t blockStart = 0; ok && blockStart < m_numRows; blockStart += blockRows)
+    {
+        const int64_t thisRows = min(blockRows, m_numRows - blockStart);
+        for (int64_t row = 0; row < thisRows; ++row)
+        {
+            indexSelect[0] = blockStart + row;
+            m_source->getRow(rowScratch.data(), indexSelect, false);
+            for (int64_t col = 0; col < m_numCols; ++col)
+            {
+                transposed[col * thisRows + row] = rowScratch[col];
+            }
+        }
+        for (int64_t col = 0; ok && col < m_numCols; ++col)
+        {
+            ok = tempFile.seek(sizeof(CacheHeader) + (col * m_numRows + blockStart) * sizeof(float)) &&
+                 tempFile.write((const char*)(transposed.data() + col * thisRows), thisRows * sizeof(float)) == (qint64)(thisRows * sizeof(float));
+        }
+    }
+    tempFile.close();
+    if (!ok || tempFile.error() != QFileDevice::NoError)
+    {
+        tempFile.remove();
+        throw DataFileException("failed to write column cache file '" + tempFilename + "'");
+    }
+    QFile::remove(m_cacheFilename);//rename won't overwrite, this also removes the cache of an older version of the same cifti file
+    if (!tempFile.rename(m_cacheFilename))
+    {
+        tempFile.remove();
+        throw DataFileException("failed to rename column cache file to '" + m_cacheFilename + "'");
+    }
+}
+
+void CiftiColumnCacheImpl::getColumn(float* dataOut, const int64_t& index) const
+{
+    CaretAssert(index >= 0 && index < m_numCols);
+    {
+        CaretMutexLocker locked(&m_cacheMutex);
+        if (!m_cacheOpenTried)
+        {//building the cache reads the whole file, so wait until a column is actually needed
+            m_cacheOpenTried = true;
+            try
+            {
+                openCache();
+            } catch (DataFileException& e) {
+                CaretLogInfo("unable to use column cache file '" + m_cacheFilename + "', reading columns from '" + m_sourceFilename + "': " + e.whatString());
+                m_cacheFile.close();
+                m_columnData = NULL;
+            }
+        }
+    }
+    if (m_columnData == NULL)
+    {
+        m_source->getColumn(dataOut, index);
+        return;
+    }
+    memcpy(dataOut, m_columnData + index * m_numRows, m_numRows * sizeof(float));
+}
+
 CiftiXnatImpl::CiftiXnatImpl(const QString& url, const QString& user, const QString& pass)
 {
     CaretHttpManager::setAuthentication(url, user, pass);
@@ -71,6 +71,21 @@ namespace caret
         }
         void getColumn(float* dataOut, const int64_t& index) const;//for 2D only, will be slow if on disk!
         
+        ///direct access to row data when it doesn't need conversion (in memory, or memory mapped native float32 on disk), returns NULL otherwise, so use getRow as a fallback
+        ///the pointer becomes invalid when the file is closed, or its XML or data are changed
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
+        const float* getRowPointer(const int64_t& index) const;//for 2D only
+        
+        ///for 2D files being read from disk, make getColumn read from a transposed copy of the matrix in a separate cache file, building the cache file on the first getColumn if it is missing or out of date
+        ///empty name means in the user's cache directory if possible, otherwise in the temp directory, named from the cifti file's path, so a rebuild replaces the entry for an older version of the file
+        ///returns false if the cache can't be used, if the cache file can't be built later, getColumn reads from the cifti file instead
+        bool enableColumnCache(const QString& cacheFileName = QString());
+        
+        ///size limit for column cache files in the default location, least recently used files are removed after a cache file is built, <= 0 means column caching is off for files that check isColumnCacheEnabled()
+        static void setColumnCacheLimit(const int64_t& maxBytes);
+        static int64_t getColumnCacheLimit();
+        static bool isColumnCacheEnabled();
+        
         void setCiftiXML(const CiftiXML& xml, const bool useOldMetadata = true);
         void setCiftiXML(const CiftiXMLOld &xml, const bool useOldMetadata = true);//set xml from old implementation
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
@@ -94,6 +109,7 @@ namespace caret
         public:
             virtual void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const = 0;
             virtual void getColumn(float* dataOut, const int64_t& index) const = 0;
+            virtual const float* getRowPointer(const std::vector<int64_t>&) const { return NULL; }
             virtual bool isInMemory() const { return false; }
             virtual ~ReadImplInterface();
         };
@@ -118,6 +134,7 @@ namespace caret
         int16_t m_writingDataType;
         double m_minScalingVal, m_maxScalingVal;
         bool m_xmlBroken;//sentinel for forgetMapping hack
+        static int64_t s_columnCacheMaxBytes;
         
         void verifyWriteImpl();
         static void copyImplData(const ReadImplInterface* from, WriteImplInterface* to, const std::vector<int64_t>& dims);
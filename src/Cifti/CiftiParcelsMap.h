@@ -50,6 +50,7 @@ namespace caret
         bool hasSurface(const StructureEnum::Enum& structure) const;//only checks whether surface has been added/read
         bool hasSurfaceData(const StructureEnum::Enum& structure) const;
         const VolumeSpace& getVolumeSpace() const;
+        bool hasVolumeSpace() const { return m_haveVolumeSpace; }//can be true without any voxels
         int64_t getSurfaceNumberOfNodes(const StructureEnum::Enum& structure) const;
         int64_t getIndexForNode(const int64_t& node, const StructureEnum::Enum& structure) const;
         int64_t getIndexForVoxel(const int64_t* ijk) const;
@@ -100,6 +100,7 @@ namespace caret
         static int directionFromString(const QString& input);//convenience conversion function, throws on error
         static QString directionFromStringExplanation();//and explanation text
     private:
+        friend class CiftiXMLCache;//restores the parsed version
         std::vector<CaretPointer<CiftiMappingType> > m_indexMaps;
         CiftiVersion m_parsedVersion;
         mutable GiftiMetaData m_fileMetaData;//hack to allow metadata to be modified without allowing dimension-changing operations
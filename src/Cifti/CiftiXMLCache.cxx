@@ -0,0 +1,599 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiXMLCache.h"
+
+#include "CaretAssert.h"
+#include "CaretHierarchy.h"
+#include "CaretLogger.h"
+#include "CaretPerfTrace.h"
+#include "CiftiXML.h"
+#include "DataFileException.h"
+#include "GiftiLabel.h"
+#include "GiftiLabelTable.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+QString CiftiXMLCache::s_directory;
+int64_t CiftiXMLCache::s_maxBytes = 0;
+
+namespace
+{
+    const char CACHE_MAGIC[8] = { 'W', 'B', 'C', 'X', 'M', 'L', '0', '1' };//change the version if the serialization changes
+
+    //small XML (series, few maps) parses faster than the cache file can be opened
+    const int64_t MIN_CACHED_XML_BYTES = 64 * 1024;
+
+    struct CacheHeader
+    {//native endian, a file from a machine with different endianness fails the magic check
+        char magic[8];
+        int64_t payloadBytes;
+    };
+
+    QString cacheFileName(const QString& directory, const QString& key)
+    {
+        return QDir(directory).filePath(key + ".cxml");
+    }
+
+    class CacheWriter
+    {
+        QByteArray& m_out;
+    public:
+        explicit CacheWriter(QByteArray& out) : m_out(out) { }
+        void writeData(const void* data, const int64_t& bytes)
+        {
+            if (bytes > 0) m_out.append((const char*)data, bytes);
+        }
+        template<typename T>
+        void write(const T& value) { writeData(&value, sizeof(T)); }
+        void writeString(const QString& text)
+        {
+            QByteArray utf8 = text.toUtf8();
+            write<int64_t>(utf8.size());
+            writeData(utf8.constData(), utf8.size());
+        }
+        void writeIndices(const vector<int64_t>& indices)
+        {
+            write<int64_t>(indices.size());
+            writeData(indices.data(), indices.size() * sizeof(int64_t));
+        }
+        void writeMetaData(const GiftiMetaData& metaData)
+        {
+            map<AString, AString> entries = metaData.getAsMap();
+            write<int64_t>(entries.size());
+            for (map<AString, AString>::const_iterator iter = entries.begin(); iter != entries.end(); ++iter)
+            {
+                writeString(iter->first);
+                writeString(iter->second);
+            }
+        }
+        void writeVolumeSpace(const VolumeSpace& space)
+        {
+            writeData(space.getDims(), 3 * sizeof(int64_t));
+            const vector<vector<float> >& sform = space.getSform();
+            for (int i = 0; i < 3; ++i)
+            {
+                CaretAssert(sform[i].size() == 4);
+                writeData(sform[i].data(), 4 * sizeof(float));
+            }
+        }
+    };
+
+    class CacheReader
+    {//throws on running off the end, so a bad file can't do anything worse than a cache miss
+        const char* m_cur, *m_end;
+    public:
+        CacheReader(const char* data, const int64_t& bytes) : m_cur(data), m_end(data + bytes) { }
+        bool atEnd() const { return m_cur == m_end; }
+        const char* readData(const int64_t& bytes)
+        {
+            if (bytes < 0 || bytes > m_end - m_cur) throw DataFileException("cifti xml cache data is truncated");
+            const char* ret = m_cur;
+            m_cur += bytes;
+            return ret;
+        }
+        template<typename T>
+        T read()
+        {
+            T ret;
+            memcpy(&ret, readData(sizeof(T)), sizeof(T));
+            return ret;
+        }
+        int64_t readCount(const int64_t& elementBytes)
+        {//check against the remaining size before anything allocates for it
+            int64_t ret = read<int64_t>();
+            if (ret < 0 || ret > (m_end - m_cur) / elementBytes) throw DataFileException("cifti xml cache data has an invalid count");
+            return ret;
+        }
+        QString readString()
+        {
+            int64_t bytes = readCount(1);
+            return QString::fromUtf8(readData(bytes), bytes);
+        }
+        vector<int64_t> readIndices()
+        {
+            vector<int64_t> ret(readCount(sizeof(int64_t)));
+            if (!ret.empty()) memcpy(ret.data(), readData(ret.size() * sizeof(int64_t)), ret.size() * sizeof(int64_t));
+            return ret;
+        }
+        void readMetaData(GiftiMetaData& metaDataOut)
+        {
+            int64_t numEntries = readCount(2 * sizeof(int64_t));
+            map<AString, AString> entries;
+            for (int64_t i = 0; i < numEntries; ++i)
+            {
+                AString key = readString();
+                entries[key] = readString();
+            }
+            metaDataOut.clear(false);//same as parsing, don't keep a generated unique ID
+            metaDataOut.replaceWithMap(entries);
+        }
+        VolumeSpace readVolumeSpace()
+        {
+            int64_t dims[3];
+            float sform[12];
+            memcpy(dims, readData(sizeof(dims)), sizeof(dims));
+            memcpy(sform, readData(sizeof(sform)), sizeof(sform));
+            return VolumeSpace(dims, sform);
+        }
+        StructureEnum::Enum readStructure()
+        {
+            bool valid = false;
+            StructureEnum::Enum ret = StructureEnum::fromIntegerCode(read<int32_t>(), &valid);
+            if (!valid) throw DataFileException("cifti xml cache data has an invalid structure");
+            return ret;
+        }
+    };
+
+    void writeBrainModels(CacheWriter& writer, const CiftiBrainModelsMap& myMap)
+    {
+        writer.write<uint8_t>(myMap.hasVolumeSpace() ? 1 : 0);
+        if (myMap.hasVolumeSpace()) writer.writeVolumeSpace(myMap.getVolumeSpace());
+        vector<CiftiBrainModelsMap::ModelInfo> models = myMap.getModelInfo();
+        writer.write<int64_t>(models.size());
+        for (size_t i = 0; i < models.size(); ++i)
+        {
+            writer.write<int32_t>(models[i].m_type);
+            writer.write<int32_t>(StructureEnum::toIntegerCode(models[i].m_structure));
+            if (models[i].m_type == CiftiBrainModelsMap::SURFACE)
+            {
+                writer.write<int64_t>(myMap.getSurfaceNumberOfNodes(models[i].m_structure));
+                writer.writeIndices(myMap.getNodeList(models[i].m_structure));
+            } else {
+                writer.writeIndices(myMap.getVoxelList(models[i].m_structure));
+            }
+        }
+    }
+
+    void readBrainModels(CacheReader& reader, CiftiBrainModelsMap& myMap)
+    {
+        if (reader.read<uint8_t>() != 0) myMap.setVolumeSpace(reader.readVolumeSpace());
+        int64_t numModels = reader.readCount(2 * sizeof(int32_t));
+        for (int64_t i = 0; i < numModels; ++i)
+        {
+            int32_t type = reader.read<int32_t>();
+            StructureEnum::Enum structure = reader.readStructure();
+            if (type == CiftiBrainModelsMap::SURFACE)
+            {
+                int64_t numNodes = reader.read<int64_t>();
+                myMap.addSurfaceModel(numNodes, structure, reader.readIndices());
+            } else if (type == CiftiBrainModelsMap::VOXELS) {
+                myMap.addVolumeModel(structure, reader.readIndices());
+            } else {
+                throw DataFileException("cifti xml cache data has an invalid model type");
+            }
+        }
+    }
+
+    void writeParcels(CacheWriter& writer, const CiftiParcelsMap& myMap)
+    {
+        writer.write<uint8_t>(myMap.hasVolumeSpace() ? 1 : 0);
+        if (myMap.hasVolumeSpace()) writer.writeVolumeSpace(myMap.getVolumeSpace());
+        vector<StructureEnum::Enum> surfaces = myMap.getParcelSurfaceStructures();
+        writer.write<int64_t>(surfaces.size());
+        for (size_t i = 0; i < surfaces.size(); ++i)
+        {
+            writer.write<int32_t>(StructureEnum::toIntegerCode(surfaces[i]));
+            writer.write<int64_t>(myMap.getSurfaceNumberOfNodes(surfaces[i]));
+        }
+        const vector<CiftiParcelsMap::Parcel>& parcels = myMap.getParcels();
+        writer.write<int64_t>(parcels.size());
+        for (size_t i = 0; i < parcels.size(); ++i)
+        {
+            const CiftiParcelsMap::Parcel& thisParcel = parcels[i];
+            writer.writeString(thisParcel.m_name);
+            writer.write<int64_t>(thisParcel.m_voxelIndices.size());
+            for (set<VoxelIJK>::const_iterator iter = thisParcel.m_voxelIndices.begin(); iter != thisParcel.m_voxelIndices.end(); ++iter)
+            {
+                writer.writeData(iter->m_ijk, 3 * sizeof(int64_t));
+            }
+            writer.write<int64_t>(thisParcel.m_surfaceNodes.size());
+            for (map<StructureEnum::Enum, set<int64_t> >::const_iterator iter = thisParcel.m_surfaceNodes.begin(); iter != thisParcel.m_surfaceNodes.end(); ++iter)
+            {
+                writer.write<int32_t>(StructureEnum::toIntegerCode(iter->first));
+                writer.writeIndices(vector<int64_t>(iter->second.begin(), iter->second.end()));
+            }
+        }
+    }
+
+    void readParcels(CacheReader& reader, CiftiParcelsMap& myMap)
+    {
+        if (reader.read<uint8_t>() != 0) myMap.setVolumeSpace(reader.readVolumeSpace());
+        int64_t numSurfaces = reader.readCount(sizeof(int32_t) + sizeof(int64_t));
+        for (int64_t i = 0; i < numSurfaces; ++i)
+        {
+            StructureEnum::Enum structure = reader.readStructure();
+            myMap.addSurface(reader.read<int64_t>(), structure);
+        }
+        int64_t numParcels = reader.readCount(3 * sizeof(int64_t));
+        for (int64_t i = 0; i < numParcels; ++i)
+        {
+            CiftiParcelsMap::Parcel thisParcel;
+            thisParcel.m_name = reader.readString();
+            int64_t numVoxels = reader.readCount(3 * sizeof(int64_t));
+            for (int64_t v = 0; v < numVoxels; ++v)
+            {
+                int64_t ijk[3];
+                memcpy(ijk, reader.readData(sizeof(ijk)), sizeof(ijk));
+                thisParcel.m_voxelIndices.insert(thisParcel.m_voxelIndices.end(), VoxelIJK(ijk));//written in sorted order
+            }
+            int64_t numParcelSurfaces = reader.readCount(sizeof(int32_t) + sizeof(int64_t));
+            for (int64_t s = 0; s < numParcelSurfaces; ++s)
+            {
+                StructureEnum::Enum structure = reader.readStructure();
+                vector<int64_t> nodes = reader.readIndices();
+                thisParcel.m_surfaceNodes[structure] = set<int64_t>(nodes.begin(), nodes.end());
+            }
+            myMap.addParcel(thisParcel);
+        }
+    }
+
+    void writeSeries(CacheWriter& writer, const CiftiSeriesMap& myMap)
+    {
+        writer.write<int64_t>(myMap.getLength());
+        writer.write<float>(myMap.getStart());
+        writer.write<float>(myMap.getStep());
+        writer.write<int32_t>(myMap.getUnit());
+    }
+
+    CiftiSeriesMap readSeries(CacheReader& reader)
+    {
+        int64_t length = reader.read<int64_t>();
+        float start = reader.read<float>();
+        float step = reader.read<float>();
+        int32_t unit = reader.read<int32_t>();
+        vector<CiftiSeriesMap::Unit> allUnits = CiftiSeriesMap::getAllUnits();
+        for (size_t i = 0; i < allUnits.size(); ++i)
+        {
+            if (allUnits[i] == unit) return CiftiSeriesMap(length, start, step, allUnits[i]);//length of -1 (cifti-1 without a length) is set later from the nifti header
+        }
+        throw DataFileException("cifti xml cache data has an invalid series unit");
+    }
+
+    void writeScalars(CacheWriter& writer, const CiftiScalarsMap& myMap)
+    {
+        int64_t length = myMap.getLength();
+        writer.write<int64_t>(length);
+        for (int64_t i = 0; i < length; ++i)
+        {
+            writer.writeString(myMap.getMapName(i));
+            writer.writeMetaData(*(myMap.getMapMetadata(i)));//palette is stored in the metadata
+        }
+    }
+
+    void readScalars(CacheReader& reader, CiftiScalarsMap& myMap)
+    {
+        int64_t length = reader.readCount(2 * sizeof(int64_t));
+        if (length < 1) throw DataFileException("cifti xml cache data has an empty scalars mapping");
+        myMap.setLength(length);
+        for (int64_t i = 0; i < length; ++i)
+        {
+            myMap.setMapName(i, reader.readString());
+            reader.readMetaData(*(myMap.getMapMetadata(i)));
+        }
+    }
+
+    void writeLabels(CacheWriter& writer, const CiftiLabelsMap& myMap)
+    {
+        int64_t length = myMap.getLength();
+        writer.write<int64_t>(length);
+        for (int64_t i = 0; i < length; ++i)
+        {
+            writer.writeString(myMap.getMapName(i));
+            writer.writeMetaData(*(myMap.getMapMetadata(i)));
+            const GiftiLabelTable* myTable = myMap.getMapLabelTable(i);
+            set<int32_t> keys = myTable->getKeys();
+            writer.write<int64_t>(keys.size());
+            for (set<int32_t>::const_iterator iter = keys.begin(); iter != keys.end(); ++iter)
+            {
+                const GiftiLabel* myLabel = myTable->getLabel(*iter);
+                CaretAssert(myLabel != NULL);
+                float rgba[4];
+                myLabel->getColor(rgba);
+                writer.write<int32_t>(*iter);
+                writer.writeString(myLabel->getName());
+                writer.writeData(rgba, sizeof(rgba));
+            }
+        }
+    }
+
+    void readLabels(CacheReader& reader, CiftiLabelsMap& myMap)
+    {
+        int64_t length = reader.readCount(3 * sizeof(int64_t));
+        if (length < 1) throw DataFileException("cifti xml cache data has an empty labels mapping");
+        myMap.setLength(length);
+        for (int64_t i = 0; i < length; ++i)
+        {
+            myMap.setMapName(i, reader.readString());
+            reader.readMetaData(*(myMap.getMapMetadata(i)));
+            GiftiLabelTable* myTable = myMap.getMapLabelTable(i);
+            myTable->clear();//same as parsing, includes the default unlabeled key
+            int64_t numLabels = reader.readCount(sizeof(int32_t) + sizeof(int64_t) + 4 * sizeof(float));
+            for (int64_t j = 0; j < numLabels; ++j)
+            {
+                int32_t key = reader.read<int32_t>();
+                QString name = reader.readString();
+                float rgba[4];
+                memcpy(rgba, reader.readData(sizeof(rgba)), sizeof(rgba));
+                myTable->setLabel(key, name, rgba[0], rgba[1], rgba[2], rgba[3]);
+            }
+            AString hierMDtext = myMap.getMapMetadata(i)->get("CaretHierarchy");
+            if (hierMDtext != "")
+            {//same as parsing, the hierarchy isn't compared by ==, so it must be recreated here
+                CaretHierarchy tempHier;
+                try {
+                    tempHier.readXML(hierMDtext);
+                } catch (const CaretException& e) {
+                    CaretLogWarning("error parsing hierarchy metadata: " + e.whatString());
+                }
+                myTable->setHierarchy(tempHier);
+            }
+        }
+    }
+}
+
+void CiftiXMLCache::setCacheDirectory(const QString& directory, const int64_t& maxBytes)
+{
+    s_directory = directory;
+    s_maxBytes = maxBytes;
+    if (directory != "" && !QDir().mkpath(directory))
+    {
+        CaretLogWarning("unable to create cifti xml cache directory '" + directory + "', cifti xml cache disabled");
+        s_directory = "";
+    }
+}
+
+bool CiftiXMLCache::isEnabled()
+{
+    return s_directory != "";
+}
+
+void CiftiXMLCache::readXML(CiftiXML& xmlOut, const QByteArray& data)
+{
+    if (!isEnabled() || data.size() < MIN_CACHED_XML_BYTES)
+    {
+        xmlOut.readXML(data);
+        return;
+    }
+    QCryptographicHash myHash(QCryptographicHash::Sha256);
+    myHash.addData(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    myHash.addData(data);//the XML is the only input to parsing, so file size and modification time add nothing, and renamed or copied files still hit
+    QString key(myHash.result().toHex());
+    if (load(key, xmlOut))
+    {
+        CaretPerfTrace::addCount("cifti xml cache hits");
+        return;
+    }
+    CaretPerfTrace::addCount("cifti xml cache misses");
+    xmlOut.readXML(data);//let parse errors propagate normally
+    store(key, xmlOut);
+}
+
+QByteArray CiftiXMLCache::serialize(const CiftiXML& xml)
+{
+    QByteArray ret;
+    CacheWriter writer(ret);
+    writer.write<int16_t>(xml.getParsedVersion().getMajor());
+    writer.write<int16_t>(xml.getParsedVersion().getMinor());
+    writer.writeMetaData(*(xml.getFileMetaData()));//file palette is stored in the metadata
+    int numDims = xml.getNumberOfDimensions();
+    writer.write<int32_t>(numDims);
+    for (int i = 0; i < numDims; ++i)
+    {
+        const CiftiMappingType* myMap = xml.getMap(i);
+        if (myMap == NULL)
+        {
+            writer.write<int32_t>(0);
+            continue;
+        }
+        writer.write<int32_t>(myMap->getType());
+        switch (myMap->getType())
+        {
+            case CiftiMappingType::BRAIN_MODELS:
+                writeBrainModels(writer, xml.getBrainModelsMap(i));
+                break;
+            case CiftiMappingType::PARCELS:
+                writeParcels(writer, xml.getParcelsMap(i));
+                break;
+            case CiftiMappingType::SERIES:
+                writeSeries(writer, xml.getSeriesMap(i));
+                break;
+            case CiftiMappingType::SCALARS:
+                writeScalars(writer, xml.getScalarsMap(i));
+                break;
+            case CiftiMappingType::LABELS:
+                writeLabels(writer, xml.getLabelsMap(i));
+                break;
+        }
+    }
+    return ret;
+}
+
+bool CiftiXMLCache::deserialize(const char* data, const int64_t& bytes, CiftiXML& xmlOut)
+{
+    xmlOut.clear();
+    try
+    {//fill the output in place, rather than copying a large mapping
+        CiftiXML& result = xmlOut;
+        CacheReader reader(data, bytes);
+        int16_t major = reader.read<int16_t>();
+        int16_t minor = reader.read<int16_t>();
+        result.m_parsedVersion = CiftiVersion(major, minor);
+        reader.readMetaData(*(result.getFileMetaData()));
+        int32_t numDims = reader.read<int32_t>();
+        if (numDims < 0 || numDims > bytes) throw DataFileException("cifti xml cache data has an invalid number of dimensions");
+        result.setNumberOfDimensions(numDims);
+        for (int i = 0; i < numDims; ++i)
+        {
+            int32_t type = reader.read<int32_t>();
+            switch (type)
+            {
+                case 0:
+                    break;
+                case CiftiMappingType::BRAIN_MODELS:
+                    result.setMap(i, CiftiBrainModelsMap());
+                    readBrainModels(reader, result.getBrainModelsMap(i));
+                    break;
+                case CiftiMappingType::PARCELS:
+                    result.setMap(i, CiftiParcelsMap());
+                    readParcels(reader, result.getParcelsMap(i));
+                    break;
+                case CiftiMappingType::SERIES:
+                    result.setMap(i, readSeries(reader));
+                    break;
+                case CiftiMappingType::SCALARS:
+                    result.setMap(i, CiftiScalarsMap());
+                    readScalars(reader, result.getScalarsMap(i));
+                    break;
+                case CiftiMappingType::LABELS:
+                    result.setMap(i, CiftiLabelsMap());
+                    readLabels(reader, result.getLabelsMap(i));
+                    break;
+                default:
+                    throw DataFileException("cifti xml cache data has an invalid mapping type");
+            }
+        }
+        if (!reader.atEnd()) throw DataFileException("cifti xml cache data has extra bytes at the end");
+    } catch (CaretException& e) {
+        CaretLogFine("invalid cifti xml cache data: " + e.whatString());
+        xmlOut.clear();
+        return false;
+    }
+    return true;
+}
+
+bool CiftiXMLCache::load(const QString& key, CiftiXML& xmlOut)
+{
+    QFile myFile(cacheFileName(s_directory, key));
+    if (!myFile.open(QIODevice::ReadOnly)) return false;//the normal cache miss
+    CacheHeader header;
+    if (myFile.read((char*)&header, sizeof(CacheHeader)) != (qint64)sizeof(CacheHeader) || memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.payloadBytes < 0 || myFile.size() != (qint64)(sizeof(CacheHeader) + header.payloadBytes))
+    {
+        CaretLogInfo("ignoring invalid cifti xml cache file '" + myFile.fileName() + "'");
+        return false;
+    }
+    const uchar* mapped = myFile.map(sizeof(CacheHeader), header.payloadBytes);//index arrays are copied straight out of the mapping, with no text to convert
+    if (mapped == NULL)
+    {
+        CaretLogInfo("failed to map cifti xml cache file '" + myFile.fileName() + "'");
+        return false;
+    }
+    bool ok = deserialize((const char*)mapped, header.payloadBytes, xmlOut);
+    myFile.unmap((uchar*)mapped);
+    if (!ok)
+    {
+        CaretLogInfo("ignoring inconsistent cifti xml cache file '" + myFile.fileName() + "'");
+        return false;
+    }
+    CaretLogFine("loaded cifti xml from cache file '" + myFile.fileName() + "'");
+    return true;
+}
+
+void CiftiXMLCache::store(const QString& key, const CiftiXML& xml)
+{
+    QByteArray payload = serialize(xml);
+    CiftiXML check;//only cache what reads back identically, in case a mapping has something the binary form doesn't capture
+    if (!deserialize(payload.constData(), payload.size(), check) || check != xml || check.getParsedVersion() != xml.getParsedVersion())
+    {
+        CaretLogInfo("parsed cifti xml does not round trip through the cache format, not caching it");
+        return;
+    }
+    QString finalName = cacheFileName(s_directory, key);
+    static std::atomic<int64_t> tempCounter(0);//files can also be opened on several threads at once, see DataFilePrefetcher
+    QString tempName = finalName + ".tmp" + QString::number(QCoreApplication::applicationPid()) + "_" + QString::number(tempCounter++);//concurrent processes may read the same file, don't write into each others' files
+    QFile myFile(tempName);
+    if (!myFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        CaretLogInfo("unable to write cifti xml cache file '" + tempName + "'");
+        return;
+    }
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.payloadBytes = payload.size();
+    bool ok = myFile.write((const char*)&header, sizeof(CacheHeader)) == (qint64)sizeof(CacheHeader);
+    ok = ok && myFile.write(payload) == (qint64)payload.size();
+    ok = ok && myFile.flush();
+    myFile.close();
+    if (!ok)
+    {
+        CaretLogInfo("failed to write cifti xml cache file '" + tempName + "'");
+        myFile.remove();
+        return;
+    }
+    QFile::remove(finalName);//if another process stored the same key first, the contents are identical anyway
+    if (!myFile.rename(finalName))
+    {
+        myFile.remove();
+        return;
+    }
+    enforceSizeLimit();
+}
+
+void CiftiXMLCache::enforceSizeLimit()
+{
+    if (s_maxBytes <= 0) return;
+    QFileInfoList entries = QDir(s_directory).entryInfoList(QStringList() << "*.cxml", QDir::Files, QDir::Time | QDir::Reversed);//oldest first
+    int64_t total = 0;
+    for (int i = 0; i < entries.size(); ++i)
+    {
+        total += entries[i].size();
+    }
+    for (int i = 0; i < entries.size() && total > s_maxBytes; ++i)
+    {
+        if (QFile::remove(entries[i].absoluteFilePath()))
+        {
+            total -= entries[i].size();
+        }
+    }
+}
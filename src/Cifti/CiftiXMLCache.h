@@ -0,0 +1,59 @@
+#ifndef __CIFTI_XML_CACHE_H__
+#define __CIFTI_XML_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <QByteArray>
+#include <QString>
+
+#include <stdint.h>
+
+namespace caret
+{
+    class CiftiXML;
+
+    ///on-disk cache of parsed cifti XML in a binary form, keyed by a hash of the XML text, so that files with large brain models or parcels mappings don't need their XML parsed every time they are opened
+    ///disabled unless a directory is set, all failures to read or write the cache are logged and treated as a cache miss
+    class CiftiXMLCache
+    {
+    public:
+        ///empty directory disables the cache, maxBytes <= 0 means no size limit
+        static void setCacheDirectory(const QString& directory, const int64_t& maxBytes);
+        static bool isEnabled();
+
+        ///same as xmlOut.readXML(data), but uses and fills the cache when it is enabled and the XML is large enough to be worth caching
+        static void readXML(CiftiXML& xmlOut, const QByteArray& data);
+
+        ///binary form of everything in the XML, exposed for testing
+        static QByteArray serialize(const CiftiXML& xml);
+        ///returns false if the data is not a valid serialization
+        static bool deserialize(const char* data, const int64_t& bytes, CiftiXML& xmlOut);
+    private:
+        static QString s_directory;
+        static int64_t s_maxBytes;
+        static bool load(const QString& key, CiftiXML& xmlOut);
+        static void store(const QString& key, const CiftiXML& xml);
+        static void enforceSizeLimit();
+    };
+
+}
+
+#endif //__CIFTI_XML_CACHE_H__
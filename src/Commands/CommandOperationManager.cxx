@@ -252,9 +252,16 @@
 #include "CommandUnitTest.h"
 #include "ProgramParameters.h"
 
+#include "CaretBinaryFile.h"
 #include "CaretLogger.h"
+#include "CaretPerfTrace.h"
 #include "dot_wrapper.h"
+#include "DotBlockKernel.h"
 #include "CaretCommandGlobalOptions.h"
+#include "CiftiFile.h"
+#include "CiftiXMLCache.h"
+#include "SparseWeightCache.h"
+#include "VolumeFile.h"
 
 #include <iostream>
 #include <map>
@@ -596,6 +603,7 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
         {
             CaretLogWarning("SIMD type '" + DotSIMDEnum::toName(impl) + "' not supported (could be cpu, compiler, or build options), using '" + DotSIMDEnum::toName(retval) + "'");
         }
+        DotBlockKernel::setImplementation(impl);//does its own fallback, and selects FMA variants when AUTO
     }
     if (getGlobalOption(parameters, "-nifti-output-datatype", 1, globalOptionArgs))
     {
@@ -631,6 +639,46 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
     {
         caret_global_command_options.m_ciftiReadMemory = true;
     }
+    if (getGlobalOption(parameters, "-block-gzip", 0, globalOptionArgs))
+    {
+        CaretBinaryFile::setBlockGzipWriting(true);
+    }
+    if (getGlobalOption(parameters, "-weight-cache", 2, globalOptionArgs))
+    {
+        bool valid = false;
+        double maxMB = globalOptionArgs[1].toDouble(&valid);
+        if (!valid || maxMB < 0.0) throw CommandException("invalid size limit for -weight-cache: '" + globalOptionArgs[1] + "'");
+        SparseWeightCache::setCacheDirectory(globalOptionArgs[0], (int64_t)(maxMB * 1024 * 1024));
+    }
+    if (getGlobalOption(parameters, "-cifti-xml-cache", 2, globalOptionArgs))
+    {
+        bool valid = false;
+        double maxMB = globalOptionArgs[1].toDouble(&valid);
+        if (!valid || maxMB < 0.0) throw CommandException("invalid size limit for -cifti-xml-cache: '" + globalOptionArgs[1] + "'");
+        CiftiXMLCache::setCacheDirectory(globalOptionArgs[0], (int64_t)(maxMB * 1024 * 1024));
+    }
+    if (getGlobalOption(parameters, "-cifti-column-cache", 1, globalOptionArgs))
+    {
+        bool valid = false;
+        double maxMB = globalOptionArgs[0].toDouble(&valid);
+        if (!valid || maxMB < 0.0) throw CommandException("invalid size limit for -cifti-column-cache: '" + globalOptionArgs[0] + "'");
+        CiftiFile::setColumnCacheLimit((int64_t)(maxMB * 1024 * 1024));
+    }
+    if (getGlobalOption(parameters, "-volume-paging", 1, globalOptionArgs))
+    {
+        bool valid = false;
+        double maxMB = globalOptionArgs[0].toDouble(&valid);
+        if (!valid || maxMB < 0.0) throw CommandException("invalid size limit for -volume-paging: '" + globalOptionArgs[0] + "'");
+        VolumeFile::setPagedReadingMemoryLimit((int64_t)(maxMB * 1024 * 1024));
+    }
+    if (getGlobalOption(parameters, "-perf-report", 0, globalOptionArgs))
+    {
+        CaretPerfTrace::enable();
+    }
+    if (getGlobalOption(parameters, "-perf-trace", 1, globalOptionArgs))
+    {
+        CaretPerfTrace::setTraceFile(globalOptionArgs[0]);
+    }
 
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
@@ -729,6 +777,7 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
                 cout << operation->getHelpInformation(myProgramName) << endl;
             } else {
                 operation->execute(parameters, preventProvenance);
+                CaretPerfTrace::writeReport(cerr, commandSwitch);//does nothing unless -perf-report or -perf-trace was given
             }
         }
     }
@@ -785,7 +834,34 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
         return "";
     }
     /*OptionInfo ciftiReadMemInfo = */parseGlobalOption(parameters, "-cifti-read-memory", 0, globalOptionArgs, true);
-    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -cifti-output-datatype\\ -cifti-output-range\\ -nifti-output-datatype\\ -nifti-output-range\\ -cifti-read-memory";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
+    /*OptionInfo blockGzipInfo = */parseGlobalOption(parameters, "-block-gzip", 0, globalOptionArgs, true);
+    OptionInfo weightCacheInfo = parseGlobalOption(parameters, "-weight-cache", 2, globalOptionArgs, true);
+    if (weightCacheInfo.specified && !weightCacheInfo.complete)
+    {
+        return "";
+    }
+    OptionInfo ciftiXMLCacheInfo = parseGlobalOption(parameters, "-cifti-xml-cache", 2, globalOptionArgs, true);
+    if (ciftiXMLCacheInfo.specified && !ciftiXMLCacheInfo.complete)
+    {
+        return "";
+    }
+    OptionInfo ciftiColumnCacheInfo = parseGlobalOption(parameters, "-cifti-column-cache", 1, globalOptionArgs, true);
+    if (ciftiColumnCacheInfo.specified && !ciftiColumnCacheInfo.complete)
+    {
+        return "";
+    }
+    OptionInfo volumePagingInfo = parseGlobalOption(parameters, "-volume-paging", 1, globalOptionArgs, true);
+    if (volumePagingInfo.specified && !volumePagingInfo.complete)
+    {
+        return "";
+    }
+    /*OptionInfo perfReportInfo = */parseGlobalOption(parameters, "-perf-report", 0, globalOptionArgs, true);
+    OptionInfo perfTraceInfo = parseGlobalOption(parameters, "-perf-trace", 1, globalOptionArgs, true);
+    if (perfTraceInfo.specified && !perfTraceInfo.complete)
+    {
+        return "";
+    }
+    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -cifti-output-datatype\\ -cifti-output-range\\ -nifti-output-datatype\\ -nifti-output-range\\ -cifti-read-memory\\ -block-gzip\\ -weight-cache\\ -cifti-xml-cache\\ -cifti-column-cache\\ -volume-paging\\ -perf-report\\ -perf-trace";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
     if (!parameters.hasNext())
@@ -1184,6 +1260,48 @@ void CommandOperationManager::printGlobalOptions()
     cout << "                                        avoid hitting limits on number of open" << endl;
     cout << "                                        files" << endl;
     cout << endl;
+    cout << "   -block-gzip                       write .gz outputs as block gzip, which" << endl;
+    cout << "                                        gzip can still read, but allows fast" << endl;
+    cout << "                                        seeking and multithreaded reading" << endl;
+    cout << endl;
+    cout << "   -weight-cache <directory> <max-MB>" << endl;
+    cout << "                                     save computed smoothing and resampling" << endl;
+    cout << "                                        weights in the directory, and reuse" << endl;
+    cout << "                                        them when the same surfaces and" << endl;
+    cout << "                                        settings are used again, removing the" << endl;
+    cout << "                                        oldest files when over the size limit" << endl;
+    cout << endl;
+    cout << "   -cifti-xml-cache <directory> <max-MB>" << endl;
+    cout << "                                     save the parsed XML of large cifti" << endl;
+    cout << "                                        inputs in the directory in a binary" << endl;
+    cout << "                                        form, and reuse it when a file with the" << endl;
+    cout << "                                        same XML is read again, removing the" << endl;
+    cout << "                                        oldest files when over the size limit" << endl;
+    cout << endl;
+    cout << "   -cifti-column-cache <max-MB>      read maps of large on-disk cifti files" << endl;
+    cout << "                                        from a transposed copy in the user's" << endl;
+    cout << "                                        cache directory, built when a map is" << endl;
+    cout << "                                        first read, removing the least" << endl;
+    cout << "                                        recently used copies when over the" << endl;
+    cout << "                                        size limit" << endl;
+    cout << endl;
+    cout << "   -volume-paging <max-MB>           read uncompressed single-component NIFTI" << endl;
+    cout << "                                        inputs larger than the limit a frame" << endl;
+    cout << "                                        at a time as frames are used, keeping" << endl;
+    cout << "                                        about max-MB of each in memory, for" << endl;
+    cout << "                                        files larger than RAM" << endl;
+    cout << endl;
+    cout << "   -perf-report                      after the command finishes, print time" << endl;
+    cout << "                                        spent in reading, writing, weight" << endl;
+    cout << "                                        computation and other phases, bytes" << endl;
+    cout << "                                        read and written per file, peak" << endl;
+    cout << "                                        memory use, and thread utilization to" << endl;
+    cout << "                                        standard error" << endl;
+    cout << endl;
+    cout << "   -perf-trace <file>                like -perf-report, and also write the" << endl;
+    cout << "                                        phases as a chrome trace event file," << endl;
+    cout << "                                        for chrome://tracing or perfetto" << endl;
+    cout << endl;
     cout << "   -cifti-output-datatype <type>     deprecated, only affects cifti outputs" << endl;
     cout << "   -cifti-output-range <min> <max>   deprecated, only affects cifti outputs" << endl;
     cout << endl;
@@ -33,9 +33,13 @@
 
 =========================================================================*/
 #include "CaretAssert.h"
+#include "CaretOMP.h"
 
 #include "Base64.h"
 
+#include <algorithm>
+#include <vector>
+
 using namespace caret;
 
 //----------------------------------------------------------------------------
@@ -298,3 +302,157 @@ uint64_t Base64::decode(const unsigned char *input,
 
   return optr - output;
 }
+
+//----------------------------------------------------------------------------
+namespace
+{
+  //quads (4 characters, 3 bytes) decoded by one thread at a time
+  const uint64_t DECODE_STREAM_BLOCK_QUADS = 16384;
+
+  //set in the shifted tables for any character that stops the fast decoding
+  const uint32_t DECODE_STREAM_STOP = 0x80000000;
+
+  //decoded 6-bit values already shifted to their position in a quad, so
+  //decoding a quad is 4 lookups and 3 ORs, padding also stops decoding
+  struct ShiftedDecodeTables
+  {
+    uint32_t shifted[4][256];
+    ShiftedDecodeTables()
+    {
+      for (int c = 0; c < 256; ++c)
+        {
+        const unsigned char value = Base64DecodeTable[c];
+        for (int position = 0; position < 4; ++position)
+          {
+          if (value == 0xFF || c == '=')
+            {
+            shifted[position][c] = DECODE_STREAM_STOP;
+            }
+          else
+            {
+            shifted[position][c] = ((uint32_t)value) << (6 * (3 - position));
+            }
+          }
+        }
+    }
+  };
+
+  const ShiftedDecodeTables& getShiftedDecodeTables()
+  {
+    static const ShiftedDecodeTables tables;
+    return tables;
+  }
+
+  inline bool isBase64Whitespace(const unsigned char c)
+  {
+    return (c == ' ') || (c == '\n') || (c == '\r') || (c == '\t');
+  }
+
+  //decode quads in blocks on several threads, returns the first quad that
+  //has a character that isn't base64 (including padding and whitespace)
+  uint64_t decodeStreamQuads(const unsigned char *text,
+                             const uint64_t numQuads,
+                             unsigned char *output)
+  {
+    const ShiftedDecodeTables& tables = getShiftedDecodeTables();
+    const int64_t numBlocks = (numQuads + DECODE_STREAM_BLOCK_QUADS - 1) / DECODE_STREAM_BLOCK_QUADS;
+    std::vector<uint64_t> blockStops(numBlocks);
+#pragma omp CARET_PARFOR schedule(static) if(numBlocks > 1)
+    for (int64_t block = 0; block < numBlocks; ++block)
+      {
+      const uint64_t blockEnd = std::min((block + 1) * DECODE_STREAM_BLOCK_QUADS, numQuads);
+      uint64_t quad = block * DECODE_STREAM_BLOCK_QUADS;
+      const unsigned char *ptr = text + quad * 4;
+      unsigned char *optr = output + quad * 3;
+      for (; quad < blockEnd; ++quad)
+        {
+        const uint32_t bits = (tables.shifted[0][ptr[0]] | tables.shifted[1][ptr[1]]
+                               | tables.shifted[2][ptr[2]] | tables.shifted[3][ptr[3]]);
+        if (bits & DECODE_STREAM_STOP)
+          {
+          break;
+          }
+        optr[0] = (unsigned char)(bits >> 16);
+        optr[1] = (unsigned char)(bits >> 8);
+        optr[2] = (unsigned char)bits;
+        ptr += 4;
+        optr += 3;
+        }
+      blockStops[block] = quad;
+      }
+    for (int64_t block = 0; block < numBlocks; ++block)
+      {
+      if (blockStops[block] < std::min((block + 1) * DECODE_STREAM_BLOCK_QUADS, numQuads))
+        {
+        return blockStops[block];
+        }
+      }
+    return numQuads;
+  }
+}
+
+//----------------------------------------------------------------------------
+uint64_t Base64::decodeStream(const char *input,
+                              uint64_t inputLength,
+                              unsigned char *output,
+                              uint64_t maxOutputLength)
+{
+  const unsigned char *text = (const unsigned char*)input;
+
+  // Decode complete triplets that fit in the output
+
+  const uint64_t numQuads = inputLength / 4;
+  uint64_t quad = decodeStreamQuads(text,
+                                    std::min(numQuads, maxOutputLength / 3),
+                                    output);
+
+  // If decoding stopped at whitespace, remove the whitespace from
+  // the rest of the text and decode that
+
+  for (uint64_t i = quad * 4; i < inputLength; ++i)
+    {
+    if (isBase64Whitespace(text[i]))
+      {
+      std::vector<char> compacted;
+      compacted.reserve(inputLength - quad * 4);
+      for (uint64_t j = quad * 4; j < inputLength; ++j)
+        {
+        if (!isBase64Whitespace(text[j]))
+          {
+          compacted.push_back(text[j]);
+          }
+        }
+      return quad * 3 + decodeStream(compacted.data(),
+                                     compacted.size(),
+                                     output + quad * 3,
+                                     maxOutputLength - quad * 3);
+      }
+    }
+
+  // Decode the rest one triplet at a time, this handles padding and a
+  // last triplet that only partly fits in the output
+
+  unsigned char *optr = output + quad * 3;
+  unsigned char *oend = output + maxOutputLength;
+  while (quad < numQuads && optr < oend)
+    {
+    const unsigned char *ptr = text + quad * 4;
+    unsigned char temp[3];
+    int len = 
+      Base64::DecodeTriplet(ptr[0], ptr[1], ptr[2], ptr[3],
+                            &temp[0], &temp[1], &temp[2]);
+    if (len > oend - optr)
+      {
+      len = oend - optr;
+      }
+    std::copy(temp, temp + len, optr);
+    optr += len;
+    if (len < 3)
+      {
+      break;
+      }
+    ++quad;
+    }
+
+  return optr - output;
+}
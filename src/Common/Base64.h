@@ -88,6 +88,18 @@ public:
                               uint64_t length, 
                               unsigned char *output,
                               uint64_t max_input_length = 0);
+
+  // Description:
+  // Decode a complete base64 stream of 'inputLength' characters into at
+  // most 'maxOutputLength' bytes, and return the number of bytes decoded.
+  // Whitespace (such as line breaks in XML text) is ignored, decoding
+  // stops at padding or any other character that is not base64.  The input
+  // does not need to be null terminated.  Long streams are decoded by
+  // several threads, output past the returned length may be overwritten.
+  static uint64_t decodeStream(const char *input,
+                               uint64_t inputLength,
+                               unsigned char *output,
+                               uint64_t maxOutputLength);
     
 private:
     // Description:  
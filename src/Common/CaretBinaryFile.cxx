@@ -28,6 +28,8 @@
 #include "CaretAssert.h"
 #include "CaretBinaryFile.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "CaretPerfTrace.h"
 #include "DataFileException.h"
 
 #include <QDir>
@@ -35,7 +37,9 @@
 #include "zlib.h"
 
 #include <cstdio>
+#include <cstring>
 #include <algorithm>
+#include <vector>
 
 using namespace caret;
 using namespace std;
@@ -61,6 +65,47 @@ namespace caret
     };
     
     const int64_t ZFileImpl::CHUNK_SIZE = 1<<26;//64MiB, large enough for good performance, small enough for zlib, must convert to uint32
+    
+    //block gzip (BGZF, as used by htslib): a series of independent gzip members of at most 64KiB, each with its compressed size in an extra header field
+    //standard gzip tools see a normal multi-member gzip file, but we can index the blocks, seek to any of them, and decompress many at once
+    class BgzfFileImpl : public CaretBinaryFile::ImplInterface
+    {
+        QFile m_file;
+        bool m_writing;
+        int64_t m_pos;//uncompressed position
+        vector<int64_t> m_blockStarts, m_blockOffsets;//reading: compressed start and uncompressed offset of each block, plus one extra entry for the end of the file
+        vector<char> m_pending;//writing: uncompressed data that hasn't been compressed yet
+        int64_t m_cachedBlock;//reading: which block m_blockCache holds, for reads that don't cover entire blocks
+        vector<char> m_blockCache, m_compressedScratch;
+        const static int64_t BLOCK_DATA_SIZE, MAX_BLOCK_SIZE, WRITE_BATCH_BLOCKS, READ_BATCH_SIZE;
+        const static int HEADER_SIZE, FOOTER_SIZE;
+        static int64_t parseBlockSize(const unsigned char* header);//returns -1 if not a BGZF block header
+        static bool inflateBlock(const char* block, const int64_t& blockSize, char* dataOut, const int64_t& dataSize);
+        static void deflateBlock(const char* data, const int64_t& dataSize, vector<char>& blockOut);
+        void buildIndex();
+        int64_t findBlock(const int64_t& position) const;
+        void readCompressed(const int64_t& startBlock, const int64_t& endBlock);
+        void loadCache(const int64_t& block);
+        void flushBlocks(const bool& final);
+    public:
+        BgzfFileImpl() { m_writing = false; m_pos = 0; m_cachedBlock = -1; }
+        static bool isBlockGzip(const QString& filename);
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        void close();
+        void seek(const int64_t& position);
+        int64_t pos() { return m_pos; }
+        int64_t size();
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+        ~BgzfFileImpl();
+    };
+    
+    const int64_t BgzfFileImpl::BLOCK_DATA_SIZE = 65280;//same as htslib, so that even incompressible data fits in a block
+    const int64_t BgzfFileImpl::MAX_BLOCK_SIZE = 65536;
+    const int64_t BgzfFileImpl::WRITE_BATCH_BLOCKS = 256;//~16MiB of uncompressed data per parallel compression step
+    const int64_t BgzfFileImpl::READ_BATCH_SIZE = 1<<26;//64MiB of compressed data per parallel decompression step
+    const int BgzfFileImpl::HEADER_SIZE = 18;
+    const int BgzfFileImpl::FOOTER_SIZE = 8;
 #endif //ZLIB_VERSION
 
     class QFileImpl : public CaretBinaryFile::ImplInterface
@@ -80,10 +125,22 @@ namespace caret
     const int64_t QFileImpl::CHUNK_SIZE = 1<<30;//1GiB, QT4 apparently chokes at more than 2GiB via buffer.read using int32
 }
 
+bool CaretBinaryFile::s_blockGzipWriting = false;
+
 CaretBinaryFile::ImplInterface::~ImplInterface()
 {
 }
 
+void CaretBinaryFile::setBlockGzipWriting(const bool& enabled)
+{
+    s_blockGzipWriting = enabled;
+}
+
+bool CaretBinaryFile::getBlockGzipWriting()
+{
+    return s_blockGzipWriting;
+}
+
 CaretBinaryFile::CaretBinaryFile(const QString& filename, const OpenMode& fileMode)
 {
     open(filename, fileMode);
@@ -120,7 +177,12 @@ void CaretBinaryFile::open(const QString& filename, const OpenMode& opmode)
     if (filename.endsWith(".gz"))
     {
 #ifdef ZLIB_VERSION
-        m_impl.grabNew(new ZFileImpl());
+        if ((opmode == READ && BgzfFileImpl::isBlockGzip(filename)) || (opmode == WRITE_TRUNCATE && s_blockGzipWriting))
+        {
+            m_impl.grabNew(new BgzfFileImpl());
+        } else {
+            m_impl.grabNew(new ZFileImpl());
+        }
 #else //ZLIB_VERSION
         throw DataFileException("can't open .gz file '" + filename + "', compiled without zlib support");
 #endif //ZLIB_VERSION
@@ -136,6 +198,7 @@ void CaretBinaryFile::read(void* dataOut, const int64_t& count, int64_t* numRead
     CaretAssert(count >= 0);//not sure about allowing 0
     if (!getOpenForRead()) throw DataFileException("file is not open for reading");
     m_impl->read(dataOut, count, numRead);
+    if (CaretPerfTrace::isEnabled()) CaretPerfTrace::addBytesRead(getFilename(), (numRead == NULL ? count : *numRead));
 }
 
 void CaretBinaryFile::seek(const int64_t& position)
@@ -162,6 +225,7 @@ void CaretBinaryFile::write(const void* dataIn, const int64_t& count)
     CaretAssert(count >= 0);//not sure about allowing 0
     if (!getOpenForWrite()) throw DataFileException("file is not open for writing");
     m_impl->write(dataIn, count);
+    if (CaretPerfTrace::isEnabled()) CaretPerfTrace::addBytesWritten(getFilename(), count);
 }
 
 #ifdef ZLIB_VERSION
@@ -283,6 +347,323 @@ ZFileImpl::~ZFileImpl()
         CaretLogSevere("caught unknown exception type while closing a compressed file");
     }
 }
+
+int64_t BgzfFileImpl::parseBlockSize(const unsigned char* header)
+{
+    if (header[0] != 31 || header[1] != 139 || header[2] != 8 || header[3] != 4) return -1;//gzip magic, deflate, only FEXTRA flag set
+    if (header[10] != 6 || header[11] != 0) return -1;//XLEN, BGZF has exactly one subfield
+    if (header[12] != 'B' || header[13] != 'C' || header[14] != 2 || header[15] != 0) return -1;
+    return (int64_t)header[16] + ((int64_t)header[17] << 8) + 1;//BSIZE is total block size minus 1
+}
+
+bool BgzfFileImpl::isBlockGzip(const QString& filename)
+{
+    QFile testFile(filename);
+    if (!testFile.open(QIODevice::ReadOnly)) return false;//let ZFileImpl generate the error message
+    unsigned char header[HEADER_SIZE];
+    if (testFile.read((char*)header, HEADER_SIZE) != HEADER_SIZE) return false;
+    return parseBlockSize(header) > 0;
+}
+
+bool BgzfFileImpl::inflateBlock(const char* block, const int64_t& blockSize, char* dataOut, const int64_t& dataSize)
+{//static and no shared state, so blocks can be inflated in parallel
+    if (dataSize == 0) return true;//EOF marker, or an empty block
+    z_stream myStream;
+    myStream.zalloc = Z_NULL;
+    myStream.zfree = Z_NULL;
+    myStream.opaque = Z_NULL;
+    myStream.next_in = (Bytef*)(block + HEADER_SIZE);
+    myStream.avail_in = (uInt)(blockSize - HEADER_SIZE - FOOTER_SIZE);
+    if (inflateInit2(&myStream, -15) != Z_OK) return false;//negative window bits for raw deflate, we have already parsed the gzip header
+    myStream.next_out = (Bytef*)dataOut;
+    myStream.avail_out = (uInt)dataSize;
+    int ret = inflate(&myStream, Z_FINISH);
+    inflateEnd(&myStream);
+    if (ret != Z_STREAM_END || myStream.avail_out != 0) return false;
+    const unsigned char* footer = (const unsigned char*)(block + blockSize - FOOTER_SIZE);
+    uLong expectCRC = (uLong)footer[0] + ((uLong)footer[1] << 8) + ((uLong)footer[2] << 16) + ((uLong)footer[3] << 24);
+    return crc32(crc32(0L, Z_NULL, 0), (const Bytef*)dataOut, (uInt)dataSize) == expectCRC;
+}
+
+void BgzfFileImpl::deflateBlock(const char* data, const int64_t& dataSize, vector<char>& blockOut)
+{//also static for parallel use, throws only on zlib init failure
+    CaretAssert(dataSize <= BLOCK_DATA_SIZE);
+    blockOut.resize(MAX_BLOCK_SIZE);
+    int64_t compressedSize = -1;
+    for (int level = Z_DEFAULT_COMPRESSION; compressedSize < 0; level = 0)//if compression makes it too big, store it uncompressed instead, BLOCK_DATA_SIZE ensures it fits
+    {
+        z_stream myStream;
+        myStream.zalloc = Z_NULL;
+        myStream.zfree = Z_NULL;
+        myStream.opaque = Z_NULL;
+        if (deflateInit2(&myStream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) throw DataFileException("failed to initialize zlib compression");
+        myStream.next_in = (Bytef*)data;
+        myStream.avail_in = (uInt)dataSize;
+        myStream.next_out = (Bytef*)(blockOut.data() + HEADER_SIZE);
+        myStream.avail_out = (uInt)(MAX_BLOCK_SIZE - HEADER_SIZE - FOOTER_SIZE);
+        int ret = deflate(&myStream, Z_FINISH);
+        if (ret == Z_STREAM_END) compressedSize = MAX_BLOCK_SIZE - HEADER_SIZE - FOOTER_SIZE - myStream.avail_out;
+        deflateEnd(&myStream);
+        if (compressedSize < 0 && level == 0) throw DataFileException("failed to compress block");//shouldn't happen
+    }
+    const int64_t blockSize = HEADER_SIZE + compressedSize + FOOTER_SIZE;
+    const unsigned char header[HEADER_SIZE] = { 31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0,
+                                                (unsigned char)((blockSize - 1) & 0xFF), (unsigned char)((blockSize - 1) >> 8) };
+    memcpy(blockOut.data(), header, HEADER_SIZE);
+    uLong myCRC = crc32(crc32(0L, Z_NULL, 0), (const Bytef*)data, (uInt)dataSize);
+    unsigned char* footer = (unsigned char*)(blockOut.data() + HEADER_SIZE + compressedSize);
+    for (int i = 0; i < 4; ++i)
+    {
+        footer[i] = (unsigned char)((myCRC >> (8 * i)) & 0xFF);
+        footer[i + 4] = (unsigned char)((((uint64_t)dataSize) >> (8 * i)) & 0xFF);
+    }
+    blockOut.resize(blockSize);
+}
+
+void BgzfFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    close();
+    m_fileName = filename;
+    m_pos = 0;
+    m_cachedBlock = -1;
+    m_blockStarts.clear();
+    m_blockOffsets.clear();
+    m_pending.clear();
+    m_file.setFileName(filename);
+    switch (opmode)
+    {
+        case CaretBinaryFile::READ:
+            m_writing = false;
+            if (!m_file.open(QIODevice::ReadOnly)) throw DataFileException("failed to open compressed file '" + filename + "'");
+            buildIndex();
+            break;
+        case CaretBinaryFile::WRITE_TRUNCATE:
+            m_writing = true;
+            remove(QDir::toNativeSeparators(filename).toLocal8Bit());//same reasoning as the other implementations
+            if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) throw DataFileException("failed to open compressed file '" + filename + "', unable to create file");
+            break;
+        default:
+            throw DataFileException("compressed file only supports READ and WRITE_TRUNCATE modes");
+    }
+}
+
+void BgzfFileImpl::buildIndex()
+{//reads only the header and footer of each block
+    const int64_t fileSize = m_file.size();
+    int64_t compressedPos = 0, uncompressedPos = 0;
+    unsigned char header[HEADER_SIZE], isize[4];
+    while (compressedPos < fileSize)
+    {
+        if (!m_file.seek(compressedPos) || m_file.read((char*)header, HEADER_SIZE) != HEADER_SIZE)
+        {
+            throw DataFileException("error while reading block header in compressed file '" + m_fileName + "'");
+        }
+        int64_t blockSize = parseBlockSize(header);
+        if (blockSize < HEADER_SIZE + FOOTER_SIZE || compressedPos + blockSize > fileSize)
+        {
+            throw DataFileException("compressed file '" + m_fileName + "' starts with block gzip, but contains a malformed block");
+        }
+        if (!m_file.seek(compressedPos + blockSize - 4) || m_file.read((char*)isize, 4) != 4)
+        {
+            throw DataFileException("error while reading block footer in compressed file '" + m_fileName + "'");
+        }
+        m_blockStarts.push_back(compressedPos);
+        m_blockOffsets.push_back(uncompressedPos);
+        compressedPos += blockSize;
+        uncompressedPos += (int64_t)isize[0] + ((int64_t)isize[1] << 8) + ((int64_t)isize[2] << 16) + ((int64_t)isize[3] << 24);
+    }
+    m_blockStarts.push_back(compressedPos);
+    m_blockOffsets.push_back(uncompressedPos);
+}
+
+int64_t BgzfFileImpl::findBlock(const int64_t& position) const
+{//last block starting at or before position, which skips empty blocks
+    CaretAssert(position < m_blockOffsets.back());
+    return (upper_bound(m_blockOffsets.begin(), m_blockOffsets.end(), position) - m_blockOffsets.begin()) - 1;
+}
+
+void BgzfFileImpl::readCompressed(const int64_t& startBlock, const int64_t& endBlock)
+{
+    const int64_t numBytes = m_blockStarts[endBlock] - m_blockStarts[startBlock];
+    m_compressedScratch.resize(numBytes);
+    if (!m_file.seek(m_blockStarts[startBlock]) || m_file.read(m_compressedScratch.data(), numBytes) != numBytes)
+    {
+        throw DataFileException("error while reading compressed file '" + m_fileName + "'");
+    }
+}
+
+void BgzfFileImpl::loadCache(const int64_t& block)
+{
+    if (m_cachedBlock == block) return;
+    m_cachedBlock = -1;//in case of error
+    readCompressed(block, block + 1);
+    m_blockCache.resize(m_blockOffsets[block + 1] - m_blockOffsets[block]);
+    if (!inflateBlock(m_compressedScratch.data(), m_compressedScratch.size(), m_blockCache.data(), m_blockCache.size()))
+    {
+        throw DataFileException("error while decompressing compressed file '" + m_fileName + "'");
+    }
+    m_cachedBlock = block;
+}
+
+void BgzfFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    if (m_writing || !m_file.isOpen()) throw DataFileException("read called on BgzfFileImpl not open for reading");//shouldn't happen
+    const int64_t toRead = max(int64_t(0), min(count, m_blockOffsets.back() - m_pos));
+    char* charOut = (char*)dataOut;
+    int64_t done = 0;
+    while (done < toRead)
+    {
+        const int64_t block = findBlock(m_pos);
+        const int64_t inBlock = m_pos - m_blockOffsets[block], blockLength = m_blockOffsets[block + 1] - m_blockOffsets[block];
+        if (inBlock != 0 || toRead - done < blockLength)
+        {//partial block, go through the cache so that many small reads don't decompress it repeatedly
+            loadCache(block);
+            const int64_t numCopy = min(blockLength - inBlock, toRead - done);
+            memcpy(charOut + done, m_blockCache.data() + inBlock, numCopy);
+            done += numCopy;
+            m_pos += numCopy;
+        } else {//run of entire blocks, decompress them straight into the output in parallel
+            int64_t endBlock = block + 1;
+            const int64_t numBlocks = (int64_t)m_blockStarts.size() - 1;
+            while (endBlock < numBlocks && m_blockOffsets[endBlock + 1] <= m_pos + (toRead - done) &&
+                   m_blockStarts[endBlock + 1] - m_blockStarts[block] <= READ_BATCH_SIZE)
+            {
+                ++endBlock;
+            }
+            readCompressed(block, endBlock);
+            const int64_t runLength = m_blockOffsets[endBlock] - m_blockOffsets[block];
+            bool failed = false;//can't throw out of an openmp loop
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int64_t i = block; i < endBlock; ++i)
+            {
+                if (!inflateBlock(m_compressedScratch.data() + (m_blockStarts[i] - m_blockStarts[block]), m_blockStarts[i + 1] - m_blockStarts[i],
+                                  charOut + done + (m_blockOffsets[i] - m_blockOffsets[block]), m_blockOffsets[i + 1] - m_blockOffsets[i]))
+                {
+                    failed = true;//all threads only ever write true, so no race worth guarding
+                }
+            }
+            if (failed) throw DataFileException("error while decompressing compressed file '" + m_fileName + "'");
+            done += runLength;
+            m_pos += runLength;
+        }
+    }
+    if (numRead == NULL)
+    {
+        if (done != count) throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");
+    } else {
+        *numRead = done;
+    }
+}
+
+void BgzfFileImpl::seek(const int64_t& position)
+{
+    if (!m_file.isOpen()) throw DataFileException("seek called on unopened BgzfFileImpl");//shouldn't happen
+    if (m_writing)
+    {
+        if (position < m_pos) throw DataFileException("can't seek backwards while writing compressed file '" + m_fileName + "'");
+        if (position > m_pos)
+        {
+            vector<char> zeros(position - m_pos, 0);//gzseek also fills forward seeks with zeros when writing
+            write(zeros.data(), zeros.size());
+        }
+    } else {
+        m_pos = position;//reading past the end just reads nothing, like other implementations
+    }
+}
+
+int64_t BgzfFileImpl::size()
+{
+    if (m_writing) return m_pos;
+    if (m_blockOffsets.empty()) return -1;
+    return m_blockOffsets.back();
+}
+
+void BgzfFileImpl::write(const void* dataIn, const int64_t& count)
+{
+    if (!m_writing || !m_file.isOpen()) throw DataFileException("write called on BgzfFileImpl not open for writing");//shouldn't happen
+    const char* charIn = (const char*)dataIn;
+    int64_t done = 0;
+    while (done < count)
+    {
+        const int64_t numCopy = min(count - done, WRITE_BATCH_BLOCKS * BLOCK_DATA_SIZE - (int64_t)m_pending.size());
+        m_pending.insert(m_pending.end(), charIn + done, charIn + done + numCopy);
+        done += numCopy;
+        if ((int64_t)m_pending.size() == WRITE_BATCH_BLOCKS * BLOCK_DATA_SIZE) flushBlocks(false);
+    }
+    m_pos += count;
+}
+
+void BgzfFileImpl::flushBlocks(const bool& final)
+{
+    int64_t numBlocks = (int64_t)m_pending.size() / BLOCK_DATA_SIZE;
+    if (final && (int64_t)m_pending.size() % BLOCK_DATA_SIZE != 0) ++numBlocks;
+    vector<vector<char> > compressed(numBlocks);
+    bool failed = false;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        try
+        {
+            deflateBlock(m_pending.data() + i * BLOCK_DATA_SIZE, min(BLOCK_DATA_SIZE, (int64_t)m_pending.size() - i * BLOCK_DATA_SIZE), compressed[i]);
+        } catch (...) {
+            failed = true;
+        }
+    }
+    if (failed) throw DataFileException("error while compressing data for file '" + m_fileName + "'");
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        if (m_file.write(compressed[i].data(), compressed[i].size()) != (qint64)compressed[i].size())
+        {
+            throw DataFileException("failed to write to compressed file '" + m_fileName + "'");
+        }
+    }
+    m_pending.erase(m_pending.begin(), m_pending.begin() + min((int64_t)m_pending.size(), numBlocks * BLOCK_DATA_SIZE));
+    if (final)
+    {
+        vector<char> eofBlock;
+        deflateBlock(NULL, 0, eofBlock);//empty block marks a complete file, like htslib
+        if (m_file.write(eofBlock.data(), eofBlock.size()) != (qint64)eofBlock.size())
+        {
+            throw DataFileException("failed to write to compressed file '" + m_fileName + "'");
+        }
+    }
+}
+
+void BgzfFileImpl::close()
+{
+    if (!m_file.isOpen()) return;
+    if (m_writing)
+    {
+        m_writing = false;//don't try to finish the file again from the destructor if this throws
+        try
+        {
+            flushBlocks(true);
+        } catch (...) {
+            m_file.close();
+            throw;
+        }
+        if (!m_file.flush()) throw DataFileException("failed to flush compressed file '" + m_fileName + "' before closing, data may be corrupted");
+    }
+    m_file.close();
+    m_pending.clear();
+    m_blockCache.clear();
+    m_compressedScratch.clear();
+    m_cachedBlock = -1;
+}
+
+BgzfFileImpl::~BgzfFileImpl()
+{
+    try//throwing from a destructor is a bad idea
+    {
+        close();
+    } catch (CaretException& e) {
+        CaretLogSevere(e.whatString());
+    } catch (exception& e) {
+        CaretLogSevere(e.what());
+    } catch (...) {
+        CaretLogSevere("caught unknown exception type while closing a compressed file");
+    }
+}
 #endif //ZLIB_VERSION
 
 void QFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
@@ -56,6 +56,11 @@ namespace caret {
         void read(void* dataOut, const int64_t& count, int64_t* numRead = NULL);//throw if numRead is NULL and (error or end of file reached early)
         void write(const void* dataIn, const int64_t& count);//failure to complete write is always an exception
         int64_t size();//may return -1 if size cannot be determined efficiently
+        
+        ///write new .gz files as block gzip (BGZF), which standard gzip tools can still read, but allows random access and parallel decompression
+        ///block gzip files are detected when reading regardless of this setting
+        static void setBlockGzipWriting(const bool& enabled);
+        static bool getBlockGzipWriting();
         class ImplInterface
         {
         protected:
@@ -74,6 +79,7 @@ namespace caret {
     private:
         CaretPointer<ImplInterface> m_impl;
         OpenMode m_curMode;//so implementation classes don't have to track it
+        static bool s_blockGzipWriting;
     };
 } //namespace caret
 
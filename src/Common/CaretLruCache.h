@@ -0,0 +1,147 @@
+#ifndef __CARET_LRU_CACHE_H__
+#define __CARET_LRU_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "CaretMutex.h"
+
+#include <list>
+#include <map>
+#include <utility>
+#include "stdint.h"
+
+#include <QtGlobal>
+
+namespace caret
+{
+    ///least recently used cache of decoded data (tiles, chunks, etc), limited by the bytes of the values rather than their count
+    ///V should be cheap to copy and share its data, like std::shared_ptr, and a default constructed V means "not in the cache"
+    ///all functions may be called from any thread
+    template <typename K, typename V>
+    class CaretLruCache
+    {
+        struct Entry
+        {
+            K m_key;
+            V m_value;
+            int64_t m_numberOfBytes;
+            Entry(const K& key, const V& value, const int64_t& numberOfBytes) : m_key(key), m_value(value), m_numberOfBytes(numberOfBytes) { }
+        };
+        typedef std::list<Entry> EntryList;
+        const AString m_name;
+        const int64_t m_maximumBytes;
+        CaretMutex m_mutex;//protects everything below
+        EntryList m_entries;//most recently used at the front
+        std::map<K, typename EntryList::iterator> m_lookup;
+        int64_t m_bytesUsed, m_hitCount, m_missCount;
+        CaretLruCache(const CaretLruCache&);
+        CaretLruCache& operator=(const CaretLruCache&);
+    public:
+        ///name is only used for logging, the most recently used value is always kept, even if it exceeds maximumBytes
+        CaretLruCache(const AString& name, const int64_t& maximumBytes);
+
+        ~CaretLruCache();
+
+        ///returns a default constructed V if the key is not in the cache
+        V get(const K& key);
+
+        ///if another thread already added the key, the existing value is kept
+        void add(const K& key, const V& value, const int64_t& numberOfBytes);
+
+        void clear();
+
+        int64_t getMaximumBytes() const { return m_maximumBytes; }
+
+        ///defaultMegabytes unless the environment variable is set to a number of megabytes
+        static int64_t getMaximumBytesFromEnvironment(const char* variableName, const int64_t& defaultMegabytes);
+    };
+
+    template <typename K, typename V>
+    CaretLruCache<K, V>::CaretLruCache(const AString& name, const int64_t& maximumBytes) : m_name(name), m_maximumBytes(maximumBytes)
+    {
+        m_bytesUsed = 0;
+        m_hitCount = 0;
+        m_missCount = 0;
+    }
+
+    template <typename K, typename V>
+    CaretLruCache<K, V>::~CaretLruCache()
+    {
+        CaretLogFine(m_name + " cache hits=" + AString::number(m_hitCount) + " misses=" + AString::number(m_missCount) + " bytes=" + AString::number(m_bytesUsed));
+    }
+
+    template <typename K, typename V>
+    V CaretLruCache<K, V>::get(const K& key)
+    {
+        CaretMutexLocker locked(&m_mutex);
+        typename std::map<K, typename EntryList::iterator>::iterator iter = m_lookup.find(key);
+        if (iter == m_lookup.end())
+        {
+            ++m_missCount;
+            return V();
+        }
+        ++m_hitCount;
+        m_entries.splice(m_entries.begin(), m_entries, iter->second);//list iterators stay valid when spliced
+        return iter->second->m_value;
+    }
+
+    template <typename K, typename V>
+    void CaretLruCache<K, V>::add(const K& key, const V& value, const int64_t& numberOfBytes)
+    {
+        CaretAssert(numberOfBytes >= 0);
+        CaretMutexLocker locked(&m_mutex);
+        if (m_lookup.find(key) != m_lookup.end()) return;//another thread decoded it at the same time
+        m_entries.push_front(Entry(key, value, numberOfBytes));
+        m_lookup.insert(std::make_pair(key, m_entries.begin()));
+        m_bytesUsed += numberOfBytes;
+        while (m_bytesUsed > m_maximumBytes && m_entries.size() > 1)
+        {
+            const Entry& oldest = m_entries.back();
+            m_bytesUsed -= oldest.m_numberOfBytes;
+            m_lookup.erase(oldest.m_key);
+            m_entries.pop_back();
+        }
+    }
+
+    template <typename K, typename V>
+    void CaretLruCache<K, V>::clear()
+    {
+        CaretMutexLocker locked(&m_mutex);
+        m_entries.clear();
+        m_lookup.clear();
+        m_bytesUsed = 0;
+    }
+
+    template <typename K, typename V>
+    int64_t CaretLruCache<K, V>::getMaximumBytesFromEnvironment(const char* variableName, const int64_t& defaultMegabytes)
+    {
+        int64_t megabytes = defaultMegabytes;
+        bool valid = false;
+        const int64_t envMegabytes = qgetenv(variableName).toLongLong(&valid);
+        if (valid && envMegabytes >= 0) megabytes = envMegabytes;
+        return megabytes * 1024 * 1024;
+    }
+}
+
+#endif //__CARET_LRU_CACHE_H__
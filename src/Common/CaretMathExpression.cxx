@@ -22,7 +22,9 @@
 #include "CaretException.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -39,6 +41,8 @@ CaretMathExpression::CaretMathExpression(const AString& expression)
         throw CaretException("extra characters on end of expression: '" + m_input.mid(m_position) + "'");
     }
     CaretLogFiner("parsed '" + expression + "' as '" + toString() + "'");
+    m_numRegisters = 0;
+    compileNode(m_root, 0);
 }
 
 double CaretMathExpression::evaluate(const vector<float>& variableValues) const
@@ -47,6 +51,373 @@ double CaretMathExpression::evaluate(const vector<float>& variableValues) const
     return m_root->eval(variableValues);
 }
 
+namespace
+{
+    const int64_t BLOCK_SIZE = 256;//elements per register, small enough that all registers stay in cache
+}
+
+void CaretMathExpression::evaluateBlock(const vector<const float*>& variableData, const int64_t& count, float* out) const
+{
+    CaretAssert(variableData.size() == m_varNames.size());
+    int64_t numBlocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (numBlocks < 2)
+    {
+        vector<double> registers(m_numRegisters * BLOCK_SIZE);
+        if (count > 0) runProgram(variableData, 0, count, registers.data(), out);
+        return;
+    }
+#pragma omp CARET_PAR
+    {
+        vector<double> registers(m_numRegisters * BLOCK_SIZE);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t block = 0; block < numBlocks; ++block)
+        {
+            int64_t start = block * BLOCK_SIZE;
+            runProgram(variableData, start, min(BLOCK_SIZE, count - start), registers.data(), out);
+        }
+    }
+}
+
+bool CaretMathExpression::MathNode::usesVariables() const
+{
+    if (m_type == VAR) return true;
+    for (int i = 0; i < (int)m_arguments.size(); ++i)
+    {
+        if (m_arguments[i]->usesVariables()) return true;
+    }
+    return false;
+}
+
+void CaretMathExpression::compileNode(const MathNode* node, const int& destReg)
+{//registers are used like a stack, children of a node only use registers at or above the node's own
+    m_numRegisters = max(m_numRegisters, destReg + 1);
+    if (!node->usesVariables())
+    {//fold constant subexpressions, using the tree evaluator so the value is exactly the same
+        Instruction myInst(Instruction::LOAD_CONST, destReg);
+        myInst.m_constVal = node->eval(vector<float>());
+        m_program.push_back(myInst);
+        return;
+    }
+    int numArgs = (int)node->m_arguments.size();
+    switch (node->m_type)
+    {
+        case MathNode::VAR:
+        {
+            Instruction myInst(Instruction::LOAD_VAR, destReg);
+            myInst.m_varIndex = node->m_varIndex;
+            m_program.push_back(myInst);
+            break;
+        }
+        case MathNode::OR:
+        case MathNode::AND:
+        case MathNode::EQUAL:
+        case MathNode::GREATERLESS:
+        case MathNode::ADDSUB:
+        case MathNode::MULTDIV:
+        {//chains are evaluated left to right, same as the tree
+            CaretAssert(numArgs > 1);
+            compileNode(node->m_arguments[0], destReg);
+            for (int i = 1; i < numArgs; ++i)
+            {
+                compileNode(node->m_arguments[i], destReg + 1);
+                Instruction::OpCode myOp = Instruction::ADD;
+                switch (node->m_type)
+                {
+                    case MathNode::OR:
+                        myOp = Instruction::OR;
+                        break;
+                    case MathNode::AND:
+                        myOp = Instruction::AND;
+                        break;
+                    case MathNode::EQUAL:
+                        myOp = node->m_invert[i] ? Instruction::NOT_EQUAL : Instruction::EQUAL;
+                        break;
+                    case MathNode::GREATERLESS:
+                        if (node->m_inclusive[i])
+                        {
+                            myOp = node->m_invert[i] ? Instruction::LESS_EQUAL : Instruction::GREATER_EQUAL;
+                        } else {
+                            myOp = node->m_invert[i] ? Instruction::LESS : Instruction::GREATER;
+                        }
+                        break;
+                    case MathNode::ADDSUB:
+                        myOp = node->m_invert[i] ? Instruction::SUB : Instruction::ADD;
+                        break;
+                    case MathNode::MULTDIV:
+                        myOp = node->m_invert[i] ? Instruction::DIV : Instruction::MULT;
+                        break;
+                    default:
+                        CaretAssert(false);
+                }
+                Instruction myInst(myOp, destReg);
+                myInst.m_args[0] = destReg;
+                myInst.m_args[1] = destReg + 1;
+                m_program.push_back(myInst);
+            }
+            break;
+        }
+        case MathNode::NOT:
+        case MathNode::NEGATE:
+        {
+            CaretAssert(numArgs == 1);
+            compileNode(node->m_arguments[0], destReg);
+            Instruction myInst(node->m_type == MathNode::NOT ? Instruction::NOT : Instruction::NEGATE, destReg);
+            myInst.m_args[0] = destReg;
+            m_program.push_back(myInst);
+            break;
+        }
+        case MathNode::POW:
+        case MathNode::FUNC:
+        {
+            CaretAssert(numArgs <= 3);
+            Instruction myInst(node->m_type == MathNode::POW ? Instruction::POW : Instruction::FUNC, destReg);
+            myInst.m_function = node->m_function;
+            for (int i = 0; i < numArgs; ++i)
+            {
+                compileNode(node->m_arguments[i], destReg + i);
+                myInst.m_args[i] = destReg + i;
+            }
+            m_program.push_back(myInst);
+            break;
+        }
+        case MathNode::CONST://handled by folding
+        case MathNode::INVALID:
+            CaretAssertMessage(0, "unexpected MathNode type while compiling expression");
+            throw CaretException("parsing problem in CaretMathExpression");
+    }
+}
+
+void CaretMathExpression::runProgram(const vector<const float*>& variableData, const int64_t& start, const int64_t& count, double* registers, float* out) const
+{//NOTE: every operation must match MathNode::eval exactly, including the float fudge factor in comparisons
+    CaretAssert(count <= BLOCK_SIZE);
+    for (vector<Instruction>::const_iterator iter = m_program.begin(); iter != m_program.end(); ++iter)
+    {
+        double* dest = registers + iter->m_dest * BLOCK_SIZE;
+        const double* a = (iter->m_args[0] >= 0 ? registers + iter->m_args[0] * BLOCK_SIZE : NULL);
+        const double* b = (iter->m_args[1] >= 0 ? registers + iter->m_args[1] * BLOCK_SIZE : NULL);
+        const double* c = (iter->m_args[2] >= 0 ? registers + iter->m_args[2] * BLOCK_SIZE : NULL);
+        switch (iter->m_op)
+        {
+            case Instruction::LOAD_VAR:
+            {
+                CaretAssertVectorIndex(variableData, iter->m_varIndex);
+                const float* varIn = variableData[iter->m_varIndex] + start;
+                for (int64_t i = 0; i < count; ++i) dest[i] = varIn[i];
+                break;
+            }
+            case Instruction::LOAD_CONST:
+            {
+                const double value = iter->m_constVal;
+                for (int64_t i = 0; i < count; ++i) dest[i] = value;
+                break;
+            }
+            case Instruction::OR:
+                for (int64_t i = 0; i < count; ++i) dest[i] = (a[i] > 0.0 || b[i] > 0.0) ? 1.0 : 0.0;
+                break;
+            case Instruction::AND:
+                for (int64_t i = 0; i < count; ++i) dest[i] = (a[i] > 0.0 && b[i] > 0.0) ? 1.0 : 0.0;
+                break;
+            case Instruction::EQUAL:
+            case Instruction::NOT_EQUAL:
+            {
+                const double equalVal = (iter->m_op == Instruction::EQUAL ? 1.0 : 0.0);
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    float adjust = min(abs(a[i]), abs(b[i])) / 1000000;
+                    bool equal = (a[i] >= b[i] - adjust) && (a[i] <= b[i] + adjust);
+                    dest[i] = equal ? equalVal : 1.0 - equalVal;
+                }
+                break;
+            }
+            case Instruction::GREATER:
+                for (int64_t i = 0; i < count; ++i) dest[i] = (a[i] > b[i] ? 1.0 : 0.0);
+                break;
+            case Instruction::LESS:
+                for (int64_t i = 0; i < count; ++i) dest[i] = (a[i] < b[i] ? 1.0 : 0.0);
+                break;
+            case Instruction::GREATER_EQUAL:
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    float adjust = min(abs(a[i]), abs(b[i])) / 1000000;
+                    dest[i] = (a[i] >= b[i] - adjust ? 1.0 : 0.0);
+                }
+                break;
+            case Instruction::LESS_EQUAL:
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    float adjust = min(abs(a[i]), abs(b[i])) / 1000000;
+                    dest[i] = (a[i] <= b[i] + adjust ? 1.0 : 0.0);
+                }
+                break;
+            case Instruction::ADD:
+                for (int64_t i = 0; i < count; ++i) dest[i] = a[i] + b[i];
+                break;
+            case Instruction::SUB:
+                for (int64_t i = 0; i < count; ++i) dest[i] = a[i] - b[i];
+                break;
+            case Instruction::MULT:
+                for (int64_t i = 0; i < count; ++i) dest[i] = a[i] * b[i];
+                break;
+            case Instruction::DIV:
+                for (int64_t i = 0; i < count; ++i) dest[i] = a[i] / b[i];
+                break;
+            case Instruction::NOT:
+                for (int64_t i = 0; i < count; ++i) dest[i] = (a[i] > 0.0) ? 0.0 : 1.0;
+                break;
+            case Instruction::NEGATE:
+                for (int64_t i = 0; i < count; ++i) dest[i] = -a[i];
+                break;
+            case Instruction::POW:
+                for (int64_t i = 0; i < count; ++i) dest[i] = pow(a[i], b[i]);
+                break;
+            case Instruction::FUNC:
+                switch (iter->m_function)
+                {
+                    case MathFunctionEnum::SIN:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = sin(a[i]);
+                        break;
+                    case MathFunctionEnum::COS:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = cos(a[i]);
+                        break;
+                    case MathFunctionEnum::TAN:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = tan(a[i]);
+                        break;
+                    case MathFunctionEnum::ASIN:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = asin(a[i]);
+                        break;
+                    case MathFunctionEnum::ACOS:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = acos(a[i]);
+                        break;
+                    case MathFunctionEnum::ATAN:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = atan(a[i]);
+                        break;
+                    case MathFunctionEnum::SINH:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = sinh(a[i]);
+                        break;
+                    case MathFunctionEnum::COSH:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = cosh(a[i]);
+                        break;
+                    case MathFunctionEnum::TANH:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = tanh(a[i]);
+                        break;
+                    case MathFunctionEnum::ASINH:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double arg = a[i];
+                            if (arg > 0)
+                            {
+                                dest[i] = log(arg + sqrt(arg * arg + 1));
+                            } else {
+                                dest[i] = -log(-arg + sqrt(arg * arg + 1));
+                            }
+                        }
+                        break;
+                    case MathFunctionEnum::ACOSH:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double arg = a[i];
+                            dest[i] = log(arg + sqrt(arg * arg - 1));
+                        }
+                        break;
+                    case MathFunctionEnum::ATANH:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double arg = a[i];
+                            dest[i] = 0.5 * log((1 + arg) / (1 - arg));
+                        }
+                        break;
+                    case MathFunctionEnum::SINC:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double arg = a[i];
+                            if (arg == 0.0)
+                            {
+                                dest[i] = 1.0;
+                            } else {
+                                dest[i] = sin(arg) / arg;
+                            }
+                        }
+                        break;
+                    case MathFunctionEnum::LN:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = log(a[i]);
+                        break;
+                    case MathFunctionEnum::EXP:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = exp(a[i]);
+                        break;
+                    case MathFunctionEnum::LOG:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = log10(a[i]);
+                        break;
+                    case MathFunctionEnum::LOG2:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = log2(a[i]);
+                        break;
+                    case MathFunctionEnum::SQRT:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = sqrt(a[i]);
+                        break;
+                    case MathFunctionEnum::ABS:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = abs(a[i]);
+                        break;
+                    case MathFunctionEnum::FLOOR:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = floor(a[i]);
+                        break;
+                    case MathFunctionEnum::ROUND:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double temp = a[i];
+                            if (temp > 0.0)
+                            {
+                                dest[i] = floor(temp + 0.5);
+                            } else {
+                                dest[i] = ceil(temp - 0.5);
+                            }
+                        }
+                        break;
+                    case MathFunctionEnum::CEIL:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = ceil(a[i]);
+                        break;
+                    case MathFunctionEnum::ATAN2:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = atan2(a[i], b[i]);
+                        break;
+                    case MathFunctionEnum::MIN:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = (a[i] > b[i] ? b[i] : a[i]);
+                        break;
+                    case MathFunctionEnum::MAX:
+                        for (int64_t i = 0; i < count; ++i) dest[i] = (a[i] < b[i] ? b[i] : a[i]);
+                        break;
+                    case MathFunctionEnum::MOD:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double first = a[i], second = b[i];
+                            if (second == 0.0)
+                            {
+                                dest[i] = 0.0;
+                            } else {
+                                dest[i] = first - second * floor(first / second);
+                            }
+                        }
+                        break;
+                    case MathFunctionEnum::CLAMP:
+                        for (int64_t i = 0; i < count; ++i)
+                        {
+                            double temp = a[i];
+                            if (temp < b[i]) temp = b[i];
+                            if (temp > c[i]) temp = c[i];
+                            dest[i] = temp;
+                        }
+                        break;
+                    case MathFunctionEnum::INVALID:
+                        CaretAssertMessage(0, "Instruction is type FUNC but INVALID function");
+                        throw CaretException("parsing problem in CaretMathExpression");
+                }
+                break;
+        }
+    }
+    const double* result = registers;//the root always ends up in register 0
+    for (int64_t i = 0; i < count; ++i)
+    {
+        out[start + i] = (float)result[i];
+    }
+}
+
 vector<AString> CaretMathExpression::getVarNames() const
 {
     vector<AString> ret(m_varNames.size());
@@ -62,7 +62,42 @@ class CaretMathExpression
         MathNode(const ExprType& type) { m_type = type; m_function = MathFunctionEnum::INVALID; }
         double eval(const std::vector<float>& values) const;
         AString toString(const std::vector<AString>& varNames, bool addParens = true) const;
+        bool usesVariables() const;
     };
+    struct Instruction
+    {//one step of the flattened expression, operating on whole blocks of elements at once
+        enum OpCode
+        {
+            LOAD_VAR,
+            LOAD_CONST,
+            OR,
+            AND,
+            EQUAL,
+            NOT_EQUAL,
+            GREATER,
+            LESS,
+            GREATER_EQUAL,
+            LESS_EQUAL,
+            ADD,
+            SUB,
+            MULT,
+            DIV,
+            NOT,
+            NEGATE,
+            POW,
+            FUNC
+        };
+        OpCode m_op;
+        MathFunctionEnum::Enum m_function;
+        int m_dest, m_varIndex;
+        int m_args[3];//registers
+        double m_constVal;
+        Instruction(const OpCode& op, const int& dest) { m_op = op; m_dest = dest; m_function = MathFunctionEnum::INVALID; m_varIndex = -1; m_args[0] = m_args[1] = m_args[2] = -1; m_constVal = 0.0; }
+    };
+    std::vector<Instruction> m_program;
+    int m_numRegisters;
+    void compileNode(const MathNode* node, const int& destReg);
+    void runProgram(const std::vector<const float*>& variableData, const int64_t& start, const int64_t& count, double* registers, float* out) const;
     std::map<AString, int> m_varNames;
     AString m_input;
     int m_position, m_end;
@@ -87,6 +122,8 @@ public:
     static bool getNamedConstant(const AString& name, double& valueOut);
     CaretMathExpression(const AString& expression);
     double evaluate(const std::vector<float>& variableValues) const;
+    ///evaluate the expression for count elements at once, variable v of element i is variableData[v][i], gives the same results as evaluate() cast to float
+    void evaluateBlock(const std::vector<const float*>& variableData, const int64_t& count, float* out) const;
     std::vector<AString> getVarNames() const;
     AString toString() const;//the expression, with a lot of parentheses added
 };
@@ -0,0 +1,304 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretPerfTrace.h"
+
+#include "CaretLogger.h"
+#include "CaretMutex.h"
+#include "CaretOMP.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef CARET_OS_WINDOWS
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+using namespace caret;
+using namespace std;
+
+bool CaretPerfTrace::s_enabled = false;
+
+namespace
+{
+    struct ScopeStats
+    {
+        int64_t calls = 0, wallMicros = 0, cpuMicros = 0, maxWallMicros = 0, firstStart = -1;
+    };
+
+    struct FileStats
+    {
+        int64_t bytesRead = 0, bytesWritten = 0;
+    };
+
+    struct TraceEvent
+    {
+        const char* name;
+        int64_t startMicros, wallMicros;
+        int threadId;
+    };
+
+    //keep the trace to a size that chrome://tracing can still open, phases are meant to be coarse
+    const int64_t MAX_TRACE_EVENTS = 1000000;
+
+    CaretMutex perfMutex;//protects everything below
+    chrono::steady_clock::time_point perfStartTime = chrono::steady_clock::now();
+    int64_t perfStartCpu = 0;
+    QString perfTraceFileName;
+    map<string, ScopeStats> perfScopes;
+    map<QString, FileStats> perfFiles;
+    map<string, int64_t> perfCounters;
+    vector<TraceEvent> perfTraceEvents;
+    int64_t perfDroppedEvents = 0;
+    int perfNextThreadId = 0;
+
+    //small sequential ids read better in the trace viewer than native thread ids
+    int getPerfThreadId()
+    {
+        static thread_local int threadId = -1;
+        if (threadId < 0)
+        {//called with perfMutex held
+            threadId = perfNextThreadId++;
+        }
+        return threadId;
+    }
+
+    QString formatSeconds(const int64_t& micros)
+    {
+        return QString::number(micros / 1000000.0, 'f', 3);
+    }
+
+    QString formatMegabytes(const int64_t& bytes)
+    {
+        return QString::number(bytes / (1024.0 * 1024.0), 'f', 1);
+    }
+
+    QByteArray jsonEscape(const char* text)
+    {
+        QByteArray ret;
+        for (const char* c = text; *c != '\0'; ++c)
+        {
+            if (*c == '"' || *c == '\\') ret += '\\';
+            if ((unsigned char)(*c) < 32) continue;
+            ret += *c;
+        }
+        return ret;
+    }
+}
+
+void CaretPerfTrace::enable()
+{
+    CaretMutexLocker locker(&perfMutex);
+    if (s_enabled) return;
+    perfStartTime = chrono::steady_clock::now();
+    s_enabled = true;
+    perfStartCpu = getProcessCpuMicroseconds();
+}
+
+void CaretPerfTrace::setTraceFile(const QString& fileName)
+{
+    enable();
+    CaretMutexLocker locker(&perfMutex);
+    perfTraceFileName = fileName;
+}
+
+int64_t CaretPerfTrace::getWallMicroseconds()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - perfStartTime).count();
+}
+
+int64_t CaretPerfTrace::getProcessCpuMicroseconds()
+{
+#ifdef CARET_OS_WINDOWS
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) return 0;
+    uint64_t kernel100ns = (((uint64_t)kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+    uint64_t user100ns = (((uint64_t)userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+    return (int64_t)((kernel100ns + user100ns) / 10);
+#else
+    timespec cpuTime;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuTime) != 0) return 0;
+    return ((int64_t)cpuTime.tv_sec) * 1000000 + cpuTime.tv_nsec / 1000;
+#endif
+}
+
+int64_t CaretPerfTrace::getPeakResidentBytes()
+{
+#ifdef CARET_OS_WINDOWS
+    PROCESS_MEMORY_COUNTERS memCounters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &memCounters, sizeof(memCounters))) return -1;
+    return (int64_t)memCounters.PeakWorkingSetSize;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef CARET_OS_MACOSX
+    return (int64_t)usage.ru_maxrss;//bytes on mac
+#else
+    return ((int64_t)usage.ru_maxrss) * 1024;//kilobytes on linux
+#endif
+#endif
+}
+
+void CaretPerfTrace::addScope(const char* name, const int64_t& startMicros, const int64_t& wallMicros, const int64_t& cpuMicros)
+{
+    if (!s_enabled) return;
+    CaretMutexLocker locker(&perfMutex);
+    ScopeStats& stats = perfScopes[name];
+    ++stats.calls;
+    stats.wallMicros += wallMicros;
+    stats.cpuMicros += cpuMicros;
+    stats.maxWallMicros = max(stats.maxWallMicros, wallMicros);
+    if (stats.firstStart < 0) stats.firstStart = startMicros;
+    if (perfTraceFileName != "")
+    {
+        if ((int64_t)perfTraceEvents.size() < MAX_TRACE_EVENTS)
+        {
+            TraceEvent event = { name, startMicros, wallMicros, getPerfThreadId() };
+            perfTraceEvents.push_back(event);
+        } else {
+            ++perfDroppedEvents;
+        }
+    }
+}
+
+void CaretPerfTrace::addBytesRead(const QString& fileName, const int64_t& bytes)
+{
+    if (!s_enabled) return;
+    CaretMutexLocker locker(&perfMutex);
+    perfFiles[fileName].bytesRead += bytes;
+}
+
+void CaretPerfTrace::addBytesWritten(const QString& fileName, const int64_t& bytes)
+{
+    if (!s_enabled) return;
+    CaretMutexLocker locker(&perfMutex);
+    perfFiles[fileName].bytesWritten += bytes;
+}
+
+void CaretPerfTrace::addCount(const char* name, const int64_t& amount)
+{
+    if (!s_enabled) return;
+    CaretMutexLocker locker(&perfMutex);
+    perfCounters[name] += amount;
+}
+
+void CaretPerfTrace::writeReport(ostream& output, const QString& title)
+{
+    if (!s_enabled) return;
+    const int64_t totalWall = getWallMicroseconds();
+    const int64_t totalCpu = getProcessCpuMicroseconds() - perfStartCpu;
+    const int64_t peakBytes = getPeakResidentBytes();
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    CaretMutexLocker locker(&perfMutex);
+    output << "performance report for " << title.toStdString() << endl;
+    output << "   wall time: " << formatSeconds(totalWall).toStdString() << " s, cpu time: " << formatSeconds(totalCpu).toStdString()
+           << " s, threads: " << numThreads;
+    if (totalWall > 0)
+    {
+        output << ", thread utilization: " << QString::number(100.0 * totalCpu / ((double)totalWall * numThreads), 'f', 1).toStdString() << "%";
+    }
+    output << endl;
+    if (peakBytes >= 0)
+    {
+        output << "   peak resident memory: " << formatMegabytes(peakBytes).toStdString() << " MB" << endl;
+    }
+    if (!perfScopes.empty())
+    {//in order of first use, which is usually the order the phases ran in
+        vector<pair<int64_t, string> > scopeOrder;
+        for (map<string, ScopeStats>::const_iterator iter = perfScopes.begin(); iter != perfScopes.end(); ++iter)
+        {
+            scopeOrder.push_back(make_pair(iter->second.firstStart, iter->first));
+        }
+        sort(scopeOrder.begin(), scopeOrder.end());
+        output << endl << "   phase times are inclusive of nested phases, cpu is for the whole process while the phase was running" << endl;
+        output << "   " << QString("phase").leftJustified(40).toStdString() << QString("calls").rightJustified(10).toStdString()
+               << QString("wall (s)").rightJustified(12).toStdString() << QString("cpu (s)").rightJustified(12).toStdString()
+               << QString("max wall (s)").rightJustified(14).toStdString() << endl;
+        for (size_t i = 0; i < scopeOrder.size(); ++i)
+        {
+            const ScopeStats& stats = perfScopes[scopeOrder[i].second];
+            output << "   " << QString(scopeOrder[i].second.c_str()).leftJustified(40).toStdString()
+                   << QString::number(stats.calls).rightJustified(10).toStdString()
+                   << formatSeconds(stats.wallMicros).rightJustified(12).toStdString()
+                   << formatSeconds(stats.cpuMicros).rightJustified(12).toStdString()
+                   << formatSeconds(stats.maxWallMicros).rightJustified(14).toStdString() << endl;
+        }
+    }
+    if (!perfFiles.empty())
+    {
+        output << endl << "   " << QString("file").leftJustified(60).toStdString() << QString("read (MB)").rightJustified(12).toStdString()
+               << QString("written (MB)").rightJustified(14).toStdString() << endl;
+        for (map<QString, FileStats>::const_iterator iter = perfFiles.begin(); iter != perfFiles.end(); ++iter)
+        {
+            output << "   " << iter->first.leftJustified(60).toStdString()
+                   << formatMegabytes(iter->second.bytesRead).rightJustified(12).toStdString()
+                   << formatMegabytes(iter->second.bytesWritten).rightJustified(14).toStdString() << endl;
+        }
+    }
+    if (!perfCounters.empty())
+    {
+        output << endl << "   " << QString("counter").leftJustified(40).toStdString() << QString("count").rightJustified(16).toStdString() << endl;
+        for (map<string, int64_t>::const_iterator iter = perfCounters.begin(); iter != perfCounters.end(); ++iter)
+        {
+            output << "   " << QString(iter->first.c_str()).leftJustified(40).toStdString()
+                   << QString::number(iter->second).rightJustified(16).toStdString() << endl;
+        }
+    }
+    if (perfTraceFileName != "")
+    {
+        writeTraceFile();
+    }
+}
+
+void CaretPerfTrace::writeTraceFile()
+{//called with perfMutex held
+    if (perfDroppedEvents > 0)
+    {
+        CaretLogWarning("performance trace is limited to " + QString::number(MAX_TRACE_EVENTS) + " events, " +
+                        QString::number(perfDroppedEvents) + " events were not recorded");
+    }
+    QByteArray traceText = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < perfTraceEvents.size(); ++i)
+    {
+        const TraceEvent& event = perfTraceEvents[i];
+        if (i != 0) traceText += ",\n";
+        traceText += "{\"name\":\"" + jsonEscape(event.name) + "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + QByteArray::number(event.threadId) +
+                     ",\"ts\":" + QByteArray::number((qlonglong)event.startMicros) + ",\"dur\":" + QByteArray::number((qlonglong)event.wallMicros) + "}";
+    }
+    traceText += "\n]}\n";
+    QFile traceFile(perfTraceFileName);
+    if (!traceFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || traceFile.write(traceText) != traceText.size())
+    {//a failed trace shouldn't fail the command that was being measured
+        CaretLogWarning("failed to write performance trace file '" + perfTraceFileName + "': " + traceFile.errorString());
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef __CARET_PERF_TRACE_H__
+#define __CARET_PERF_TRACE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <QString>
+
+#include <ostream>
+#include <stdint.h>
+
+namespace caret
+{
+
+    ///collects timings of named phases, byte counts per file, and counters for a performance report
+    ///disabled unless enable() is called (wb_command -perf-report), when disabled every entry point returns after testing a bool
+    class CaretPerfTrace
+    {
+    public:
+        static bool isEnabled() { return s_enabled; }
+        ///start collecting, times in the report and trace are relative to this call
+        static void enable();
+        ///also write the recorded phases as chrome trace events (chrome://tracing or perfetto) when the report is written, enables collection
+        static void setTraceFile(const QString& fileName);
+
+        ///name must be a string literal (or otherwise outlive the report), times are from getWallMicroseconds() and getProcessCpuMicroseconds()
+        static void addScope(const char* name, const int64_t& startMicros, const int64_t& wallMicros, const int64_t& cpuMicros);
+        static void addBytesRead(const QString& fileName, const int64_t& bytes);
+        static void addBytesWritten(const QString& fileName, const int64_t& bytes);
+        static void addCount(const char* name, const int64_t& amount = 1);
+
+        ///summary table of phases, files, counters, peak memory and thread utilization, then writes the trace file if one was set
+        static void writeReport(std::ostream& output, const QString& title);
+
+        static int64_t getWallMicroseconds();
+        ///cpu time used by all threads of the process
+        static int64_t getProcessCpuMicroseconds();
+        ///-1 if not available on this platform
+        static int64_t getPeakResidentBytes();
+    private:
+        static bool s_enabled;
+        static void writeTraceFile();
+    };
+
+    ///records the time from construction to destruction as a phase of the performance report, does nothing if the report isn't enabled
+    class CaretPerfScope
+    {
+        const char* m_name;
+        int64_t m_startWall, m_startCpu;
+        CaretPerfScope(const CaretPerfScope&);
+        CaretPerfScope& operator=(const CaretPerfScope&);
+    public:
+        explicit CaretPerfScope(const char* name) : m_name(NULL)
+        {
+            if (CaretPerfTrace::isEnabled())
+            {
+                m_name = name;
+                m_startWall = CaretPerfTrace::getWallMicroseconds();
+                m_startCpu = CaretPerfTrace::getProcessCpuMicroseconds();
+            }
+        }
+        ~CaretPerfScope()
+        {
+            if (m_name != NULL)
+            {
+                CaretPerfTrace::addScope(m_name, m_startWall, CaretPerfTrace::getWallMicroseconds() - m_startWall,
+                                         CaretPerfTrace::getProcessCpuMicroseconds() - m_startCpu);
+            }
+        }
+    };
+
+}
+
+#define CARET_PERF_SCOPE_CONCAT_INNER(a, b) a##b
+#define CARET_PERF_SCOPE_CONCAT(a, b) CARET_PERF_SCOPE_CONCAT_INNER(a, b)
+///time the rest of the enclosing block as the named phase, name must be a string literal
+#define CARET_PERF_SCOPE(name) caret::CaretPerfScope CARET_PERF_SCOPE_CONCAT(caretPerfScope_, __LINE__)(name)
+
+#endif //__CARET_PERF_TRACE_H__
@@ -19,12 +19,60 @@
 /*LICENSE_END*/
 
 #include "CaretPointLocator.h"
+#include "CaretAssert.h"
 #include "CaretHeap.h"
+#include "CaretOMP.h"
+
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <numeric>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    //add a candidate to arrays sorted by distance, caller has already checked that it belongs there
+    void insertCandidate(int64_t* indices, float* dist2s, int32_t& numFound, const int32_t k, const int64_t index, const float dist2)
+    {
+        int32_t pos = numFound;
+        if (numFound < k)
+        {
+            ++numFound;
+        } else {
+            pos = k - 1;//drop the current worst
+        }
+        while (pos > 0 && dist2s[pos - 1] > dist2)
+        {
+            indices[pos] = indices[pos - 1];
+            dist2s[pos] = dist2s[pos - 1];
+            --pos;
+        }
+        indices[pos] = index;
+        dist2s[pos] = dist2;
+    }
+    
+    float boxDistSquared(const float minBox[3], const float maxBox[3], const float point[3])
+    {
+        float ret = 0.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            float diff = 0.0f;
+            if (point[i] < minBox[i])
+            {
+                diff = minBox[i] - point[i];
+            } else if (point[i] > maxBox[i]) {
+                diff = point[i] - maxBox[i];
+            }
+            ret += diff * diff;
+        }
+        return ret;
+    }
+    
+    const int KD_STACK_SIZE = 128;//median splits keep the depth under log2(number of points)
+}
+
 void CaretPointLocator::addPoint(Oct<LeafVector<Point> >* thisOct, const float point[3], const int64_t index, const int32_t pointSet)
 {
     if (thisOct->m_leaf)
@@ -72,6 +120,11 @@ void CaretPointLocator::addPoint(Oct<LeafVector<Point> >* thisOct, const float p
 
 int32_t CaretPointLocator::addPointSet(const float* coordsIn, const int64_t numCoords)
 {
+    if (m_buildMode == STATIC_TREE)
+    {
+        CaretAssertMessage(false, "point sets can't be added to a static point locator");
+        return -1;
+    }
     CaretMutexLocker locked(&m_modifyMutex);
     int32_t setNum = newIndex();
     if (numCoords < 1) return setNum;
@@ -100,10 +153,16 @@ int32_t CaretPointLocator::addPointSet(const float* coordsIn, const int64_t numC
     return setNum;
 }
 
-CaretPointLocator::CaretPointLocator(const float* coordsIn, const int64_t numCoords)
+CaretPointLocator::CaretPointLocator(const float* coordsIn, const int64_t numCoords, const BuildMode mode)
 {
+    m_buildMode = mode;
     m_nextSetIndex = 1;//next set will be set #1
     m_tree = NULL;
+    if (m_buildMode == STATIC_TREE)
+    {
+        buildKdTree(coordsIn, numCoords);
+        return;
+    }
     if (numCoords >= 1)
     {
         Vector3D minBox, maxBox;
@@ -129,12 +188,188 @@ CaretPointLocator::CaretPointLocator(const float* coordsIn, const int64_t numCoo
 
 CaretPointLocator::CaretPointLocator(const float minBounds[3], const float maxBounds[3])
 {
+    m_buildMode = DYNAMIC_TREE;
     m_nextSetIndex = 0;
     m_tree = new Oct<LeafVector<Point> >(minBounds, maxBounds);
 }
 
+void CaretPointLocator::buildKdTree(const float* coordsIn, const int64_t numCoords)
+{
+    if (numCoords < 1) return;
+    m_kdIndices.resize(numCoords);
+    iota(m_kdIndices.begin(), m_kdIndices.end(), (int64_t)0);
+    m_kdNodes.reserve(2 * (numCoords / KD_LEAF_SIZE) + 1);
+    buildKdNode(coordsIn, 0, numCoords);
+    m_kdCoords.resize(numCoords * 3);
+    for (int64_t i = 0; i < numCoords; ++i)
+    {
+        const float* source = coordsIn + m_kdIndices[i] * 3;
+        m_kdCoords[i * 3] = source[0];
+        m_kdCoords[i * 3 + 1] = source[1];
+        m_kdCoords[i * 3 + 2] = source[2];
+    }
+}
+
+int64_t CaretPointLocator::buildKdNode(const float* coordsIn, const int64_t begin, const int64_t end)
+{
+    const int64_t nodeIndex = (int64_t)m_kdNodes.size();
+    m_kdNodes.push_back(KdNode());//reserve the slot so children come after it
+    KdNode thisNode;
+    thisNode.m_begin = begin;
+    thisNode.m_end = end;
+    thisNode.m_right = -1;
+    const float* first = coordsIn + m_kdIndices[begin] * 3;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        thisNode.m_min[axis] = first[axis];
+        thisNode.m_max[axis] = first[axis];
+    }
+    for (int64_t i = begin + 1; i < end; ++i)
+    {
+        const float* point = coordsIn + m_kdIndices[i] * 3;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (point[axis] < thisNode.m_min[axis]) thisNode.m_min[axis] = point[axis];
+            if (point[axis] > thisNode.m_max[axis]) thisNode.m_max[axis] = point[axis];
+        }
+    }
+    int splitAxis = 0;
+    for (int axis = 1; axis < 3; ++axis)
+    {
+        if (thisNode.m_max[axis] - thisNode.m_min[axis] > thisNode.m_max[splitAxis] - thisNode.m_min[splitAxis])
+        {
+            splitAxis = axis;
+        }
+    }
+    if (end - begin > KD_LEAF_SIZE && thisNode.m_max[splitAxis] > thisNode.m_min[splitAxis])//identical points stay in one leaf
+    {
+        const int64_t mid = begin + (end - begin) / 2;
+        nth_element(m_kdIndices.begin() + begin, m_kdIndices.begin() + mid, m_kdIndices.begin() + end,
+                    [coordsIn, splitAxis](const int64_t a, const int64_t b) { return coordsIn[a * 3 + splitAxis] < coordsIn[b * 3 + splitAxis]; });
+        buildKdNode(coordsIn, begin, mid);//left child is always the next node
+        thisNode.m_right = buildKdNode(coordsIn, mid, end);
+    }
+    m_kdNodes[nodeIndex] = thisNode;//don't hold a reference across the recursion, the vector may reallocate
+    return nodeIndex;
+}
+
+int32_t CaretPointLocator::kdNearest(const float target[3], const int32_t k, const float maxDist2, int64_t* positionsOut, float* dist2Out) const
+{
+    if (m_kdNodes.empty() || k < 1) return 0;
+    int32_t numFound = 0;
+    float bound = maxDist2;//shrinks to the kth best distance once k points are found
+    int64_t stackNodes[KD_STACK_SIZE];
+    float stackDist2[KD_STACK_SIZE];
+    int stackSize = 0;
+    float curDist2 = boxDistSquared(m_kdNodes[0].m_min, m_kdNodes[0].m_max, target);
+    if (curDist2 > bound) return 0;
+    stackNodes[0] = 0;
+    stackDist2[0] = curDist2;
+    stackSize = 1;
+    while (stackSize > 0)
+    {
+        --stackSize;
+        if (stackDist2[stackSize] > bound) continue;//bound shrank after it was pushed
+        const KdNode& thisNode = m_kdNodes[stackNodes[stackSize]];
+        if (thisNode.m_right == -1)
+        {
+            for (int64_t i = thisNode.m_begin; i < thisNode.m_end; ++i)
+            {
+                float tempf = MathFunctions::distanceSquared3D(m_kdCoords.data() + i * 3, target);
+                if (numFound < k ? tempf <= bound : tempf < bound)
+                {
+                    insertCandidate(positionsOut, dist2Out, numFound, k, i, tempf);
+                    if (numFound == k) bound = dist2Out[k - 1];
+                }
+            }
+        } else {
+            const int64_t left = stackNodes[stackSize] + 1, right = thisNode.m_right;
+            const float leftDist2 = boxDistSquared(m_kdNodes[left].m_min, m_kdNodes[left].m_max, target);
+            const float rightDist2 = boxDistSquared(m_kdNodes[right].m_min, m_kdNodes[right].m_max, target);
+            CaretAssert(stackSize + 2 <= KD_STACK_SIZE);
+            if (leftDist2 < rightDist2)//push the nearer child last so it is searched first
+            {
+                if (rightDist2 <= bound) { stackNodes[stackSize] = right; stackDist2[stackSize] = rightDist2; ++stackSize; }
+                stackNodes[stackSize] = left; stackDist2[stackSize] = leftDist2; ++stackSize;
+            } else {
+                if (leftDist2 <= bound) { stackNodes[stackSize] = left; stackDist2[stackSize] = leftDist2; ++stackSize; }
+                stackNodes[stackSize] = right; stackDist2[stackSize] = rightDist2; ++stackSize;
+            }
+        }
+    }
+    return numFound;
+}
+
+int64_t CaretPointLocator::kdClosest(const float target[3], const float maxDist2, LocatorInfo* infoOut) const
+{
+    int64_t position = -1;
+    float dist2 = -1.0f;
+    if (kdNearest(target, 1, maxDist2, &position, &dist2) == 0)
+    {
+        if (infoOut != NULL)
+        {
+            infoOut->whichSet = -1;
+            infoOut->index = -1;
+        }
+        return -1;
+    }
+    if (infoOut != NULL)
+    {
+        infoOut->whichSet = 0;
+        infoOut->coords = m_kdCoords.data() + position * 3;
+        infoOut->index = m_kdIndices[position];
+    }
+    return m_kdIndices[position];
+}
+
+int32_t CaretPointLocator::octNearest(const float target[3], const int32_t k, const float maxDist2, int64_t* indicesOut, float* dist2Out) const
+{
+    if (m_tree == NULL || k < 1) return 0;
+    int32_t numFound = 0;
+    float bound = maxDist2, curDist2 = m_tree->distSquaredToPoint(target), tempf;
+    if (curDist2 > bound) return 0;
+    CaretSimpleMinHeap<Oct<LeafVector<Point> >*, float> myHeap;
+    myHeap.push(m_tree, curDist2);
+    while (!myHeap.isEmpty())
+    {
+        Oct<LeafVector<Point> >* thisOct = myHeap.pop(&curDist2);
+        if (curDist2 > bound) break;//everything left in the heap is farther
+        if (thisOct->m_leaf)
+        {
+            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
+            int curSize = (int)myVecRef.size();
+            for (int i = 0; i < curSize; ++i)
+            {
+                tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
+                if (numFound < k ? tempf <= bound : tempf < bound)
+                {
+                    insertCandidate(indicesOut, dist2Out, numFound, k, myVecRef[i].m_index, tempf);
+                    if (numFound == k) bound = dist2Out[k - 1];
+                }
+            }
+        } else {
+            for (int ii = 0; ii < 2; ++ii)
+            {
+                for (int ij = 0; ij < 2; ++ij)
+                {
+                    for (int ik = 0; ik < 2; ++ik)
+                    {
+                        tempf = thisOct->m_children[ii][ij][ik]->distSquaredToPoint(target);
+                        if (tempf <= bound)
+                        {
+                            myHeap.push(thisOct->m_children[ii][ij][ik], tempf);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return numFound;
+}
+
 int64_t CaretPointLocator::closestPoint(const float target[3], LocatorInfo* infoOut) const
 {
+    if (m_buildMode == STATIC_TREE) return kdClosest(target, numeric_limits<float>::infinity(), infoOut);
     if (m_tree == NULL) return -1;
     CaretSimpleMinHeap<Oct<LeafVector<Point> >*, float> myHeap;
     bool first = true;
@@ -201,6 +436,7 @@ int64_t CaretPointLocator::closestPointLimited(const float target[3], const floa
         infoOut->whichSet = -1;
         infoOut->index = -1;
     }
+    if (m_buildMode == STATIC_TREE) return kdClosest(target, maxDist * maxDist, infoOut);
     if (m_tree == NULL) return -1;
     float curDist2 = m_tree->distSquaredToPoint(target), maxDist2 = maxDist * maxDist;
     if (curDist2 > maxDist2)
@@ -267,6 +503,33 @@ int64_t CaretPointLocator::closestPointLimited(const float target[3], const floa
 vector<LocatorInfo> CaretPointLocator::pointsInRange(const float target[3], const float& maxDist) const
 {//each point occurs in only once in the tree, so we can use a vector
     vector<LocatorInfo> ret;
+    if (m_buildMode == STATIC_TREE)
+    {
+        if (m_kdNodes.empty()) return ret;
+        const float maxDist2 = maxDist * maxDist;
+        vector<int64_t> myStack(1, 0);
+        while (!myStack.empty())
+        {
+            const KdNode& thisNode = m_kdNodes[myStack.back()];
+            const int64_t nodeIndex = myStack.back();
+            myStack.pop_back();
+            if (boxDistSquared(thisNode.m_min, thisNode.m_max, target) > maxDist2) continue;
+            if (thisNode.m_right == -1)
+            {
+                for (int64_t i = thisNode.m_begin; i < thisNode.m_end; ++i)
+                {
+                    if (MathFunctions::distanceSquared3D(m_kdCoords.data() + i * 3, target) <= maxDist2)
+                    {
+                        ret.push_back(LocatorInfo(m_kdIndices[i], 0, Vector3D(m_kdCoords.data() + i * 3)));
+                    }
+                }
+            } else {
+                myStack.push_back(nodeIndex + 1);
+                myStack.push_back(thisNode.m_right);
+            }
+        }
+        return ret;
+    }
     if (m_tree == NULL) return ret;
     float curDist2 = m_tree->distSquaredToPoint(target), maxDist2 = maxDist * maxDist;
     if (curDist2 > maxDist2) return ret;
@@ -310,6 +573,12 @@ vector<LocatorInfo> CaretPointLocator::pointsInRange(const float target[3], cons
 
 bool CaretPointLocator::anyInRange(const float target[3], const float& maxDist) const
 {
+    if (m_buildMode == STATIC_TREE)
+    {//a nearest search also visits the closer nodes first
+        int64_t position = -1;
+        float dist2 = -1.0f;
+        return kdNearest(target, 1, maxDist * maxDist, &position, &dist2) != 0 && dist2 <= maxDist * maxDist;//inclusive, like the octree range tests
+    }
     if (m_tree == NULL) return false;
     float curDist2 = m_tree->distSquaredToPoint(target), maxDist2 = maxDist * maxDist, tempf;
     if (curDist2 > maxDist2) return false;
@@ -350,6 +619,68 @@ bool CaretPointLocator::anyInRange(const float target[3], const float& maxDist)
     return false;
 }
 
+int32_t CaretPointLocator::kNearest(const float target[3], const int32_t k, int64_t* indicesOut, float* distancesOut) const
+{
+    if (k < 1) return 0;
+    vector<float> scratch;
+    float* dist2s = distancesOut;
+    if (dist2s == NULL)
+    {
+        scratch.resize(k);
+        dist2s = scratch.data();
+    }
+    int32_t numFound = 0;
+    if (m_buildMode == STATIC_TREE)
+    {
+        numFound = kdNearest(target, k, numeric_limits<float>::infinity(), indicesOut, dist2s);
+        for (int32_t i = 0; i < numFound; ++i)
+        {
+            indicesOut[i] = m_kdIndices[indicesOut[i]];
+        }
+    } else {
+        numFound = octNearest(target, k, numeric_limits<float>::infinity(), indicesOut, dist2s);
+    }
+    if (distancesOut != NULL)
+    {
+        for (int32_t i = 0; i < numFound; ++i)
+        {
+            distancesOut[i] = sqrt(distancesOut[i]);
+        }
+    }
+    return numFound;
+}
+
+void CaretPointLocator::closestPoints(const float* targets, const int64_t numTargets, int64_t* indicesOut, const float maxDist) const
+{
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t i = 0; i < numTargets; ++i)
+    {
+        if (maxDist >= 0.0f)
+        {
+            indicesOut[i] = closestPointLimited(targets + i * 3, maxDist);
+        } else {
+            indicesOut[i] = closestPoint(targets + i * 3);
+        }
+    }
+}
+
+void CaretPointLocator::kNearestPoints(const float* targets, const int64_t numTargets, const int32_t k, int64_t* indicesOut, float* distancesOut) const
+{
+    if (k < 1) return;
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t i = 0; i < numTargets; ++i)
+    {
+        int64_t* thisIndices = indicesOut + i * k;
+        float* thisDistances = (distancesOut == NULL ? NULL : distancesOut + i * k);
+        int32_t numFound = kNearest(targets + i * 3, k, thisIndices, thisDistances);
+        for (int32_t j = numFound; j < k; ++j)
+        {
+            thisIndices[j] = -1;
+            if (thisDistances != NULL) thisDistances[j] = -1.0f;
+        }
+    }
+}
+
 int32_t CaretPointLocator::newIndex()
 {
     if (m_unusedIndexes.empty())
@@ -364,6 +695,11 @@ int32_t CaretPointLocator::newIndex()
 
 void CaretPointLocator::removePointSet(int32_t whichSet)
 {
+    if (m_buildMode == STATIC_TREE)
+    {
+        CaretAssertMessage(false, "point sets can't be removed from a static point locator");
+        return;
+    }
     CaretMutexLocker locked(&m_modifyMutex);
     m_unusedIndexes.push_back(whichSet);
     removeSetHelper(m_tree, whichSet);
@@ -52,6 +52,16 @@ namespace caret {
     
     class CaretPointLocator
     {
+    public:
+        ///how the points are stored
+        enum BuildMode
+        {
+            ///octree, point sets can be added and removed after construction
+            DYNAMIC_TREE,
+            ///flat kd-tree of only the constructor's point set, faster queries, but point sets can't be added or removed
+            STATIC_TREE
+        };
+    private:
         struct Point
         {
             Vector3D m_point;
@@ -73,13 +83,31 @@ namespace caret {
         static const int NUM_POINTS_SPLIT = 100;
         void removeSetHelper(Oct<LeafVector<Point> >* thisOct, const int32_t thisSet);
         CaretPointLocator();
+        
+        ///node of the flat kd-tree, stored in preorder so the left child of a non-leaf node is the next node
+        struct KdNode
+        {
+            float m_min[3], m_max[3];//bounding box of the node's points
+            int64_t m_begin, m_end;//range of the node's points in m_kdCoords/m_kdIndices
+            int64_t m_right;//index of the right child, -1 for leaves
+        };
+        BuildMode m_buildMode;
+        std::vector<KdNode> m_kdNodes;
+        std::vector<float> m_kdCoords;//points reordered so that every node's points are contiguous
+        std::vector<int64_t> m_kdIndices;//original index of each reordered point
+        static const int KD_LEAF_SIZE = 16;
+        void buildKdTree(const float* coordsIn, const int64_t numCoords);
+        int64_t buildKdNode(const float* coordsIn, const int64_t begin, const int64_t end);
+        int64_t kdClosest(const float target[3], const float maxDist2, LocatorInfo* infoOut) const;
+        int32_t kdNearest(const float target[3], const int32_t k, const float maxDist2, int64_t* positionsOut, float* dist2Out) const;
+        int32_t octNearest(const float target[3], const int32_t k, const float maxDist2, int64_t* indicesOut, float* dist2Out) const;
     public:
         ///make an empty point locator with given bounding box (bounding box can expand later, but may be less efficient
         CaretPointLocator(const float minBounds[3], const float maxBounds[3]);
         ///make a point locator with the bounding box of this point set, and use this point set as set #0
-        CaretPointLocator(const float* coordsIn, const int64_t numCoords);
+        CaretPointLocator(const float* coordsIn, const int64_t numCoords, const BuildMode mode = DYNAMIC_TREE);
         ///convenience constructor for vectors
-        CaretPointLocator(const std::vector<float> coordsIn) : CaretPointLocator(coordsIn.data(), coordsIn.size() / 3) { }
+        CaretPointLocator(const std::vector<float> coordsIn, const BuildMode mode = DYNAMIC_TREE) : CaretPointLocator(coordsIn.data(), coordsIn.size() / 3, mode) { }
         ~CaretPointLocator() { if (m_tree != NULL) { delete m_tree; } }
         ///add a point set, SAVE THE RETURN VALUE because it is how you identify which point set found points belong to
         int32_t addPointSet(const float* coordsIn, const int64_t numCoords);
@@ -91,6 +119,13 @@ namespace caret {
         int64_t closestPointLimited(const float target[3], const float& maxDist, LocatorInfo* infoOut = NULL) const;
         std::vector<LocatorInfo> pointsInRange(const float target[3], const float& maxDist) const;
         bool anyInRange(const float target[3], const float& maxDist) const;
+        ///finds up to k closest points sorted by distance, returns how many were found, distancesOut is optional, results are ambiguous with multiple point sets
+        int32_t kNearest(const float target[3], const int32_t k, int64_t* indicesOut, float* distancesOut = NULL) const;
+        ///closest point to each of numTargets coordinate triples in parallel, indicesOut must have room for numTargets, negative maxDist means no limit
+        void closestPoints(const float* targets, const int64_t numTargets, int64_t* indicesOut, const float maxDist = -1.0f) const;
+        ///k closest points to each target in parallel, output arrays must have room for numTargets * k, missing points are -1
+        void kNearestPoints(const float* targets, const int64_t numTargets, const int32_t k, int64_t* indicesOut, float* distancesOut = NULL) const;
+        BuildMode getBuildMode() const { return m_buildMode; }
     };
 }
 
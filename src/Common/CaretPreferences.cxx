@@ -106,6 +106,12 @@ CaretPreferences::CaretPreferences()
                                                       CaretPreferenceDataValue::SavedInScene::SAVE_NO,
                                                       s_defaultCziDimension));
     
+    m_connectivityRowCacheMegabytes.reset(new CaretPreferenceDataValue(this->qSettings,
+                                                                       "connectivityRowCacheMegabytes",
+                                                                       CaretPreferenceDataValue::DataType::INTEGER,
+                                                                       CaretPreferenceDataValue::SavedInScene::SAVE_NO,
+                                                                       s_defaultConnectivityRowCacheMegabytes));
+    
     m_volumeSurfaceOutlineSeparation.reset(new CaretPreferenceDataValue(this->qSettings,
                                                                         "volumeSurfaceOutlineSeparation",
                                                                         CaretPreferenceDataValue::DataType::FLOAT,
@@ -1786,6 +1792,27 @@ CaretPreferences::setCziDimension(const int32_t dimension)
     m_cziDimension->setValue(dimension);
 }
 
+/**
+ * @return Memory, in megabytes, for caching rows read from dense connectivity files.
+ * Zero disables caching and prefetching of rows.
+ */
+int32_t
+CaretPreferences::getConnectivityRowCacheMegabytes() const
+{
+    return m_connectivityRowCacheMegabytes->getValue().toInt();
+}
+
+/**
+ * Set the memory, in megabytes, for caching rows read from dense connectivity files.
+ * @param megabytes
+ *    New size of the cache, zero disables caching.
+ */
+void
+CaretPreferences::setConnectivityRowCacheMegabytes(const int32_t megabytes)
+{
+    m_connectivityRowCacheMegabytes->setValue(megabytes);
+}
+
 /**
  * @return The volume surface outline separartion
  */
@@ -307,6 +307,10 @@ namespace caret {
         
         static void getSupportedCziDimensions(std::vector<std::pair<int32_t, QString>>& supportedValuesOut);
         
+        int32_t getConnectivityRowCacheMegabytes() const;
+        
+        void setConnectivityRowCacheMegabytes(const int32_t megabytes);
+        
         WuQMacroGroup* getMacros();
         
         const WuQMacroGroup* getMacros() const;
@@ -479,6 +483,8 @@ namespace caret {
         
         std::unique_ptr<CaretPreferenceDataValue> m_cziDimension;
         
+        std::unique_ptr<CaretPreferenceDataValue> m_connectivityRowCacheMegabytes;
+        
         std::unique_ptr<CaretPreferenceDataValue> m_identificationStereotaxicDistance;
         
         std::unique_ptr<CaretPreferenceDataValue> m_imageFileTextureCompressionEnabled;
@@ -584,6 +590,8 @@ namespace caret {
         
         static const int32_t s_defaultCziDimension = 2048;
         
+        static const int32_t s_defaultConnectivityRowCacheMegabytes = 512;
+        
 
         
     };
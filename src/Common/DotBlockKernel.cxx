@@ -0,0 +1,359 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "DotBlockKernel.h"
+
+#include "CaretAssert.h"
+
+#include <algorithm>
+#include <atomic>
+
+//the x86 micro-kernels use function target attributes rather than separately compiled libraries like kloewe/dot does,
+//so only try them where the dot library itself was found to work (gcc or clang on x86_64)
+#if defined(CARET_DOTFCN) && defined(__GNUC__) && (defined(__x86_64__) || defined(__amd64__))
+#define DOT_BLOCK_X86
+#include <immintrin.h>
+#endif
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    //elements per k block, partial sums get moved into double at the end of each block
+    //256 floats is 1KB per row, so an A micro-panel plus a few dozen B rows stay in L1/L2
+    const int KBLOCK = 256;
+
+    typedef void (*MicroKernelFunc)(const float* const* a, const float* const* b, const int kStart, const int kEnd, double* out, const int outStride);
+
+    struct KernelInfo
+    {
+        DotSIMDEnum::Enum m_impl;
+        MicroKernelFunc m_func;
+        int m_rows, m_cols;//shape of the output tile computed by m_func
+    };
+
+    //used for the edges of every implementation, and as the full kernel for NAIVE
+    void genericEdge(const float* const* a, const int numA, const float* const* b, const int numB, const int kStart, const int kEnd, double* out, const int outStride)
+    {
+        for (int i = 0; i < numA; ++i)
+        {
+            const float* arow = a[i];
+            for (int j = 0; j < numB; ++j)
+            {
+                const float* brow = b[j];
+                float partial[4] = { 0.0f, 0.0f, 0.0f, 0.0f };//several independent sums, so the adds can overlap
+                int k = kStart;
+                for (; k + 4 <= kEnd; k += 4)
+                {
+                    partial[0] += arow[k] * brow[k];
+                    partial[1] += arow[k + 1] * brow[k + 1];
+                    partial[2] += arow[k + 2] * brow[k + 2];
+                    partial[3] += arow[k + 3] * brow[k + 3];
+                }
+                double accum = ((double)partial[0] + partial[1]) + ((double)partial[2] + partial[3]);
+                for (; k < kEnd; ++k)
+                {
+                    accum += arow[k] * brow[k];
+                }
+                out[i * outStride + j] += accum;
+            }
+        }
+    }
+
+    const int GENERIC_ROWS = 4, GENERIC_COLS = 2;
+
+    void genericKernel(const float* const* a, const float* const* b, const int kStart, const int kEnd, double* out, const int outStride)
+    {
+        genericEdge(a, GENERIC_ROWS, b, GENERIC_COLS, kStart, kEnd, out, outStride);
+    }
+
+#ifdef DOT_BLOCK_X86
+    //4 rows of A by 2 rows of B keeps 8 accumulators, 4 A values and 1 B value in the 16 ymm registers
+    const int AVX_ROWS = 4, AVX_COLS = 2;
+
+    __attribute__((target("avx")))
+    void avxFinish(__m256 acc[AVX_ROWS][AVX_COLS], const float* const* a, const float* const* b, const int kTail, const int kEnd, double* out, const int outStride)
+    {
+        float temp[8];
+        for (int i = 0; i < AVX_ROWS; ++i)
+        {
+            for (int j = 0; j < AVX_COLS; ++j)
+            {
+                _mm256_storeu_ps(temp, acc[i][j]);
+                double accum = (((double)temp[0] + temp[1]) + ((double)temp[2] + temp[3])) + (((double)temp[4] + temp[5]) + ((double)temp[6] + temp[7]));
+                for (int k = kTail; k < kEnd; ++k)
+                {
+                    accum += a[i][k] * b[j][k];
+                }
+                out[i * outStride + j] += accum;
+            }
+        }
+    }
+
+    __attribute__((target("avx")))
+    void avxKernel(const float* const* a, const float* const* b, const int kStart, const int kEnd, double* out, const int outStride)
+    {
+        __m256 acc[AVX_ROWS][AVX_COLS];
+        for (int i = 0; i < AVX_ROWS; ++i)
+        {
+            for (int j = 0; j < AVX_COLS; ++j)
+            {
+                acc[i][j] = _mm256_setzero_ps();
+            }
+        }
+        int k = kStart;
+        for (; k + 8 <= kEnd; k += 8)
+        {
+            __m256 avals[AVX_ROWS];
+            for (int i = 0; i < AVX_ROWS; ++i)
+            {
+                avals[i] = _mm256_loadu_ps(a[i] + k);
+            }
+            for (int j = 0; j < AVX_COLS; ++j)
+            {
+                __m256 bval = _mm256_loadu_ps(b[j] + k);
+                for (int i = 0; i < AVX_ROWS; ++i)
+                {
+                    acc[i][j] = _mm256_add_ps(acc[i][j], _mm256_mul_ps(avals[i], bval));
+                }
+            }
+        }
+        avxFinish(acc, a, b, k, kEnd, out, outStride);
+    }
+
+    __attribute__((target("avx,fma")))
+    void avxFmaKernel(const float* const* a, const float* const* b, const int kStart, const int kEnd, double* out, const int outStride)
+    {
+        __m256 acc[AVX_ROWS][AVX_COLS];
+        for (int i = 0; i < AVX_ROWS; ++i)
+        {
+            for (int j = 0; j < AVX_COLS; ++j)
+            {
+                acc[i][j] = _mm256_setzero_ps();
+            }
+        }
+        int k = kStart;
+        for (; k + 8 <= kEnd; k += 8)
+        {
+            __m256 avals[AVX_ROWS];
+            for (int i = 0; i < AVX_ROWS; ++i)
+            {
+                avals[i] = _mm256_loadu_ps(a[i] + k);
+            }
+            for (int j = 0; j < AVX_COLS; ++j)
+            {
+                __m256 bval = _mm256_loadu_ps(b[j] + k);
+                for (int i = 0; i < AVX_ROWS; ++i)
+                {
+                    acc[i][j] = _mm256_fmadd_ps(avals[i], bval, acc[i][j]);
+                }
+            }
+        }
+        avxFinish(acc, a, b, k, kEnd, out, outStride);
+    }
+
+    //32 zmm registers allow a square 4x4 tile
+    const int AVX512_ROWS = 4, AVX512_COLS = 4;
+
+    __attribute__((target("avx512f")))
+    void avx512Finish(__m512 acc[AVX512_ROWS][AVX512_COLS], const float* const* a, const float* const* b, const int kTail, const int kEnd, double* out, const int outStride)
+    {
+        float temp[16];
+        for (int i = 0; i < AVX512_ROWS; ++i)
+        {
+            for (int j = 0; j < AVX512_COLS; ++j)
+            {
+                _mm512_storeu_ps(temp, acc[i][j]);
+                double accum = 0.0;
+                for (int t = 0; t < 16; t += 2)
+                {
+                    accum += (double)temp[t] + temp[t + 1];
+                }
+                for (int k = kTail; k < kEnd; ++k)
+                {
+                    accum += a[i][k] * b[j][k];
+                }
+                out[i * outStride + j] += accum;
+            }
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    void avx512Kernel(const float* const* a, const float* const* b, const int kStart, const int kEnd, double* out, const int outStride)
+    {
+        __m512 acc[AVX512_ROWS][AVX512_COLS];
+        for (int i = 0; i < AVX512_ROWS; ++i)
+        {
+            for (int j = 0; j < AVX512_COLS; ++j)
+            {
+                acc[i][j] = _mm512_setzero_ps();
+            }
+        }
+        int k = kStart;
+        for (; k + 16 <= kEnd; k += 16)
+        {
+            __m512 avals[AVX512_ROWS];
+            for (int i = 0; i < AVX512_ROWS; ++i)
+            {
+                avals[i] = _mm512_loadu_ps(a[i] + k);
+            }
+            for (int j = 0; j < AVX512_COLS; ++j)
+            {
+                __m512 bval = _mm512_loadu_ps(b[j] + k);
+                for (int i = 0; i < AVX512_ROWS; ++i)
+                {
+                    acc[i][j] = _mm512_add_ps(acc[i][j], _mm512_mul_ps(avals[i], bval));
+                }
+            }
+        }
+        avx512Finish(acc, a, b, k, kEnd, out, outStride);
+    }
+
+    __attribute__((target("avx512f")))
+    void avx512FmaKernel(const float* const* a, const float* const* b, const int kStart, const int kEnd, double* out, const int outStride)
+    {
+        __m512 acc[AVX512_ROWS][AVX512_COLS];
+        for (int i = 0; i < AVX512_ROWS; ++i)
+        {
+            for (int j = 0; j < AVX512_COLS; ++j)
+            {
+                acc[i][j] = _mm512_setzero_ps();
+            }
+        }
+        int k = kStart;
+        for (; k + 16 <= kEnd; k += 16)
+        {
+            __m512 avals[AVX512_ROWS];
+            for (int i = 0; i < AVX512_ROWS; ++i)
+            {
+                avals[i] = _mm512_loadu_ps(a[i] + k);
+            }
+            for (int j = 0; j < AVX512_COLS; ++j)
+            {
+                __m512 bval = _mm512_loadu_ps(b[j] + k);
+                for (int i = 0; i < AVX512_ROWS; ++i)
+                {
+                    acc[i][j] = _mm512_fmadd_ps(avals[i], bval, acc[i][j]);
+                }
+            }
+        }
+        avx512Finish(acc, a, b, k, kEnd, out, outStride);
+    }
+#endif //DOT_BLOCK_X86
+
+    const KernelInfo GENERIC_INFO = { DOT_NAIVE, genericKernel, GENERIC_ROWS, GENERIC_COLS };
+#ifdef DOT_BLOCK_X86
+    const KernelInfo AVX_INFO = { DOT_AVX, avxKernel, AVX_ROWS, AVX_COLS };
+    const KernelInfo AVXFMA_INFO = { DOT_AVXFMA, avxFmaKernel, AVX_ROWS, AVX_COLS };
+    const KernelInfo AVX512_INFO = { DOT_AVX512, avx512Kernel, AVX512_ROWS, AVX512_COLS };
+    const KernelInfo AVX512FMA_INFO = { DOT_AVX512FMA, avx512FmaKernel, AVX512_ROWS, AVX512_COLS };
+#endif
+
+    //like dot_set_impl, fall back to the next best supported set if the requested one isn't available
+    const KernelInfo* selectKernel(const DotSIMDEnum::Enum& impl)
+    {
+#ifdef DOT_BLOCK_X86
+        __builtin_cpu_init();
+        bool haveAVX = __builtin_cpu_supports("avx"), haveFMA = __builtin_cpu_supports("fma"), haveAVX512 = __builtin_cpu_supports("avx512f");
+        switch (impl)
+        {
+            case DOT_AUTO:
+                if (haveAVX512) return &AVX512FMA_INFO;
+                if (haveAVX && haveFMA) return &AVXFMA_INFO;
+                if (haveAVX) return &AVX_INFO;
+                return &GENERIC_INFO;
+            case DOT_AVX512FMA:
+                if (haveAVX512) return &AVX512FMA_INFO;
+                return selectKernel(DOT_AVXFMA);
+            case DOT_AVX512:
+                if (haveAVX512) return &AVX512_INFO;
+                return selectKernel(DOT_AVX);
+            case DOT_AVXFMA:
+                if (haveAVX && haveFMA) return &AVXFMA_INFO;
+                return selectKernel(DOT_AVX);
+            case DOT_AVX:
+                if (haveAVX) return &AVX_INFO;
+                return &GENERIC_INFO;
+            default:
+                return &GENERIC_INFO;
+        }
+#else
+        (void)impl;
+        return &GENERIC_INFO;
+#endif
+    }
+
+    atomic<const KernelInfo*> g_overrideKernel(NULL);
+
+    const KernelInfo* getKernel()
+    {
+        const KernelInfo* ret = g_overrideKernel.load();
+        if (ret != NULL) return ret;
+        static const KernelInfo* autoKernel = selectKernel(DOT_AUTO);//c++11 guarantees thread-safe initialization
+        return autoKernel;
+    }
+}
+
+void DotBlockKernel::compute(const float* const* aRows, const int& numA, const float* const* bRows, const int& numB, const int& length,
+                             double* out, const int& outStride)
+{
+    CaretAssert(outStride >= numB);
+    const KernelInfo* kernel = getKernel();
+    for (int i = 0; i < numA; ++i)
+    {
+        for (int j = 0; j < numB; ++j)
+        {
+            out[i * outStride + j] = 0.0;
+        }
+    }
+    const int fullA = numA - numA % kernel->m_rows, fullB = numB - numB % kernel->m_cols;
+    for (int kStart = 0; kStart < length; kStart += KBLOCK)
+    {
+        const int kEnd = min(kStart + KBLOCK, length);
+        for (int i = 0; i < fullA; i += kernel->m_rows)
+        {//the A micro-panel stays in L1 while we sweep across all of B
+            for (int j = 0; j < fullB; j += kernel->m_cols)
+            {
+                kernel->m_func(aRows + i, bRows + j, kStart, kEnd, out + i * outStride + j, outStride);
+            }
+            if (fullB < numB)
+            {
+                genericEdge(aRows + i, kernel->m_rows, bRows + fullB, numB - fullB, kStart, kEnd, out + i * outStride + fullB, outStride);
+            }
+        }
+        if (fullA < numA)
+        {
+            genericEdge(aRows + fullA, numA - fullA, bRows, numB, kStart, kEnd, out + fullA * outStride, outStride);
+        }
+    }
+}
+
+DotSIMDEnum::Enum DotBlockKernel::setImplementation(const DotSIMDEnum::Enum& impl)
+{
+    const KernelInfo* kernel = selectKernel(impl);
+    g_overrideKernel.store(kernel);
+    return kernel->m_impl;
+}
+
+DotSIMDEnum::Enum DotBlockKernel::getImplementation()
+{
+    return getKernel()->m_impl;
+}
@@ -0,0 +1,47 @@
+#ifndef __DOT_BLOCK_KERNEL_H__
+#define __DOT_BLOCK_KERNEL_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "dot_wrapper.h"
+
+namespace caret
+{
+
+    ///computes a block of dot products between two sets of rows (ie, A * B^T), reusing each loaded value across several rows
+    ///products are single precision, partial sums are moved into double every few hundred elements, which keeps accuracy close to dsdot
+    class DotBlockKernel
+    {
+    public:
+        ///out[i * outStride + j] = dot(aRows[i], bRows[j]) for all i < numA, j < numB
+        ///safe to call from multiple threads at once, as long as the output regions don't overlap
+        static void compute(const float* const* aRows, const int& numA, const float* const* bRows, const int& numB, const int& length,
+                            double* out, const int& outStride);
+
+        ///choose the micro-kernels to use, same names as -simd, falls back to the best supported if the requested one isn't available
+        static DotSIMDEnum::Enum setImplementation(const DotSIMDEnum::Enum& impl);
+
+        static DotSIMDEnum::Enum getImplementation();
+    };
+
+}
+
+#endif //__DOT_BLOCK_KERNEL_H__
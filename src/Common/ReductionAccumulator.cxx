@@ -0,0 +1,277 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "ReductionAccumulator.h"
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+#include "MathFunctions.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    //columns handled by one thread at a time, small enough that a block of rows stays in cache while it is walked
+    const int64_t COLUMN_CHUNK = 256;
+}
+
+bool ReductionAccumulator::canAccumulate(const ReductionEnum::Enum& type)
+{
+    switch (type)
+    {
+        case ReductionEnum::INVALID:
+        case ReductionEnum::MEDIAN:
+        case ReductionEnum::MODE:
+            return false;
+        default:
+            return true;
+    }
+}
+
+ReductionAccumulator::ReductionAccumulator(const ReductionEnum::Enum& type, const int64_t& numColumns, const bool& onlyNumeric)
+{
+    CaretAssert(numColumns >= 0);
+    m_type = type;
+    m_onlyNumeric = onlyNumeric;
+    switch (type)
+    {
+        case ReductionEnum::SUM:
+        case ReductionEnum::MEAN:
+            m_kind = SUM_KIND;
+            break;
+        case ReductionEnum::STDEV:
+        case ReductionEnum::SAMPSTDEV:
+        case ReductionEnum::VARIANCE:
+        case ReductionEnum::TSNR:
+        case ReductionEnum::COV:
+            m_kind = VARIANCE_KIND;
+            break;
+        case ReductionEnum::L2NORM:
+            m_kind = SQUARES_KIND;
+            break;
+        case ReductionEnum::PRODUCT:
+            m_kind = PRODUCT_KIND;
+            break;
+        case ReductionEnum::MAX:
+        case ReductionEnum::INDEXMAX:
+            m_kind = MAX_KIND;
+            break;
+        case ReductionEnum::MIN:
+        case ReductionEnum::INDEXMIN:
+            m_kind = MIN_KIND;
+            break;
+        case ReductionEnum::COUNT_NONZERO:
+            m_kind = NONZERO_KIND;
+            break;
+        default:
+            throw CaretException("reduction type '" + ReductionEnum::toName(type) + "' can't be computed in a single pass");
+    }
+    m_states.resize(numColumns);
+    if (m_kind == PRODUCT_KIND)
+    {
+        for (int64_t i = 0; i < numColumns; ++i) m_states[i].sum = 1.0;
+    }
+    if (m_kind == NONZERO_KIND)
+    {
+        for (int64_t i = 0; i < numColumns; ++i) m_states[i].index = 0;
+    }
+}
+
+void ReductionAccumulator::addRows(const float* const* rows, const int64_t& numRows)
+{
+    addRowsDispatch(rows, numRows, NULL, NULL);
+}
+
+void ReductionAccumulator::addRows(const float* const* rows, const int64_t& numRows, const float* rowMask)
+{
+    addRowsDispatch(rows, numRows, rowMask, NULL);
+}
+
+void ReductionAccumulator::addRows(const float* const* rows, const int64_t& numRows, const float* const* elementMasks)
+{
+    addRowsDispatch(rows, numRows, NULL, elementMasks);
+}
+
+void ReductionAccumulator::addRowsDispatch(const float* const* rows, const int64_t& numRows, const float* rowMask, const float* const* elementMasks)
+{//switch once per block, so the inner loops don't test the reduction type
+    switch (m_kind)
+    {
+        case SUM_KIND:
+            addRowsTyped<SUM_KIND>(rows, numRows, rowMask, elementMasks);
+            break;
+        case VARIANCE_KIND:
+            addRowsTyped<VARIANCE_KIND>(rows, numRows, rowMask, elementMasks);
+            break;
+        case SQUARES_KIND:
+            addRowsTyped<SQUARES_KIND>(rows, numRows, rowMask, elementMasks);
+            break;
+        case PRODUCT_KIND:
+            addRowsTyped<PRODUCT_KIND>(rows, numRows, rowMask, elementMasks);
+            break;
+        case MAX_KIND:
+            addRowsTyped<MAX_KIND>(rows, numRows, rowMask, elementMasks);
+            break;
+        case MIN_KIND:
+            addRowsTyped<MIN_KIND>(rows, numRows, rowMask, elementMasks);
+            break;
+        case NONZERO_KIND:
+            addRowsTyped<NONZERO_KIND>(rows, numRows, rowMask, elementMasks);
+            break;
+    }
+}
+
+template<ReductionAccumulator::Kind KIND>
+void ReductionAccumulator::addRowsTyped(const float* const* rows, const int64_t& numRows, const float* rowMask, const float* const* elementMasks)
+{
+    const int64_t numColumns = (int64_t)m_states.size();
+    const bool onlyNumeric = m_onlyNumeric;
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t chunkStart = 0; chunkStart < numColumns; chunkStart += COLUMN_CHUNK)
+    {
+        const int64_t chunkEnd = min(chunkStart + COLUMN_CHUNK, numColumns);
+        for (int64_t row = 0; row < numRows; ++row)
+        {
+            if (rowMask != NULL && !(rowMask[row] > 0.0f)) continue;
+            const float* rowData = rows[row];
+            const float* maskData = (elementMasks == NULL ? NULL : elementMasks[row]);
+            for (int64_t col = chunkStart; col < chunkEnd; ++col)
+            {
+                if (maskData != NULL && !(maskData[col] > 0.0f)) continue;
+                State& state = m_states[col];
+                const float value = rowData[col];
+                const int64_t position = state.seen;
+                ++state.seen;
+                if (onlyNumeric && !MathFunctions::isNumeric(value)) continue;
+                switch (KIND)//constant in each instantiation
+                {
+                    case SUM_KIND:
+                        state.sum += value;
+                        break;
+                    case VARIANCE_KIND:
+                    {//sum is kept separately so that the mean is exactly the one ReductionOperation uses
+                        state.sum += value;
+                        const double delta = value - state.mean;
+                        state.mean += delta / (state.count + 1);
+                        state.m2 += delta * (value - state.mean);
+                        break;
+                    }
+                    case SQUARES_KIND:
+                        state.sum += value * value;//float product, same as ReductionOperation
+                        break;
+                    case PRODUCT_KIND:
+                        state.sum *= value;
+                        break;
+                    case MAX_KIND:
+                        if (state.count == 0 || value > state.extreme)
+                        {
+                            state.extreme = value;
+                            state.index = position;
+                        }
+                        break;
+                    case MIN_KIND:
+                        if (state.count == 0 || value < state.extreme)
+                        {
+                            state.extreme = value;
+                            state.index = position;
+                        }
+                        break;
+                    case NONZERO_KIND:
+                        if (value != 0.0f) ++state.index;
+                        break;
+                }
+                ++state.count;
+            }
+        }
+    }
+}
+
+int64_t ReductionAccumulator::getCount(const int64_t& column) const
+{
+    CaretAssertVectorIndex(m_states, column);
+    return m_states[column].count;
+}
+
+float ReductionAccumulator::getResult(const int64_t& column) const
+{
+    CaretAssertVectorIndex(m_states, column);
+    const State& state = m_states[column];
+    if (state.count == 0)
+    {
+        if (m_onlyNumeric && state.seen > 0) throw CaretException("all input values to reduceOnlyNumeric were non-numeric");
+        throw CaretException("no values were included in the reduction");
+    }
+    switch (m_type)
+    {
+        case ReductionEnum::SUM:
+            return state.sum;
+        case ReductionEnum::MEAN:
+            return state.sum / state.count;
+        case ReductionEnum::STDEV:
+            return sqrt(state.m2 / state.count);
+        case ReductionEnum::VARIANCE:
+            return state.m2 / state.count;
+        case ReductionEnum::SAMPSTDEV:
+        case ReductionEnum::TSNR:
+        case ReductionEnum::COV:
+        {
+            if (state.count < 2) throw CaretException("taking the sample standard deviation of 1 element would require dividing by zero");
+            const double sampstdev = sqrt(state.m2 / (state.count - 1));
+            const double mean = state.sum / state.count;
+            switch (m_type)
+            {
+                case ReductionEnum::SAMPSTDEV:
+                    return sampstdev;
+                case ReductionEnum::TSNR:
+                    return mean / sampstdev;
+                default:
+                    return sampstdev / mean;
+            }
+        }
+        case ReductionEnum::L2NORM:
+            return sqrt(state.sum);
+        case ReductionEnum::PRODUCT:
+            return state.sum;
+        case ReductionEnum::MAX:
+        case ReductionEnum::MIN:
+            return state.extreme;
+        case ReductionEnum::INDEXMAX:
+        case ReductionEnum::INDEXMIN:
+            return state.index + 1;//1-based, to match gui and column arguments
+        case ReductionEnum::COUNT_NONZERO:
+            return state.index;
+        default:
+            break;
+    }
+    CaretAssertMessage(false, "unhandled reduction type");
+    return 0.0f;
+}
+
+void ReductionAccumulator::getResults(float* resultsOut) const
+{
+    const int64_t numColumns = (int64_t)m_states.size();
+    for (int64_t i = 0; i < numColumns; ++i)
+    {
+        resultsOut[i] = getResult(i);
+    }
+}
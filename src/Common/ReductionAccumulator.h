@@ -0,0 +1,84 @@
+#ifndef __REDUCTION_ACCUMULATOR_H__
+#define __REDUCTION_ACCUMULATOR_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "ReductionEnum.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+
+    ///single pass reduction of many columns at once, rows of data are added a block at a time, so the data never needs to be in memory all at once
+    ///gives the same results as ReductionOperation, except that the variance based reductions use Welford's method (double precision) instead of two passes
+    class ReductionAccumulator
+    {
+    public:
+        ///false for reductions that need all values at once (MEDIAN, MODE)
+        static bool canAccumulate(const ReductionEnum::Enum& type);
+
+        ///onlyNumeric skips NaN and inf like ReductionOperation::reduceOnlyNumeric, index results still count the skipped values
+        ReductionAccumulator(const ReductionEnum::Enum& type, const int64_t& numColumns, const bool& onlyNumeric = false);
+
+        ///add rows in order, value j of each row goes to column j, parallel over columns
+        void addRows(const float* const* rows, const int64_t& numRows);
+        ///rows with rowMask <= 0 are skipped entirely, and are not counted for index results (like an roi)
+        void addRows(const float* const* rows, const int64_t& numRows, const float* rowMask);
+        ///elements with their mask value <= 0 are skipped, masks have the same shape as rows
+        void addRows(const float* const* rows, const int64_t& numRows, const float* const* elementMasks);
+
+        int64_t getNumberOfColumns() const { return (int64_t)m_states.size(); }
+        ///number of values included so far
+        int64_t getCount(const int64_t& column) const;
+        ///throws CaretException if the column has no included values, or too few for the sample based reductions
+        float getResult(const int64_t& column) const;
+        void getResults(float* resultsOut) const;
+    private:
+        enum Kind
+        {
+            SUM_KIND,
+            VARIANCE_KIND,
+            SQUARES_KIND,
+            PRODUCT_KIND,
+            MAX_KIND,
+            MIN_KIND,
+            NONZERO_KIND
+        };
+        struct State
+        {
+            int64_t seen, count, index;//index is also the nonzero count
+            double sum, mean, m2;//sum is also the product
+            float extreme;
+            State() : seen(0), count(0), index(-1), sum(0.0), mean(0.0), m2(0.0), extreme(0.0f) { }
+        };
+        template<Kind KIND>
+        void addRowsTyped(const float* const* rows, const int64_t& numRows, const float* rowMask, const float* const* elementMasks);
+        void addRowsDispatch(const float* const* rows, const int64_t& numRows, const float* rowMask, const float* const* elementMasks);
+        ReductionEnum::Enum m_type;
+        Kind m_kind;
+        bool m_onlyNumeric;
+        std::vector<State> m_states;
+    };
+
+}
+
+#endif //__REDUCTION_ACCUMULATOR_H__
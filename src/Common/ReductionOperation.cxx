@@ -140,10 +140,10 @@ float ReductionOperation::reduce(const float* data, const int64_t& numElems, con
         {
             vector<float> dataCopy(numElems);
             for (int64_t i = 0; i < numElems; ++i) dataCopy[i] = data[i];
-            sort(dataCopy.begin(), dataCopy.end());
+            nth_element(dataCopy.begin(), dataCopy.begin() + numElems / 2, dataCopy.end());//selection instead of a full sort
             if ((numElems & 1) == 0)//if even, average middle two
-            {
-                return (dataCopy[numElems / 2 - 1] + dataCopy[numElems / 2]) / 2.0f;
+            {//the lower middle value is the largest of the elements before the center
+                return (*max_element(dataCopy.begin(), dataCopy.begin() + numElems / 2) + dataCopy[numElems / 2]) / 2.0f;
             } else {
                 return dataCopy[numElems / 2];//otherwise, take the center
             }
@@ -194,6 +194,21 @@ float ReductionOperation::reduce(const float* data, const int64_t& numElems, con
     return 0.0f;
 }
 
+float ReductionOperation::percentile(float* data, const int64_t& numElems, const float& percent)
+{
+    CaretAssert(numElems > 0);
+    CaretAssert(percent >= 0.0f && percent <= 100.0f);
+    const float index = percent / 100.0f * (numElems - 1);
+    if (index <= 0) return *min_element(data, data + numElems);
+    if (index >= numElems - 1) return *max_element(data, data + numElems);
+    float ipart, fpart;
+    fpart = modf(index, &ipart);
+    const int64_t lowIndex = (int64_t)ipart;
+    nth_element(data, data + lowIndex, data + numElems);//selection instead of a full sort, everything after lowIndex is at least as large
+    const float lowValue = data[lowIndex], highValue = *min_element(data + lowIndex + 1, data + numElems);
+    return (1.0f - fpart) * lowValue + fpart * highValue;
+}
+
 float ReductionOperation::reduceExcludeDev(const float* data, const int64_t& numElems, const ReductionEnum::Enum& type, const float& numDevBelow, const float& numDevAbove)
 {
     CaretAssert(numElems > 0);
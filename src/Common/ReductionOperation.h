@@ -37,6 +37,8 @@ namespace caret {
         static float reduceWeighted(const float* data, const float* weights, const int64_t& numElems, const ReductionEnum::Enum& type);
         static float reduceWeightedExcludeDev(const float* data, const float* weights, const int64_t& numElems, const ReductionEnum::Enum& type, const float& numDevBelow, const float& numDevAbove);
         static float reduceWeightedOnlyNumeric(const float* data, const float* weights, const int64_t& numElems, const ReductionEnum::Enum& type);
+        ///value at a percentile (0 to 100), interpolating between the closest two values, reorders the data
+        static float percentile(float* data, const int64_t& numElems, const float& percent);
         static bool isLengthOneReasonable(const ReductionEnum::Enum& type);
         static AString getHelpInfo();
     };
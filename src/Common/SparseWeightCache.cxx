@@ -0,0 +1,224 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SparseWeightCache.h"
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+QString SparseWeightCache::s_directory;
+int64_t SparseWeightCache::s_maxBytes = 0;
+
+namespace
+{
+    const char CACHE_MAGIC[8] = { 'W', 'B', 'W', 'C', 'S', 'R', '0', '1' };
+    
+    struct CacheHeader
+    {//native endian, a file from a machine with different endianness won't pass the size checks
+        char magic[8];
+        int64_t numRows, numWeights, numPerRow;
+    };
+    
+    QString cacheFileName(const QString& directory, const QString& key)
+    {
+        return QDir(directory).filePath(key + ".wcsr");
+    }
+    
+    ///update the modification time of an open cache file, so that eviction by modification time removes the least recently used entries
+    void touchFile(QFile& myFile)
+    {
+        bool touched = false;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        touched = myFile.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+#endif
+        if (!touched)
+        {//rewriting the magic in place changes nothing but the modification time
+            QFile rewriteFile(myFile.fileName());
+            if (!rewriteFile.open(QIODevice::ReadWrite) || rewriteFile.write(CACHE_MAGIC, sizeof(CACHE_MAGIC)) != (qint64)sizeof(CACHE_MAGIC))
+            {
+                CaretLogFine("unable to update modification time of weight cache file '" + myFile.fileName() + "'");
+            }
+        }
+    }
+}
+
+SparseWeightCache::KeyBuilder::KeyBuilder(const QString& kind) : m_hash(QCryptographicHash::Sha256)
+{
+    QByteArray kindBytes = kind.toUtf8();
+    addValue(kindBytes.size());
+    m_hash.addData(kindBytes);
+}
+
+void SparseWeightCache::KeyBuilder::addData(const void* data, const int64_t& bytes)
+{
+    const int64_t CHUNK = 1 << 30;//QCryptographicHash takes an int length
+    for (int64_t done = 0; done < bytes; done += CHUNK)
+    {
+        m_hash.addData(((const char*)data) + done, (int)min(CHUNK, bytes - done));
+    }
+}
+
+QString SparseWeightCache::KeyBuilder::getKey() const
+{
+    return QString(m_hash.result().toHex());
+}
+
+void SparseWeightCache::setCacheDirectory(const QString& directory, const int64_t& maxBytes)
+{
+    s_directory = directory;
+    s_maxBytes = maxBytes;
+    if (directory != "" && !QDir().mkpath(directory))
+    {
+        CaretLogWarning("unable to create weight cache directory '" + directory + "', weight cache disabled");
+        s_directory = "";
+    }
+}
+
+bool SparseWeightCache::isEnabled()
+{
+    return s_directory != "";
+}
+
+bool SparseWeightCache::load(const QString& key, const int64_t& numRows, const int64_t& numIndices, Weights& weightsOut)
+{
+    if (!isEnabled()) return false;
+    QFile myFile(cacheFileName(s_directory, key));
+    if (!myFile.open(QIODevice::ReadOnly)) return false;//the normal cache miss
+    CacheHeader header;
+    if (myFile.read((char*)&header, sizeof(CacheHeader)) != (qint64)sizeof(CacheHeader) || memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.numRows != numRows || header.numWeights < 0 || (header.numPerRow != 0 && header.numPerRow != header.numRows))
+    {
+        CaretLogInfo("ignoring invalid weight cache file '" + myFile.fileName() + "'");
+        return false;
+    }
+    const int64_t dataBytes = (header.numRows + 1) * sizeof(int64_t) + header.numWeights * (sizeof(int32_t) + sizeof(float)) + header.numPerRow * sizeof(float);
+    if (myFile.size() != (qint64)(sizeof(CacheHeader) + dataBytes))
+    {
+        CaretLogInfo("ignoring truncated weight cache file '" + myFile.fileName() + "'");
+        return false;
+    }
+    const uchar* mapped = myFile.map(sizeof(CacheHeader), dataBytes);//file is exactly the in-memory layout of the arrays, so mapping avoids any parsing or extra copies
+    if (mapped == NULL)
+    {
+        CaretLogInfo("failed to map weight cache file '" + myFile.fileName() + "'");
+        return false;
+    }
+    weightsOut.rowStarts.resize(header.numRows + 1);
+    weightsOut.indices.resize(header.numWeights);
+    weightsOut.weights.resize(header.numWeights);
+    weightsOut.perRow.resize(header.numPerRow);
+    const uchar* cur = mapped;
+    memcpy(weightsOut.rowStarts.data(), cur, weightsOut.rowStarts.size() * sizeof(int64_t));
+    cur += weightsOut.rowStarts.size() * sizeof(int64_t);
+    memcpy(weightsOut.indices.data(), cur, weightsOut.indices.size() * sizeof(int32_t));
+    cur += weightsOut.indices.size() * sizeof(int32_t);
+    memcpy(weightsOut.weights.data(), cur, weightsOut.weights.size() * sizeof(float));
+    cur += weightsOut.weights.size() * sizeof(float);
+    memcpy(weightsOut.perRow.data(), cur, weightsOut.perRow.size() * sizeof(float));
+    myFile.unmap((uchar*)mapped);
+    bool consistent = (weightsOut.rowStarts[0] == 0 && weightsOut.rowStarts[header.numRows] == header.numWeights);
+    for (int64_t i = 0; consistent && i < header.numRows; ++i)
+    {//users index the weight arrays with these, so a corrupt file must not get through
+        consistent = (weightsOut.rowStarts[i] <= weightsOut.rowStarts[i + 1]);
+    }
+    for (int64_t j = 0; consistent && j < header.numWeights; ++j)
+    {
+        consistent = (weightsOut.indices[j] >= 0 && weightsOut.indices[j] < numIndices);
+    }
+    if (!consistent)
+    {
+        CaretLogInfo("ignoring inconsistent weight cache file '" + myFile.fileName() + "'");
+        weightsOut = Weights();
+        return false;
+    }
+    touchFile(myFile);
+    CaretLogFine("loaded weights from cache file '" + myFile.fileName() + "'");
+    return true;
+}
+
+void SparseWeightCache::store(const QString& key, const Weights& weights)
+{
+    if (!isEnabled()) return;
+    CaretAssert(weights.rowStarts.size() > 0 && weights.indices.size() == weights.weights.size());
+    CaretAssert(weights.perRow.empty() || weights.perRow.size() + 1 == weights.rowStarts.size());
+    QString finalName = cacheFileName(s_directory, key);
+    QString tempName = finalName + ".tmp" + QString::number(QCoreApplication::applicationPid());//concurrent processes may compute the same weights, don't write into each others' files
+    QFile myFile(tempName);
+    if (!myFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        CaretLogInfo("unable to write weight cache file '" + tempName + "'");
+        return;
+    }
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.numRows = (int64_t)weights.rowStarts.size() - 1;
+    header.numWeights = (int64_t)weights.indices.size();
+    header.numPerRow = (int64_t)weights.perRow.size();
+    bool ok = myFile.write((const char*)&header, sizeof(CacheHeader)) == (qint64)sizeof(CacheHeader);
+    ok = ok && myFile.write((const char*)weights.rowStarts.data(), weights.rowStarts.size() * sizeof(int64_t)) == (qint64)(weights.rowStarts.size() * sizeof(int64_t));
+    ok = ok && myFile.write((const char*)weights.indices.data(), weights.indices.size() * sizeof(int32_t)) == (qint64)(weights.indices.size() * sizeof(int32_t));
+    ok = ok && myFile.write((const char*)weights.weights.data(), weights.weights.size() * sizeof(float)) == (qint64)(weights.weights.size() * sizeof(float));
+    ok = ok && myFile.write((const char*)weights.perRow.data(), weights.perRow.size() * sizeof(float)) == (qint64)(weights.perRow.size() * sizeof(float));
+    ok = ok && myFile.flush();
+    myFile.close();
+    if (!ok)
+    {
+        CaretLogInfo("failed to write weight cache file '" + tempName + "'");
+        myFile.remove();
+        return;
+    }
+    QFile::remove(finalName);//if another process stored the same key first, the contents are identical anyway
+    if (!myFile.rename(finalName))
+    {
+        myFile.remove();
+        return;
+    }
+    enforceSizeLimit();
+}
+
+void SparseWeightCache::enforceSizeLimit()
+{
+    if (s_maxBytes <= 0) return;
+    QFileInfoList entries = QDir(s_directory).entryInfoList(QStringList() << "*.wcsr", QDir::Files, QDir::Time | QDir::Reversed);//least recently used first, load() updates the modification time
+    int64_t total = 0;
+    for (int i = 0; i < entries.size(); ++i)
+    {
+        total += entries[i].size();
+    }
+    for (int i = 0; i < entries.size() && total > s_maxBytes; ++i)
+    {
+        if (QFile::remove(entries[i].absoluteFilePath()))
+        {
+            total -= entries[i].size();
+        }
+    }
+}
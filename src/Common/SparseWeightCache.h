@@ -0,0 +1,75 @@
+#ifndef __SPARSE_WEIGHT_CACHE_H__
+#define __SPARSE_WEIGHT_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <QCryptographicHash>
+#include <QString>
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret
+{
+
+    ///on-disk cache of precomputed sparse weights (smoothing kernels, resampling weights), in CSR format, keyed by a hash of everything the weights depend on
+    ///disabled unless a directory is set, all failures to read or write the cache are logged and treated as a cache miss
+    class SparseWeightCache
+    {
+    public:
+        ///builds the hash for a cache key, add every input that affects the weights
+        class KeyBuilder
+        {
+            QCryptographicHash m_hash;
+        public:
+            ///kind separates different users of the cache, change it if the weight computation changes
+            explicit KeyBuilder(const QString& kind);
+            void addData(const void* data, const int64_t& bytes);
+            template<typename T>
+            void addValue(const T& value) { addData(&value, sizeof(T)); }
+            QString getKey() const;
+        };
+        
+        ///weights for row i are at [rowStarts[i], rowStarts[i + 1]), perRow is optional extra data with one value per row (may be empty)
+        struct Weights
+        {
+            std::vector<int64_t> rowStarts;
+            std::vector<int32_t> indices;
+            std::vector<float> weights, perRow;
+        };
+        
+        ///empty directory disables the cache, maxBytes <= 0 means no size limit
+        static void setCacheDirectory(const QString& directory, const int64_t& maxBytes);
+        static bool isEnabled();
+        
+        ///returns false if the key isn't in the cache, or if the cached weights don't have numRows rows with indices in [0, numIndices)
+        static bool load(const QString& key, const int64_t& numRows, const int64_t& numIndices, Weights& weightsOut);
+        ///writes the weights, then removes the least recently used entries if the cache is over the size limit
+        static void store(const QString& key, const Weights& weights);
+    private:
+        static QString s_directory;
+        static int64_t s_maxBytes;
+        static void enforceSizeLimit();
+    };
+
+}
+
+#endif //__SPARSE_WEIGHT_CACHE_H__
@@ -0,0 +1,286 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "TfceMergeTree.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+///how it works:
+///elements are added in order of decreasing absolute value, and union-find tracks which cluster each added element is in
+///every cluster that exists at some threshold is a node of the merge tree, a node's accum is its integral from its peak down to where it merges into its parent (or to 0)
+///an element's TFCE value is the integral of the node it joined, from its own value down, plus the full accum of every ancestor node
+///so, each element only records the node's accum at the time it joined (as a negative offset), and the ancestor sums are done once per node at the end
+///positive and negative elements never join each other's clusters, so both signs are done in the same pass
+
+struct TfceMergeTree::Workspace
+{
+    vector<uint64_t> order;//absolute value bits in the high half, element index in the low half
+    vector<int64_t> setParent;//union-find, -1 for elements not added yet
+    vector<int64_t> setSize;
+    vector<int64_t> setNode;//only valid for set roots, the node for the cluster as a whole
+    vector<int64_t> elemNode;//node the element joined
+    vector<double> elemOffset;
+    vector<double> nodeAccum, nodeMeasure, nodeCum;
+    vector<float> nodeLast;
+    vector<double> nodeLastPow;//pow(nodeLast, integrated_h), so each value only needs pow() done once
+    vector<int64_t> nodeParent;
+    vector<int64_t> touching;
+
+    ///integrate the node from its last threshold down to bottomVal, at its current measure
+    void updateNode(const int64_t& node, const float& bottomVal, const double& bottomPow, const double& param_e, const double& integrated_h)
+    {
+        if (bottomVal != nodeLast[node])//skip computing if there is no difference
+        {
+            CaretAssert(bottomVal < nodeLast[node]);
+            nodeAccum[node] += pow(nodeMeasure[node], param_e) * (nodeLastPow[node] - bottomPow) / integrated_h;
+            nodeLast[node] = bottomVal;
+            nodeLastPow[node] = bottomPow;
+        }
+    }
+
+    int64_t newNode(const float& value, const double& valuePow, const double& measure)
+    {
+        nodeAccum.push_back(0.0);
+        nodeMeasure.push_back(measure);
+        nodeLast.push_back(value);
+        nodeLastPow.push_back(valuePow);
+        nodeParent.push_back(-1);
+        return (int64_t)nodeParent.size() - 1;
+    }
+};
+
+namespace
+{
+    int64_t findRoot(vector<int64_t>& setParent, int64_t elem)
+    {
+        while (setParent[elem] != elem)
+        {
+            setParent[elem] = setParent[setParent[elem]];//path halving
+            elem = setParent[elem];
+        }
+        return elem;
+    }
+
+    uint64_t floatBits(const float& value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+}
+
+TfceMergeTree::TfceMergeTree(const vector<int64_t>& offsets, const vector<int64_t>& neighbors, const vector<float>& measure)
+{
+    m_gridMode = false;
+    m_numElements = (int64_t)measure.size();
+    CaretAssert((int64_t)offsets.size() == m_numElements + 1);
+    CaretAssert(offsets.back() == (int64_t)neighbors.size());
+    if (m_numElements > (int64_t)UINT32_MAX) throw CaretException("too many elements for TFCE");
+    m_offsets = offsets;
+    m_neighbors = neighbors;
+    m_measure = measure;
+    m_voxelMeasure = 0.0f;
+    m_dims[0] = 0; m_dims[1] = 0; m_dims[2] = 0;
+}
+
+TfceMergeTree::TfceMergeTree(const int64_t dims[3], const float& voxelMeasure)
+{
+    m_gridMode = true;
+    m_dims[0] = dims[0]; m_dims[1] = dims[1]; m_dims[2] = dims[2];
+    m_numElements = dims[0] * dims[1] * dims[2];
+    if (m_numElements > (int64_t)UINT32_MAX) throw CaretException("too many elements for TFCE");
+    m_voxelMeasure = voxelMeasure;
+}
+
+void TfceMergeTree::compute(const float* data, float* out, const float* roiData, const float& param_e, const float& param_h) const
+{
+    Workspace work;
+    computeWithWorkspace(data, out, roiData, param_e, param_h, work);
+}
+
+void TfceMergeTree::computeMaps(const vector<const float*>& dataMaps, const vector<float*>& outMaps, const float* roiData, const float& param_e, const float& param_h) const
+{
+    CaretAssert(dataMaps.size() == outMaps.size());
+    const int64_t numMaps = (int64_t)dataMaps.size();
+#pragma omp CARET_PAR
+    {
+        Workspace work;//reuse the allocations for all maps this thread does
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t i = 0; i < numMaps; ++i)
+        {
+            computeWithWorkspace(dataMaps[i], outMaps[i], roiData, param_e, param_h, work);
+        }
+    }
+}
+
+void TfceMergeTree::computeWithWorkspace(const float* data, float* out, const float* roiData, const float& param_e, const float& param_h, Workspace& work) const
+{
+    const double use_e = param_e, integrated_h = param_h + 1.0f;//integral(x^h) = (x^(h + 1))/(h + 1) + C
+    work.order.clear();
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        if ((roiData == NULL || roiData[i] > 0.0f) && (data[i] > 0.0f || data[i] < 0.0f))//also excludes NaN
+        {
+            work.order.push_back((floatBits(abs(data[i])) << 32) | (uint64_t)i);//bits of positive floats sort the same as the values
+        }
+    }
+    sort(work.order.begin(), work.order.end());
+    work.setParent.assign(m_numElements, -1);
+    work.setSize.resize(m_numElements);
+    work.setNode.resize(m_numElements);
+    work.elemNode.resize(m_numElements);
+    work.elemOffset.resize(m_numElements);
+    work.nodeAccum.clear();
+    work.nodeMeasure.clear();
+    work.nodeLast.clear();
+    work.nodeLastPow.clear();
+    work.nodeParent.clear();
+    for (auto iter = work.order.rbegin(); iter != work.order.rend(); ++iter)//largest first
+    {
+        const int64_t elem = (int64_t)(*iter & 0xFFFFFFFFu);
+        const bool negative = data[elem] < 0.0f;
+        const float value = abs(data[elem]);
+        const double valuePow = pow((double)value, integrated_h);
+        const double elemMeasure = (m_gridMode ? m_voxelMeasure : m_measure[elem]);
+        work.touching.clear();
+        auto checkNeighbor = [&](const int64_t& neigh)
+        {
+            if (work.setParent[neigh] != -1 && (data[neigh] < 0.0f) == negative)
+            {
+                int64_t root = findRoot(work.setParent, neigh);
+                if (find(work.touching.begin(), work.touching.end(), root) == work.touching.end())
+                {
+                    work.touching.push_back(root);
+                }
+            }
+        };
+        if (m_gridMode)
+        {
+            const int64_t i = elem % m_dims[0], rest = elem / m_dims[0];
+            const int64_t j = rest % m_dims[1], k = rest / m_dims[1];
+            const int64_t jstride = m_dims[0], kstride = m_dims[0] * m_dims[1];
+            if (k > 0) checkNeighbor(elem - kstride);
+            if (j > 0) checkNeighbor(elem - jstride);
+            if (i > 0) checkNeighbor(elem - 1);
+            if (i + 1 < m_dims[0]) checkNeighbor(elem + 1);
+            if (j + 1 < m_dims[1]) checkNeighbor(elem + jstride);
+            if (k + 1 < m_dims[2]) checkNeighbor(elem + kstride);
+        } else {
+            const int64_t end = m_offsets[elem + 1];
+            for (int64_t n = m_offsets[elem]; n < end; ++n)
+            {
+                checkNeighbor(m_neighbors[n]);
+            }
+        }
+        const int numTouching = (int)work.touching.size();
+        switch (numTouching)
+        {
+            case 0://new peak, new leaf node
+            {
+                int64_t node = work.newNode(value, valuePow, elemMeasure);
+                work.setParent[elem] = elem;
+                work.setSize[elem] = 1;
+                work.setNode[elem] = node;
+                work.elemNode[elem] = node;
+                work.elemOffset[elem] = 0.0;
+                break;
+            }
+            case 1://grow the cluster, remember how much it had integrated before this element was in it
+            {
+                int64_t root = work.touching[0];
+                int64_t node = work.setNode[root];
+                work.updateNode(node, value, valuePow, use_e, integrated_h);
+                work.nodeMeasure[node] += elemMeasure;
+                work.setParent[elem] = root;
+                ++work.setSize[root];
+                work.elemNode[elem] = node;
+                work.elemOffset[elem] = -work.nodeAccum[node];
+                break;
+            }
+            default://merge: finish the touching nodes at this value, and make a new node as their parent
+            {
+                double mergedMeasure = elemMeasure;
+                int64_t bigRoot = work.touching[0];
+                for (int t = 0; t < numTouching; ++t)
+                {
+                    int64_t root = work.touching[t];
+                    int64_t node = work.setNode[root];
+                    work.updateNode(node, value, valuePow, use_e, integrated_h);
+                    mergedMeasure += work.nodeMeasure[node];
+                    if (work.setSize[root] > work.setSize[bigRoot]) bigRoot = root;
+                }
+                int64_t merged = work.newNode(value, valuePow, mergedMeasure);//NOTE: may reallocate node vectors
+                for (int t = 0; t < numTouching; ++t)
+                {
+                    int64_t root = work.touching[t];
+                    work.nodeParent[work.setNode[root]] = merged;
+                    if (root != bigRoot)
+                    {
+                        work.setParent[root] = bigRoot;
+                        work.setSize[bigRoot] += work.setSize[root];
+                    }
+                }
+                work.setParent[elem] = bigRoot;
+                ++work.setSize[bigRoot];
+                work.setNode[bigRoot] = merged;
+                work.elemNode[elem] = merged;
+                work.elemOffset[elem] = 0.0;
+                break;
+            }
+        }
+    }
+    const int64_t numNodes = (int64_t)work.nodeParent.size();
+    work.nodeCum.resize(numNodes);
+    for (int64_t node = numNodes - 1; node >= 0; --node)//parents are always created after their children
+    {
+        if (work.nodeParent[node] == -1)
+        {
+            work.updateNode(node, 0.0f, 0.0, use_e, integrated_h);//include the to-zero slice
+            work.nodeCum[node] = work.nodeAccum[node];
+        } else {
+            CaretAssert(work.nodeParent[node] > node);
+            work.nodeCum[node] = work.nodeAccum[node] + work.nodeCum[work.nodeParent[node]];
+        }
+    }
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        if (work.setParent[i] == -1)
+        {
+            out[i] = 0.0f;
+        } else {
+            double result = work.elemOffset[i] + work.nodeCum[work.elemNode[i]];
+            if (data[i] < 0.0f)
+            {
+                out[i] = (float)-result;
+            } else {
+                out[i] = (float)result;
+            }
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef __TFCE_MERGE_TREE_H__
+#define __TFCE_MERGE_TREE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cstdint>
+#include <vector>
+
+namespace caret
+{
+
+    ///exact threshold-free cluster enhancement, using a sort and union-find to build the tree of cluster merges, integrating each cluster only once
+    ///the neighbor structure is set up once and can then be used for any number of maps (columns, frames, permutations) at once
+    class TfceMergeTree
+    {
+        std::vector<int64_t> m_offsets, m_neighbors;//graph mode, compressed rows: neighbors of element i are m_neighbors[m_offsets[i]] to m_neighbors[m_offsets[i + 1] - 1]
+        std::vector<float> m_measure;//graph mode, area (or whatever) of each element
+        int64_t m_dims[3];//grid mode, i varies fastest
+        float m_voxelMeasure;
+        bool m_gridMode;
+        int64_t m_numElements;
+        struct Workspace;
+        void computeWithWorkspace(const float* data, float* out, const float* roiData, const float& param_e, const float& param_h, Workspace& work) const;
+    public:
+        ///arbitrary graph, such as a surface, offsets must have one more element than measure
+        TfceMergeTree(const std::vector<int64_t>& offsets, const std::vector<int64_t>& neighbors, const std::vector<float>& measure);
+
+        ///voxel grid with face neighbors and constant voxel volume, element index is i + dims[0] * (j + dims[1] * k)
+        TfceMergeTree(const int64_t dims[3], const float& voxelMeasure);
+
+        int64_t getNumberOfElements() const { return m_numElements; }
+
+        ///TFCE of positive values, negated TFCE of negated negative values, 0 outside the roi (roiData[i] <= 0) - roiData may be NULL
+        void compute(const float* data, float* out, const float* roiData, const float& param_e, const float& param_h) const;
+
+        ///same as compute() for each pair of maps, running the maps in parallel
+        void computeMaps(const std::vector<const float*>& dataMaps, const std::vector<float*>& outMaps, const float* roiData, const float& param_e, const float& param_h) const;
+    };
+
+}
+
+#endif //__TFCE_MERGE_TREE_H__
@@ -48,6 +48,7 @@
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
 #include "CaretPreferences.h"
+#include "CiftiFile.h"
 #include "CommandOperationManager.h"
 #include "DeveloperFlagsEnum.h"
 #if QT_VERSION < 0x060000
@@ -65,6 +66,7 @@
 #include "SceneDialog.h"
 #include "SessionManager.h"
 #include "SystemUtilities.h"
+#include "VolumeFile.h"
 #include "WorkbenchQtMessageHandler.h"
 #include "WuQMessageBox.h"
 #include "WuQtUtilities.h"
@@ -694,6 +696,12 @@ void printHelp(const AString& progName)
     << "    -help" << endl
     << "        display this usage text" << endl
     << endl
+    << "    -cifti-column-cache <max-MB>" << endl
+    << "        Read maps of large CIFTI files that are read as needed" << endl
+    << "        from a transposed copy in the user's cache directory," << endl
+    << "        built when a map is first shown, removing the least" << endl
+    << "        recently used copies when over max-MB." << endl
+    << endl
     << "    -enable-perf" << endl
     << "        Enable graphics performance improvements (surface buffers, volume textures)"
     << endl
@@ -780,6 +788,11 @@ void printHelp(const AString& progName)
     << "    -spec-load-all" << endl
     << "        load all files in the given spec file, don't show spec file dialog" << endl
     << endl
+    << "    -volume-paging <max-MB>" << endl
+    << "        Read uncompressed single-component NIFTI volumes larger" << endl
+    << "        than the limit a frame at a time as frames are viewed," << endl
+    << "        keeping about max-MB of each in memory." << endl
+    << endl
     << "    -window-size  <X Y>" << endl
     << "        Set the size of the browser window" << endl
     << endl
@@ -806,6 +819,25 @@ void parseCommandLine(const AString& progName, ProgramParameters* myParams, Prog
                 } else if (thisParam == "-help") {
                     printHelp(progName);
                     exit(0);
+                } else if (thisParam == "-cifti-column-cache") {
+                    if (myParams->hasNext()) {
+                        const AString limitText = myParams->nextString("CIFTI Column Cache Limit");
+                        bool valid = false;
+                        const double maxMB = limitText.toDouble(&valid);
+                        if (valid && (maxMB >= 0.0)) {
+                            CiftiFile::setColumnCacheLimit((int64_t)(maxMB * 1024 * 1024));
+                        }
+                        else {
+                            cerr << "Invalid size limit \""
+                            << qPrintable(limitText)
+                            << "\" for \"-cifti-column-cache\" option" << std::endl;
+                            hasFatalError = true;
+                        }
+                    }
+                    else {
+                        cerr << "Missing size limit for \"-cifti-column-cache\" option" << std::endl;
+                        hasFatalError = true;
+                    }
                 } else if (thisParam == "-enable-perf") {
                     DeveloperFlagsEnum::setFlag(DeveloperFlagsEnum::DEVELOPER_FLAG_SURFACE_BUFFER, true);
                 } else if (thisParam == "-logging") {
@@ -898,6 +930,25 @@ void parseCommandLine(const AString& progName, ProgramParameters* myParams, Prog
                         cerr << "Missing spec file name for \"-spec\" option" << endl;
                         hasFatalError = true;
                     }
+                } else if (thisParam == "-volume-paging") {
+                    if (myParams->hasNext()) {
+                        const AString limitText = myParams->nextString("Volume Paging Limit");
+                        bool valid = false;
+                        const double maxMB = limitText.toDouble(&valid);
+                        if (valid && (maxMB >= 0.0)) {
+                            VolumeFile::setPagedReadingMemoryLimit((int64_t)(maxMB * 1024 * 1024));
+                        }
+                        else {
+                            cerr << "Invalid size limit \""
+                            << qPrintable(limitText)
+                            << "\" for \"-volume-paging\" option" << std::endl;
+                            hasFatalError = true;
+                        }
+                    }
+                    else {
+                        cerr << "Missing size limit for \"-volume-paging\" option" << std::endl;
+                        hasFatalError = true;
+                    }
                 } else if (thisParam == "-graphics-size") {
                     if (myParams->hasNext()) {
                         myState.graphicsSizeXY[0] = myParams->nextInt("Graphics Size X");
@@ -24,6 +24,7 @@
 #include "ByteSwapping.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CiftiXMLCache.h"
 #include "FileInformation.h"
 
 #include <QByteArray>
@@ -89,7 +90,7 @@ void CaretSparseFile::readFile(const AString& filename)
     
     QByteArray myXMLBytes(xml_length, '\0');
     m_file.read(myXMLBytes.data(), xml_length);
-    m_xml.readXML(myXMLBytes);
+    CiftiXMLCache::readXML(m_xml, myXMLBytes);
     if (m_xml.getDimensionLength(CiftiXML::ALONG_ROW) != m_dims[0] || m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN) != m_dims[1])
     {
         throw DataFileException("cifti XML doesn't match dimensions of sparse file");
@@ -275,6 +275,37 @@ CiftiConnectivityMatrixDenseDynamicFile::getProcessedDataForRow(std::vector<floa
                                                dataOut);
 }
 
+/**
+ * Compute the average of the PROCESSED data for the given rows.  The
+ * correlation computes the average in one pass over the data.
+ *
+ * @param rowIndices
+ *     Indices of the rows.
+ * @param dataOut
+ *     Output with the average.
+ * @return
+ *     True if the average was computed.
+ */
+bool
+CiftiConnectivityMatrixDenseDynamicFile::getProcessedDataAverageForRows(const std::vector<int64_t>& rowIndices,
+                                                                        std::vector<float>& dataOut) const
+{
+    if ((m_numberOfBrainordinates <= 0)
+        || (m_numberOfTimePoints <= 0)) {
+        return false;
+    }
+    
+    ConnectivityCorrelationTwo* connCorrelationTwo(getConnectivityCorrelationTwo());
+    if (connCorrelationTwo == NULL) {
+        return false;
+    }
+    
+    CaretAssert(static_cast<int64_t>(dataOut.size()) == m_numberOfBrainordinates);
+    connCorrelationTwo->computeAverageForDataSetIndices(rowIndices,
+                                                        dataOut);
+    return true;
+}
+
 /**
  * Save subclass data to the scene.
  *
@@ -364,6 +395,13 @@ CiftiConnectivityMatrixDenseDynamicFile::getConnectivityCorrelationTwo() const
                                                                                      errorMessage);
             if (cc != NULL) {
                 m_connectivityCorrelationTwo.reset(cc);
+                if (cc->hasNormalizedData()) {
+                    /*
+                     * Correlation uses its own copy of the data, this copy
+                     * is reread if the correlation is recreated
+                     */
+                    std::vector<float>().swap(m_dataSeriesMatrixData);
+                }
             }
             else {
                 m_connectivityCorrelationFailedFlag = true;
@@ -359,6 +359,13 @@ CiftiConnectivityMatrixParcelDynamicFile::getConnectivityCorrelationTwo() const
                                                                                      errorMessage);
             if (cc != NULL) {
                 m_connectivityCorrelationTwo.reset(cc);
+                if (cc->hasNormalizedData()) {
+                    /*
+                     * Correlation uses its own copy of the data, this copy
+                     * is reread if the correlation is recreated
+                     */
+                    std::vector<float>().swap(m_dataSeriesMatrixData);
+                }
             }
             else {
                 m_connectivityCorrelationFailedFlag = true;
@@ -0,0 +1,288 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __CIFTI_CONNECTIVITY_MATRIX_ROW_CACHE_DECLARE__
+#include "CiftiConnectivityMatrixRowCache.h"
+#undef __CIFTI_CONNECTIVITY_MATRIX_ROW_CACHE_DECLARE__
+
+#include <algorithm>
+
+#include <QMutexLocker>
+#include <QThread>
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretLogger.h"
+#include "CiftiFile.h"
+
+using namespace caret;
+
+/**
+ * Runs the prefetching loop of a row cache.
+ */
+class CiftiConnectivityMatrixRowCache::PrefetchThread : public QThread
+{
+public:
+    PrefetchThread(CiftiConnectivityMatrixRowCache* rowCache)
+    : m_rowCache(rowCache) { }
+
+    void run() override {
+        m_rowCache->runPrefetching();
+    }
+
+    CiftiConnectivityMatrixRowCache* m_rowCache;
+};
+
+/**
+ * \class caret::CiftiConnectivityMatrixRowCache
+ * \brief Least recently used cache of rows read from a connectivity matrix file
+ * \ingroup Files
+ *
+ * Rows are read from the file on demand, and rows that are likely to be
+ * needed soon (such as those of vertices neighboring the identified vertex)
+ * may be read by a background thread so that they are in the cache when
+ * they are requested.  CiftiFile::getRow() is safe to call from more than
+ * one thread, so the file is not locked while a row is read.
+ */
+
+/**
+ * Constructor.
+ *
+ * @param ciftiFile
+ *    File from which rows are read, must remain valid for the life of this instance.
+ * @param maximumBytes
+ *    Memory that may be used by the cached rows.  At least one row is always cached.
+ */
+CiftiConnectivityMatrixRowCache::CiftiConnectivityMatrixRowCache(const CiftiFile* ciftiFile,
+                                                                 const int64_t maximumBytes)
+: m_ciftiFile(ciftiFile)
+{
+    CaretAssert(m_ciftiFile);
+    m_rowLength = m_ciftiFile->getNumberOfColumns();
+    const int64_t rowBytes = std::max(m_rowLength, (int64_t)1) * (int64_t)sizeof(float);
+    m_maximumNumberOfRows = std::max(maximumBytes / rowBytes, (int64_t)1);
+
+    m_prefetchThread.reset(new PrefetchThread(this));
+    m_prefetchThread->start(QThread::LowPriority);
+}
+
+/**
+ * Destructor.  Waits for any row being prefetched to finish reading.
+ */
+CiftiConnectivityMatrixRowCache::~CiftiConnectivityMatrixRowCache()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopPrefetchingFlag = true;
+        m_pendingRowIndices.clear();
+        m_prefetchCondition.wakeAll();
+    }
+    m_prefetchThread->wait();
+
+    CaretLogFine("Connectivity row cache for "
+                 + m_ciftiFile->getFileName()
+                 + " hits="
+                 + AString::number(m_hitCount)
+                 + " misses="
+                 + AString::number(m_missCount));
+}
+
+/**
+ * @return Maximum number of rows kept in the cache.
+ */
+int64_t
+CiftiConnectivityMatrixRowCache::getMaximumNumberOfRows() const
+{
+    return m_maximumNumberOfRows;
+}
+
+/**
+ * Get a row, from the cache if it is present, otherwise from the file.
+ *
+ * @param dataOut
+ *    Output with data, must have room for a complete row.
+ * @param rowIndex
+ *    Index of the row.
+ */
+void
+CiftiConnectivityMatrixRowCache::getRow(float* dataOut,
+                                        const int64_t rowIndex)
+{
+    if (copyRowFromCache(dataOut,
+                         rowIndex)) {
+        return;
+    }
+
+    std::vector<float> rowData(m_rowLength);
+    m_ciftiFile->getRow(rowData.data(),
+                        rowIndex);
+    std::copy(rowData.begin(),
+              rowData.end(),
+              dataOut);
+
+    QMutexLocker locker(&m_mutex);
+    insertRow(rowIndex,
+              rowData);
+}
+
+/**
+ * Request rows that are read in the background if they are not in the cache.
+ * Any rows from a previous request that have not been read are discarded,
+ * since they are no longer of interest.  Rows that are already cached are
+ * marked as recently used.
+ *
+ * @param rowIndices
+ *    Indices of rows, most important first.
+ */
+void
+CiftiConnectivityMatrixRowCache::requestPrefetch(const std::vector<int64_t>& rowIndices)
+{
+    /*
+     * Prefetching must not push out more than half the cache,
+     * which includes rows the user identified earlier.
+     */
+    const int64_t maximumPending = std::max(m_maximumNumberOfRows / 2, (int64_t)1);
+
+    QMutexLocker locker(&m_mutex);
+    m_pendingRowIndices.clear();
+    for (const int64_t rowIndex : rowIndices) {
+        if ((int64_t)m_pendingRowIndices.size() >= maximumPending) {
+            break;
+        }
+        if ((rowIndex < 0)
+            || (rowIndex >= m_ciftiFile->getNumberOfRows())) {
+            continue;
+        }
+        auto iter = m_rowLookup.find(rowIndex);
+        if (iter != m_rowLookup.end()) {
+            m_rows.splice(m_rows.begin(), m_rows, iter->second);
+        }
+        else {
+            m_pendingRowIndices.push_back(rowIndex);
+        }
+    }
+    if ( ! m_pendingRowIndices.empty()) {
+        m_prefetchCondition.wakeAll();
+    }
+}
+
+/**
+ * Copy a row from the cache and mark it as most recently used.
+ *
+ * @param dataOut
+ *    Output with data.
+ * @param rowIndex
+ *    Index of the row.
+ * @return
+ *    True if the row was in the cache, else false.
+ */
+bool
+CiftiConnectivityMatrixRowCache::copyRowFromCache(float* dataOut,
+                                                  const int64_t rowIndex)
+{
+    QMutexLocker locker(&m_mutex);
+    auto iter = m_rowLookup.find(rowIndex);
+    if (iter == m_rowLookup.end()) {
+        ++m_missCount;
+        return false;
+    }
+
+    m_rows.splice(m_rows.begin(), m_rows, iter->second);
+    const std::vector<float>& rowData = iter->second->second;
+    std::copy(rowData.begin(),
+              rowData.end(),
+              dataOut);
+    ++m_hitCount;
+    return true;
+}
+
+/**
+ * Add a row to the cache, removing the least recently used rows
+ * if the cache is full.  Must be called with the mutex locked.
+ *
+ * @param rowIndex
+ *    Index of the row.
+ * @param rowData
+ *    Data for the row, contents are moved into the cache.
+ */
+void
+CiftiConnectivityMatrixRowCache::insertRow(const int64_t rowIndex,
+                                           std::vector<float>& rowData)
+{
+    auto iter = m_rowLookup.find(rowIndex);
+    if (iter != m_rowLookup.end()) {
+        /*
+         * Other thread read it at the same time
+         */
+        m_rows.splice(m_rows.begin(), m_rows, iter->second);
+        return;
+    }
+
+    while ((int64_t)m_rows.size() >= m_maximumNumberOfRows) {
+        m_rowLookup.erase(m_rows.back().first);
+        m_rows.pop_back();
+    }
+    m_rows.emplace_front(rowIndex,
+                         std::move(rowData));
+    m_rowLookup[rowIndex] = m_rows.begin();
+}
+
+/**
+ * Loop run by the prefetch thread until the cache is destroyed.
+ */
+void
+CiftiConnectivityMatrixRowCache::runPrefetching()
+{
+    QMutexLocker locker(&m_mutex);
+    while ( ! m_stopPrefetchingFlag) {
+        if (m_pendingRowIndices.empty()) {
+            m_prefetchCondition.wait(&m_mutex);
+            continue;
+        }
+
+        const int64_t rowIndex = m_pendingRowIndices.front();
+        m_pendingRowIndices.pop_front();
+        if (m_rowLookup.find(rowIndex) != m_rowLookup.end()) {
+            continue;
+        }
+
+        locker.unlock();
+        std::vector<float> rowData(m_rowLength);
+        bool validFlag = true;
+        try {
+            m_ciftiFile->getRow(rowData.data(),
+                                rowIndex);
+        }
+        catch (const CaretException& e) {
+            CaretLogFine("Prefetch of row "
+                         + AString::number(rowIndex)
+                         + " failed: "
+                         + e.whatString());
+            validFlag = false;
+        }
+        locker.relock();
+
+        if (validFlag) {
+            insertRow(rowIndex,
+                      rowData);
+        }
+    }
+}
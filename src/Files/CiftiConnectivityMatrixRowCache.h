@@ -0,0 +1,107 @@
+#ifndef __CIFTI_CONNECTIVITY_MATRIX_ROW_CACHE_H__
+#define __CIFTI_CONNECTIVITY_MATRIX_ROW_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <QMutex>
+#include <QWaitCondition>
+
+namespace caret {
+
+    class CiftiFile;
+
+    class CiftiConnectivityMatrixRowCache
+    {
+    public:
+        CiftiConnectivityMatrixRowCache(const CiftiFile* ciftiFile,
+                                        const int64_t maximumBytes);
+
+        ~CiftiConnectivityMatrixRowCache();
+
+        CiftiConnectivityMatrixRowCache(const CiftiConnectivityMatrixRowCache&) = delete;
+
+        CiftiConnectivityMatrixRowCache& operator=(const CiftiConnectivityMatrixRowCache&) = delete;
+
+        void getRow(float* dataOut,
+                    const int64_t rowIndex);
+
+        void requestPrefetch(const std::vector<int64_t>& rowIndices);
+
+        int64_t getMaximumNumberOfRows() const;
+
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        class PrefetchThread;
+
+        typedef std::list<std::pair<int64_t, std::vector<float>>> RowList;
+
+        bool copyRowFromCache(float* dataOut,
+                              const int64_t rowIndex);
+
+        void insertRow(const int64_t rowIndex,
+                       std::vector<float>& rowData);
+
+        void runPrefetching();
+
+        const CiftiFile* m_ciftiFile;
+
+        int64_t m_rowLength;
+
+        int64_t m_maximumNumberOfRows;
+
+        /** protects all members below, but is not held while reading the file */
+        QMutex m_mutex;
+
+        QWaitCondition m_prefetchCondition;
+
+        /** most recently used row is at the front */
+        RowList m_rows;
+
+        std::unordered_map<int64_t, RowList::iterator> m_rowLookup;
+
+        std::deque<int64_t> m_pendingRowIndices;
+
+        bool m_stopPrefetchingFlag = false;
+
+        int64_t m_hitCount = 0;
+
+        int64_t m_missCount = 0;
+
+        std::unique_ptr<PrefetchThread> m_prefetchThread;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __CIFTI_CONNECTIVITY_MATRIX_ROW_CACHE_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __CIFTI_CONNECTIVITY_MATRIX_ROW_CACHE_DECLARE__
+
+} // namespace
+#endif  //__CIFTI_CONNECTIVITY_MATRIX_ROW_CACHE_H__
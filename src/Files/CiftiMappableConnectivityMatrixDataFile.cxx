@@ -23,13 +23,18 @@
 #include "CiftiMappableConnectivityMatrixDataFile.h"
 #undef __CIFTI_MAPPABLE_CONNECTIVITY_MATRIX_DATA_FILE_DECLARE__
 
+#include <algorithm>
+
 #include "CaretAssert.h"
+#include "CaretPreferences.h"
+#include "CiftiConnectivityMatrixRowCache.h"
 #include "CiftiFile.h"
 #include "CaretLogger.h"
 #include "ChartableMatrixParcelInterface.h"
 #include "ConnectivityDataLoaded.h"
 #include "DataFileException.h"
 #include "ElapsedTimer.h"
+#include "EventCaretPreferencesGet.h"
 #include "EventManager.h"
 #include "EventProgressUpdate.h"
 #include "SceneClass.h"
@@ -83,6 +88,10 @@ CiftiMappableConnectivityMatrixDataFile::~CiftiMappableConnectivityMatrixDataFil
 void
 CiftiMappableConnectivityMatrixDataFile::clear()
 {
+    /*
+     * Row cache may be reading the CiftiFile that the parent deletes
+     */
+    m_rowCache.reset();
     CiftiMappableDataFile::clear();
     clearPrivate();
 }
@@ -95,6 +104,9 @@ void
 CiftiMappableConnectivityMatrixDataFile::clearPrivate()
 {
     m_loadedRowData.clear();
+    m_rowCache.reset();
+    m_rowCacheCreationTested = false;
+    m_recentlyLoadedRowIndices.clear();
     m_rowLoadedTextForMapName = "";
     m_rowLoadedText = "";
     m_dataLoadingEnabled = true;
@@ -371,7 +383,13 @@ CiftiMappableConnectivityMatrixDataFile::getRowColumnAverageForIndices(const std
     bool dataWasLoadedFlag(false);
     
     const int64_t numIndices = static_cast<int64_t>(indices.size());
-    if (numIndices > 0) {
+    if ((numIndices > 0)
+        && doRowsFlag
+        && getProcessedDataAverageForRows(indices,
+                                          dataAverageOut)) {
+        dataWasLoadedFlag = true;
+    }
+    else if (numIndices > 0) {
         std::vector<double> sum(dataLength, 0.0);
         std::vector<float>  data(dataLength);
         
@@ -598,8 +616,15 @@ CiftiMappableConnectivityMatrixDataFile::getDataForColumn(float* dataOut, const
 void
 CiftiMappableConnectivityMatrixDataFile::getDataForRow(float* dataOut, const int64_t& index) const
 {
-    m_ciftiFile->getRow(dataOut,
-                        index);
+    CiftiConnectivityMatrixRowCache* rowCache = getRowCache();
+    if (rowCache != NULL) {
+        rowCache->getRow(dataOut,
+                         index);
+    }
+    else {
+        m_ciftiFile->getRow(dataOut,
+                            index);
+    }
 }
 
 /**
@@ -632,8 +657,136 @@ CiftiMappableConnectivityMatrixDataFile::getProcessedDataForColumn(float* dataOu
 void
 CiftiMappableConnectivityMatrixDataFile::getProcessedDataForRow(std::vector<float>& dataOut, const int64_t& index) const
 {
-    m_ciftiFile->getRow(&dataOut[0],
-                        index);
+    getDataForRow(&dataOut[0],
+                  index);
+}
+
+/**
+ * @return The cache for rows read from the file, or NULL if rows are not cached.
+ * Only dense connectivity files read from a local disk use a cache, other
+ * files are in memory, small, or compute their rows.  The size of the cache
+ * is from the preferences when the cache is created.
+ */
+CiftiConnectivityMatrixRowCache*
+CiftiMappableConnectivityMatrixDataFile::getRowCache() const
+{
+    if ( ! m_rowCacheCreationTested) {
+        m_rowCacheCreationTested = true;
+        
+        if ((m_ciftiFile != NULL)
+            && (getDataFileType() == DataFileTypeEnum::CONNECTIVITY_DENSE)
+            && ( ! m_ciftiFile->isInMemory())
+            && ( ! DataFile::isFileOnNetwork(getFileName()))) {
+            int64_t megabytes = 0;
+            EventCaretPreferencesGet prefsEvent;
+            EventManager::get()->sendEvent(prefsEvent.getPointer());
+            CaretPreferences* prefs = prefsEvent.getCaretPreferences();
+            if (prefs != NULL) {
+                megabytes = prefs->getConnectivityRowCacheMegabytes();
+            }
+            
+            if (megabytes > 0) {
+                m_rowCache.reset(new CiftiConnectivityMatrixRowCache(m_ciftiFile,
+                                                                     megabytes * 1024 * 1024));
+                CaretLogFine("Caching up to "
+                             + AString::number(m_rowCache->getMaximumNumberOfRows())
+                             + " rows of "
+                             + getFileNameNoPath());
+            }
+        }
+    }
+    
+    return m_rowCache.get();
+}
+
+/**
+ * Remember a row that was loaded so that it is kept in the row cache.
+ *
+ * @param rowIndex
+ *    Index of the row.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::addRecentlyLoadedRowIndex(const int64_t rowIndex)
+{
+    const int32_t maximumRecentRows = 16;
+    
+    std::deque<int64_t>::iterator iter = std::find(m_recentlyLoadedRowIndices.begin(),
+                                                   m_recentlyLoadedRowIndices.end(),
+                                                   rowIndex);
+    if (iter != m_recentlyLoadedRowIndices.end()) {
+        m_recentlyLoadedRowIndices.erase(iter);
+    }
+    m_recentlyLoadedRowIndices.push_front(rowIndex);
+    if (static_cast<int32_t>(m_recentlyLoadedRowIndices.size()) > maximumRecentRows) {
+        m_recentlyLoadedRowIndices.pop_back();
+    }
+}
+
+/**
+ * Start reading, in the background, the rows for the given surface nodes
+ * (typically neighbors of an identified node) and for recently loaded rows,
+ * so that they can be displayed without waiting for the disk when requested.
+ * Nothing is done if the file does not cache rows.
+ *
+ * @param surfaceNumberOfNodes
+ *    Number of nodes in surface.
+ * @param structure
+ *    Surface's structure.
+ * @param nodeIndices
+ *    Indices of nodes, most likely to be needed first.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::prefetchDataForSurfaceNodes(const int32_t surfaceNumberOfNodes,
+                                                                     const StructureEnum::Enum structure,
+                                                                     const std::vector<int32_t>& nodeIndices)
+{
+    if (( ! m_dataLoadingEnabled)
+        || ( ! isEnabledAsLayer())) {
+        return;
+    }
+    
+    CiftiConnectivityMatrixRowCache* rowCache = getRowCache();
+    if (rowCache == NULL) {
+        return;
+    }
+    
+    std::vector<int64_t> rowIndices;
+    for (const int32_t nodeIndex : nodeIndices) {
+        int64_t rowIndex = -1;
+        int64_t columnIndex = -1;
+        getRowColumnIndexForNodeWhenLoading(structure,
+                                            surfaceNumberOfNodes,
+                                            nodeIndex,
+                                            rowIndex,
+                                            columnIndex);
+        if (rowIndex >= 0) {
+            rowIndices.push_back(rowIndex);
+        }
+    }
+    rowIndices.insert(rowIndices.end(),
+                      m_recentlyLoadedRowIndices.begin(),
+                      m_recentlyLoadedRowIndices.end());
+    
+    rowCache->requestPrefetch(rowIndices);
+}
+
+/**
+ * Some file types can compute the average of several PROCESSED rows faster than
+ * reading and averaging each row, and can override this method.
+ *
+ * @param rowIndices
+ *     Indices of the rows.
+ * @param dataOut
+ *     Output with the average, already sized to the length of a row.
+ * @return
+ *     True if the average was computed, false to average the rows one at a time.
+ */
+bool
+CiftiMappableConnectivityMatrixDataFile::getProcessedDataAverageForRows(const std::vector<int64_t>& /*rowIndices*/,
+                                                                        std::vector<float>& /*dataOut*/) const
+{
+    /* This method may be overridden by subclasses */
+    return false;
 }
 
 /**
@@ -685,6 +838,7 @@ CiftiMappableConnectivityMatrixDataFile::loadDataForRowIndex(const int64_t rowIn
             CaretLogFine("Read row " + AString::number(rowIndex + CIFTI_FILE_ROW_COLUMN_INDEX_BASE_FOR_GUI));
             m_connectivityDataLoaded->setRowColumnLoading(rowIndex,
                                                           -1);
+            addRecentlyLoadedRowIndex(rowIndex);
         }
     }
     
@@ -836,6 +990,7 @@ CiftiMappableConnectivityMatrixDataFile::loadMapDataForSurfaceNode(const int32_t
                                        rowIndex);
                 
                 CaretLogFine("Read row for vertex " + AString::number(nodeIndex));
+                addRecentlyLoadedRowIndex(rowIndex);
                 
                 m_connectivityDataLoaded->setSurfaceNodeLoading(structure,
                                                                 surfaceNumberOfNodes,
@@ -1107,6 +1262,7 @@ CiftiMappableConnectivityMatrixDataFile::loadMapDataForVoxelAtCoordinate(const i
                                 + AString::fromNumbers(xyz, 3, "_").replace('-', 'm'));
             
             CaretLogFine("Read row for voxel " + AString::fromNumbers(xyz, 3, ","));
+            addRecentlyLoadedRowIndex(rowIndex);
             
             rowIndexOut = rowIndex;
             dataWasLoaded = true;
@@ -21,6 +21,8 @@
  */
 /*LICENSE_END*/
 
+#include <deque>
+#include <memory>
 #include <set>
 
 #include "BrainConstants.h"
@@ -30,6 +32,7 @@
 
 namespace caret {
 
+    class CiftiConnectivityMatrixRowCache;
     class ConnectivityDataLoaded;
     class SceneClassAssistant;
     
@@ -68,6 +71,10 @@ namespace caret {
                                                        const int64_t volumeDimensionIJK[3],
                                                        const std::vector<VoxelIJK>& voxelIndices);
         
+        void prefetchDataForSurfaceNodes(const int32_t surfaceNumberOfNodes,
+                                         const StructureEnum::Enum structure,
+                                         const std::vector<int32_t>& nodeIndices);
+        
         void loadDataForRowIndex(const int64_t rowIndex);
         
         void loadDataForColumnIndex(const int64_t rowIndex);
@@ -128,6 +135,8 @@ namespace caret {
         
         virtual void getProcessedDataForRow(std::vector<float>& dataOut, const int64_t& index) const;
         
+        virtual bool getProcessedDataAverageForRows(const std::vector<int64_t>& rowIndices, std::vector<float>& dataOut) const;
+        
         virtual void getDataForColumn(float* dataOut, const int64_t& index) const;
         
         virtual void getDataForRow(float* dataOut, const int64_t& index) const;
@@ -171,6 +180,10 @@ namespace caret {
         
         int32_t getCifitDirectionForLoadingRowOrColumn();
         
+        CiftiConnectivityMatrixRowCache* getRowCache() const;
+        
+        void addRecentlyLoadedRowIndex(const int64_t rowIndex);
+        
         // ADD_NEW_MEMBERS_HERE
         
         SceneClassAssistant* m_sceneAssistant;
@@ -185,6 +198,14 @@ namespace caret {
         
         ConnectivityDataLoaded* m_connectivityDataLoaded;
         
+        /** Rows read from an on-disk dense connectivity file, created when first needed */
+        mutable std::unique_ptr<CiftiConnectivityMatrixRowCache> m_rowCache;
+        
+        mutable bool m_rowCacheCreationTested = false;
+        
+        /** Rows most recently loaded for display, most recent at front */
+        std::deque<int64_t> m_recentlyLoadedRowIndices;
+        
         /*
          * This is really a member of parcel file since it the parcel
          * file is the only file that can load by row or column.
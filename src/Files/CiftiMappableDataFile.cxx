@@ -47,6 +47,7 @@
 #include "CiftiXML.h"
 #include "ConnectivityDataLoaded.h"
 #include "DataFileContentInformation.h"
+#include "DataFilePrefetcher.h"
 #include "EventManager.h"
 #include "EventCaretPreferencesGet.h"
 #include "EventSurfaceColoringInvalidate.h"
@@ -711,21 +712,46 @@ CiftiMappableDataFile::readFile(const AString& ciftiMapFileName)
             }
         }
         else {
-            m_ciftiFile.grabNew(new CiftiFile());
+            /*
+             * File may have been opened, and its data read, in the background
+             */
+            std::unique_ptr<CiftiFile> prefetchedCiftiFile = DataFilePrefetcher::takeCiftiFile(ciftiMapFileName);
+            const bool openFlag = ( ! prefetchedCiftiFile);
+            m_ciftiFile.grabNew(openFlag
+                                ? new CiftiFile()
+                                : prefetchedCiftiFile.release());
             switch (m_fileMapDataType) {
                 case FILE_MAP_DATA_TYPE_INVALID:
                     break;
                 case FILE_MAP_DATA_TYPE_MATRIX:
-                    m_ciftiFile->openFile(ciftiMapFileName);
+                    if (openFlag) {
+                        m_ciftiFile->openFile(ciftiMapFileName);
+                    }
                     break;
                 case FILE_MAP_DATA_TYPE_MULTI_MAP:
-                    m_ciftiFile->openFile(ciftiMapFileName);
+                    if (openFlag) {
+                        m_ciftiFile->openFile(ciftiMapFileName);
+                    }
                     
                     switch (m_fileDataReadingType) {
                         case FILE_READ_DATA_ALL:
                             m_ciftiFile->convertToInMemory();
                             break;
                         case FILE_READ_DATA_AS_NEEDED:
+                            /*
+                             * Maps are columns, which are slow to read from an
+                             * on-disk file, so optionally read them from a
+                             * transposed copy of the matrix in a cache file,
+                             * which is built when the first map is read.
+                             */
+                            if ((m_dataReadingAccessMethod == DATA_ACCESS_FILE_COLUMNS_OR_XML_ALONG_ROW)
+                                && CiftiFile::isColumnCacheEnabled()) {
+                                if ( ! m_ciftiFile->enableColumnCache()) {
+                                    CaretLogInfo("Unable to create column cache for "
+                                                 + ciftiMapFileName
+                                                 + ", maps will be read from the file.");
+                                }
+                            }
                             break;
                     }
                     break;
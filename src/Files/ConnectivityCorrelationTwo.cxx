@@ -25,7 +25,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <new>
 
 #include "CaretAssert.h"
 #include "CaretLogger.h"
@@ -53,6 +55,11 @@ using namespace caret;
  *    where the data is in the columns of a matrix, this value is the number of columns.
  * @param errorMessageOut
  *    Contains information describing the error
+ * @param normalizedDataEnabled
+ *    If true, a contiguous copy of the data normalized for the current settings is created
+ *    (unless there is not enough memory), which makes computations much faster, especially
+ *    averages and data with a stride other than one.  When the copy is created, the data
+ *    at the data set pointers is not used after this method returns.
  * @return Pointer to new instance or NULL if there is an error.
  */
 ConnectivityCorrelationTwo*
@@ -61,7 +68,8 @@ ConnectivityCorrelationTwo::newInstance(const AString& ownerName,
                                         const std::vector<const float*>& dataSetPointers,
                                         const int64_t numberOfDataElements,
                                         const int64_t dataStride,
-                                        AString& errorMessageOut)
+                                        AString& errorMessageOut,
+                                        const bool normalizedDataEnabled)
 {
     errorMessageOut.clear();
     
@@ -83,7 +91,8 @@ ConnectivityCorrelationTwo::newInstance(const AString& ownerName,
                                           settings,
                                           dataSetPointers,
                                           numberOfDataElements,
-                                          dataStride);
+                                          dataStride,
+                                          normalizedDataEnabled);
 }
 
 
@@ -100,12 +109,15 @@ ConnectivityCorrelationTwo::newInstance(const AString& ownerName,
  * @param dataStride
  *    The offset of each element in one data pointer.  In most cases, the data is contiguous, this value is one.  In instance
  *    where the data is in the columns of a matrix, this value is the number of columns.
+ * @param normalizedDataEnabled
+ *    If true, create the normalized copy of the data.
  */
 ConnectivityCorrelationTwo::ConnectivityCorrelationTwo(const AString& ownerName,
                                                        const ConnectivityCorrelationSettings& settings,
                                                        const std::vector<const float*>& dataSetPointers,
                                                        const int64_t numberOfDataElements,
-                                                       const int64_t dataStride)
+                                                       const int64_t dataStride,
+                                                       const bool normalizedDataEnabled)
 : CaretObject(),
 m_ownerName(ownerName),
 m_settings(settings),
@@ -138,11 +150,152 @@ m_dataStride(dataStride)
                                                sqrtSumSquared);
     }
 
+    if (normalizedDataEnabled) {
+        createNormalizedData();
+    }
+    
     if (m_debugFlag) {
         printDebugData();
     }
 }
 
+/**
+ * Create the normalized copy of the data.  Each row is the data set
+ * minus its mean (unless not demeaning) divided by the square root of
+ * its sum squared for correlation, or by the square root of the
+ * number of elements for covariance.  If there is not enough memory,
+ * the copy is not created and the source data is used.
+ */
+void
+ConnectivityCorrelationTwo::createNormalizedData()
+{
+    /*
+     * Pad rows to a multiple of 16 floats so every row starts on a
+     * 64-byte boundary, and allow room to align the first row.
+     */
+    const int64_t floatsPerAlignment(64 / sizeof(float));
+    m_normalizedRowStride = (((m_numberOfDataElements + floatsPerAlignment - 1) / floatsPerAlignment)
+                             * floatsPerAlignment);
+    try {
+        m_normalizedStorage.resize(m_numberOfDataSets * m_normalizedRowStride + floatsPerAlignment,
+                                   0.0f);
+    }
+    catch (const std::bad_alloc&) {
+        CaretLogInfo("Not enough memory for normalized correlation data of "
+                     + m_ownerName
+                     + ", correlation will be slower");
+        m_normalizedStorage.clear();
+        m_normalizedRowStride = 0;
+        return;
+    }
+    const uintptr_t address(reinterpret_cast<uintptr_t>(m_normalizedStorage.data()));
+    const int64_t alignOffset(((64 - (address % 64)) % 64) / sizeof(float));
+    m_normalizedData = m_normalizedStorage.data() + alignOffset;
+    
+    bool covarianceFlag(false);
+    switch (m_settings.getMode()) {
+        case ConnectivityCorrelationModeEnum::CORRELATION:
+            break;
+        case ConnectivityCorrelationModeEnum::COVARIANCE:
+            covarianceFlag = true;
+            break;
+    }
+    const bool demeanFlag(covarianceFlag
+                          || ( ! m_settings.isCorrelationNoDemeanEnabled()));
+    
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t dataSetIndex = 0; dataSetIndex < m_numberOfDataSets; dataSetIndex++) {
+        const DataSet* dataSet(m_dataSets[dataSetIndex]);
+        CaretAssert(dataSet);
+        const double offset(demeanFlag
+                            ? dataSet->m_mean
+                            : 0.0);
+        double scale(0.0);
+        if (covarianceFlag) {
+            scale = 1.0 / std::sqrt(static_cast<double>(m_numberOfDataElements));
+        }
+        else if (dataSet->m_sqrtSumSquared != 0.0f) {
+            scale = 1.0 / dataSet->m_sqrtSumSquared;
+        }
+        float* row(const_cast<float*>(getNormalizedRow(dataSetIndex)));
+        for (int64_t i = 0; i < m_numberOfDataElements; i++) {
+            row[i] = (dataSet->get(i) - offset) * scale;
+        }
+    }
+}
+
+/**
+ * @return True if the normalized copy of the data is used for computations.
+ */
+bool
+ConnectivityCorrelationTwo::hasNormalizedData() const
+{
+    return (m_normalizedData != NULL);
+}
+
+/**
+ * @return True if the average of the values for several data sets is the value
+ * for the average of their normalized rows, which is true for covariance
+ * and for correlation without Fisher-Z.
+ */
+bool
+ConnectivityCorrelationTwo::isAverageLinear() const
+{
+    switch (m_settings.getMode()) {
+        case ConnectivityCorrelationModeEnum::CORRELATION:
+            return ( ! m_settings.isCorrelationFisherZEnabled());
+            break;
+        case ConnectivityCorrelationModeEnum::COVARIANCE:
+            break;
+    }
+    return true;
+}
+
+/**
+ * Limit a correlation to a valid value, and apply Fisher-Z if enabled.
+ * @param value
+ *    The correlation.
+ * @return
+ *    The limited correlation.
+ */
+float
+ConnectivityCorrelationTwo::applyCorrelationLimits(float value) const
+{
+    if (m_settings.isCorrelationFisherZEnabled()) {
+        if (value > 0.999999) value = 0.999999;   /*prevent inf */
+        if (value < -0.999999) value = -0.999999; /*prevent -inf*/
+        value = 0.5 * std::log((1 + value) / (1 - value));
+    }
+    else {
+        if (value > 1.0) value = 1.0; /*don't output anything silly*/
+        if (value < -1.0) value = -1.0;
+    }
+    return value;
+}
+
+/**
+ * Compute the dot product of the given normalized row with all normalized rows,
+ * which is the correlation/covariance with each data set.
+ * @param normalizedRow
+ *    The normalized row, such as one data set or the average for several data sets.
+ * @param dataOut
+ *    Output with the dot products, correlation limits are NOT applied.
+ */
+void
+ConnectivityCorrelationTwo::computeForNormalizedRow(const float* normalizedRow,
+                                                    std::vector<float>& dataOut) const
+{
+    CaretAssert(hasNormalizedData());
+    dataOut.resize(m_numberOfDataSets);
+    
+#pragma omp CARET_PARFOR schedule(static, 256)
+    for (int64_t i = 0; i < m_numberOfDataSets; i++) {
+        dataOut[i] = dsdot(normalizedRow,
+                           getNormalizedRow(i),
+                           m_numberOfDataElements);
+    }
+}
+
 /**
  * Compute the mean and the square root of sum squared for the given data
  * @param dataPtr
@@ -240,6 +393,51 @@ ConnectivityCorrelationTwo::computeAverageForDataSetIndices(const std::vector<in
         return;
     }
 
+    if (hasNormalizedData()
+        && isAverageLinear()) {
+        /*
+         * The average of dot products with each seed's row is the dot
+         * product with the average of the seed rows, so only one pass
+         * over all the data is needed regardless of the number of seeds.
+         */
+        const double numIndicesFloat(dataSetIndices.size());
+        std::vector<double> rowSum(m_numberOfDataElements, 0.0);
+        for (int64_t index : dataSetIndices) {
+            CaretAssertVectorIndex(m_dataSets, index);
+            const float* row(getNormalizedRow(index));
+            for (int64_t i = 0; i < m_numberOfDataElements; i++) {
+                rowSum[i] += row[i];
+            }
+        }
+        std::vector<float> averageRow(m_numberOfDataElements);
+        for (int64_t i = 0; i < m_numberOfDataElements; i++) {
+            averageRow[i] = rowSum[i] / numIndicesFloat;
+        }
+        
+        computeForNormalizedRow(averageRow.data(),
+                                dataOut);
+        
+        switch (m_settings.getMode()) {
+            case ConnectivityCorrelationModeEnum::CORRELATION:
+                /*
+                 * Correlation of a data set with itself is always one,
+                 * even when the data set is constant.
+                 */
+                for (int64_t index : dataSetIndices) {
+                    const float* row(getNormalizedRow(index));
+                    dataOut[index] += ((1.0 - dsdot(row, row, m_numberOfDataElements))
+                                       / numIndicesFloat);
+                }
+                for (int64_t i = 0; i < numData; i++) {
+                    dataOut[i] = applyCorrelationLimits(dataOut[i]);
+                }
+                break;
+            case ConnectivityCorrelationModeEnum::COVARIANCE:
+                break;
+        }
+        return;
+    }
+
     /*
      * Note: OpenMP is not used here.
      * OpenMP is used in 'computeForDataSet()'
@@ -324,6 +522,19 @@ ConnectivityCorrelationTwo::computeForDataSet(const DataSet& dataSet,
             break;
     }
 
+    if (hasNormalizedData()) {
+        computeForNormalizedRow(getNormalizedRow(dataSet.m_dataSetIndex),
+                                dataOut);
+        if (correlationModeFlag) {
+            for (int64_t i = 0; i < m_numberOfDataSets; i++) {
+                dataOut[i] = applyCorrelationLimits(dataOut[i]);
+            }
+            /* correlation with 'self' */
+            dataOut[dataSet.m_dataSetIndex] = 1.0;
+        }
+        return;
+    }
+    
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int64_t i = 0; i < m_numberOfDataSets; i++) {
         if (correlationModeFlag
@@ -386,17 +597,7 @@ ConnectivityCorrelationTwo::computeForDataSets(const DataSet& a,
             
             const double denom(a.m_sqrtSumSquared * b.m_sqrtSumSquared);
             if (denom != 0.0) {
-                value = (ssxy / denom);
-
-                if (m_settings.isCorrelationFisherZEnabled()) {
-                    if (value > 0.999999) value = 0.999999;   /*prevent inf */
-                    if (value < -0.999999) value = -0.999999; /*prevent -inf*/
-                    value = 0.5 * std::log((1 + value) / (1 - value));
-                }
-                else {
-                    if (value > 1.0) value = 1.0; /*don't output anything silly*/
-                    if (value < -1.0) value = -1.0;
-                }
+                value = applyCorrelationLimits(ssxy / denom);
             }
         }
             break;
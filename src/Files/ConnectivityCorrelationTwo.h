@@ -38,7 +38,8 @@ namespace caret {
                                                        const std::vector<const float*>& dataSetPointers,
                                                        const int64_t numberOfDataElements,
                                                        const int64_t dataStride,
-                                                       AString& errorMessageOut);
+                                                       AString& errorMessageOut,
+                                                       const bool normalizedDataEnabled = true);
 
         virtual ~ConnectivityCorrelationTwo();
         
@@ -48,6 +49,8 @@ namespace caret {
         
         const ConnectivityCorrelationSettings* getSettings() const;
         
+        bool hasNormalizedData() const;
+        
         void computeAverageForDataSetIndices(const std::vector<int64_t> dataSetIndices,
                                              std::vector<float>& dataOut) const;
         
@@ -91,7 +94,23 @@ namespace caret {
                                    const ConnectivityCorrelationSettings& settings,
                                    const std::vector<const float*>& dataSetPointers,
                                    const int64_t numberOfDataElements,
-                                   const int64_t dataStride);
+                                   const int64_t dataStride,
+                                   const bool normalizedDataEnabled);
+        
+        void createNormalizedData();
+        
+        /** @return normalized row for a data set, only valid if hasNormalizedData() */
+        const float* getNormalizedRow(const int64_t dataSetIndex) const {
+            CaretAssert((dataSetIndex >= 0) && (dataSetIndex < m_numberOfDataSets));
+            return m_normalizedData + dataSetIndex * m_normalizedRowStride;
+        }
+        
+        void computeForNormalizedRow(const float* normalizedRow,
+                                     std::vector<float>& dataOut) const;
+        
+        bool isAverageLinear() const;
+        
+        float applyCorrelationLimits(float value) const;
         
         void computeForDataSet(const DataSet& dataSet,
                                std::vector<float>& dataOut) const;
@@ -119,6 +138,17 @@ namespace caret {
         
         std::vector<DataSet*> m_dataSets;
         
+        /**
+         * Rows, contiguous and starting on 64-byte boundaries, scaled so that the dot product
+         * of two rows is the correlation (before any Fisher-Z) or covariance of the data sets.
+         * When present, the source data is not used after the constructor.
+         */
+        std::vector<float> m_normalizedStorage;
+        
+        const float* m_normalizedData = NULL;
+        
+        int64_t m_normalizedRowStride = 0;
+        
         bool m_debugFlag = false;
         
         // ADD_NEW_MEMBERS_HERE
@@ -25,15 +25,20 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <limits>
 
 #include <QImage>
 #include <QImageWriter>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include "BackgroundAndForegroundColors.h"
 #include "BoundingBox.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretLruCache.h"
+#include "CaretOMP.h"
 #include "CaretPreferences.h"
 #include "CziImage.h"
 #include "CziImageLoaderMultiResolution.h"
@@ -65,6 +70,101 @@ using namespace caret;
 
 static bool cziDebugFlag(false);
 
+namespace {
+    /**
+     * Width and height, in pixels, of tiles that are read and cached
+     */
+    const int64_t TILE_PIXEL_SIZE = 512;
+    
+    /**
+     * Serializes reading from a stream.  The stream created by libCZI
+     * seeks and then reads so it must not be used by more than one
+     * thread at a time but decoding of subblocks may run in parallel.
+     */
+    class SerializedStream : public libCZI::IStream
+    {
+    public:
+        SerializedStream(const std::shared_ptr<libCZI::IStream>& stream)
+        : m_stream(stream) { }
+        
+        void Read(std::uint64_t offset,
+                  void* pv,
+                  std::uint64_t size,
+                  std::uint64_t* ptrBytesRead) override {
+            QMutexLocker locker(&m_mutex);
+            m_stream->Read(offset, pv, size, ptrBytesRead);
+        }
+        
+    private:
+        std::shared_ptr<libCZI::IStream> m_stream;
+        
+        QMutex m_mutex;
+    };
+    
+    /**
+     * @return Largest integer less than or equal to numerator / denominator
+     * (denominator must be positive)
+     */
+    int64_t floorDivide(const int64_t numerator,
+                        const int64_t denominator)
+    {
+        int64_t quotient(numerator / denominator);
+        if ((numerator % denominator) < 0) {
+            --quotient;
+        }
+        return quotient;
+    }
+    
+    /**
+     * @return Largest power of two reduction in resolution that still has at least
+     * the resolution of the given zoom, so that tiles read for one region are
+     * reused for nearby regions without the image becoming too coarse.
+     */
+    int32_t zoomToZoomShift(const float zoom)
+    {
+        if ((zoom <= 0.0f)
+            || (zoom >= 1.0f)) {
+            return 0;
+        }
+        return MathFunctions::clamp(static_cast<int32_t>(std::floor(-std::log2(zoom))),
+                                    0, 20);
+    }
+    
+    /**
+     * @return Number of bytes in a pixel of the given type or zero if not supported
+     */
+    int64_t getBytesPerPixel(const libCZI::PixelType pixelType)
+    {
+        switch (pixelType) {
+            case libCZI::PixelType::Gray8:
+                return 1;
+            case libCZI::PixelType::Gray16:
+                return 2;
+            case libCZI::PixelType::Gray32Float:
+                return 4;
+            case libCZI::PixelType::Bgr24:
+                return 3;
+            case libCZI::PixelType::Bgr48:
+                return 6;
+            case libCZI::PixelType::Bgr96Float:
+                return 12;
+            case libCZI::PixelType::Bgra32:
+                return 4;
+            case libCZI::PixelType::Gray64ComplexFloat:
+                return 16;
+            case libCZI::PixelType::Bgr192ComplexFloat:
+                return 48;
+            case libCZI::PixelType::Gray32:
+                return 4;
+            case libCZI::PixelType::Gray64Float:
+                return 8;
+            case libCZI::PixelType::Invalid:
+                break;
+        }
+        return 0;
+    }
+}
+
 /**
  * \class caret::CziImageFile
  * \brief A Zeiss CZI image file
@@ -133,6 +233,13 @@ CziImageFile::resetPrivate()
     m_reader.reset();
     
     m_stream.reset();
+    
+    /*
+     * Default of 512 MB for decoded tiles of a file
+     */
+    m_tileCache.reset(new TileCache("CZI tile",
+                                    TileCache::getMaximumBytesFromEnvironment("WORKBENCH_CZI_TILE_CACHE_MB",
+                                                                              512)));
 
     m_pixelSizeMmX = 1.0f;
     m_pixelSizeMmY = 1.0f;
@@ -343,12 +450,13 @@ CziImageFile::readFile(const AString& filename)
         /*
          * If file does not exist, a std::exception is thrown
          */
-        m_stream = libCZI::CreateStreamFromFile(filename.toStdWString().c_str());
-        if ( ! m_stream) {
+        std::shared_ptr<libCZI::IStream> fileStream(libCZI::CreateStreamFromFile(filename.toStdWString().c_str()));
+        if ( ! fileStream) {
             m_errorMessage = "Creating stream for reading CZI file failed.";
             m_status = Status::ERRORED;
             return;
         }
+        m_stream.reset(new SerializedStream(fileStream));
         
         m_reader = libCZI::CreateCZIReader();
         if ( ! m_reader) {
@@ -873,16 +981,6 @@ CziImageFile::readFromCziImageFile(const ImageDataFormat imageDataFormat,
         return NULL;
     }
     
-    libCZI::CDimCoordinate coordinate;
-    coordinate.Set(libCZI::DimensionIndex::C, 0);
-    
-    const std::array<float, 3> prefBackRGB = getPreferencesImageBackgroundFloatRGB();
-    libCZI::ISingleChannelScalingTileAccessor::Options scstaOptions;
-    scstaOptions.Clear();
-    scstaOptions.backGroundColor.r = prefBackRGB[0];
-    scstaOptions.backGroundColor.g = prefBackRGB[1];
-    scstaOptions.backGroundColor.b = prefBackRGB[2];
-    
     float zoomToRead(1.0);
     QRectF regionOfInterest(regionOfInterestIn);
     
@@ -908,17 +1006,30 @@ CziImageFile::readFromCziImageFile(const ImageDataFormat imageDataFormat,
         zoomToRead = newZoom;
     }
     
-    /*
-     * Read into 24 bit RGB to avoid conversion from other pixel formats
-     */
     if (cziDebugFlag) {
         std::cout << "----------------------" << std::endl;
         std::cout << "READING IMAGE with ROI: " << CziUtilities::qRectToString(regionOfInterest) << std::endl;
     }
-    const libCZI::PixelType pixelType(libCZI::PixelType::Bgr24);
-    const libCZI::IntRect intRectROI = CziUtilities::qRectToIntRect(regionOfInterest);
     CaretAssert(m_scalingTileAccessor);
     
+    /*
+     * Data is read from tiles at a power of two reduction in resolution
+     * so expand the region to whole pixels at that resolution
+     */
+    const int32_t zoomShift(zoomToZoomShift(zoomToRead));
+    const int64_t zoomScale(static_cast<int64_t>(1) << zoomShift);
+    libCZI::IntRect intRectROI = CziUtilities::qRectToIntRect(regionOfInterest);
+    {
+        const int64_t minX(floorDivide(intRectROI.x, zoomScale) * zoomScale);
+        const int64_t minY(floorDivide(intRectROI.y, zoomScale) * zoomScale);
+        const int64_t maxX(-floorDivide(-(static_cast<int64_t>(intRectROI.x) + intRectROI.w), zoomScale) * zoomScale);
+        const int64_t maxY(-floorDivide(-(static_cast<int64_t>(intRectROI.y) + intRectROI.h), zoomScale) * zoomScale);
+        intRectROI.x = static_cast<int>(minX);
+        intRectROI.y = static_cast<int>(minY);
+        intRectROI.w = static_cast<int>(maxX - minX);
+        intRectROI.h = static_cast<int>(maxY - minY);
+    }
+    
     std::shared_ptr<libCZI::IBitmapData> bitmapDataRead;
     
     /*
@@ -951,17 +1062,26 @@ CziImageFile::readFromCziImageFile(const ImageDataFormat imageDataFormat,
         int index = 0;  /* index counting only the active channels */
         std::map<int, int> activeChNoToChIdx;   /* we need to keep track which 'active channels" corresponds to which channel index */
         
+        bool channelReadErrorFlag(false);
         libCZI::CDisplaySettingsHelper::EnumEnabledChannels(m_displaySettings.get(),
                                                             [&](int chIdx)->bool
                                                             {
-            libCZI::CDimCoordinate planeCoord{ { libCZI::DimensionIndex::C, chIdx } };
-            actvChBms.emplace_back(m_scalingTileAccessor->Get(intRectROI,
-                                                              &planeCoord,
-                                                              zoomToRead,
-                                                              nullptr));
+            std::shared_ptr<libCZI::IBitmapData> channelBitmap(readRegionFromTiles(chIdx,
+                                                                                   false,
+                                                                                   intRectROI,
+                                                                                   zoomShift,
+                                                                                   errorMessageOut));
+            if ( ! channelBitmap) {
+                channelReadErrorFlag = true;
+                return false;
+            }
+            actvChBms.emplace_back(channelBitmap);
             activeChNoToChIdx[chIdx] = index++;
             return true;
         });
+        if (channelReadErrorFlag) {
+            return NULL;
+        }
         
         /*
          * initialize the helper with the display-settings and provide the pixeltypes
@@ -1005,16 +1125,22 @@ CziImageFile::readFromCziImageFile(const ImageDataFormat imageDataFormat,
         }
     }
     else {
-        bitmapDataRead = m_scalingTileAccessor->Get(pixelType,
-                                                    intRectROI,
-                                                    &coordinate,
-                                                    zoomToRead,
-                                                    &scstaOptions);
+        /*
+         * Read into 24 bit RGB to avoid conversion from other pixel formats
+         */
+        const int32_t firstChannelIndex(0);
+        bitmapDataRead = readRegionFromTiles(firstChannelIndex,
+                                             true,
+                                             intRectROI,
+                                             zoomShift,
+                                             errorMessageOut);
     }
 
     if ( ! bitmapDataRead) {
-        errorMessageOut = ("Failed to read data for region "
-                           + CziUtilities::intRectToString(intRectROI));
+        if (errorMessageOut.isEmpty()) {
+            errorMessageOut = ("Failed to read data for region "
+                               + CziUtilities::intRectToString(intRectROI));
+        }
         return NULL;
     }
     
@@ -1055,6 +1181,208 @@ CziImageFile::readFromCziImageFile(const ImageDataFormat imageDataFormat,
     return cziImageOut;
 }
 
+/**
+ * Read a region from the image by assembling tiles.  Tiles not in the tile
+ * cache are read and decoded in parallel and then added to the cache.
+ *
+ * @param channelIndex
+ *    Index of the channel.
+ * @param bgr24Flag
+ *    If true, read 24 bit RGB with the preferences background color,
+ *    else read the channel's pixel type.
+ * @param tileAlignedRegion
+ *    Region to read whose edges are multiples of 2^zoomShift.
+ * @param zoomShift
+ *    Resolution is reduced by 2^zoomShift.
+ * @param errorMessageOut
+ *    Contains information about any errors
+ * @return
+ *    Bitmap containing the region or NULL if there is an error.
+ */
+std::shared_ptr<libCZI::IBitmapData>
+CziImageFile::readRegionFromTiles(const int32_t channelIndex,
+                                  const bool bgr24Flag,
+                                  const libCZI::IntRect& tileAlignedRegion,
+                                  const int32_t zoomShift,
+                                  AString& errorMessageOut)
+{
+    CaretAssert(m_scalingTileAccessor);
+    CaretAssert(m_tileCache);
+    
+    const int64_t zoomScale(static_cast<int64_t>(1) << zoomShift);
+    const int64_t tileLogicalSize(TILE_PIXEL_SIZE * zoomScale);
+    const float zoom(1.0f / static_cast<float>(zoomScale));
+    CaretAssert((tileAlignedRegion.x % zoomScale) == 0);
+    CaretAssert((tileAlignedRegion.y % zoomScale) == 0);
+    
+    const int64_t outputX(tileAlignedRegion.x / zoomScale);
+    const int64_t outputY(tileAlignedRegion.y / zoomScale);
+    const int64_t outputWidth(tileAlignedRegion.w / zoomScale);
+    const int64_t outputHeight(tileAlignedRegion.h / zoomScale);
+    if ((outputWidth <= 0)
+        || (outputHeight <= 0)) {
+        errorMessageOut = ("Region is empty at zoom "
+                           + AString::number(zoom)
+                           + ": "
+                           + CziUtilities::intRectToString(tileAlignedRegion));
+        return std::shared_ptr<libCZI::IBitmapData>();
+    }
+    
+    libCZI::CDimCoordinate planeCoordinate;
+    planeCoordinate.Set(libCZI::DimensionIndex::C, channelIndex);
+    
+    /*
+     * Tiles are identical for any background color when the
+     * pixel type is native since the composite replaces the background
+     */
+    libCZI::ISingleChannelScalingTileAccessor::Options options;
+    options.Clear();
+    int32_t pixelVariant(-1);
+    if (bgr24Flag) {
+        const std::array<uint8_t, 3> prefBackRGB = getPreferencesImageBackgroundByteRGB();
+        const std::array<float, 3> prefBackFloatRGB = BackgroundAndForegroundColors::toFloatRGB(prefBackRGB.data());
+        options.backGroundColor.r = prefBackFloatRGB[0];
+        options.backGroundColor.g = prefBackFloatRGB[1];
+        options.backGroundColor.b = prefBackFloatRGB[2];
+        pixelVariant = ((static_cast<int32_t>(prefBackRGB[0]) << 16)
+                        | (static_cast<int32_t>(prefBackRGB[1]) << 8)
+                        | static_cast<int32_t>(prefBackRGB[2]));
+    }
+    
+    const int64_t firstTileX(floorDivide(outputX, TILE_PIXEL_SIZE));
+    const int64_t lastTileX(floorDivide(outputX + outputWidth - 1, TILE_PIXEL_SIZE));
+    const int64_t firstTileY(floorDivide(outputY, TILE_PIXEL_SIZE));
+    const int64_t lastTileY(floorDivide(outputY + outputHeight - 1, TILE_PIXEL_SIZE));
+    
+    std::vector<TileKey> tileKeys;
+    std::vector<std::shared_ptr<libCZI::IBitmapData>> tileBitmaps;
+    std::vector<int64_t> missingTileIndices;
+    for (int64_t tileY = firstTileY; tileY <= lastTileY; tileY++) {
+        for (int64_t tileX = firstTileX; tileX <= lastTileX; tileX++) {
+            const TileKey tileKey(channelIndex,
+                                  pixelVariant,
+                                  zoomShift,
+                                  tileX,
+                                  tileY);
+            std::shared_ptr<libCZI::IBitmapData> tileBitmap(m_tileCache->get(tileKey));
+            if ( ! tileBitmap) {
+                missingTileIndices.push_back(static_cast<int64_t>(tileKeys.size()));
+            }
+            tileKeys.push_back(tileKey);
+            tileBitmaps.push_back(tileBitmap);
+        }
+    }
+    
+    /*
+     * Subblocks are read one at a time by the stream but are decoded in parallel
+     */
+    const int64_t numberOfMissingTiles(missingTileIndices.size());
+    AString tileErrorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t iMissing = 0; iMissing < numberOfMissingTiles; iMissing++) {
+        const int64_t tileIndex(missingTileIndices[iMissing]);
+        const TileKey& tileKey(tileKeys[tileIndex]);
+        const libCZI::IntRect tileRect { static_cast<int>(std::get<3>(tileKey) * tileLogicalSize),
+                                         static_cast<int>(std::get<4>(tileKey) * tileLogicalSize),
+                                         static_cast<int>(tileLogicalSize),
+                                         static_cast<int>(tileLogicalSize) };
+        try {
+            if (bgr24Flag) {
+                tileBitmaps[tileIndex] = m_scalingTileAccessor->Get(libCZI::PixelType::Bgr24,
+                                                                    tileRect,
+                                                                    &planeCoordinate,
+                                                                    zoom,
+                                                                    &options);
+            }
+            else {
+                tileBitmaps[tileIndex] = m_scalingTileAccessor->Get(tileRect,
+                                                                    &planeCoordinate,
+                                                                    zoom,
+                                                                    nullptr);
+            }
+        }
+        catch (const std::exception& e) {
+#pragma omp critical
+            {
+                tileErrorMessage = ("Failed to read data for region "
+                                    + CziUtilities::intRectToString(tileRect)
+                                    + ": "
+                                    + AString(e.what()));
+            }
+        }
+    }
+    if ( ! tileErrorMessage.isEmpty()) {
+        errorMessageOut = tileErrorMessage;
+        return std::shared_ptr<libCZI::IBitmapData>();
+    }
+    for (const int64_t tileIndex : missingTileIndices) {
+        if ( ! tileBitmaps[tileIndex]) {
+            errorMessageOut = ("Failed to read data for region "
+                               + CziUtilities::intRectToString(tileAlignedRegion));
+            return std::shared_ptr<libCZI::IBitmapData>();
+        }
+        /*
+         * Tile must not be modified after it is added to the cache
+         */
+        int64_t tileBytes(0);
+        {
+            libCZI::ScopedBitmapLockerSP bitmapLock(tileBitmaps[tileIndex]);
+            tileBytes = (static_cast<int64_t>(bitmapLock.stride)
+                         * static_cast<int64_t>(tileBitmaps[tileIndex]->GetHeight()));
+        }
+        m_tileCache->add(tileKeys[tileIndex],
+                         tileBitmaps[tileIndex],
+                         tileBytes);
+    }
+    
+    CaretAssert( ! tileBitmaps.empty());
+    const libCZI::PixelType pixelType(tileBitmaps[0]->GetPixelType());
+    const int64_t bytesPerPixel(getBytesPerPixel(pixelType));
+    if (bytesPerPixel <= 0) {
+        errorMessageOut = ("Unsupported pixel type="
+                           + AString::number(static_cast<int32_t>(pixelType)));
+        return std::shared_ptr<libCZI::IBitmapData>();
+    }
+    
+    std::shared_ptr<libCZI::IBitmapData> bitmapOut(libCZI::GetDefaultSiteObject(libCZI::SiteObjectType::Default)->CreateBitmap(pixelType,
+                                                                                                                               static_cast<std::uint32_t>(outputWidth),
+                                                                                                                               static_cast<std::uint32_t>(outputHeight)));
+    libCZI::ScopedBitmapLockerSP outputLock(bitmapOut);
+    uint8_t* outputData(static_cast<uint8_t*>(outputLock.ptrDataRoi));
+    const int64_t numberOfTiles(tileBitmaps.size());
+    const int64_t numberOfTilesX(lastTileX - firstTileX + 1);
+    
+    /*
+     * Copy the part of each tile that is within the region
+     */
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t iTile = 0; iTile < numberOfTiles; iTile++) {
+        const std::shared_ptr<libCZI::IBitmapData>& tileBitmap(tileBitmaps[iTile]);
+        CaretAssert(tileBitmap->GetPixelType() == pixelType);
+        const int64_t tileOriginX(((firstTileX + (iTile % numberOfTilesX)) * TILE_PIXEL_SIZE) - outputX);
+        const int64_t tileOriginY(((firstTileY + (iTile / numberOfTilesX)) * TILE_PIXEL_SIZE) - outputY);
+        const int64_t minX(std::max(tileOriginX, static_cast<int64_t>(0)));
+        const int64_t maxX(std::min(tileOriginX + static_cast<int64_t>(tileBitmap->GetWidth()), outputWidth));
+        const int64_t minY(std::max(tileOriginY, static_cast<int64_t>(0)));
+        const int64_t maxY(std::min(tileOriginY + static_cast<int64_t>(tileBitmap->GetHeight()), outputHeight));
+        if ((minX >= maxX)
+            || (minY >= maxY)) {
+            continue;
+        }
+        
+        libCZI::ScopedBitmapLockerSP tileLock(tileBitmap);
+        const uint8_t* tileData(static_cast<const uint8_t*>(tileLock.ptrDataRoi));
+        const int64_t rowBytes((maxX - minX) * bytesPerPixel);
+        for (int64_t y = minY; y < maxY; y++) {
+            std::memcpy(outputData + (y * outputLock.stride) + (minX * bytesPerPixel),
+                        tileData + ((y - tileOriginY) * tileLock.stride) + ((minX - tileOriginX) * bytesPerPixel),
+                        rowBytes);
+        }
+    }
+    
+    return bitmapOut;
+}
+
 void
 CziImageFile::makeWhiteGrayBackgroundColor(std::shared_ptr<libCZI::IBitmapData>& bitmapData,
                                            const unsigned char backgroundColorRGB[3])
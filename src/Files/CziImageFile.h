@@ -24,6 +24,7 @@
 
 #include <array>
 #include <memory>
+#include <tuple>
 
 #include <QRectF>
 
@@ -54,6 +55,7 @@ namespace caret {
     class CziImage;
     class CziImageLoaderBase;
     class CziImageLoaderMultiResolution;
+    template <typename K, typename V> class CaretLruCache;
     class GraphicsObjectToWindowTransform;
     class Matrix4x4;
     class RectangleTransform;
@@ -422,6 +424,12 @@ namespace caret {
         
         bool testReadingSmallImage(AString& errorMessageOut);
         
+        std::shared_ptr<libCZI::IBitmapData> readRegionFromTiles(const int32_t channelIndex,
+                                                                 const bool bgr24Flag,
+                                                                 const libCZI::IntRect& tileAlignedRegion,
+                                                                 const int32_t zoomShift,
+                                                                 AString& errorMessageOut);
+        
         void makeWhiteGrayBackgroundColor(std::shared_ptr<libCZI::IBitmapData>& bitmapData,
                                           const unsigned char backgroundColorRGB[3]);
         
@@ -467,6 +475,19 @@ namespace caret {
         
         int32_t m_maximumImageDimension = 2048;
         
+        /*
+         * Identifies a tile: channel index, pixel variant (background color or
+         * native pixel type), power of two zoom reduction, tile column, and tile row
+         */
+        typedef std::tuple<int32_t, int32_t, int32_t, int64_t, int64_t> TileKey;
+        
+        typedef CaretLruCache<TileKey, std::shared_ptr<libCZI::IBitmapData>> TileCache;
+        
+        /*
+         * Decoded tiles of the image
+         */
+        std::unique_ptr<TileCache> m_tileCache;
+        
         static const int32_t s_allFramesIndex;
         
         // ADD_NEW_MEMBERS_HERE
@@ -0,0 +1,368 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __DATA_FILE_PREFETCHER_DECLARE__
+#include "DataFilePrefetcher.h"
+#undef __DATA_FILE_PREFETCHER_DECLARE__
+
+#include <algorithm>
+#include <deque>
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretLogger.h"
+#include "CiftiFile.h"
+#include "DataFile.h"
+#include "GiftiFile.h"
+
+using namespace caret;
+
+namespace {
+    /**
+     * Files are mostly read from one disk, so more threads than this
+     * add little other than memory used by files decoded far ahead
+     * of when they are needed.
+     */
+    const int32_t MAXIMUM_NUMBER_OF_THREADS = 4;
+
+    enum class PrefetchMode {
+        NONE,
+        GIFTI,
+        CIFTI_HEADER,
+        CIFTI_ALL_DATA
+    };
+
+    enum class PendingStatus {
+        WAITING,
+        DECODING,
+        FINISHED
+    };
+
+    struct PendingFile {
+        AString m_filename;
+        PrefetchMode m_mode = PrefetchMode::NONE;
+        PendingStatus m_status = PendingStatus::WAITING;
+        std::unique_ptr<GiftiFile> m_giftiFile;
+        std::unique_ptr<CiftiFile> m_ciftiFile;
+    };
+
+    /** protects all of the variables below, but is not held while a file is decoded */
+    QMutex s_mutex;
+
+    /** signaled when a file finishes decoding */
+    QWaitCondition s_finishedCondition;
+
+    /** in the order the files will be read */
+    std::deque<std::shared_ptr<PendingFile>> s_pendingFiles;
+
+    bool s_stopFlag = false;
+
+    /** only used by the thread that starts and stops prefetching */
+    std::vector<std::unique_ptr<QThread>> s_workerThreads;
+
+    /**
+     * @return How a file of the given type is decoded ahead of reading.
+     * Only types whose data file class reads through GiftiTypeFile or
+     * CiftiMappableDataFile are prefetched.  CIFTI matrix files only have
+     * their header read, exactly as CiftiMappableDataFile reads them.
+     */
+    PrefetchMode getPrefetchMode(const DataFileTypeEnum::Enum dataFileType)
+    {
+        switch (dataFileType) {
+            case DataFileTypeEnum::LABEL:
+            case DataFileTypeEnum::METRIC:
+            case DataFileTypeEnum::RGBA:
+            case DataFileTypeEnum::SURFACE:
+                return PrefetchMode::GIFTI;
+            case DataFileTypeEnum::CONNECTIVITY_DENSE:
+            case DataFileTypeEnum::CONNECTIVITY_DENSE_PARCEL:
+            case DataFileTypeEnum::CONNECTIVITY_PARCEL:
+            case DataFileTypeEnum::CONNECTIVITY_PARCEL_DENSE:
+                return PrefetchMode::CIFTI_HEADER;
+            case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
+            case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
+            case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
+            case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
+            case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
+            case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
+            case DataFileTypeEnum::CONNECTIVITY_SCALAR_DATA_SERIES:
+                return PrefetchMode::CIFTI_ALL_DATA;
+            default:
+                break;
+        }
+        return PrefetchMode::NONE;
+    }
+
+    /**
+     * Remove a file from the pending files, waiting for it if it is being decoded.
+     * Must be called with the mutex locked.
+     *
+     * @return The file or NULL if the file is not pending or no thread
+     * had started decoding it.
+     */
+    std::shared_ptr<PendingFile> removePendingFile(const AString& filename)
+    {
+        for (auto iter = s_pendingFiles.begin(); iter != s_pendingFiles.end(); iter++) {
+            std::shared_ptr<PendingFile> pendingFile = *iter;
+            if (pendingFile->m_filename == filename) {
+                s_pendingFiles.erase(iter);
+                if (pendingFile->m_status == PendingStatus::WAITING) {
+                    /*
+                     * Reading it now is faster than waiting for a thread
+                     */
+                    return std::shared_ptr<PendingFile>();
+                }
+                while (pendingFile->m_status != PendingStatus::FINISHED) {
+                    s_finishedCondition.wait(&s_mutex);
+                }
+                return pendingFile;
+            }
+        }
+        return std::shared_ptr<PendingFile>();
+    }
+
+}
+
+/**
+ * Runs the decoding loop of the prefetcher.
+ */
+class DataFilePrefetcher::WorkerThread : public QThread
+{
+public:
+    void run() override {
+        DataFilePrefetcher::runWorker();
+    }
+};
+
+/**
+ * \class caret::DataFilePrefetcher
+ * \brief Decodes data files on background threads before they are read
+ * \ingroup Files
+ *
+ * When many files are loaded (spec files and scenes), files are decoded
+ * on a few threads in the order they will be read, so that decompressing
+ * and parsing independent files overlaps.  Only GiftiFile and CiftiFile
+ * are created on the threads, since they do not use the event manager.
+ * The data file (SurfaceFile, CiftiBrainordinateScalarFile, etc.) is still
+ * created and read on the caller's thread, in the caller's order, and its
+ * readFile() takes the decoded content in place of reading the file.
+ *
+ * A file that failed to decode, or whose decoding had not started, is
+ * simply not taken, and the data file reads it as it always has so that
+ * any error is reported exactly as before.
+ */
+
+/**
+ * Start decoding files in the background.  Any files from a previous
+ * call that have not been taken are discarded.
+ *
+ * @param filesToRead
+ *    Absolute names and types of files, in the order they will be read.
+ *    Files on the network and types that are not supported are ignored.
+ */
+void
+DataFilePrefetcher::startPrefetching(const std::vector<std::pair<AString, DataFileTypeEnum::Enum>>& filesToRead)
+{
+    stopPrefetching();
+
+    int32_t numberOfFiles = 0;
+    {
+        QMutexLocker locker(&s_mutex);
+        for (const auto& nameAndType : filesToRead) {
+            const PrefetchMode mode = getPrefetchMode(nameAndType.second);
+            if (mode == PrefetchMode::NONE) {
+                continue;
+            }
+            if (DataFile::isFileOnNetwork(nameAndType.first)) {
+                continue;
+            }
+            std::shared_ptr<PendingFile> pendingFile(new PendingFile());
+            pendingFile->m_filename = nameAndType.first;
+            pendingFile->m_mode     = mode;
+            s_pendingFiles.push_back(pendingFile);
+        }
+        numberOfFiles = static_cast<int32_t>(s_pendingFiles.size());
+    }
+
+    /*
+     * With a single file there is nothing to overlap
+     */
+    if (numberOfFiles < 2) {
+        stopPrefetching();
+        return;
+    }
+
+    const int32_t numberOfThreads = std::min(std::min(MAXIMUM_NUMBER_OF_THREADS,
+                                                      std::max(QThread::idealThreadCount(), 1)),
+                                             numberOfFiles);
+    for (int32_t i = 0; i < numberOfThreads; i++) {
+        std::unique_ptr<QThread> thread(new WorkerThread());
+        thread->start();
+        s_workerThreads.push_back(std::move(thread));
+    }
+}
+
+/**
+ * Stop decoding, wait for any file being decoded to finish,
+ * and discard all files that were not taken.
+ */
+void
+DataFilePrefetcher::stopPrefetching()
+{
+    {
+        QMutexLocker locker(&s_mutex);
+        s_stopFlag = true;
+    }
+    for (auto& thread : s_workerThreads) {
+        thread->wait();
+    }
+    s_workerThreads.clear();
+
+    QMutexLocker locker(&s_mutex);
+    s_pendingFiles.clear();
+    s_stopFlag = false;
+}
+
+/**
+ * @return True if files of the given type are decoded in the background.
+ * @param dataFileType
+ *    Type of the data file.
+ */
+bool
+DataFilePrefetcher::isPrefetchingSupported(const DataFileTypeEnum::Enum dataFileType)
+{
+    return (getPrefetchMode(dataFileType) != PrefetchMode::NONE);
+}
+
+/**
+ * Take the decoded content of a GIFTI file, waiting for it if it is being decoded.
+ *
+ * @param filename
+ *    Absolute name of the file.
+ * @return
+ *    The GIFTI file or NULL if the file is not available and must be read.
+ */
+std::unique_ptr<GiftiFile>
+DataFilePrefetcher::takeGiftiFile(const AString& filename)
+{
+    QMutexLocker locker(&s_mutex);
+    std::shared_ptr<PendingFile> pendingFile = removePendingFile(filename);
+    if (pendingFile) {
+        return std::move(pendingFile->m_giftiFile);
+    }
+    return std::unique_ptr<GiftiFile>();
+}
+
+/**
+ * Take the decoded content of a CIFTI file, waiting for it if it is being decoded.
+ * Data of multi-map types is in memory, matrix types have only the header read.
+ *
+ * @param filename
+ *    Absolute name of the file.
+ * @return
+ *    The CIFTI file or NULL if the file is not available and must be read.
+ */
+std::unique_ptr<CiftiFile>
+DataFilePrefetcher::takeCiftiFile(const AString& filename)
+{
+    QMutexLocker locker(&s_mutex);
+    std::shared_ptr<PendingFile> pendingFile = removePendingFile(filename);
+    if (pendingFile) {
+        return std::move(pendingFile->m_ciftiFile);
+    }
+    return std::unique_ptr<CiftiFile>();
+}
+
+/**
+ * Loop run by each worker thread, decoding waiting files in order
+ * until there are none left or prefetching is stopped.
+ */
+void
+DataFilePrefetcher::runWorker()
+{
+    QMutexLocker locker(&s_mutex);
+    while ( ! s_stopFlag) {
+        std::shared_ptr<PendingFile> pendingFile;
+        for (auto& pf : s_pendingFiles) {
+            if (pf->m_status == PendingStatus::WAITING) {
+                pendingFile = pf;
+                break;
+            }
+        }
+        if ( ! pendingFile) {
+            return;
+        }
+        pendingFile->m_status = PendingStatus::DECODING;
+        locker.unlock();
+
+        std::unique_ptr<GiftiFile> giftiFile;
+        std::unique_ptr<CiftiFile> ciftiFile;
+        try {
+            switch (pendingFile->m_mode) {
+                case PrefetchMode::NONE:
+                    CaretAssert(0);
+                    break;
+                case PrefetchMode::GIFTI:
+                    giftiFile.reset(new GiftiFile());
+                    giftiFile->readFile(pendingFile->m_filename);
+                    break;
+                case PrefetchMode::CIFTI_HEADER:
+                    ciftiFile.reset(new CiftiFile());
+                    ciftiFile->openFile(pendingFile->m_filename);
+                    break;
+                case PrefetchMode::CIFTI_ALL_DATA:
+                    ciftiFile.reset(new CiftiFile());
+                    ciftiFile->openFile(pendingFile->m_filename);
+                    ciftiFile->convertToInMemory();
+                    break;
+            }
+        }
+        catch (const CaretException& e) {
+            /*
+             * The file is read again when it is taken, which reports the error
+             */
+            CaretLogFine("Prefetching failed for "
+                         + pendingFile->m_filename
+                         + ": "
+                         + e.whatString());
+            giftiFile.reset();
+            ciftiFile.reset();
+        }
+        catch (const std::exception& e) {
+            CaretLogFine("Prefetching failed for "
+                         + pendingFile->m_filename
+                         + ": "
+                         + AString(e.what()));
+            giftiFile.reset();
+            ciftiFile.reset();
+        }
+
+        locker.relock();
+        pendingFile->m_giftiFile = std::move(giftiFile);
+        pendingFile->m_ciftiFile = std::move(ciftiFile);
+        pendingFile->m_status = PendingStatus::FINISHED;
+        s_finishedCondition.wakeAll();
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef __DATA_FILE_PREFETCHER_H__
+#define __DATA_FILE_PREFETCHER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "AString.h"
+#include "DataFileTypeEnum.h"
+
+namespace caret {
+
+    class CiftiFile;
+    class GiftiFile;
+
+    class DataFilePrefetcher
+    {
+    public:
+        static void startPrefetching(const std::vector<std::pair<AString, DataFileTypeEnum::Enum>>& filesToRead);
+
+        static void stopPrefetching();
+
+        static bool isPrefetchingSupported(const DataFileTypeEnum::Enum dataFileType);
+
+        static std::unique_ptr<GiftiFile> takeGiftiFile(const AString& filename);
+
+        static std::unique_ptr<CiftiFile> takeCiftiFile(const AString& filename);
+
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        DataFilePrefetcher() = delete;
+
+        class WorkerThread;
+
+        static void runWorker();
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __DATA_FILE_PREFETCHER_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __DATA_FILE_PREFETCHER_DECLARE__
+
+} // namespace
+#endif  //__DATA_FILE_PREFETCHER_H__
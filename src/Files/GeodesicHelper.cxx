@@ -39,8 +39,9 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
     TopologyHelper topoHelpIn(topoBase);//leave this building one privately, to not introduce even worse dependencies regarding SurfaceFile
     m_corrAreaSmallestFactor = 1.0f;
     numNodes = surfaceIn->getNumberOfNodes();
-    nodeNeighbors.resize(numNodes);
-    distances.resize(numNodes);
+    vector<vector<float> > distances(numNodes), distances2(numNodes);//build per-node lists first, then flatten them
+    vector<vector<int32_t> > nodeNeighbors(numNodes), nodeNeighbors2(numNodes);
+    vector<vector<CrawlInfo> > neighbors2PathInfo(numNodes);
     nodeCoords.resize(numNodes);
     vector<float> sqrtCorrAreas;//each edge has 2 vertices that influence it - assume that each influences a piece of the edge with a ratio depending on the square roots of the vertex areas
     vector<float> sqrtVertAreas;//we also assume isometric expansion at each vertex
@@ -92,9 +93,6 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
     m_avgNodeSpacing = nodeSpacingAccum / numEdges;
     std::vector<int32_t> tempneigh2;
     std::vector<float> tempdist2;
-    nodeNeighbors2.resize(numNodes);
-    distances2.resize(numNodes);
-    neighbors2PathInfo.resize(numNodes);
     const vector<TopologyEdgeInfo>& myEdgeInfo = topoHelpIn.getEdgeInfo();
     CaretAssert(numEdges == (int32_t)myEdgeInfo.size());//SurfaceFile checks for triangles with duplicated nodes
     for (int i = 0; i < numEdges; ++i)
@@ -162,6 +160,55 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
         distances2[baseNode].push_back(tempf);
         neighbors2PathInfo[baseNode].push_back(tempInfo);
     }
+    m_neighStarts.resize(numNodes + 1);
+    m_neigh2Starts.resize(numNodes + 1);
+    m_neighStarts[0] = 0;
+    m_neigh2Starts[0] = 0;
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        m_neighStarts[i + 1] = m_neighStarts[i] + nodeNeighbors[i].size();
+        m_neigh2Starts[i + 1] = m_neigh2Starts[i] + nodeNeighbors2[i].size();
+    }
+    m_neighbors.reserve(m_neighStarts[numNodes]);
+    m_distances.reserve(m_neighStarts[numNodes]);
+    m_neighbors2.reserve(m_neigh2Starts[numNodes]);
+    m_distances2.reserve(m_neigh2Starts[numNodes]);
+    m_neighbors2PathInfo.reserve(m_neigh2Starts[numNodes]);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        m_neighbors.insert(m_neighbors.end(), nodeNeighbors[i].begin(), nodeNeighbors[i].end());
+        m_distances.insert(m_distances.end(), distances[i].begin(), distances[i].end());
+        m_neighbors2.insert(m_neighbors2.end(), nodeNeighbors2[i].begin(), nodeNeighbors2[i].end());
+        m_distances2.insert(m_distances2.end(), distances2[i].begin(), distances2[i].end());
+        m_neighbors2PathInfo.insert(m_neighbors2PathInfo.end(), neighbors2PathInfo[i].begin(), neighbors2PathInfo[i].end());
+    }
+}
+
+CaretPointer<GeodesicHelperBase::Workspace> GeodesicHelperBase::getWorkspace() const
+{
+    {
+        CaretMutexLocker locked(&m_poolMutex);
+        if (!m_workspacePool.empty())
+        {
+            CaretPointer<Workspace> ret = m_workspacePool.back();
+            m_workspacePool.pop_back();
+            return ret;
+        }
+    }//allocate outside the lock, so helpers for different threads can be created in parallel
+    CaretPointer<Workspace> ret(new Workspace());
+    ret->marked.resize(numNodes, 0);//initialize once, each internal function (dijkstra methods) tracks elements changed, and resets only those (except in the case of whole surface)
+    ret->heapIdent.resize(numNodes);//the idea is to make it faster for the more likely case of small areas of the surface for functions that have limits, by removing the runtime term based solely on surface size
+    ret->output.resize(numNodes);
+    ret->changed.resize(numNodes);
+    ret->parent.resize(numNodes);
+    ret->heurVal.resize(numNodes);
+    return ret;
+}
+
+void GeodesicHelperBase::returnWorkspace(const CaretPointer<Workspace>& workspace) const
+{//marked must be all zero again, which every search method ensures before returning
+    CaretMutexLocker locked(&m_poolMutex);
+    m_workspacePool.push_back(workspace);
 }
 
 GeodesicHelper::GeodesicHelper(const CaretPointer<const GeodesicHelperBase>& baseIn)
@@ -171,21 +218,27 @@ GeodesicHelper::GeodesicHelper(const CaretPointer<const GeodesicHelperBase>& bas
     numNodes = m_myBase->numNodes;
     m_avgNodeSpacing = m_myBase->m_avgNodeSpacing;
     m_corrAreaSmallestFactor = m_myBase->m_corrAreaSmallestFactor;
-    distances = m_myBase->distances.data();
-    distances2 = m_myBase->distances2.data();
-    nodeNeighbors = m_myBase->nodeNeighbors.data();
-    nodeNeighbors2 = m_myBase->nodeNeighbors2.data();
+    neighStarts = m_myBase->m_neighStarts.data();
+    neigh2Starts = m_myBase->m_neigh2Starts.data();
+    distances = m_myBase->m_distances.data();
+    distances2 = m_myBase->m_distances2.data();
+    nodeNeighbors = m_myBase->m_neighbors.data();
+    nodeNeighbors2 = m_myBase->m_neighbors2.data();
     nodeCoords = m_myBase->nodeCoords.data();
-    neighbors2PathInfo = m_myBase->neighbors2PathInfo.data();
-    //allocate private scratch space
-    marked.resize(numNodes, 0);//initialize once, each internal function (dijkstra methods) tracks elements changed, and resets only those (except in the case of whole surface)
-    m_heapIdent.resize(numNodes);//the idea is to make it faster for the more likely case of small areas of the surface for functions that have limits, by removing the runtime term based solely on surface size
-    outputStore.resize(numNodes);
-    output = outputStore.data();//because we have a function that does a pointer swap to compute distances directly in the output array
-    changed.resize(numNodes);
-    parentStore.resize(numNodes);
-    parent = parentStore.data();//ditto for parents
-    heurVal.resize(numNodes);
+    neighbors2PathInfo = m_myBase->m_neighbors2PathInfo.data();
+    //get private scratch space, reusing it from previous helpers on the same base when possible
+    m_workspace = m_myBase->getWorkspace();
+    marked = m_workspace->marked.data();
+    m_heapIdent = m_workspace->heapIdent.data();
+    output = m_workspace->output.data();//because we have a function that does a pointer swap to compute distances directly in the output array
+    changed = m_workspace->changed.data();
+    parent = m_workspace->parent.data();//ditto for parents
+    heurVal = m_workspace->heurVal.data();
+}
+
+GeodesicHelper::~GeodesicHelper()
+{
+    m_myBase->returnWorkspace(m_workspace);
 }
 
 void GeodesicHelper::getNodesToGeoDist(const int32_t node, const float maxdist, std::vector<int32_t>& nodesOut, std::vector<float>& distsOut, const bool smoothflag)
@@ -232,14 +285,14 @@ void GeodesicHelper::dijkstra(const int32_t root, const float maxdist, std::vect
         nodes.push_back(whichnode);
         dists.push_back(output[whichnode]);
         marked[whichnode] |= 1;//anything pulled from heap will already be marked as having a valid value (flag 4)
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighStarts[whichnode];
+        numNeigh = (int32_t)(neighStarts[whichnode + 1] - neighStarts[whichnode]);
         for (j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];//isn't precomputation wonderful
+                tempf = output[whichnode] + distances[neighStarts[whichnode] + j];//isn't precomputation wonderful
                 if (tempf <= maxdist)
                 {//keep it off the heap if it is too far
                     if (!(marked[whichneigh] & 4))
@@ -259,14 +312,14 @@ void GeodesicHelper::dijkstra(const int32_t root, const float maxdist, std::vect
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Starts[whichnode];
+            numNeigh = (int32_t)(neigh2Starts[whichnode + 1] - neigh2Starts[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];
+                    tempf = output[whichnode] + distances2[neigh2Starts[whichnode] + j];
                     if (tempf <= maxdist)
                     {//keep it off the heap if it is too far
                         if (!(marked[whichneigh] & 4))
@@ -305,14 +358,14 @@ void GeodesicHelper::dijkstra(const int32_t root, bool smooth)
     {
         whichnode = m_active.pop();
         marked[whichnode] |= 1;
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighStarts[whichnode];
+        numNeigh = (int32_t)(neighStarts[whichnode + 1] - neighStarts[whichnode]);
         for (j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];
+                tempf = output[whichnode] + distances[neighStarts[whichnode] + j];
                 if (!(marked[whichneigh] & 4))
                 {
                     marked[whichneigh] |= 4;
@@ -328,14 +381,14 @@ void GeodesicHelper::dijkstra(const int32_t root, bool smooth)
         }
         if (smooth)
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Starts[whichnode];
+            numNeigh = (int32_t)(neigh2Starts[whichnode + 1] - neigh2Starts[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];
+                    tempf = output[whichnode] + distances2[neigh2Starts[whichnode] + j];
                     if (!(marked[whichneigh] & 4))
                     {
                         marked[whichneigh] |= 4;
@@ -456,14 +509,14 @@ void GeodesicHelper::dijkstra(const int32_t root, const std::vector<int32_t>& in
             --remain;
         }
         marked[whichnode] |= 1;//anything pulled from heap will already be marked as having a valid value (flag 4), so already in changed list
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighStarts[whichnode];
+        numNeigh = (int32_t)(neighStarts[whichnode + 1] - neighStarts[whichnode]);
         for (j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];//isn't precomputation wonderful
+                tempf = output[whichnode] + distances[neighStarts[whichnode] + j];//isn't precomputation wonderful
                 if (!(marked[whichneigh] & 4))
                 {
                     if (!marked[whichneigh])
@@ -483,14 +536,14 @@ void GeodesicHelper::dijkstra(const int32_t root, const std::vector<int32_t>& in
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Starts[whichnode];
+            numNeigh = (int32_t)(neigh2Starts[whichnode + 1] - neigh2Starts[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];
+                    tempf = output[whichnode] + distances2[neigh2Starts[whichnode] + j];
                     if (!(marked[whichneigh] & 4))
                     {
                         if (!marked[whichneigh])
@@ -552,14 +605,14 @@ int32_t GeodesicHelper::dijkstra(const vector<int32_t>& startList, const vector<
             break;
         }
         marked[whichnode] |= 1;//anything pulled from heap will already be marked as having a valid value (flag 4), so already in changed list
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighStarts[whichnode];
+        numNeigh = (int32_t)(neighStarts[whichnode + 1] - neighStarts[whichnode]);
         for (j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];
+                tempf = output[whichnode] + distances[neighStarts[whichnode] + j];
                 if (tempf <= maxDist)
                 {
                     if (!(marked[whichneigh] & 4))
@@ -582,14 +635,14 @@ int32_t GeodesicHelper::dijkstra(const vector<int32_t>& startList, const vector<
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Starts[whichnode];
+            numNeigh = (int32_t)(neigh2Starts[whichnode + 1] - neigh2Starts[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];
+                    tempf = output[whichnode] + distances2[neigh2Starts[whichnode] + j];
                     if (tempf <= maxDist)
                     {
                         if (!(marked[whichneigh] & 4))
@@ -640,14 +693,14 @@ int32_t GeodesicHelper::closest(const int32_t& root, const char* roi, const floa
             break;
         }
         marked[whichnode] |= 1;//anything pulled from heap will already be marked as having a valid value (flag 4), so already in changed list
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighStarts[whichnode];
+        numNeigh = (int32_t)(neighStarts[whichnode + 1] - neighStarts[whichnode]);
         for (j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];//isn't precomputation wonderful
+                tempf = output[whichnode] + distances[neighStarts[whichnode] + j];//isn't precomputation wonderful
                 if (tempf <= maxdist)
                 {
                     if (!(marked[whichneigh] & 4))
@@ -670,14 +723,14 @@ int32_t GeodesicHelper::closest(const int32_t& root, const char* roi, const floa
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Starts[whichnode];
+            numNeigh = (int32_t)(neigh2Starts[whichnode + 1] - neigh2Starts[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];//isn't precomputation wonderful
+                    tempf = output[whichnode] + distances2[neigh2Starts[whichnode] + j];//isn't precomputation wonderful
                     if (tempf <= maxdist)
                     {
                         if (!(marked[whichneigh] & 4))
@@ -727,14 +780,14 @@ int32_t GeodesicHelper::closest(const int32_t& root, const char* roi, bool smoot
             break;
         }
         marked[whichnode] |= 1;//anything pulled from heap will already be marked as having a valid value (flag 4), so already in changed list
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighStarts[whichnode];
+        numNeigh = (int32_t)(neighStarts[whichnode + 1] - neighStarts[whichnode]);
         for (j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];//isn't precomputation wonderful
+                tempf = output[whichnode] + distances[neighStarts[whichnode] + j];//isn't precomputation wonderful
                 if (!(marked[whichneigh] & 4))
                 {
                     parent[whichneigh] = whichnode;
@@ -754,14 +807,14 @@ int32_t GeodesicHelper::closest(const int32_t& root, const char* roi, bool smoot
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Starts[whichnode];
+            numNeigh = (int32_t)(neigh2Starts[whichnode + 1] - neigh2Starts[whichnode]);
             for (j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];//isn't precomputation wonderful
+                    tempf = output[whichnode] + distances2[neigh2Starts[whichnode] + j];//isn't precomputation wonderful
                     if (!(marked[whichneigh] & 4))
                     {
                         parent[whichneigh] = whichnode;
@@ -806,14 +859,14 @@ void GeodesicHelper::aStar(const int32_t root, const int32_t endpoint, bool smoo
         whichnode = m_active.pop();//we use a modifiable heap, so we don't need to check for duplicates
         marked[whichnode] |= 1;//frozen - will already be in changed list, due to being in heap
         if (whichnode == endpoint) break;
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighStarts[whichnode];
+        numNeigh = (int32_t)(neighStarts[whichnode + 1] - neighStarts[whichnode]);
         for (int32_t j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j];
+                tempf = output[whichnode] + distances[neighStarts[whichnode] + j];
                 if (!(marked[whichneigh] & 4))
                 {
                     heurVal[whichneigh] = m_corrAreaSmallestFactor * (nodeCoords[whichneigh] - nodeCoords[endpoint]).length();
@@ -831,14 +884,14 @@ void GeodesicHelper::aStar(const int32_t root, const int32_t endpoint, bool smoo
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            neighbors = nodeNeighbors2 + neigh2Starts[whichnode];
+            numNeigh = (int32_t)(neigh2Starts[whichnode + 1] - neigh2Starts[whichnode]);
             for (int32_t j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if (!(marked[whichneigh] & 1))
                 {//skip floating point math if frozen
-                    tempf = output[whichnode] + distances2[whichnode][j];
+                    tempf = output[whichnode] + distances2[neigh2Starts[whichnode] + j];
                     if (!(marked[whichneigh] & 4))
                     {
                         heurVal[whichneigh] = m_corrAreaSmallestFactor * (nodeCoords[whichneigh] - nodeCoords[endpoint]).length();
@@ -908,14 +961,14 @@ void GeodesicHelper::aStarLine(const int32_t& root, const int32_t& endpoint, con
         whichnode = m_active.pop();//we use a modifiable heap, so we don't need to check for duplicates
         marked[whichnode] |= 1;//frozen - will already be in changed list, due to being in heap
         if (whichnode == endpoint) break;
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighStarts[whichnode];
+        numNeigh = (int32_t)(neighStarts[whichnode + 1] - neighStarts[whichnode]);
         for (int32_t j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if (!(marked[whichneigh] & 1))
             {//skip floating point math if frozen
-                tempf = output[whichnode] + distances[whichnode][j] + penaltyScale * distances[whichnode][j] * (linePenalty(nodeCoords[whichnode], linep1, linep2, segment) + linePenalty(nodeCoords[whichneigh], linep1, linep2, segment));
+                tempf = output[whichnode] + distances[neighStarts[whichnode] + j] + penaltyScale * distances[neighStarts[whichnode] + j] * (linePenalty(nodeCoords[whichnode], linep1, linep2, segment) + linePenalty(nodeCoords[whichneigh], linep1, linep2, segment));
                 if (!(marked[whichneigh] & 4))
                 {
                     remainEucl = (nodeCoords[whichneigh] - nodeCoords[endpoint]).length();
@@ -956,14 +1009,14 @@ void GeodesicHelper::aStarData(const int32_t& root, const int32_t& endpoint, con
         whichnode = m_active.pop();//we use a modifiable heap, so we don't need to check for duplicates
         marked[whichnode] |= 1;//frozen - will already be in changed list, due to being in heap
         if (whichnode == endpoint) break;
-        neighbors = nodeNeighbors[whichnode].data();
-        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        neighbors = nodeNeighbors + neighStarts[whichnode];
+        numNeigh = (int32_t)(neighStarts[whichnode + 1] - neighStarts[whichnode]);
         for (int32_t j = 0; j < numNeigh; ++j)
         {
             whichneigh = neighbors[j];
             if ((roiData == NULL || roiData[whichneigh] > 0.0f) && !(marked[whichneigh] & 1))
             {//skip floating point math if frozen or outside roi
-                tempf = output[whichnode] + distances[whichnode][j] * (1.0f + followStrength * (data[whichnode] + data[whichneigh]));//integrate 1 + strength * value to get distance plus path-integrated data
+                tempf = output[whichnode] + distances[neighStarts[whichnode] + j] * (1.0f + followStrength * (data[whichnode] + data[whichneigh]));//integrate 1 + strength * value to get distance plus path-integrated data
                 if (!(marked[whichneigh] & 4))
                 {
                     heurVal[whichneigh] = m_corrAreaSmallestFactor * (nodeCoords[whichneigh] - nodeCoords[endpoint]).length();
@@ -981,16 +1034,16 @@ void GeodesicHelper::aStarData(const int32_t& root, const int32_t& endpoint, con
         }
         if (smooth)//repeat with numNeighbors2, nodeNeighbors2, distance2
         {
-            neighbors = nodeNeighbors2[whichnode].data();
-            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
-            const GeodesicHelperBase::CrawlInfo* pathInfo = neighbors2PathInfo[whichnode].data();
+            neighbors = nodeNeighbors2 + neigh2Starts[whichnode];
+            numNeigh = (int32_t)(neigh2Starts[whichnode + 1] - neigh2Starts[whichnode]);
+            const GeodesicHelperBase::CrawlInfo* pathInfo = neighbors2PathInfo + neigh2Starts[whichnode];
             for (int32_t j = 0; j < numNeigh; ++j)
             {
                 whichneigh = neighbors[j];
                 if ((roiData == NULL || roiData[whichneigh] > 0.0f) && !(marked[whichneigh] & 1))
                 {//skip floating point math if frozen or outside roi
-                    tempf = output[whichnode] + distances2[whichnode][j] + followStrength * (data[whichnode] * pathInfo[j].pieceDists[0] + data[whichneigh] * pathInfo[j].pieceDists[1]
-                                + distances2[whichnode][j] * (data[pathInfo[j].edgeNodes[0]] * pathInfo[j].edgeWeight + data[pathInfo[j].edgeNodes[1]] * (1.0f - pathInfo[j].edgeWeight)));
+                    tempf = output[whichnode] + distances2[neigh2Starts[whichnode] + j] + followStrength * (data[whichnode] * pathInfo[j].pieceDists[0] + data[whichneigh] * pathInfo[j].pieceDists[1]
+                                + distances2[neigh2Starts[whichnode] + j] * (data[pathInfo[j].edgeNodes[0]] * pathInfo[j].edgeWeight + data[pathInfo[j].edgeNodes[1]] * (1.0f - pathInfo[j].edgeWeight)));
                     if (!(marked[whichneigh] & 4))
                     {
                         heurVal[whichneigh] = m_corrAreaSmallestFactor * (nodeCoords[whichneigh] - nodeCoords[endpoint]).length();
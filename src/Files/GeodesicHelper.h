@@ -49,9 +49,20 @@ namespace caret {
         GeodesicHelperBase();//can't construct without arguments
         GeodesicHelperBase& operator=(const GeodesicHelperBase& right);//can't assign
         GeodesicHelperBase(const GeodesicHelperBase& right);//can't use copy constructor
-        std::vector<std::vector<float> > distances, distances2;
-        std::vector<std::vector<int32_t> > nodeNeighbors, nodeNeighbors2;
-        std::vector<std::vector<CrawlInfo> > neighbors2PathInfo;
+        struct Workspace
+        {//per-helper scratch arrays, pooled so that creating helpers repeatedly doesn't reallocate them
+            std::vector<float> output, heurVal;
+            std::vector<int32_t> marked, changed, parent;
+            std::vector<int64_t> heapIdent;
+        };
+        std::vector<int64_t> m_neighStarts, m_neigh2Starts;//compressed rows: the neighbors of node i are from [i] to [i + 1]
+        std::vector<int32_t> m_neighbors, m_neighbors2;
+        std::vector<float> m_distances, m_distances2;
+        std::vector<CrawlInfo> m_neighbors2PathInfo;
+        mutable CaretMutex m_poolMutex;
+        mutable std::vector<CaretPointer<Workspace> > m_workspacePool;
+        CaretPointer<Workspace> getWorkspace() const;
+        void returnWorkspace(const CaretPointer<Workspace>& workspace) const;
         std::vector<Vector3D> nodeCoords;//for line-following and A*
         int32_t numNodes;
         float m_avgNodeSpacing;//to use for balancing line following penalty
@@ -66,16 +77,17 @@ namespace caret {
         CaretPointer<const GeodesicHelperBase> m_myBase;//mostly just for automatic memory management
         CaretMutex inUse;//could add a function and a locker pointer to be able to lock to thread once, then call repeatedly without locking, if mutex overhead is actually a factor
         CaretMinHeap<int32_t, float> m_active;//save and reuse the allocated space
-        const std::vector<float>* distances, *distances2;
-        const std::vector<int32_t>* nodeNeighbors, *nodeNeighbors2;
-        const std::vector<GeodesicHelperBase::CrawlInfo>* neighbors2PathInfo;
+        const int64_t* neighStarts, *neigh2Starts;
+        const float* distances, *distances2;
+        const int32_t* nodeNeighbors, *nodeNeighbors2;
+        const GeodesicHelperBase::CrawlInfo* neighbors2PathInfo;
         const Vector3D* nodeCoords;
+        CaretPointer<GeodesicHelperBase::Workspace> m_workspace;
         float* output;
         int32_t* parent;
-        std::vector<float> outputStore;
-        std::vector<float> heurVal;
-        std::vector<int32_t> marked, changed, parentStore;
-        std::vector<int64_t> m_heapIdent;
+        float* heurVal;
+        int32_t* marked, *changed;
+        int64_t* m_heapIdent;
         int32_t numNodes;
         float m_avgNodeSpacing;
         float m_corrAreaSmallestFactor;
@@ -95,6 +107,7 @@ namespace caret {
         void aStarData(const int32_t& root, const int32_t& endpoint, const float* data, const float& followStrength, const float* roiData, const bool& smooth);//to single endpoint, following data
     public:
         explicit GeodesicHelper(const CaretPointer<const GeodesicHelperBase>& baseIn);
+        ~GeodesicHelper();
         /// Get distances from root node, up to a geodesic distance cutoff (stops computing when no more nodes are within that distance)
         void getNodesToGeoDist(const int32_t node, const float maxdist, std::vector<int32_t>& neighborsOut, std::vector<float>& distsOut, const bool smoothflag = true);
 
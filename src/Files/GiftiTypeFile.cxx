@@ -21,6 +21,7 @@
 #include "CaretLogger.h"
 #include "DataFileContentInformation.h"
 #include "DataFileException.h"
+#include "DataFilePrefetcher.h"
 #include "FastStatistics.h"
 #include "GiftiDataArray.h"
 #include "GiftiFile.h"
@@ -153,7 +154,14 @@ GiftiTypeFile::readFile(const AString& filename)
     checkFileReadability(filename);
     
     this->setFileName(filename);
-    this->giftiFile->readFile(filename);
+    std::unique_ptr<GiftiFile> prefetchedGiftiFile = DataFilePrefetcher::takeGiftiFile(filename);
+    if (prefetchedGiftiFile) {
+        delete this->giftiFile;
+        this->giftiFile = prefetchedGiftiFile.release();
+    }
+    else {
+        this->giftiFile->readFile(filename);
+    }
     this->validateDataArraysAfterReading();
     updateAfterFileDataChanges();
     this->clearModified();
@@ -22,11 +22,14 @@
 
 #include "CaretAssert.h"
 #include "CaretException.h"
+#include "CaretPerfTrace.h"
 #include "SurfaceFile.h"
 #include "MetricFile.h"
 #include "GeodesicHelper.h"
 #include "TopologyHelper.h"
 #include "CaretOMP.h"
+#include "SparseWeightCache.h"
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
@@ -34,19 +37,117 @@ using namespace caret;
 
 MetricSmoothingObject::MetricSmoothingObject(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas)
 {
+    CARET_PERF_SCOPE("metric smoothing weights");
     CaretAssert(mySurf != NULL);
     if (myRoi != NULL && mySurf->getNumberOfNodes() != myRoi->getNumberOfNodes())
     {
         throw CaretException("roi number of nodes doesn't match the surface");
     }
-    precomputeWeights(mySurf, kernel, myRoi, myMethod, nodeAreas);
+    m_numNodes = mySurf->getNumberOfNodes();
+    const float* passAreas = nodeAreas;
+    vector<float> areasTemp;
+    if (passAreas == NULL)
+    {//compute them here so they can be part of the cache key
+        mySurf->computeNodeAreas(areasTemp);
+        passAreas = areasTemp.data();
+    }
+    QString cacheKey;
+    if (SparseWeightCache::isEnabled())
+    {
+        cacheKey = getWeightCacheKey(mySurf, kernel, myRoi, myMethod, passAreas);
+        SparseWeightCache::Weights cached;
+        if (SparseWeightCache::load(cacheKey, m_numNodes, m_numNodes, cached) && (int64_t)cached.perRow.size() == m_numNodes)
+        {
+            m_rowStarts.swap(cached.rowStarts);
+            m_neighbors.swap(cached.indices);
+            m_weights.swap(cached.weights);
+            m_weightSums.swap(cached.perRow);
+            CaretPerfTrace::addCount("metric smoothing weights from cache");
+            return;
+        }
+    }
+    precomputeWeights(mySurf, kernel, myRoi, myMethod, passAreas);
+    convertWeightsToCSR();
+    if (SparseWeightCache::isEnabled())
+    {
+        SparseWeightCache::Weights toStore;
+        toStore.rowStarts = m_rowStarts;
+        toStore.indices = m_neighbors;
+        toStore.weights = m_weights;
+        toStore.perRow = m_weightSums;
+        SparseWeightCache::store(cacheKey, toStore);
+    }
+}
+
+QString MetricSmoothingObject::getWeightCacheKey(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, const Method& myMethod, const float* nodeAreas)
+{
+    SparseWeightCache::KeyBuilder myKey("MetricSmoothingObject 1");//change the version if the weight computation changes
+    const int32_t numNodes = mySurf->getNumberOfNodes(), numTriangles = mySurf->getNumberOfTriangles();
+    myKey.addValue(numNodes);
+    myKey.addData(mySurf->getCoordinateData(), numNodes * 3 * sizeof(float));
+    vector<int32_t> triangles(numTriangles * 3);
+    for (int32_t i = 0; i < numTriangles; ++i)
+    {
+        const int32_t* thisTri = mySurf->getTriangle(i);
+        triangles[i * 3] = thisTri[0];
+        triangles[i * 3 + 1] = thisTri[1];
+        triangles[i * 3 + 2] = thisTri[2];
+    }
+    myKey.addValue(numTriangles);
+    myKey.addData(triangles.data(), triangles.size() * sizeof(int32_t));
+    myKey.addValue(kernel);
+    myKey.addValue((int32_t)myMethod);
+    myKey.addData(nodeAreas, numNodes * sizeof(float));
+    if (myRoi != NULL)
+    {//only the "inside" test matters to the weights
+        const float* roiData = myRoi->getValuePointerForColumn(0);
+        vector<char> roiMask(numNodes);
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            roiMask[i] = (roiData[i] > 0.0f) ? 1 : 0;
+        }
+        myKey.addValue((int32_t)1);
+        myKey.addData(roiMask.data(), numNodes);
+    } else {
+        myKey.addValue((int32_t)0);
+    }
+    return myKey.getKey();
+}
+
+void MetricSmoothingObject::convertWeightsToCSR()
+{
+    CaretAssert((int32_t)m_weightLists.size() == m_numNodes);
+    m_rowStarts.resize(m_numNodes + 1);
+    m_weightSums.resize(m_numNodes);
+    m_rowStarts[0] = 0;
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        m_rowStarts[i + 1] = m_rowStarts[i] + m_weightLists[i].m_nodes.size();
+        m_weightSums[i] = m_weightLists[i].m_weightSum;
+    }
+    m_neighbors.resize(m_rowStarts[m_numNodes]);
+    m_weights.resize(m_rowStarts[m_numNodes]);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        const WeightList& myWeightRef = m_weightLists[i];
+        int64_t base = m_rowStarts[i];
+        int32_t numWeights = (int32_t)myWeightRef.m_nodes.size();
+        for (int32_t j = 0; j < numWeights; ++j)
+        {
+            m_neighbors[base + j] = myWeightRef.m_nodes[j];
+            m_weights[base + j] = myWeightRef.m_weights[j];
+        }
+    }
+    vector<WeightList>().swap(m_weightLists);//release the per-node vectors
 }
 
 void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* columnOut, const MetricFile* roi, const bool& fixZeros) const
 {
+    CARET_PERF_SCOPE("metric smoothing apply");
     CaretAssert(metricIn != NULL);
     CaretAssert(columnOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != m_numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
@@ -54,14 +155,14 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
     {
         throw CaretException("invalid column number");
     }
-    if (columnOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || columnOut->getNumberOfColumns() != 1)
+    if (columnOut->getNumberOfNodes() != m_numNodes || columnOut->getNumberOfColumns() != 1)
     {
-        columnOut->setNumberOfNodesAndColumns(m_weightLists.size(), 1);
+        columnOut->setNumberOfNodesAndColumns(m_numNodes, 1);
     }
     vector<float> scratch(metricIn->getNumberOfNodes());
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != m_numNodes)
         {
             throw CaretException("roi does not match surface number of nodes");
         }
@@ -73,17 +174,18 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
 
 void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const
 {
+    CARET_PERF_SCOPE("metric smoothing apply");
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != m_numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricOut->getNumberOfNodes() != m_numNodes)
     {
         throw CaretException("output metric does not match surface number of nodes");
     }
-    if (roi != NULL && (roi->getNumberOfNodes() != (int32_t)m_weightLists.size()))
+    if (roi != NULL && (roi->getNumberOfNodes() != m_numNodes))
     {
         throw CaretException("roi does not match surface number of nodes");
     }
@@ -113,29 +215,160 @@ void MetricSmoothingObject::smoothMetric(const MetricFile* metricIn, MetricFile*
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
     int32_t numCols = metricIn->getNumberOfColumns();
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != m_numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || metricOut->getNumberOfColumns() != numCols)
+    if (metricOut->getNumberOfNodes() != m_numNodes || metricOut->getNumberOfColumns() != numCols)
     {
-        metricOut->setNumberOfNodesAndColumns(m_weightLists.size(), numCols);
+        metricOut->setNumberOfNodesAndColumns(m_numNodes, numCols);
     }
-    vector<float> scratch(metricIn->getNumberOfNodes());
+    smoothColumns(metricIn, 0, numCols, metricOut, roi, 0, fixZeros);
+}
+
+void MetricSmoothingObject::smoothColumns(const MetricFile* metricIn, const int& firstColumn, const int& numColumns, MetricFile* metricOut,
+                                          const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const
+{
+    CARET_PERF_SCOPE("metric smoothing apply");
+    CaretAssert(metricIn != NULL);
+    CaretAssert(metricOut != NULL);
+    if (metricIn->getNumberOfNodes() != m_numNodes)
+    {
+        throw CaretException("metric does not match surface number of nodes");
+    }
+    if (metricOut->getNumberOfNodes() != m_numNodes)
+    {
+        throw CaretException("output metric does not match surface number of nodes");
+    }
+    if (firstColumn < 0 || numColumns < 0 || firstColumn + numColumns > metricIn->getNumberOfColumns() || firstColumn + numColumns > metricOut->getNumberOfColumns())
+    {
+        throw CaretException("invalid column range");
+    }
+    const float* roiColumn = NULL;
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != m_numNodes)
         {
             throw CaretException("roi does not match surface number of nodes");
         }
-        for (int32_t i = 0; i < numCols; ++i)
+        if (whichRoiColumn < 0 || whichRoiColumn >= roi->getNumberOfColumns())
         {
-            smoothColumnInternal(scratch.data(), metricIn, i, metricOut, i, roi, 0, fixZeros);
+            throw CaretException("invalid roi column number");
         }
-    } else {
-        for (int32_t i = 0; i < numCols; ++i)
+        roiColumn = roi->getValuePointerForColumn(whichRoiColumn);
+    }
+    vector<vector<float> > scratchOut(min(numColumns, (int)COLUMN_BLOCK_SIZE), vector<float>(m_numNodes));
+    const float* columnsIn[COLUMN_BLOCK_SIZE];
+    float* columnsOut[COLUMN_BLOCK_SIZE];
+    for (int blockStart = 0; blockStart < numColumns; blockStart += COLUMN_BLOCK_SIZE)
+    {
+        int blockCount = min((int)COLUMN_BLOCK_SIZE, numColumns - blockStart);
+        for (int c = 0; c < blockCount; ++c)
+        {
+            columnsIn[c] = metricIn->getValuePointerForColumn(firstColumn + blockStart + c);
+            columnsOut[c] = scratchOut[c].data();
+        }
+        smoothBlockInternal(columnsIn, blockCount, columnsOut, roiColumn, fixZeros);
+        for (int c = 0; c < blockCount; ++c)
+        {
+            metricOut->setValuesForColumn(firstColumn + blockStart + c, columnsOut[c]);
+        }
+    }
+}
+
+void MetricSmoothingObject::smoothBlockInternal(const float* const* columnsIn, const int& numColumns, float* const* columnsOut, const float* roiColumn, const bool& fixZeros) const
+{//same arithmetic, in the same order, as smoothColumnInternal, but each neighbor index and weight is loaded once for the whole block
+    CaretAssert(numColumns > 0 && numColumns <= COLUMN_BLOCK_SIZE);
+    const int B = COLUMN_BLOCK_SIZE;//the inner loops always run over the full block width so they can be vectorized, unused columns are zero
+    vector<float> interleaved((int64_t)m_numNodes * B, 0.0f);//node-major copy of the block, so all values of a neighbor are in one cache line
+#pragma omp CARET_PAR
+    {
+#pragma omp CARET_FOR schedule(static)
+        for (int32_t i = 0; i < m_numNodes; ++i)
         {
-            smoothColumnInternal(scratch.data(), metricIn, i, metricOut, i, fixZeros);
+            float* nodeValues = interleaved.data() + (int64_t)i * B;
+            for (int c = 0; c < numColumns; ++c)
+            {
+                nodeValues[c] = columnsIn[c][i];
+            }
+        }//implicit barrier, so all of interleaved is filled before smoothing
+#pragma omp CARET_FOR schedule(dynamic, 64)
+        for (int32_t i = 0; i < m_numNodes; ++i)
+        {
+            float sum[B], weightsum[B], result[B];
+            for (int c = 0; c < B; ++c)
+            {
+                sum[c] = 0.0f;
+                weightsum[c] = 0.0f;
+                result[c] = 0.0f;
+            }
+            if ((roiColumn == NULL || roiColumn[i] > 0.0f) && m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
+            {
+                const int64_t rowEnd = m_rowStarts[i + 1];
+                if (fixZeros)
+                {
+                    for (int64_t j = m_rowStarts[i]; j < rowEnd; ++j)
+                    {
+                        int32_t neighbor = m_neighbors[j];
+                        if (roiColumn != NULL && !(roiColumn[neighbor] > 0.0f)) continue;
+                        const float weight = m_weights[j];
+                        const float* values = interleaved.data() + (int64_t)neighbor * B;
+                        for (int c = 0; c < B; ++c)
+                        {
+                            if (values[c] != 0.0f)
+                            {
+                                sum[c] += weight * values[c];
+                                weightsum[c] += weight;
+                            }
+                        }
+                    }
+                    for (int c = 0; c < B; ++c)
+                    {
+                        if (weightsum[c] != 0.0f) result[c] = sum[c] / weightsum[c];
+                    }
+                } else if (roiColumn != NULL) {
+                    float sharedWeightSum = 0.0f;
+                    for (int64_t j = m_rowStarts[i]; j < rowEnd; ++j)
+                    {
+                        int32_t neighbor = m_neighbors[j];
+                        if (roiColumn[neighbor] > 0.0f)
+                        {
+                            const float weight = m_weights[j];
+                            const float* values = interleaved.data() + (int64_t)neighbor * B;
+                            for (int c = 0; c < B; ++c)
+                            {
+                                sum[c] += weight * values[c];
+                            }
+                            sharedWeightSum += weight;
+                        }
+                    }
+                    if (sharedWeightSum != 0.0f)
+                    {
+                        for (int c = 0; c < B; ++c)
+                        {
+                            result[c] = sum[c] / sharedWeightSum;
+                        }
+                    }
+                } else {
+                    for (int64_t j = m_rowStarts[i]; j < rowEnd; ++j)
+                    {
+                        const float weight = m_weights[j];
+                        const float* values = interleaved.data() + (int64_t)m_neighbors[j] * B;
+                        for (int c = 0; c < B; ++c)
+                        {
+                            sum[c] += weight * values[c];
+                        }
+                    }
+                    for (int c = 0; c < B; ++c)
+                    {
+                        result[c] = sum[c] / m_weightSums[i];
+                    }
+                }
+            }
+            for (int c = 0; c < numColumns; ++c)
+            {
+                columnsOut[c][i] = result[c];
+            }
         }
     }
 }
@@ -154,17 +387,16 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            if (m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                const int64_t rowEnd = m_rowStarts[i + 1];
+                for (int64_t j = m_rowStarts[i]; j < rowEnd; ++j)
                 {
-                    float value = myColumn[myWeightRef.m_nodes[j]];
+                    float value = myColumn[m_neighbors[j]];
                     if (value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_weights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -183,16 +415,15 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)
+            if (m_weightSums[i] != 0.0f)
             {
                 float sum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                const int64_t rowEnd = m_rowStarts[i + 1];
+                for (int64_t j = m_rowStarts[i]; j < rowEnd; ++j)
                 {
-                    sum += myWeightRef.m_weights[j] * myColumn[myWeightRef.m_nodes[j]];
+                    sum += m_weights[j] * myColumn[m_neighbors[j]];
                 }
-                scratch[i] = sum / myWeightRef.m_weightSum;
+                scratch[i] = sum / m_weightSums[i];
             } else {
                 scratch[i] = 0.0f;
             }
@@ -218,18 +449,17 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            if (roiColumn[i] > 0.0f && m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                const int64_t rowEnd = m_rowStarts[i + 1];
+                for (int64_t j = m_rowStarts[i]; j < rowEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = m_neighbors[j];
                     float value = myColumn[neighbor];
                     if (roiColumn[neighbor] > 0.0f && value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_weights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -248,17 +478,16 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)
+            if (roiColumn[i] > 0.0f && m_weightSums[i] != 0.0f)
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                const int64_t rowEnd = m_rowStarts[i + 1];
+                for (int64_t j = m_rowStarts[i]; j < rowEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = m_neighbors[j];
                     if (roiColumn[neighbor] > 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_weights[j];
                         sum += weight * myColumn[neighbor];
                         weightsum += weight;
                     }
@@ -20,6 +20,7 @@
 /*LICENSE_END*/
 
 #include <cmath>
+#include <cstring>
 #include <limits>
 #include <unordered_map>
 
@@ -38,6 +39,7 @@
 #include "LabelSelectionItemModel.h"
 #include "Palette.h"
 #include "PaletteColorMapping.h"
+#include "PaletteLookupTable.h"
 #include "MathFunctions.h"
 #include "TabDrawingInfo.h"
 
@@ -183,209 +185,132 @@ NodeAndVoxelColoring::colorScalarsWithPalettePrivate(const FastStatistics* stati
                                                           numberOfScalars);
     
     /*
-     * Get color for normalized values of -1.0 and 1.0.
-     * Since there may be a large number of values that are -1.0 or 1.0
-     * we can compute the color only once for these values and save time.
+     * Colors come from a table of the palette sampled at high resolution,
+     * instead of searching the palette for every value.  Hiding, thresholding,
+     * and the table lookup are combined with selects rather than branches
+     * so that the loops below vectorize.
      */
-    float rgbaPositiveOne[4], rgbaNegativeOne[4];
-    palette->getPaletteColor(1.0,
-                             interpolateFlag,
-                             rgbaPositiveOne);
-    const bool rgbaPositiveOneValid = (rgbaPositiveOne[3] > 0.0);
-    palette->getPaletteColor(-1.0,
-                             interpolateFlag,
-                             rgbaNegativeOne);
-    const bool rgbaNegativeOneValid = (rgbaNegativeOne[3] > 0.0);
+    const std::shared_ptr<const PaletteLookupTable> lookupTable = palette->getLookupTable(interpolateFlag);
+    CaretAssert(lookupTable);
+    
+    const bool showPositiveValues = ( ! hidePositiveValues);
+    const bool showNegativeValues = ( ! hideNegativeValues);
+    const bool showZeroValues     = ( ! hideZeroValues);
+    const bool showFailuresInGreen = (showMappedThresholdFailuresInGreen
+                                      && (thresholdType == PaletteThresholdTypeEnum::THRESHOLD_TYPE_MAPPED));
     
     /*
      * Color all scalars.
      */
-#pragma omp CARET_PARFOR schedule(dynamic, 4096)
-        for (int64_t i = 0; i < numberOfScalars; i++) {
-        const int64_t i4 = i * 4;
-        
-        /*
-         * Initialize coloring for node since one of the
-         * continue statements below may cause moving
-         * on to next node
-         */
-        switch (colorDataType) {
-            case COLOR_TYPE_FLOAT:
-                rgbaFloat[i4]   =  0.0;
-                rgbaFloat[i4+1] =  0.0;
-                rgbaFloat[i4+2] =  0.0;
-                rgbaFloat[i4+3] =  0.0;
-                break;
-            case COLOR_TYPE_UNSIGNED_BTYE:
-                rgbaUnsignedByte[i4]   =  0;
-                rgbaUnsignedByte[i4+1] =  0;
-                rgbaUnsignedByte[i4+2] =  0;
-                rgbaUnsignedByte[i4+3] =  0;
-                break;
-        }
-        
-        float scalar = scalarValues[i];
-        const float threshold = thresholdValues[i];
-        
-        /*
-         * Positive/Zero/Negative Test
-         */
-        if (scalar > PaletteColorMapping::SMALL_POSITIVE) {
-            if (hidePositiveValues) {
-                continue;
-            }
-        }
-        else if (scalar < PaletteColorMapping::SMALL_NEGATIVE) {
-            if (hideNegativeValues) {
-                continue;
-            }
-        }
-        else if (MathFunctions::isNaN(scalar)) {
-            continue;//TSC: never color NaN
-        } else {
-            /*
-             * May be very near zero so force to zero.
-             * 
-             * TSC: that seems wrong, leave the normalized value alone
-             *  if the data value is near zero, that doesn't mean the palette settings aren't also near zero
-             *  therefore, normalized value may not be near zero, which is important
-             * 
-             */
-            //normalizedValues[i] = 0.0;
-            if (hideZeroValues) {
-                continue;
-            }
-        }
-        
-        /*
-         * Temporary for rgba coloring now that past possible
-         * continue statements
-         */
-        float rgbaOut[4] = {
-             0.0,
-             0.0,
-             0.0,
-             0.0
-        };
-        
-        const float normalValue = normalizedValues[i];
-        
-        /*
-         * RGBA colors have been mapped for extreme values
-         */
-        if (normalValue >= 1.0) {
-            if (rgbaPositiveOneValid) {
-                rgbaOut[0] = rgbaPositiveOne[0];
-                rgbaOut[1] = rgbaPositiveOne[1];
-                rgbaOut[2] = rgbaPositiveOne[2];
-                rgbaOut[3] = rgbaPositiveOne[3];
-            }
-        }
-        else if (normalValue <= -1.0) {
-            if (rgbaNegativeOneValid) {
-                rgbaOut[0] = rgbaNegativeOne[0];
-                rgbaOut[1] = rgbaNegativeOne[1];
-                rgbaOut[2] = rgbaNegativeOne[2];
-                rgbaOut[3] = rgbaNegativeOne[3];
-            }
-        }
-        else {
-            /*
-             * Color scalar using palette
-             */
-            float rgba[4];
-            palette->getPaletteColor(normalValue,
-                                     interpolateFlag,
-                                     rgba);
-            if (rgba[3] > 0.0f) {
-                rgbaOut[0] = rgba[0];
-                rgbaOut[1] = rgba[1];
-                rgbaOut[2] = rgba[2];
-                rgbaOut[3] = rgba[3];
-            }
-        }
-        
-        /*
-         * Threshold Test
-         * Threshold is done last so colors are still set
-         * but if threshold test fails, alpha is set invalid.
-         */
-        bool thresholdPassedFlag = false;
-        if (skipThresholdTesting) {
-            thresholdPassedFlag = true;
-        }
-        else if (showOutsideFlag) {
-            if (threshold > thresholdMaximum) {
-                thresholdPassedFlag = true;
-            }
-            else if (threshold < thresholdMinimum) {
-                thresholdPassedFlag = true;
-            }
-        }
-        else {
-            if ((threshold >= thresholdMinimum) &&
-                (threshold <= thresholdMaximum)) {
-                thresholdPassedFlag = true;
+    const float* normalizedPointer = normalizedValues.data();
+    switch (colorDataType) {
+        case COLOR_TYPE_FLOAT:
+        {
+            const float* lookupColors = lookupTable->getColorsFloat();
+            const float zeroColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+#pragma omp CARET_PARFOR schedule(static)
+            for (int64_t i = 0; i < numberOfScalars; i++) {
+                const float scalar = scalarValues[i];
+                const float threshold = thresholdValues[i];
+                const int32_t lookupIndex = lookupTable->getIndex(normalizedPointer[i]);
+                
+                /*
+                 * NaN is never colored since it fails all three tests
+                 */
+                const bool displayFlag = (((scalar > PaletteColorMapping::SMALL_POSITIVE) & showPositiveValues)
+                                          | ((scalar < PaletteColorMapping::SMALL_NEGATIVE) & showNegativeValues)
+                                          | ((scalar <= PaletteColorMapping::SMALL_POSITIVE)
+                                             & (scalar >= PaletteColorMapping::SMALL_NEGATIVE)
+                                             & showZeroValues));
+                const bool thresholdPassedFlag = (skipThresholdTesting
+                                                  | (showOutsideFlag
+                                                     ? ((threshold > thresholdMaximum) | (threshold < thresholdMinimum))
+                                                     : ((threshold >= thresholdMinimum) & (threshold <= thresholdMaximum))));
+                const bool positiveGreenFlag = (showFailuresInGreen
+                                                & (threshold > 0.0f)
+                                                & (threshold < thresholdMappedPositive)
+                                                & (threshold > thresholdMappedPositiveAverageArea));
+                const bool negativeGreenFlag = (showFailuresInGreen
+                                                & (threshold < 0.0f)
+                                                & (threshold > thresholdMappedNegative)
+                                                & (threshold < thresholdMappedNegativeAverageArea));
+                
+                /*
+                 * A failed threshold clears RGB in addition to alpha, for volume Maximum Intensity Projection
+                 */
+                const float* failedColor = (positiveGreenFlag
+                                            ? positiveThresholdGreenColor
+                                            : (negativeGreenFlag
+                                               ? negativeThresholdGreenColor
+                                               : zeroColor));
+                const float* rgba = (thresholdPassedFlag
+                                     ? (lookupColors + lookupIndex * 4)
+                                     : failedColor);
+                rgba = (displayFlag ? rgba : zeroColor);
+                
+                const int64_t i4 = i * 4;
+                CaretAssertArrayIndex(rgbaFloat, numberOfScalars * 4, i4 + 3);
+                rgbaFloat[i4]   = rgba[0];
+                rgbaFloat[i4+1] = rgba[1];
+                rgbaFloat[i4+2] = rgba[2];
+                rgbaFloat[i4+3] = rgba[3];
             }
         }
-        if ( ! thresholdPassedFlag) {
+            break;
+        case COLOR_TYPE_UNSIGNED_BTYE:
+        {
             /*
-             * Need to clear RGB, in addition to alpha for volume Maximum Intensity Projection
+             * Colors are moved as one 32-bit word, copying preserves the byte order
              */
-            rgbaOut[0] = 0.0;
-            rgbaOut[1] = 0.0;
-            rgbaOut[2] = 0.0;
-            rgbaOut[3] = 0.0;
-            if (showMappedThresholdFailuresInGreen) {
-                if (thresholdType == PaletteThresholdTypeEnum::THRESHOLD_TYPE_MAPPED) {
-                    if (threshold > 0.0f) {
-                        if ((threshold < thresholdMappedPositive) &&
-                            (threshold > thresholdMappedPositiveAverageArea)) {
-                            rgbaOut[0] = positiveThresholdGreenColor[0];
-                            rgbaOut[1] = positiveThresholdGreenColor[1];
-                            rgbaOut[2] = positiveThresholdGreenColor[2];
-                            rgbaOut[3] = positiveThresholdGreenColor[3];
-                        }
-                    }
-                    else if (threshold < 0.0f) {
-                        if ((threshold > thresholdMappedNegative) &&
-                            (threshold < thresholdMappedNegativeAverageArea)) {
-                            rgbaOut[0] = negativeThresholdGreenColor[0];
-                            rgbaOut[1] = negativeThresholdGreenColor[1];
-                            rgbaOut[2] = negativeThresholdGreenColor[2];
-                            rgbaOut[3] = negativeThresholdGreenColor[3];
-                        }
-                    }
-                }
+            const uint8_t* lookupColors = lookupTable->getColorsByte();
+            uint8_t greenBytes[4];
+            uint32_t positiveGreenWord, negativeGreenWord;
+            PaletteLookupTable::convertColorToByte(positiveThresholdGreenColor, greenBytes);
+            std::memcpy(&positiveGreenWord, greenBytes, 4);
+            PaletteLookupTable::convertColorToByte(negativeThresholdGreenColor, greenBytes);
+            std::memcpy(&negativeGreenWord, greenBytes, 4);
+#pragma omp CARET_PARFOR schedule(static)
+            for (int64_t i = 0; i < numberOfScalars; i++) {
+                const float scalar = scalarValues[i];
+                const float threshold = thresholdValues[i];
+                const int32_t lookupIndex = lookupTable->getIndex(normalizedPointer[i]);
+                
+                const bool displayFlag = (((scalar > PaletteColorMapping::SMALL_POSITIVE) & showPositiveValues)
+                                          | ((scalar < PaletteColorMapping::SMALL_NEGATIVE) & showNegativeValues)
+                                          | ((scalar <= PaletteColorMapping::SMALL_POSITIVE)
+                                             & (scalar >= PaletteColorMapping::SMALL_NEGATIVE)
+                                             & showZeroValues));
+                const bool thresholdPassedFlag = (skipThresholdTesting
+                                                  | (showOutsideFlag
+                                                     ? ((threshold > thresholdMaximum) | (threshold < thresholdMinimum))
+                                                     : ((threshold >= thresholdMinimum) & (threshold <= thresholdMaximum))));
+                const bool positiveGreenFlag = (showFailuresInGreen
+                                                & (threshold > 0.0f)
+                                                & (threshold < thresholdMappedPositive)
+                                                & (threshold > thresholdMappedPositiveAverageArea));
+                const bool negativeGreenFlag = (showFailuresInGreen
+                                                & (threshold < 0.0f)
+                                                & (threshold > thresholdMappedNegative)
+                                                & (threshold < thresholdMappedNegativeAverageArea));
+                
+                uint32_t colorWord;
+                std::memcpy(&colorWord, lookupColors + lookupIndex * 4, 4);
+                const uint32_t failedWord = (positiveGreenFlag
+                                             ? positiveGreenWord
+                                             : (negativeGreenFlag
+                                                ? negativeGreenWord
+                                                : 0));
+                colorWord = (thresholdPassedFlag ? colorWord : failedWord);
+                colorWord = (displayFlag ? colorWord : 0);
+                
+                CaretAssertArrayIndex(rgbaUnsignedByte, numberOfScalars * 4, i * 4 + 3);
+                std::memcpy(rgbaUnsignedByte + i * 4, &colorWord, 4);
             }
         }
-
-        switch (colorDataType) {
-            case COLOR_TYPE_FLOAT:
-                CaretAssertArrayIndex(rgbaFloat, numberOfScalars * 4, i*4+3);
-                rgbaFloat[i4]   = rgbaOut[0];
-                rgbaFloat[i4+1] = rgbaOut[1];
-                rgbaFloat[i4+2] = rgbaOut[2];
-                rgbaFloat[i4+3] = rgbaOut[3];
-                break;
-            case COLOR_TYPE_UNSIGNED_BTYE:
-                CaretAssertArrayIndex(rgbaUnsignedByte, numberOfScalars * 4, i*4+3);
-                rgbaUnsignedByte[i4]   = rgbaOut[0] * 255.0;
-                rgbaUnsignedByte[i4+1] = rgbaOut[1] * 255.0;
-                rgbaUnsignedByte[i4+2] = rgbaOut[2] * 255.0;
-                if (rgbaOut[3] > 0.0) {
-                    rgbaUnsignedByte[i4+3] = rgbaOut[3] * 255.0;
-                }
-                else {
-                    rgbaUnsignedByte[i4+3] = 0;
-                }
-                break;
-        }
+            break;
     }
 }
 
-
-
 /**
  * Color scalars using a palette.
  *
@@ -1275,6 +1275,15 @@ OmeZarrImageFile::getGraphicsPrimitiveForMediaDrawing(const int32_t tabIndex,
                     GraphicsPrimitiveV3fT2f* primitive(createGraphicsPrimitive(dataSet,
                                                                                sliceIndex));
                     tabOverlayInfo->m_graphicsPrimitive.reset(primitive);
+                    
+                    /*
+                     * Decode the adjacent slices in the background so that
+                     * stepping through slices does not wait for decompression
+                     */
+                    if (primitive != NULL) {
+                        dataSet->prefetchSlice(sliceIndex + 1);
+                        dataSet->prefetchSlice(sliceIndex - 1);
+                    }
                 }
                 else {
                     CaretLogSevere("Invalid data set index="
@@ -759,6 +759,8 @@ SceneFile::writeFile(const AString& filenameIn)
          */
         SceneInfo::addWorkbenchVersionInfoToMetaData(m_metadata);
         
+        detachScenesFromFile();
+        
         SceneFileXmlStreamWriter xmlStreamWriter;
         xmlStreamWriter.writeFile(this);
 
@@ -772,6 +774,18 @@ SceneFile::writeFile(const AString& filenameIn)
     }
 }
 
+/**
+ * Read the classes of any scenes that have not been read from the file
+ * and keep them in memory since writing replaces the file's content.
+ */
+void
+SceneFile::detachScenesFromFile()
+{
+    for (auto scene : m_scenes) {
+        scene->detachContentFromFile();
+    }
+}
+
 /**
  * Write the scene file stream writer
  * @param filename
@@ -791,6 +805,8 @@ SceneFile::writeFileStreamWriter(const AString& filename)
     this->setFileName(filename);
     
     try {
+        detachScenesFromFile();
+        
         SceneFileXmlStreamWriter xmlStreamWriter;
         xmlStreamWriter.writeFile(this);
 
@@ -193,6 +193,7 @@ namespace caret {
         static const AString XML_ATTRIBUTE_VERSION;
         
     private:
+        void detachScenesFromFile();
 
         /** the scenes*/
         std::vector<Scene*> m_scenes;
@@ -19,7 +19,9 @@
  */
 /*LICENSE_END*/
 
+#include <QDateTime>
 #include <QFile>
+#include <QFileInfo>
 #include <QXmlStreamAttributes>
 #include <QXmlStreamReader>
 
@@ -42,7 +44,67 @@
 
 using namespace caret;
 
-
+namespace {
+    /**
+     * Convert offsets in characters, as counted by QXmlStreamReader in
+     * UTF-16 units following any byte order mark, to offsets in bytes
+     * in a UTF-8 encoded file.
+     *
+     * @param file
+     *    The open file.
+     * @param offsetsInOut
+     *    Input containing character offsets in increasing order,
+     *    output containing the corresponding byte offsets.
+     * @return
+     *    True if all offsets were converted.
+     */
+    bool characterOffsetsToByteOffsets(QFile& file,
+                                       std::vector<int64_t>& offsetsInOut)
+    {
+        if ( ! file.seek(0)) {
+            return false;
+        }
+        
+        int64_t byteOffset(0);
+        const QByteArray byteOrderMark(file.peek(3));
+        if (byteOrderMark == QByteArray("\xEF\xBB\xBF")) {
+            byteOffset = 3;
+            file.seek(byteOffset);
+        }
+        
+        const int64_t numberOfOffsets(offsetsInOut.size());
+        int64_t offsetIndex(0);
+        int64_t characterOffset(0);
+        while (offsetIndex < numberOfOffsets) {
+            const QByteArray block(file.read(1024 * 1024));
+            if (block.isEmpty()) {
+                break;
+            }
+            for (const char c : block) {
+                const uint8_t byte(static_cast<uint8_t>(c));
+                if ((byte & 0xC0) != 0x80) {
+                    /*
+                     * Not a continuation byte so a character starts here
+                     */
+                    while ((offsetIndex < numberOfOffsets)
+                           && (offsetsInOut[offsetIndex] == characterOffset)) {
+                        offsetsInOut[offsetIndex] = byteOffset;
+                        ++offsetIndex;
+                    }
+                    characterOffset += (((byte & 0xF8) == 0xF0) ? 2 : 1);
+                }
+                ++byteOffset;
+            }
+        }
+        while ((offsetIndex < numberOfOffsets)
+               && (offsetsInOut[offsetIndex] == characterOffset)) {
+            offsetsInOut[offsetIndex] = byteOffset;
+            ++offsetIndex;
+        }
+        
+        return (offsetIndex == numberOfOffsets);
+    }
+}
     
 /**
  * \class caret::SceneFileXmlStreamReader 
@@ -99,9 +161,32 @@ SceneFileXmlStreamReader::readFile(const AString& filename,
                                 + file.errorString());
     }
     
+    m_deferSceneClassesFlag = true;
+    m_sceneLocations.clear();
     QXmlStreamReader xmlReader(&file);
     readFileContent(xmlReader,
                     sceneFile);
+    
+    if ( ! xmlReader.hasError()) {
+        if ( ! setSceneContentLocations(file)) {
+            /*
+             * Scene locations could not be verified so read everything now
+             */
+            CaretLogFine("Unable to locate scenes for reading when needed, reading all scenes in "
+                         + m_filename);
+            sceneFile->clear();
+            m_sceneInfoMap.clear();
+            m_unexpectedXmlElements.clear();
+            m_deferSceneClassesFlag = false;
+            m_sceneLocations.clear();
+            
+            file.seek(0);
+            xmlReader.clear();
+            xmlReader.setDevice(&file);
+            readFileContent(xmlReader,
+                            sceneFile);
+        }
+    }
 
     AString errorMessage;
     if (xmlReader.hasError()) {
@@ -164,6 +249,7 @@ SceneFileXmlStreamReader::readFileContent(QXmlStreamReader& xmlReader,
     
     while ( ( ! xmlReader.atEnd())
            && ( ! endElementFound)) {
+        const int64_t tokenStartOffset(xmlReader.characterOffset());
         xmlReader.readNext();
         switch (xmlReader.tokenType()) {
             case QXmlStreamReader::StartElement:
@@ -187,10 +273,22 @@ SceneFileXmlStreamReader::readFileContent(QXmlStreamReader& xmlReader,
                     
                     Scene* scene = new Scene(sceneType);
                     SceneXmlStreamReader sceneReader;
-                    sceneReader.readScene(xmlReader,
-                                          scene,
-                                          m_filename);
+                    if (m_deferSceneClassesFlag) {
+                        sceneReader.readSceneWithoutClasses(xmlReader,
+                                                            scene,
+                                                            m_filename);
+                    }
+                    else {
+                        sceneReader.readScene(xmlReader,
+                                              scene,
+                                              m_filename);
+                    }
                     if ( ! xmlReader.hasError()) {
+                        if (m_deferSceneClassesFlag) {
+                            m_sceneLocations.push_back({ scene,
+                                                         tokenStartOffset,
+                                                         xmlReader.characterOffset() });
+                        }
                         auto mapIter = m_sceneInfoMap.find(sceneIndex);
                         SceneInfo* sceneInfo = ((mapIter != m_sceneInfoMap.end())
                                                 ? mapIter->second
@@ -315,3 +413,69 @@ SceneFileXmlStreamReader::readSceneInfoDirectory(QXmlStreamReader& xmlReader,
     }
 }
 
+/**
+ * Find the byte offsets of the scenes whose classes were skipped and give
+ * them to the scenes so that their classes are read when needed.
+ *
+ * @param file
+ *    The scene file.
+ * @return
+ *    True if the location of every scene was found, else false, in which
+ *    case the file must be read again with the scenes' classes.
+ */
+bool
+SceneFileXmlStreamReader::setSceneContentLocations(QFile& file)
+{
+    if (m_sceneLocations.empty()) {
+        return true;
+    }
+    
+    std::vector<int64_t> offsets;
+    for (const auto& sl : m_sceneLocations) {
+        offsets.push_back(sl.m_startOffset);
+        offsets.push_back(sl.m_endOffset);
+    }
+    if ( ! characterOffsetsToByteOffsets(file,
+                                         offsets)) {
+        return false;
+    }
+    
+    /*
+     * Verify that each location starts and ends with the scene's element
+     */
+    const QByteArray sceneStartText("<" + SceneXmlStreamReader::ELEMENT_SCENE.toUtf8());
+    const QByteArray sceneEndText("</" + SceneXmlStreamReader::ELEMENT_SCENE.toUtf8() + ">");
+    const int64_t numberOfScenes(m_sceneLocations.size());
+    for (int64_t i = 0; i < numberOfScenes; i++) {
+        const int64_t startOffset(offsets[i * 2]);
+        const int64_t endOffset(offsets[i * 2 + 1]);
+        if ( ! file.seek(startOffset)) {
+            return false;
+        }
+        if (file.read(sceneStartText.size()) != sceneStartText) {
+            return false;
+        }
+        if ( ! file.seek(endOffset - sceneEndText.size())) {
+            return false;
+        }
+        if (file.read(sceneEndText.size()) != sceneEndText) {
+            return false;
+        }
+        
+        m_sceneLocations[i].m_startOffset = startOffset;
+        m_sceneLocations[i].m_endOffset   = endOffset;
+    }
+    
+    const QFileInfo fileInfo(m_filename);
+    const int64_t fileSize(fileInfo.size());
+    const int64_t lastModifiedMilliseconds(fileInfo.lastModified().toMSecsSinceEpoch());
+    for (const auto& sl : m_sceneLocations) {
+        sl.m_scene->setContentLocationInFile(m_filename,
+                                             sl.m_startOffset,
+                                             sl.m_endOffset - sl.m_startOffset,
+                                             fileSize,
+                                             lastModifiedMilliseconds);
+    }
+    
+    return true;
+}
@@ -25,13 +25,16 @@
 
 #include <memory>
 #include <set>
+#include <vector>
 
 #include "SceneFileXmlStreamBase.h"
 
+class QFile;
 class QXmlStreamReader;
 
 namespace caret {
 
+    class Scene;
     class SceneFile;
     class SceneInfo;
     
@@ -52,6 +55,17 @@ namespace caret {
         // ADD_NEW_METHODS_HERE
 
     private:
+        /** Location of a scene's element in the file */
+        struct SceneLocation {
+            Scene* m_scene;
+            
+            int64_t m_startOffset;
+            
+            int64_t m_endOffset;
+        };
+        
+        bool setSceneContentLocations(QFile& file);
+        
         void readFileContent(QXmlStreamReader& xmlReader,
                              SceneFile* sceneFile);
         
@@ -66,6 +80,12 @@ namespace caret {
         
         std::map<int32_t, SceneInfo*> m_sceneInfoMap;
         
+        /** When true, scene classes are read from the file only when they are needed */
+        bool m_deferSceneClassesFlag = true;
+        
+        /** Scenes whose classes were skipped, in the order they are in the file */
+        std::vector<SceneLocation> m_sceneLocations;
+        
         // ADD_NEW_MEMBERS_HERE
 
     };
@@ -1391,6 +1391,13 @@ int32_t SurfaceFile::closestNode(const float target[3], const float maxDist) con
     }
 }
 
+void SurfaceFile::closestNodes(const float* targets, const int64_t numTargets, std::vector<int32_t>& nodesOut, const float maxDist) const
+{
+    std::vector<int64_t> indices(numTargets);
+    getPointLocator()->closestPoints(targets, numTargets, indices.data(), (maxDist > 0.0f ? maxDist : -1.0f));
+    nodesOut.assign(indices.begin(), indices.end());
+}
+
 CaretPointer<const CaretPointLocator> SurfaceFile::getPointLocator() const
 {
     if (m_locator == NULL)//try to avoid locking even once
@@ -1398,7 +1405,7 @@ CaretPointer<const CaretPointLocator> SurfaceFile::getPointLocator() const
         CaretMutexLocker myLock(&m_locatorMutex);
         if (m_locator == NULL)//test again AFTER lock to avoid race conditions
         {
-            m_locator.grabNew(new CaretPointLocator(getCoordinateData(), getNumberOfNodes()));
+            m_locator.grabNew(new CaretPointLocator(getCoordinateData(), getNumberOfNodes(), CaretPointLocator::STATIC_TREE));
         }
     }
     return m_locator;
@@ -166,6 +166,9 @@ namespace caret {
         ///find the closest node on the surface, within maxDist if maxDist is positive
         int32_t closestNode(const float target[3], const float maxDist = -1.0f) const;
         
+        ///find the closest node to each of numTargets coordinate triples in parallel, within maxDist if maxDist is positive
+        void closestNodes(const float* targets, const int64_t numTargets, std::vector<int32_t>& nodesOut, const float maxDist = -1.0f) const;
+        
         virtual void setModified();
         
         AString getInformation() const;
@@ -29,9 +29,11 @@
 #include "CaretException.h"
 #include "CaretLogger.h"
 #include "CaretOMP.h"
+#include "CaretPerfTrace.h"
 #include "FastStatistics.h"
 #include "GeodesicHelper.h"
 #include "SignedDistanceHelper.h"
+#include "SparseWeightCache.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 #include "Vector3D.h"
@@ -46,6 +48,7 @@ using namespace caret;
 SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
                                                  const float* currentAreas, const float* newAreas, const float* currentRoi, const bool allowNonSphere)
 {
+    CARET_PERF_SCOPE("surface resampling weights");
     m_nonsphereAllowed = allowNonSphere;
     SurfaceFile currentSphereMod, newSphereMod;
     const SurfaceFile* useCurrent = currentSphere, *useNew = newSphere;
@@ -59,21 +62,126 @@ SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEn
     }
     //TODO: warning if nonsphere allowed and distance between surfaces is large at some point?
     //if warning was enabled always, then a highly distorted sphere could trip it, so maybe it would be a good idea anyway, but with a different message
+    if (myMethod == SurfaceResamplingMethodEnum::ADAP_BARY_AREA)
+    {
+        CaretAssert(currentAreas != NULL && newAreas != NULL);
+        if (currentAreas == NULL || newAreas == NULL) throw CaretException("ADAP_BARY_AREA method requires providing vertex areas using anatomical surfaces or vertex area metrics");
+    }
+    QString cacheKey;
+    if (SparseWeightCache::isEnabled())
+    {
+        cacheKey = getWeightCacheKey(myMethod, currentSphere, newSphere, currentAreas, newAreas, currentRoi, allowNonSphere);
+        if (loadCachedWeights(cacheKey, newSphere->getNumberOfNodes(), currentSphere->getNumberOfNodes()))
+        {
+            CaretPerfTrace::addCount("surface resampling weights from cache");
+            return;
+        }
+    }
     switch (myMethod)
     {
         case SurfaceResamplingMethodEnum::ADAP_BARY_AREA:
-            CaretAssert(currentAreas != NULL && newAreas != NULL);
-            if (currentAreas == NULL || newAreas == NULL) throw CaretException("ADAP_BARY_AREA method requires providing vertex areas using anatomical surfaces or vertex area metrics");
             computeWeightsAdapBaryArea(useCurrent, useNew, currentAreas, newAreas, currentRoi);
             break;
         case SurfaceResamplingMethodEnum::BARYCENTRIC:
             computeWeightsBarycentric(useCurrent, useNew, currentRoi);
             break;
     }
+    if (SparseWeightCache::isEnabled())
+    {
+        storeCachedWeights(cacheKey);
+    }
+}
+
+namespace
+{
+    void addSurfaceToKey(SparseWeightCache::KeyBuilder& myKey, const SurfaceFile* surface)
+    {
+        const int32_t numNodes = surface->getNumberOfNodes(), numTriangles = surface->getNumberOfTriangles();
+        myKey.addValue(numNodes);
+        myKey.addData(surface->getCoordinateData(), numNodes * 3 * sizeof(float));
+        vector<int32_t> triangles(numTriangles * 3);
+        for (int32_t i = 0; i < numTriangles; ++i)
+        {
+            const int32_t* thisTri = surface->getTriangle(i);
+            triangles[i * 3] = thisTri[0];
+            triangles[i * 3 + 1] = thisTri[1];
+            triangles[i * 3 + 2] = thisTri[2];
+        }
+        myKey.addValue(numTriangles);
+        myKey.addData(triangles.data(), triangles.size() * sizeof(int32_t));
+    }
+}
+
+QString SurfaceResamplingHelper::getWeightCacheKey(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                                   const float* currentAreas, const float* newAreas, const float* currentRoi, const bool& allowNonSphere)
+{
+    SparseWeightCache::KeyBuilder myKey("SurfaceResamplingHelper 1");//change the version if the weight computation changes
+    myKey.addValue((int32_t)myMethod);
+    myKey.addValue((int32_t)(allowNonSphere ? 1 : 0));
+    addSurfaceToKey(myKey, currentSphere);//the radius change is deterministic, so the original coordinates are enough
+    addSurfaceToKey(myKey, newSphere);
+    if (myMethod == SurfaceResamplingMethodEnum::ADAP_BARY_AREA)
+    {
+        myKey.addData(currentAreas, currentSphere->getNumberOfNodes() * sizeof(float));
+        myKey.addData(newAreas, newSphere->getNumberOfNodes() * sizeof(float));
+    }
+    if (currentRoi != NULL)
+    {//only the "inside" test matters to the weights
+        const int32_t numNodes = currentSphere->getNumberOfNodes();
+        vector<char> roiMask(numNodes);
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            roiMask[i] = (currentRoi[i] > 0.0f) ? 1 : 0;
+        }
+        myKey.addValue((int32_t)1);
+        myKey.addData(roiMask.data(), numNodes);
+    } else {
+        myKey.addValue((int32_t)0);
+    }
+    return myKey.getKey();
+}
+
+bool SurfaceResamplingHelper::loadCachedWeights(const QString& key, const int& numNewNodes, const int& numCurrentNodes)
+{
+    SparseWeightCache::Weights cached;
+    if (!SparseWeightCache::load(key, numNewNodes, numCurrentNodes, cached)) return false;
+    int64_t compactsize = (int64_t)cached.indices.size();
+    m_storagechunk = CaretArray<WeightElem>(compactsize);
+    for (int64_t i = 0; i < compactsize; ++i)
+    {
+        m_storagechunk[i] = WeightElem(cached.indices[i], cached.weights[i]);
+    }
+    m_weights = CaretArray<WeightElem*>(numNewNodes + 1);
+    for (int i = 0; i <= numNewNodes; ++i)
+    {
+        m_weights[i] = m_storagechunk + cached.rowStarts[i];
+    }
+    return true;
+}
+
+void SurfaceResamplingHelper::storeCachedWeights(const QString& key) const
+{
+    int numNodes = (int)m_weights.size() - 1;
+    SparseWeightCache::Weights toStore;
+    toStore.rowStarts.resize(numNodes + 1);
+    for (int i = 0; i <= numNodes; ++i)
+    {
+        toStore.rowStarts[i] = m_weights[i] - m_weights[0];
+    }
+    int64_t compactsize = toStore.rowStarts[numNodes];
+    toStore.indices.resize(compactsize);
+    toStore.weights.resize(compactsize);
+    for (int64_t i = 0; i < compactsize; ++i)
+    {
+        toStore.indices[i] = m_weights[0][i].node;
+        toStore.weights[i] = m_weights[0][i].weight;
+    }
+    SparseWeightCache::store(key, toStore);
 }
 
 void SurfaceResamplingHelper::resampleNormal(const float* input, float* output, const float& invalidVal) const
 {
+    CARET_PERF_SCOPE("surface resampling apply");
     int numNodes = (int)m_weights.size() - 1;
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int i = 0; i < numNodes; ++i)
@@ -95,6 +203,7 @@ void SurfaceResamplingHelper::resampleNormal(const float* input, float* output,
 
 void SurfaceResamplingHelper::resample3DCoord(const float* input, float* output) const
 {
+    CARET_PERF_SCOPE("surface resampling apply");
     int numNodes = (int)m_weights.size() - 1;
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int i = 0; i < numNodes; ++i)
@@ -117,6 +226,7 @@ void SurfaceResamplingHelper::resample3DCoord(const float* input, float* output)
 
 void SurfaceResamplingHelper::resamplePopular(const int32_t* input, int32_t* output, const int32_t& invalidVal) const
 {
+    CARET_PERF_SCOPE("surface resampling apply");
     int numNodes = (int)m_weights.size() - 1;
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int i = 0; i < numNodes; ++i)
@@ -152,6 +262,7 @@ void SurfaceResamplingHelper::resamplePopular(const int32_t* input, int32_t* out
 
 void SurfaceResamplingHelper::resampleLargest(const float* input, float* output, const float& invalidVal) const
 {
+    CARET_PERF_SCOPE("surface resampling apply");
     int numNodes = (int)m_weights.size() - 1;
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int i = 0; i < numNodes; ++i)
@@ -178,6 +289,7 @@ void SurfaceResamplingHelper::resampleLargest(const float* input, float* output,
 
 void SurfaceResamplingHelper::resampleLargest(const int32_t* input, int32_t* output, const int32_t& invalidVal) const
 {
+    CARET_PERF_SCOPE("surface resampling apply");
     int numNodes = (int)m_weights.size() - 1;
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int i = 0; i < numNodes; ++i)
@@ -24,6 +24,8 @@
 #include "CaretPointer.h"
 #include "SurfaceResamplingMethodEnum.h"
 
+#include <QString>
+
 #include <map>
 #include <vector>
 
@@ -49,6 +51,10 @@ namespace caret {
         void computeWeightsBarycentric(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentRoi);
         void makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, std::vector<std::map<int, float> >& weights, const float* currentRoi);
         void compactWeights(const std::vector<std::map<int, float> >& weights);
+        static QString getWeightCacheKey(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                         const float* currentAreas, const float* newAreas, const float* currentRoi, const bool& allowNonSphere);
+        bool loadCachedWeights(const QString& key, const int& numNewNodes, const int& numCurrentNodes);
+        void storeCachedWeights(const QString& key) const;
     public:
         SurfaceResamplingHelper() { }
         SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
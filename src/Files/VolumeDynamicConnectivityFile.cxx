@@ -363,31 +363,19 @@ VolumeDynamicConnectivityFile::loadMapAverageDataForVoxelIndices(const int64_t v
      */
     clearVoxels();
     
-    std::vector<double> dataSum(m_numberOfVoxels);
-    std::fill(dataSum.begin(),
-              dataSum.end(),
-              0.0);
     std::vector<int64_t> brainordinateIndices;
     for (auto voxel : voxelIndices) {
         const int64_t offset(m_parentVolumeFile->getIndex(voxel.m_ijk));
         brainordinateIndices.push_back(offset);
-        
-        std::vector<float> data;
-        connCorrelationTwo->computeForDataSetIndex(offset, data);
-        
-        for (int64_t j = 0; j < m_numberOfVoxels; j++) {
-            CaretAssertVectorIndex(dataSum, j);
-            CaretAssertVectorIndex(data, j);
-            dataSum[j] += data[j];
-        }
     }
     
     if (m_numberOfVoxels > 0) {
-        const double numVoxels(m_numberOfVoxels);
-        for (int64_t j = 0; j < m_numberOfVoxels; j++) {
-            CaretAssertVectorIndex(dataSum, j);
-            m_voxelData[j] = (dataSum[j] / numVoxels);
-        }
+        std::vector<float> dataAverage(m_numberOfVoxels);
+        connCorrelationTwo->computeAverageForDataSetIndices(brainordinateIndices,
+                                                            dataAverage);
+        std::copy(dataAverage.begin(),
+                  dataAverage.end(),
+                  m_voxelData);
         
         const int32_t mapIndex(0);
         const int64_t validDataCount(static_cast<int64_t>(brainordinateIndices.size()));
@@ -551,6 +539,12 @@ VolumeDynamicConnectivityFile::getConnectivityCorrelationTwo() const
              * IJK dimensions are same in this and parent volume
              */
             CaretAssert(m_parentVolumeFile);
+            /*
+             * Pointers into every timepoint are kept by the correlation,
+             * so a paged parent must have all frames in memory
+             */
+            const_cast<VolumeFile*>(m_parentVolumeFile)->loadAllFrames();
+            CaretAssert( ! m_parentVolumeFile->isPaged());
             const float* parentVoxels = m_parentVolumeFile->getFrame(0);
             CaretAssert(parentVoxels);
             
@@ -576,13 +570,19 @@ VolumeDynamicConnectivityFile::getConnectivityCorrelationTwo() const
                         
             const int64_t nextTimePointOffset(m_parentVolumeFile->getFrame(1)
                                               - m_parentVolumeFile->getFrame(0));
+            /*
+             * The parent volume keeps its data for display, so a normalized
+             * copy would double the memory used by the 4D volume
+             */
+            const bool normalizedDataEnabled(false);
             AString errorMessage;
             ConnectivityCorrelationTwo* cc(ConnectivityCorrelationTwo::newInstance(getFileName(),
                                                                                    *m_correlationSettings,
                                                                                    brainordinateDataPointers,
                                                                                    numberOfTimePoints,
                                                                                    nextTimePointOffset,
-                                                                                   errorMessage));
+                                                                                   errorMessage,
+                                                                                   normalizedDataEnabled));
             if (cc != NULL) {
                 m_connectivityCorrelationTwo.reset(cc);
             }
@@ -26,12 +26,14 @@
 #include <sstream>
 #include <string>
 
+#include <QFileInfo>
 #include <QTemporaryFile>
 
 #include "ApplicationInformation.h"
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
 #include "CaretMappableDataFileClusterFinder.h"
+#include "CaretPerfTrace.h"
 #include "CaretResult.h"
 #include "CaretTemporaryFile.h"
 #include "ChartDataCartesian.h"
@@ -61,12 +63,14 @@
 #include "VoxelColorUpdate.h"
 
 #include <limits>
+#include <set>
 
 using namespace caret;
 using namespace std;
 
 const float VolumeFile::INVALID_INTERP_VALUE = 0.0f;//we may want NaN or something more obvious
 bool VolumeFile::s_voxelColoringEnabled = true;
+int64_t VolumeFile::s_pagedReadingMemoryLimit = 0;
 const AString VolumeFile::s_paletteColorMappingNameInMetaData = "__DYNAMIC_FILE_PALETTE_COLOR_MAPPING__";
 
 /**
@@ -89,6 +93,104 @@ VolumeFile::setVoxelColoringEnabled(const bool enabled)
                            : "Volume coloring is disabled."));
 }
 
+namespace
+{
+    //reads frames of an uncompressed, single component nifti file for paged volumes
+    class NiftiFrameSource : public AbstractFrameSource
+    {
+        mutable NiftiIO m_io;//convertNative doesn't touch the file
+        vector<int64_t> m_extraDims;
+        int64_t m_frameElems;
+    public:
+        NiftiFrameSource(const AString& filename)
+        {
+            m_io.openRead(filename);
+            const vector<int64_t>& dims = m_io.getDimensions();
+            CaretAssert(dims.size() > 3 && m_io.getNumComponents() == 1);
+            m_frameElems = dims[0] * dims[1] * dims[2];
+            m_extraDims = vector<int64_t>(dims.begin() + 3, dims.end());
+        }
+        
+        int64_t getNativeFrameBytes() const override
+        {
+            return m_frameElems * m_io.numBytesPerElem();
+        }
+        
+        void readNativeFrame(char* nativeOut, const int64_t& brickIndex, const int64_t& component) override
+        {
+            CaretAssert(component == 0);
+            (void)component;
+            vector<int64_t> indexSelect(m_extraDims.size());
+            int64_t remaining = brickIndex;
+            for (int i = 0; i < (int)m_extraDims.size(); ++i)
+            {//same order as VolumeBase::getNonSpatialIndexesFromBrickIndex
+                indexSelect[i] = remaining % m_extraDims[i];
+                remaining /= m_extraDims[i];
+            }
+            m_io.readNative(nativeOut, 3, indexSelect);
+        }
+        
+        void convertNative(float* dataOut, const char* nativeFrame, const int64_t& offset, const int64_t& count) const override
+        {
+            m_io.convertNative(dataOut, nativeFrame + offset * m_io.numBytesPerElem(), count);
+        }
+    };
+    
+    //paged volumes must be loaded before their file is overwritten
+    CaretMutex pagedVolumesMutex;
+    set<VolumeFile*> pagedVolumes;
+}
+
+/**
+ * Set the memory limit for reading volume files on demand.  Uncompressed,
+ * single-component NIfTI files with more than one frame, whose data would use
+ * more than this much memory, keep the file open and read frames the first
+ * time they are used, keeping them in the file's datatype and dropping the
+ * least recently used frames to stay near the limit.  Modifying voxels of
+ * such a volume reads the rest of it into memory.
+ *
+ * @param bytesPerFile
+ *    Limit for each file, 0 reads all files into memory (the default).
+ */
+void
+VolumeFile::setPagedReadingMemoryLimit(const int64_t& bytesPerFile)
+{
+    s_pagedReadingMemoryLimit = max(bytesPerFile, int64_t(0));
+}
+
+/**
+ * @return The memory limit for reading volume files on demand, 0 if disabled.
+ */
+int64_t
+VolumeFile::getPagedReadingMemoryLimit()
+{
+    return s_pagedReadingMemoryLimit;
+}
+
+/**
+ * Read all frames of any paged volume that reads from the given file, so
+ * that the file can be replaced.
+ */
+void
+VolumeFile::loadPagedVolumesReadingFrom(const AString& filename)
+{
+    const AString canonicalPath = QFileInfo(filename).canonicalFilePath();
+    if (canonicalPath.isEmpty()) return;//doesn't exist yet
+    CaretMutexLocker locked(&pagedVolumesMutex);
+    for (set<VolumeFile*>::iterator iter = pagedVolumes.begin(); iter != pagedVolumes.end();)
+    {
+        VolumeFile* volume = *iter;
+        if (volume->m_pagedFilePath == canonicalPath)
+        {
+            volume->loadAllFrames();
+            volume->m_pagedFilePath = "";
+            pagedVolumes.erase(iter++);
+        } else {
+            ++iter;
+        }
+    }
+}
+
 /** protected, used by dynamic volume file */
 VolumeFile::VolumeFile(const DataFileTypeEnum::Enum dataFileType)
 : VolumeBase(),
@@ -161,6 +263,15 @@ void VolumeFile::reinitialize(const vector<int64_t>& dimensionsIn, const vector<
     setType(whatType);
 }
 
+void VolumeFile::reinitializePaged(const vector<int64_t>& dimensionsIn, const vector<vector<float> >& indexToSpace, AbstractFrameSource* source)
+{
+    clear();
+    VolumeBase::reinitializePaged(dimensionsIn, indexToSpace, source, s_pagedReadingMemoryLimit);
+    m_graphicsPrimitiveManager->clear();
+    validateMembers();
+    setType(SubvolumeAttributes::ANATOMY);
+}
+
 void VolumeFile::reinitialize(const VolumeSpace& volSpaceIn, const int64_t numFrames, const int64_t numComponents,
                               SubvolumeAttributes::VolumeType whatType, const AbstractHeader* templateHeader)
 {
@@ -255,6 +366,12 @@ VolumeFile::clear()
     
     m_dataRangeValid = false;
     m_nonZeroVoxelCoordinateBoundingBoxes.clear();
+    if (!m_pagedFilePath.isEmpty())
+    {
+        CaretMutexLocker locked(&pagedVolumesMutex);
+        pagedVolumes.erase(this);
+        m_pagedFilePath = "";
+    }
     VolumeBase::clear();
     
     m_volumeFileEditorDelegate->clear();
@@ -271,6 +388,7 @@ VolumeFile::clear()
 
 void VolumeFile::readFile(const AString& filename)
 {
+    CARET_PERF_SCOPE("volume read");
     ElapsedTimer timer;
     timer.start();
     
@@ -326,30 +444,47 @@ void VolumeFile::readFile(const AString& filename)
                 throw DataFileException(filename, "volume FOV is 1x1x1 voxel, with over 10,000 frames, which suggests a broken cifti file (no header extension)");
             }
         }//this check is also done in reinitialize(), but we don't want to call getSForm before this check when reading a file
-        reinitialize(myDims, inHeader.getSForm(), numComponents);
-        setFileName(filename);  // must be done after reinitialize() since it calls clear() which clears the name of the file
         int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
-        if (numComponents != 1)
+        int64_t numFrames = 1;
+        for (int i = 0; i < (int)extraDims.size(); ++i)
         {
-            vector<float> tempFrame(frameSize), readBuffer(frameSize * numComponents);
-            for (MultiDimIterator<int64_t> myiter(extraDims); !myiter.atEnd(); ++myiter)
+            numFrames *= extraDims[i];
+        }
+        bool usePaging = (s_pagedReadingMemoryLimit > 0 && numComponents == 1 && numFrames > 1 &&
+                          fileToRead == filename && !filename.endsWith(".gz", Qt::CaseInsensitive) &&//seeking backwards in gzip means decompressing from the start again
+                          frameSize * numFrames * (int64_t)sizeof(float) > s_pagedReadingMemoryLimit);
+        if (usePaging)
+        {//frames are read when they are used
+            reinitializePaged(myDims, inHeader.getSForm(), new NiftiFrameSource(fileToRead));
+            setFileName(filename);
+            m_pagedFilePath = QFileInfo(fileToRead).canonicalFilePath();
+            CaretMutexLocker locked(&pagedVolumesMutex);
+            pagedVolumes.insert(this);
+        } else {
+            reinitialize(myDims, inHeader.getSForm(), numComponents);
+            setFileName(filename);  // must be done after reinitialize() since it calls clear() which clears the name of the file
+            if (numComponents != 1)
             {
-                myIO.readData(readBuffer.data(), fullDims, *myiter);
-                for (int c = 0; c < numComponents; ++c)
+                vector<float> tempFrame(frameSize), readBuffer(frameSize * numComponents);
+                for (MultiDimIterator<int64_t> myiter(extraDims); !myiter.atEnd(); ++myiter)
                 {
-                    for (int64_t i = 0; i < frameSize; ++i)
+                    myIO.readData(readBuffer.data(), fullDims, *myiter);
+                    for (int c = 0; c < numComponents; ++c)
                     {
-                        tempFrame[i] = readBuffer[i * numComponents + c];
+                        for (int64_t i = 0; i < frameSize; ++i)
+                        {
+                            tempFrame[i] = readBuffer[i * numComponents + c];
+                        }
+                        setFrame(tempFrame.data(), getBrickIndexFromNonSpatialIndexes(*myiter), c);
                     }
-                    setFrame(tempFrame.data(), getBrickIndexFromNonSpatialIndexes(*myiter), c);
                 }
-            }
-        } else {//avoid the added allocation for separating components
-            vector<float> tempFrame(frameSize);
-            for (MultiDimIterator<int64_t> myiter(extraDims); !myiter.atEnd(); ++myiter)
-            {
-                myIO.readData(tempFrame.data(), fullDims, *myiter);
-                setFrame(tempFrame.data(), getBrickIndexFromNonSpatialIndexes(*myiter));
+            } else {//avoid the added allocation for separating components
+                vector<float> tempFrame(frameSize);
+                for (MultiDimIterator<int64_t> myiter(extraDims); !myiter.atEnd(); ++myiter)
+                {
+                    myIO.readData(tempFrame.data(), fullDims, *myiter);
+                    setFrame(tempFrame.data(), getBrickIndexFromNonSpatialIndexes(*myiter));
+                }
             }
         }
         
@@ -392,6 +527,7 @@ void VolumeFile::readFile(const AString& filename)
 void 
 VolumeFile::writeFile(const AString& filename)
 {
+    CARET_PERF_SCOPE("volume write");
     if (!(filename.endsWith(".nii.gz") || filename.endsWith(".nii")))
     {
         CaretLogWarning("volume file '" + filename + "' should be saved ending in .nii.gz or .nii, other formats are not supported");
@@ -454,6 +590,7 @@ VolumeFile::writeFile(const AString& filename)
             outHeader.setDataType(m_writingDType);
         }
     }
+    loadPagedVolumesReadingFrom(filename);//including this one
     NiftiIO myIO;
     int outVersion = 1;
     if (!outHeader.canWriteVersion(1)) outVersion = 2;
@@ -604,11 +741,17 @@ float VolumeFile::interpolateValue(const float coordIn1, const float coordIn2, c
             int64_t ind3high = ind3low + 1;
             float xhighWeight = index1 - ind1low;
             float xlowWeight = 1.0f - xhighWeight;
+            const int64_t corners[8] = { getIndex(ind1low, ind2low, ind3low, brickIndex, component), getIndex(ind1high, ind2low, ind3low, brickIndex, component),
+                                         getIndex(ind1low, ind2high, ind3low, brickIndex, component), getIndex(ind1high, ind2high, ind3low, brickIndex, component),
+                                         getIndex(ind1low, ind2low, ind3high, brickIndex, component), getIndex(ind1high, ind2low, ind3high, brickIndex, component),
+                                         getIndex(ind1low, ind2high, ind3high, brickIndex, component), getIndex(ind1high, ind2high, ind3high, brickIndex, component) };
+            float cornerVals[8];
+            getValues(corners, 8, cornerVals);//paged volumes only lock once
             float xinterp[2][2];//manually unrolled, because loops of 2 seem silly
-            xinterp[0][0] = xlowWeight * getValue(ind1low, ind2low, ind3low, brickIndex, component) + xhighWeight * getValue(ind1high, ind2low, ind3low, brickIndex, component);
-            xinterp[1][0] = xlowWeight * getValue(ind1low, ind2high, ind3low, brickIndex, component) + xhighWeight * getValue(ind1high, ind2high, ind3low, brickIndex, component);
-            xinterp[0][1] = xlowWeight * getValue(ind1low, ind2low, ind3high, brickIndex, component) + xhighWeight * getValue(ind1high, ind2low, ind3high, brickIndex, component);
-            xinterp[1][1] = xlowWeight * getValue(ind1low, ind2high, ind3high, brickIndex, component) + xhighWeight * getValue(ind1high, ind2high, ind3high, brickIndex, component);
+            xinterp[0][0] = xlowWeight * cornerVals[0] + xhighWeight * cornerVals[1];
+            xinterp[1][0] = xlowWeight * cornerVals[2] + xhighWeight * cornerVals[3];
+            xinterp[0][1] = xlowWeight * cornerVals[4] + xhighWeight * cornerVals[5];
+            xinterp[1][1] = xlowWeight * cornerVals[6] + xhighWeight * cornerVals[7];
             float yhighWeight = index2 - ind2low;
             float ylowWeight = 1.0f - yhighWeight;
             float yinterp[2];
@@ -2267,14 +2410,18 @@ VolumeFile::getDataRangeFromAllMaps(float& dataRangeMinimumOut,
     m_dataRangeMinimum = std::numeric_limits<float>::max();
     
     const int64_t* dimensions = getDimensionsPtr();
-    int64_t m_dataSize = dimensions[0] * dimensions[1] * dimensions[2] * dimensions[3] * dimensions[4];
-    const float* data = getFrame();//HACK: use first frame knowing all data is contiguous after it
-    for (int64_t i = 0; i < m_dataSize; i++) {
-        if (data[i] > m_dataRangeMaximum) {
-            m_dataRangeMaximum = data[i];
-        }
-        if (data[i] < m_dataRangeMinimum) {
-            m_dataRangeMinimum = data[i];
+    const int64_t frameSize = dimensions[0] * dimensions[1] * dimensions[2];
+    for (int64_t c = 0; c < dimensions[4]; ++c) {
+        for (int64_t b = 0; b < dimensions[3]; ++b) {
+            const float* data = getFrame(b, c);//frame at a time, paged volumes don't have contiguous data
+            for (int64_t i = 0; i < frameSize; i++) {
+                if (data[i] > m_dataRangeMaximum) {
+                    m_dataRangeMaximum = data[i];
+                }
+                if (data[i] < m_dataRangeMinimum) {
+                    m_dataRangeMinimum = data[i];
+                }
+            }
         }
     }
     
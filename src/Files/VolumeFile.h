@@ -147,6 +147,15 @@ namespace caret {
         
         mutable std::map<int32_t, std::unique_ptr<ClusterContainer>> m_mapLabelClusterContainers;
         
+        static int64_t s_pagedReadingMemoryLimit;
+        
+        ///canonical path of the file a paged volume reads from, empty when not paged
+        AString m_pagedFilePath;
+        
+        void reinitializePaged(const std::vector<int64_t>& dimensionsIn, const std::vector<std::vector<float> >& indexToSpace, AbstractFrameSource* source);
+        
+        static void loadPagedVolumesReadingFrom(const AString& filename);
+        
     protected:
         VolumeFile(const DataFileTypeEnum::Enum dataFileType);
         
@@ -172,6 +181,11 @@ namespace caret {
         
         static void setVoxelColoringEnabled(const bool enabled);
         
+        ///read large uncompressed single-component NIfTI files a frame at a time as frames are used, rather than all at once, 0 (the default) disables
+        ///applies to files whose data would be more than bytesPerFile as float, and about that much of each is kept in memory
+        static void setPagedReadingMemoryLimit(const int64_t& bytesPerFile);
+        static int64_t getPagedReadingMemoryLimit();
+        
         VolumeFile();
         VolumeFile(const std::vector<int64_t>& dimensionsIn, const std::vector<std::vector<float> >& indexToSpace, const int64_t numComponents = 1,
                    SubvolumeAttributes::VolumeType whatType = SubvolumeAttributes::ANATOMY, const AbstractHeader* templateHeader = NULL);
@@ -19,6 +19,8 @@
 /*LICENSE_END*/
 
 #include "VolumeBase.h"
+#include "CaretOMP.h"
+#include "CaretPerfTrace.h"
 #include "DataFileException.h"
 #include "FloatMatrix.h"
 #include "GiftiLabelTable.h"
@@ -37,7 +39,26 @@ AbstractHeader::~AbstractHeader()
 {
 }
 
+AbstractFrameSource::~AbstractFrameSource()
+{
+}
+
 void VolumeBase::reinitialize(const vector<int64_t>& dimensionsIn, const vector<vector<float> >& indexToSpace, const int64_t numComponents)
+{
+    int64_t storeDims[5];
+    setupDimensions(dimensionsIn, indexToSpace, numComponents, storeDims);
+    m_storage.reinitialize(storeDims);
+}
+
+void VolumeBase::reinitializePaged(const vector<int64_t>& dimensionsIn, const vector<vector<float> >& indexToSpace, AbstractFrameSource* source, const int64_t& memoryLimit)
+{
+    CaretPointer<AbstractFrameSource> sourcePtr(source);//so it gets deleted if we throw
+    int64_t storeDims[5];
+    setupDimensions(dimensionsIn, indexToSpace, 1, storeDims);
+    m_storage.reinitializePaged(storeDims, sourcePtr, memoryLimit);
+}
+
+void VolumeBase::setupDimensions(const vector<int64_t>& dimensionsIn, const vector<vector<float> >& indexToSpace, const int64_t numComponents, int64_t storeDims[5])
 {
     CaretAssert(numComponents > 0);
     clear();
@@ -64,7 +85,6 @@ void VolumeBase::reinitialize(const vector<int64_t>& dimensionsIn, const vector<
         throw DataFileException("this file doesn't appear to be a volume file");
     }
     storeDims[4] = numComponents;
-    m_storage.reinitialize(storeDims);
 }
 
 void VolumeBase::addSubvolumes(const int64_t& numToAdd)
@@ -347,6 +367,19 @@ VolumeBase::isEmpty() const
     return (getDimensionsPtr()[0] <= 0);
 }
 
+namespace
+{
+    //converted frames handed out by getFrame on a paged volume, enough that parallel loops and code holding a few frames at once don't see them reused
+    int64_t getNumPagedFloatSlots()
+    {
+        int64_t numThreads = 1;
+#ifdef CARET_OMP
+        numThreads = omp_get_max_threads();
+#endif
+        return max(int64_t(8), 2 * numThreads);
+    }
+}
+
 VolumeBase::VolumeStorage::VolumeStorage()
 {
     for (int i = 0; i < 5; ++i)
@@ -354,10 +387,15 @@ VolumeBase::VolumeStorage::VolumeStorage()
         m_dimensions[i] = 0;
         m_mult[i] = 0;
     }
+    m_paged = false;
+    m_maxNativeFrames = 0;
+    m_numNativeFrames = 0;
+    m_pageUseCounter = 0;
 }
 
 void VolumeBase::VolumeStorage::reinitialize(int64_t dims[5])
 {
+    clearPaging();
     for (int i = 0; i < 5; ++i)
     {
         CaretAssert(dims[i] > 0);//stop the debugger in the right place
@@ -372,20 +410,196 @@ void VolumeBase::VolumeStorage::reinitialize(int64_t dims[5])
     m_data.resize(m_mult[4]);
 }
 
+void VolumeBase::VolumeStorage::reinitializePaged(int64_t dims[5], const CaretPointer<AbstractFrameSource>& source, const int64_t& memoryLimit)
+{
+    CaretAssert(source != NULL);
+    clearPaging();
+    m_pageSource = source;
+    for (int i = 0; i < 5; ++i)
+    {
+        CaretAssert(dims[i] > 0);
+        if (dims[i] < 1) throw DataFileException("VolumeStorage dimensions must be positive");
+        m_dimensions[i] = dims[i];
+    }
+    m_mult[0] = m_dimensions[0];
+    for (int i = 1; i < 5; ++i)
+    {
+        m_mult[i] = m_mult[i - 1] * m_dimensions[i];
+    }
+    m_data.clear();
+    m_data.shrink_to_fit();
+    const int64_t numFrames = m_dimensions[3] * m_dimensions[4];
+    const int64_t numSlots = getNumPagedFloatSlots();
+    const int64_t nativeBytes = max(m_pageSource->getNativeFrameBytes(), int64_t(1));
+    const int64_t nativeBudget = memoryLimit - numSlots * m_mult[2] * (int64_t)sizeof(float);//converted frames count against the limit too
+    m_maxNativeFrames = max(int64_t(2), nativeBudget / nativeBytes);
+    m_nativeFrames.resize(numFrames);
+    m_nativeLastUse.resize(numFrames, -1);
+    m_numNativeFrames = 0;
+    m_floatSlots.resize(numSlots);
+    m_floatSlotFrame.resize(numSlots, -1);
+    m_floatSlotLastUse.resize(numSlots, -1);
+    m_pageUseCounter = 0;
+    m_paged = true;
+}
+
+void VolumeBase::VolumeStorage::clearPaging()
+{
+    m_pageSource.grabNew(NULL);
+    m_maxNativeFrames = 0;
+    m_nativeFrames.clear();
+    m_nativeLastUse.clear();
+    m_numNativeFrames = 0;
+    m_floatSlots.clear();
+    m_floatSlotFrame.clear();
+    m_floatSlotLastUse.clear();
+    m_pageUseCounter = 0;
+    m_paged = false;
+}
+
 VolumeBase::VolumeStorage::VolumeStorage(int64_t dims[5])
 {
+    m_paged = false;
+    m_maxNativeFrames = 0;
+    m_numNativeFrames = 0;
+    m_pageUseCounter = 0;
     reinitialize(dims);
 }
 
+const vector<char>& VolumeBase::VolumeStorage::getNativeFrame(const int64_t& frameIndex) const
+{//called with m_pageMutex locked
+    CaretAssertVectorIndex(m_nativeFrames, frameIndex);
+    m_nativeLastUse[frameIndex] = m_pageUseCounter++;
+    vector<char>& frame = m_nativeFrames[frameIndex];
+    if (!frame.empty()) return frame;
+    if (m_numNativeFrames >= m_maxNativeFrames)
+    {//a linear scan is nothing next to reading a frame from disk
+        int64_t oldest = -1;
+        for (int64_t i = 0; i < (int64_t)m_nativeFrames.size(); ++i)
+        {
+            if (i != frameIndex && !m_nativeFrames[i].empty() && (oldest == -1 || m_nativeLastUse[i] < m_nativeLastUse[oldest]))
+            {
+                oldest = i;
+            }
+        }
+        if (oldest != -1)
+        {
+            vector<char>().swap(m_nativeFrames[oldest]);
+            --m_numNativeFrames;
+        }
+    }
+    vector<char> newFrame(m_pageSource->getNativeFrameBytes());
+    m_pageSource->readNativeFrame(newFrame.data(), frameIndex % m_dimensions[3], frameIndex / m_dimensions[3]);
+    frame.swap(newFrame);
+    ++m_numNativeFrames;
+    CaretPerfTrace::addCount("volume frames read on demand");
+    return frame;
+}
+
+float VolumeBase::VolumeStorage::getPagedValue(const int64_t& index) const
+{//fallback for single voxels, loops over many voxels of a frame should use getFrame or getValues
+    CaretMutexLocker locked(&m_pageMutex);
+    if (!m_paged) return m_data[index];//another thread finished loadAllFrames while we waited
+    const vector<char>& frame = getNativeFrame(index / m_mult[2]);
+    float ret;
+    m_pageSource->convertNative(&ret, frame.data(), index % m_mult[2], 1);
+    return ret;
+}
+
+void VolumeBase::VolumeStorage::getPagedValues(const int64_t* indices, const int64_t& count, float* valuesOut) const
+{
+    CaretMutexLocker locked(&m_pageMutex);
+    if (!m_paged)
+    {
+        for (int64_t i = 0; i < count; ++i)
+        {
+            valuesOut[i] = m_data[indices[i]];
+        }
+        return;
+    }
+    int64_t lastFrame = -1;
+    const vector<char>* frame = NULL;
+    for (int64_t i = 0; i < count; ++i)
+    {
+        CaretAssert(indices[i] >= 0 && indices[i] < m_mult[4]);
+        const int64_t frameIndex = indices[i] / m_mult[2];
+        if (frameIndex != lastFrame)
+        {
+            frame = &getNativeFrame(frameIndex);
+            lastFrame = frameIndex;
+        }
+        m_pageSource->convertNative(valuesOut + i, frame->data(), indices[i] % m_mult[2], 1);
+    }
+}
+
+const float* VolumeBase::VolumeStorage::getPagedFrame(const int64_t& frameIndex) const
+{
+    CaretMutexLocker locked(&m_pageMutex);
+    if (!m_paged) return m_data.data() + frameIndex * m_mult[2];
+    int64_t slot = -1;
+    for (int64_t i = 0; i < (int64_t)m_floatSlots.size(); ++i)
+    {
+        if (m_floatSlotFrame[i] == frameIndex)
+        {
+            m_floatSlotLastUse[i] = m_pageUseCounter++;
+            return m_floatSlots[i].data();
+        }
+        if (slot == -1 || m_floatSlotLastUse[i] < m_floatSlotLastUse[slot]) slot = i;
+    }
+    const vector<char>& frame = getNativeFrame(frameIndex);
+    m_floatSlotFrame[slot] = -1;//in case conversion throws
+    m_floatSlots[slot].resize(m_mult[2]);
+    m_pageSource->convertNative(m_floatSlots[slot].data(), frame.data(), 0, m_mult[2]);
+    m_floatSlotFrame[slot] = frameIndex;
+    m_floatSlotLastUse[slot] = m_pageUseCounter++;
+    return m_floatSlots[slot].data();
+}
+
 const float* VolumeBase::VolumeStorage::getFrame(const int64_t brickIndex, const int64_t component) const
 {
+    if (m_paged)
+    {
+        CaretAssert(brickIndex >= 0 && brickIndex < m_dimensions[3]);
+        CaretAssert(component >= 0 && component < m_dimensions[4]);
+        return getPagedFrame(brickIndex + component * m_dimensions[3]);
+    }
     return m_data.data() + brickIndex * m_mult[2] + component * m_mult[3];//NOTE: do not use [4]
 }
 
+int64_t VolumeBase::VolumeStorage::getMinimumValidFrames() const
+{
+    if (m_paged) return (int64_t)m_floatSlots.size() - 1;
+    return m_dimensions[3] * m_dimensions[4];
+}
+
+void VolumeBase::VolumeStorage::loadAllFrames()
+{
+    if (!m_paged) return;
+    CaretMutexLocker locked(&m_pageMutex);//hold the lock for the whole promotion, so concurrent callers don't race on m_data
+    if (!m_paged) return;//another thread did it while we waited
+    vector<float> newData(m_mult[4]);
+    const int64_t numFrames = m_dimensions[3] * m_dimensions[4];
+    vector<char> scratch;
+    for (int64_t i = 0; i < numFrames; ++i)
+    {
+        if (!m_nativeFrames[i].empty())
+        {
+            m_pageSource->convertNative(newData.data() + i * m_mult[2], m_nativeFrames[i].data(), 0, m_mult[2]);
+        } else {//read the rest directly, without churning the cache
+            scratch.resize(m_pageSource->getNativeFrameBytes());
+            m_pageSource->readNativeFrame(scratch.data(), i % m_dimensions[3], i / m_dimensions[3]);
+            m_pageSource->convertNative(newData.data() + i * m_mult[2], scratch.data(), 0, m_mult[2]);
+        }
+    }
+    m_data.swap(newData);
+    clearPaging();//sets m_paged to false last, so unlocked readers never see unpaged mode before m_data is ready
+}
+
 void VolumeBase::VolumeStorage::setFrame(const float* frameIn, const int64_t brickIndex, const int64_t component)
 {
     CaretAssert(brickIndex >= 0 && brickIndex < m_dimensions[3]);
     CaretAssert(component >= 0 && component < m_dimensions[4]);
+    if (m_paged) loadAllFrames();
     int64_t start = brickIndex * m_mult[2] + component * m_mult[3];
     for (int64_t i = 0; i < m_mult[2]; ++i)
     {
@@ -395,6 +609,13 @@ void VolumeBase::VolumeStorage::setFrame(const float* frameIn, const int64_t bri
 
 void VolumeBase::VolumeStorage::setValueAllVoxels(const float value)
 {
+    if (m_paged)
+    {//every value is replaced, no need to read anything
+        CaretMutexLocker locked(&m_pageMutex);
+        m_data.resize(m_mult[4]);
+        clearPaging();
+    }
+    m_data.resize(m_mult[4]);
     for (int64_t i = 0; i < m_mult[4]; ++i)
     {
         m_data[i] = value;
@@ -409,6 +630,20 @@ void VolumeBase::VolumeStorage::swap(VolumeStorage& rhs)
         std::swap(m_dimensions[i], rhs.m_dimensions[i]);
         std::swap(m_mult[i], rhs.m_mult[i]);
     }
+    const bool tempPaged = m_paged;//the mutexes stay where they are, neither storage may be in use while swapping
+    m_paged = rhs.m_paged.load();
+    rhs.m_paged = tempPaged;
+    CaretPointer<AbstractFrameSource> tempSource = m_pageSource;
+    m_pageSource = rhs.m_pageSource;
+    rhs.m_pageSource = tempSource;
+    std::swap(m_maxNativeFrames, rhs.m_maxNativeFrames);
+    m_nativeFrames.swap(rhs.m_nativeFrames);
+    m_nativeLastUse.swap(rhs.m_nativeLastUse);
+    std::swap(m_numNativeFrames, rhs.m_numNativeFrames);
+    m_floatSlots.swap(rhs.m_floatSlots);
+    m_floatSlotFrame.swap(rhs.m_floatSlotFrame);
+    m_floatSlotLastUse.swap(rhs.m_floatSlotLastUse);
+    std::swap(m_pageUseCounter, rhs.m_pageUseCounter);
 }
 
 void VolumeBase::VolumeStorage::getDimensions(vector<int64_t>& dimOut) const
@@ -438,6 +673,7 @@ vector<int64_t> VolumeBase::VolumeStorage::getDimensions() const
 
 void VolumeBase::VolumeStorage::clear()
 {
+    clearPaging();
     m_data.clear();
     for (int i = 0; i < 5; ++i)
     {
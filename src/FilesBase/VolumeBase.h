@@ -23,8 +23,10 @@
 /*LICENSE_END*/
 
 #include "stdint.h"
+#include <atomic>
 #include <vector>
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 #include "CaretPointer.h"
 #include "VolumeMappableInterface.h"
 #include "VolumeSpace.h"
@@ -44,6 +46,18 @@ namespace caret {
         virtual ~AbstractHeader();
     };
     
+    ///where a paged volume gets its frames, frames are kept in memory in the source's own datatype, and converted to float when used
+    struct AbstractFrameSource
+    {
+        ///bytes of one frame in the source's datatype
+        virtual int64_t getNativeFrameBytes() const = 0;
+        ///must be safe to call from multiple threads at once
+        virtual void readNativeFrame(char* nativeOut, const int64_t& brickIndex, const int64_t& component) = 0;
+        ///convert count values of a frame from readNativeFrame, starting at element offset
+        virtual void convertNative(float* dataOut, const char* nativeFrame, const int64_t& offset, const int64_t& count) const = 0;
+        virtual ~AbstractFrameSource();
+    };
+    
     class VolumeBase : public VolumeMappableInterface
     {
         class VolumeStorage
@@ -51,12 +65,34 @@ namespace caret {
             std::vector<float> m_data;
             int64_t m_dimensions[5];//store internally as 4d+component
             int64_t m_mult[5];//precalculated multipliers for getIndex/getValue/setValue - NOTE: [0] is for index[1], [4] is the entire size of the data
+            //paged mode: m_data is empty, frames are read from m_pageSource when used, and the least recently used are dropped
+            std::atomic<bool> m_paged;//only set to false with m_pageMutex locked, after m_data is filled
+            CaretPointer<AbstractFrameSource> m_pageSource;
+            int64_t m_maxNativeFrames;
+            mutable CaretMutex m_pageMutex;//protects everything below
+            mutable std::vector<std::vector<char> > m_nativeFrames;//indexed by brick + component * dims[3], empty when not in memory
+            mutable std::vector<int64_t> m_nativeLastUse;
+            mutable int64_t m_numNativeFrames;
+            mutable std::vector<std::vector<float> > m_floatSlots;//converted frames handed out by getFrame
+            mutable std::vector<int64_t> m_floatSlotFrame, m_floatSlotLastUse;
+            mutable int64_t m_pageUseCounter;
+            const std::vector<char>& getNativeFrame(const int64_t& frameIndex) const;//call with m_pageMutex locked
+            float getPagedValue(const int64_t& index) const;
+            void getPagedValues(const int64_t* indices, const int64_t& count, float* valuesOut) const;
+            const float* getPagedFrame(const int64_t& frameIndex) const;
+            void clearPaging();
             VolumeStorage(const VolumeStorage& rhs);//deny copy, assignment for now
             VolumeStorage& operator=(const VolumeStorage& rhs);
         public:
             VolumeStorage();
             VolumeStorage(int64_t dims[5]);
             void reinitialize(int64_t dims[5]);
+            ///memoryLimit counts frames in the source's datatype plus the converted frames from getFrame
+            void reinitializePaged(int64_t dims[5], const CaretPointer<AbstractFrameSource>& source, const int64_t& memoryLimit);
+            ///read all frames and go back to normal storage, called automatically by anything that modifies the data
+            ///safe to call from multiple threads, but invalidates pointers previously returned by getFrame
+            void loadAllFrames();
+            bool isPaged() const { return m_paged; }
             void clear();
             
             virtual void getDimensions(std::vector<int64_t>& dimOut) const;//NOTE: always returns a vector of 5 elements
@@ -70,16 +106,32 @@ namespace caret {
             void swap(VolumeStorage& rhs);
             
             ///get a value at three indexes and optionally timepoint
-            inline const float& getValue(const int64_t& indexIn1, const int64_t& indexIn2, const int64_t& indexIn3, const int64_t brickIndex, const int64_t component) const
+            inline float getValue(const int64_t& indexIn1, const int64_t& indexIn2, const int64_t& indexIn3, const int64_t brickIndex, const int64_t component) const
             {
                 CaretAssert(indexValid(indexIn1, indexIn2, indexIn3, brickIndex, component));//assert so release version isn't slowed by checking
+                if (m_paged) return getPagedValue(getIndex(indexIn1, indexIn2, indexIn3, brickIndex, component));
                 return m_data[getIndex(indexIn1, indexIn2, indexIn3, brickIndex, component)];
             }
-            inline const float& getValue(const int64_t indexIn[3], const int64_t brickIndex, const int64_t component) const
+            inline float getValue(const int64_t indexIn[3], const int64_t brickIndex, const int64_t component) const
             {
                 return getValue(indexIn[0], indexIn[1], indexIn[2], brickIndex, component);
             }
             
+            ///get values at several indexes from getIndex, when paged this locks only once for all of them
+            inline void getValues(const int64_t* indices, const int64_t& count, float* valuesOut) const
+            {
+                if (m_paged)
+                {
+                    getPagedValues(indices, count, valuesOut);
+                    return;
+                }
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    CaretAssertVectorIndex(m_data, indices[i]);
+                    valuesOut[i] = m_data[indices[i]];
+                }
+            }
+            
             ///gets index into data array for three indexes plus time index
             inline int64_t getIndex(const int64_t& indexIn1, const int64_t& indexIn2, const int64_t& indexIn3, const int64_t brickIndex, const int64_t component) const
             {
@@ -110,6 +162,7 @@ namespace caret {
             inline void setValue(const float& valueIn, const int64_t& indexIn1, const int64_t& indexIn2, const int64_t& indexIn3, const int64_t brickIndex, const int64_t component)
             {
                 CaretAssert(indexValid(indexIn1, indexIn2, indexIn3, brickIndex, component));//assert so release version isn't slowed by checking
+                if (m_paged) loadAllFrames();
                 m_data[getIndex(indexIn1, indexIn2, indexIn3, brickIndex, component)] = valueIn;
             }
             inline void setValue(const float& valueIn, const int64_t indexIn[3], const int64_t brickIndex, const int64_t component)
@@ -120,8 +173,9 @@ namespace caret {
             /// set every voxel to the given value
             void setValueAllVoxels(const float value);
             
-            ///get a frame (const)
+            ///get a frame (const), when paged, the pointer is valid until getFrame has been called for getMinimumValidFrames() other frames
             const float* getFrame(const int64_t brickIndex = 0, const int64_t component = 0) const;
+            int64_t getMinimumValidFrames() const;
             
             ///set a frame
             void setFrame(const float* frameIn, const int64_t brickIndex = 0, const int64_t component = 0);
@@ -131,6 +185,7 @@ namespace caret {
         VolumeSpace m_volSpace;
         std::vector<int64_t> m_origDims;//keep track of the original dimensions
         bool m_ModifiedFlag;
+        void setupDimensions(const std::vector<int64_t>& dimensionsIn, const std::vector<std::vector<float> >& indexToSpace, const int64_t numComponents, int64_t storeDims[5]);
         
     protected:
         VolumeBase();
@@ -138,6 +193,9 @@ namespace caret {
         ///recreates the volume file storage with new size and spacing
         void reinitialize(const std::vector<int64_t>& dimensionsIn, const std::vector<std::vector<float> >& indexToSpace, const int64_t numComponents = 1);
         
+        ///like reinitialize with one component, but frames are read from source (takes ownership) when they are used, and about memoryLimit bytes of them are kept in memory
+        void reinitializePaged(const std::vector<int64_t>& dimensionsIn, const std::vector<std::vector<float> >& indexToSpace, AbstractFrameSource* source, const int64_t& memoryLimit);
+        
         void addSubvolumes(const int64_t& numToAdd);
         
     public:
@@ -218,13 +276,13 @@ namespace caret {
         inline const VolumeSpace& getVolumeSpace() const { return m_volSpace; }
 
         ///get a value at an index triplet and optionally timepoint
-        inline const float& getValue(const int64_t* indexIn, const int64_t brickIndex = 0, const int64_t component = 0) const
+        inline float getValue(const int64_t* indexIn, const int64_t brickIndex = 0, const int64_t component = 0) const
         {
             return m_storage.getValue(indexIn[0], indexIn[1], indexIn[2], brickIndex, component);
         }
         
         ///get a value at three indexes and optionally timepoint
-        inline const float& getValue(const int64_t& indexIn1, const int64_t& indexIn2, const int64_t& indexIn3, const int64_t brickIndex = 0, const int64_t component = 0) const
+        inline float getValue(const int64_t& indexIn1, const int64_t& indexIn2, const int64_t& indexIn3, const int64_t brickIndex = 0, const int64_t component = 0) const
         {
             return m_storage.getValue(indexIn1, indexIn2, indexIn3, brickIndex, component);
         }
@@ -308,9 +366,22 @@ namespace caret {
             return 0.0;
         }
         
-        ///get a frame (const)
+        ///get values at several indexes from getIndex, for paged volumes this is much cheaper than calling getValue for each
+        inline void getValues(const int64_t* indices, const int64_t& count, float* valuesOut) const
+        {
+            m_storage.getValues(indices, count, valuesOut);
+        }
+        
+        ///get a frame (const), for paged volumes see getMinimumValidFrames()
         const float* getFrame(const int64_t brickIndex = 0, const int64_t component = 0) const { return m_storage.getFrame(brickIndex, component); }
         
+        ///true if frames are read from the file when they are used, rather than all being in memory
+        bool isPaged() const { return m_storage.isPaged(); }
+        ///for paged volumes, the number of other frames that can be requested before a pointer from getFrame becomes invalid
+        int64_t getMinimumValidFrames() const { return m_storage.getMinimumValidFrames(); }
+        ///read all frames of a paged volume into memory, called automatically before anything modifies voxels
+        void loadAllFrames() { m_storage.loadAllFrames(); }
+        
         ///set a value at an index triplet and optionally timepoint
         inline void setValue(const float& valueIn, const int64_t* indexIn, const int64_t brickIndex = 0, const int64_t component = 0)
         {
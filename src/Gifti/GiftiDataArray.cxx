@@ -577,9 +577,12 @@ GiftiDataArray::transferLabelIndices(const std::map<int32_t,int32_t>& indexConve
 /**
  * read a GIFTI data array from text.
  * Data array should already be initialized and allocated.
+ * The text is the UTF-8 content of the Data element, it does
+ * not need to be null terminated.
  */
 void 
-GiftiDataArray::readFromText(const AString text,
+GiftiDataArray::readFromText(const char* text,
+                             const int64_t textLength,
                              const GiftiEndianEnum::Enum dataEndianForReading,
                              const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
                              const NiftiDataTypeEnum::Enum dataTypeForReading,
@@ -613,7 +616,7 @@ GiftiDataArray::readFromText(const AString text,
       switch (encoding) {
           case GiftiEncodingEnum::ASCII:
             {
-                std::istringstream stream(text.toStdString());
+                std::istringstream stream(std::string(text, textLength));
                 
                switch (dataType) {
                   case NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32:
@@ -656,13 +659,13 @@ GiftiDataArray::readFromText(const AString text,
           case GiftiEncodingEnum::BASE64_BINARY:
             {
                //
-               // Decode the Base64 data using VTK's algorithm
+               // Decode the Base64 data directly into the array
                //
                const uint64_t numDecoded =
-                     Base64::decode((const unsigned char*)(text.toStdString().c_str()),
-                                                data.size(),
-                                                &data[0],
-                                                text.size());
+                     Base64::decodeStream(text,
+                                          textLength,
+                                          &data[0],
+                                          data.size());
                if (numDecoded != data.size()) {
                   std::ostringstream str;
                   str << "Decoding of Base64 Binary data failed.\n"
@@ -682,15 +685,14 @@ GiftiDataArray::readFromText(const AString text,
           case GiftiEncodingEnum::GZIP_BASE64_BINARY:
             {
                //
-               // Decode the Base64 data using VTK's algorithm
+               // Decode the Base64 data
                //
-               std::vector<unsigned char> dataBuffer(text.size() - text.size() / 4 + 10);//generous constant to make up for integer rounding
-               //const char* textChars = text.toLatin1().constData();
+               std::vector<unsigned char> dataBuffer(textLength - textLength / 4 + 10);//generous constant to make up for integer rounding
                const uint64_t numDecoded =
-                     Base64::decode((unsigned char*)text.toStdString().c_str(),
-                                                dataBuffer.size(),
-                                                dataBuffer.data(),
-                                                text.size());
+                     Base64::decodeStream(text,
+                                          textLength,
+                                          dataBuffer.data(),
+                                          dataBuffer.size());
                if (numDecoded == 0) {
                    std::ostringstream str;
                    str << "Decoding of GZip Base64 Binary data failed."
@@ -112,8 +112,9 @@ namespace caret {
         // get data offset 
         //int64_t getDataOffset(const int64_t nodeNum, const int64_t componentNum) const;//TSC: implementation was wrong, commenting out for now
         
-        // read a data array from text
-        void readFromText(const AString text,
+        // read a data array from the text of its Data element
+        void readFromText(const char* text,
+                          const int64_t textLength,
                           const GiftiEndianEnum::Enum dataEndianForReading,
                           const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
                           const NiftiDataTypeEnum::Enum dataTypeForReading,
@@ -26,6 +26,7 @@
 #include "CaretAssert.h"
 #include "CaretHierarchy.h"
 #include "CaretLogger.h"
+#include "CaretPerfTrace.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
 #include "GiftiEncodingEnum.h"
@@ -41,6 +42,7 @@
 
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 
 using namespace caret;
 
@@ -845,6 +847,7 @@ GiftiFile::removeDataArray(const GiftiDataArray* arrayPointer)
 void
 GiftiFile::readFile(const AString& filename)
 {
+    CARET_PERF_SCOPE("gifti read");
     this->clear();
     this->setFileName(filename);
     
@@ -874,6 +877,7 @@ GiftiFile::readFile(const AString& filename)
         throw DataFileException(filename,
                                 AString::fromStdString(str.str()));
     }
+    if (CaretPerfTrace::isEnabled()) CaretPerfTrace::addBytesRead(filename, QFileInfo(filename).size());//the xml parser reads the file itself
     
     /*
      * If any maps are missing names, give them default names.
@@ -910,6 +914,7 @@ GiftiFile::readFile(const AString& filename)
 void 
 GiftiFile::writeFile(const AString& filename)
 {
+    CARET_PERF_SCOPE("gifti write");
     try {
         this->setFileName(filename);
         
@@ -950,6 +955,7 @@ GiftiFile::writeFile(const AString& filename)
         // Finish writing the file
         //
         giftiFileWriter.finish();
+        if (CaretPerfTrace::isEnabled()) CaretPerfTrace::addBytesWritten(filename, QFileInfo(filename).size());
     }
     catch (const GiftiException& e) {
         throw DataFileException(filename,
@@ -21,6 +21,7 @@
 #include <sstream>
 
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "FileInformation.h"
 #include "GiftiEndianEnum.h"
 #include "GiftiLabel.h"
@@ -50,6 +51,7 @@ GiftiFileSaxReader::GiftiFileSaxReader(GiftiFile* giftiFileIn)
     this->labelTableSaxReader = NULL;
     this->metaDataSaxReader = NULL;
     this->dataArrayDataHasBeenRead = false;
+    this->pendingArrayDataBytes = 0;
 }
 
 /**
@@ -214,6 +216,7 @@ GiftiFileSaxReader::startElement(const AString& namespaceURI,
    stateStack.push(previousState);
    
    elementText = "";
+   dataElementText.clear();
 }
 
 /**
@@ -228,6 +231,7 @@ GiftiFileSaxReader::endElement(const AString& namespaceURI,
       case STATE_NONE:
          break;
       case STATE_GIFTI:
+         this->decodePendingArrayData();
          break;
       case STATE_METADATA:
            this->metaDataSaxReader->endElement(namespaceURI, localName, qName);
@@ -295,6 +299,7 @@ GiftiFileSaxReader::endElement(const AString& namespaceURI,
    // Clear out for new elements
    //
    this->elementText = "";
+   this->dataElementText.clear();
    
    //
    // Go to previous state
@@ -506,8 +511,19 @@ GiftiFileSaxReader::createDataArray(const XmlAttributes& attributes)
     dataArrayDataHasBeenRead = false;
 }
 
+namespace {
+    /*
+     * Data element text kept for decoding in parallel before it is
+     * decoded regardless, limits the memory used by large files
+     */
+    const int64_t MAXIMUM_PENDING_ARRAY_DATA_BYTES = 256 * 1024 * 1024;
+}
+
 /**
  * process the array data into numbers.
+ * Encoded data is only saved here, the arrays of a file
+ * are decoded together by decodePendingArrayData(),
+ * since decoding is independent for each array.
  */
 void 
 GiftiFileSaxReader::processArrayData()
@@ -515,8 +531,34 @@ GiftiFileSaxReader::processArrayData()
     this->dataArrayDataHasBeenRead = true;
 
     CaretAssert(dataArray);
+    switch (this->encodingForReadingArrayData) {
+        case GiftiEncodingEnum::ASCII:
+        case GiftiEncodingEnum::BASE64_BINARY:
+        case GiftiEncodingEnum::GZIP_BASE64_BINARY:
+            if ( ! this->giftiFile->getReadMetaDataOnlyFlag()) {
+                PendingArrayData pending;
+                pending.dataArray = dataArray.getPointer();
+                pending.text.swap(dataElementText);
+                pending.endian = this->endianForReadingArrayData;
+                pending.arraySubscriptingOrder = arraySubscriptingOrderForReadingArrayData;
+                pending.dataType = dataTypeForReadingArrayData;
+                pending.dimensions = dimensionsForReadingArrayData;
+                pending.encoding = encodingForReadingArrayData;
+                pendingArrayDataBytes += pending.text.size();
+                pendingArrayData.push_back(std::move(pending));
+                if (pendingArrayDataBytes > MAXIMUM_PENDING_ARRAY_DATA_BYTES) {
+                    decodePendingArrayData();
+                }
+                return;
+            }
+            break;
+        case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
+            break;
+    }
+    
     try {
-        dataArray->readFromText(elementText,
+        dataArray->readFromText(dataElementText.data(),
+                                dataElementText.size(),
                                 this->endianForReadingArrayData,
                                 arraySubscriptingOrderForReadingArrayData,
                                 dataTypeForReadingArrayData,
@@ -531,6 +573,54 @@ GiftiFileSaxReader::processArrayData()
     }
 }
 
+/**
+ * decode the data of arrays saved by processArrayData(), one array per thread.
+ * The arrays are owned by the GIFTI file (or by this reader for the array
+ * currently being read), they are not accessed by anything else while
+ * the file is being read.
+ */
+void
+GiftiFileSaxReader::decodePendingArrayData()
+{
+    const int64_t numPending = pendingArrayData.size();
+    if (numPending == 0) {
+        return;
+    }
+    
+    std::vector<AString> errorMessages(numPending);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numPending; i++) {
+        PendingArrayData& pending = pendingArrayData[i];
+        try {
+            pending.dataArray->readFromText(pending.text.data(),
+                                            pending.text.size(),
+                                            pending.endian,
+                                            pending.arraySubscriptingOrder,
+                                            pending.dataType,
+                                            pending.dimensions,
+                                            pending.encoding,
+                                            "",
+                                            0,
+                                            false);
+        }
+        catch (const CaretException& e) {
+            errorMessages[i] = e.whatString();
+        }
+        catch (const std::exception& e) {
+            errorMessages[i] = e.what();
+        }
+        std::string().swap(pending.text);
+    }
+    pendingArrayData.clear();
+    pendingArrayDataBytes = 0;
+    
+    for (int64_t i = 0; i < numPending; i++) {
+        if ( ! errorMessages[i].isEmpty()) {
+            throw XmlSaxParserException(errorMessages[i]);
+        }
+    }
+}
+
 /**
  * get characters in an element.
  */
@@ -543,6 +633,9 @@ GiftiFileSaxReader::characters(const char* ch)
     else if (this->labelTableSaxReader != NULL) {
         this->labelTableSaxReader->characters(ch);
     }
+    else if (this->state == STATE_DATA_ARRAY_DATA) {
+        dataElementText += ch;
+    }
     else {
         elementText += ch;
     }
@@ -594,5 +687,6 @@ GiftiFileSaxReader::startDocument()
 void 
 GiftiFileSaxReader::endDocument()
 {
+    this->decodePendingArrayData();
 }
 
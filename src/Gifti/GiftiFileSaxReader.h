@@ -23,6 +23,8 @@
 /*LICENSE_END*/
 
 #include <stack>
+#include <string>
+#include <vector>
 #include <AString.h>
 #include <stdint.h>
 
@@ -103,6 +105,9 @@ namespace caret {
         // process the array data into numbers
         void processArrayData();
         
+        // decode the data of arrays that were deferred by processArrayData()
+        void decodePendingArrayData();
+        
         // create a data array
         void createDataArray(const XmlAttributes& attributes);
         
@@ -121,6 +126,26 @@ namespace caret {
         /// element text
         AString elementText;
         
+        /// text of a data array's Data element, kept as the parser's UTF-8 so it is never converted
+        std::string dataElementText;
+        
+        /// Data element text of an array that is decoded later, along with other arrays
+        struct PendingArrayData {
+            GiftiDataArray* dataArray;
+            std::string text;
+            GiftiEndianEnum::Enum endian;
+            GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrder;
+            NiftiDataTypeEnum::Enum dataType;
+            std::vector<int64_t> dimensions;
+            GiftiEncodingEnum::Enum encoding;
+        };
+        
+        /// arrays whose data has not been decoded yet
+        std::vector<PendingArrayData> pendingArrayData;
+        
+        /// size of the text in pendingArrayData
+        int64_t pendingArrayDataBytes;
+        
         /// GIFTI data array being read
         CaretPointer<GiftiDataArray> dataArray;
         
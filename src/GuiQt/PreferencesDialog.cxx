@@ -602,6 +602,22 @@ PreferencesDialog::createMiscellaneousWidget()
     QObject::connect(m_fileOpenFromOpSysTypeComboBox, &EnumComboBoxTemplate::itemActivated,
                      this, &PreferencesDialog::miscFileOpenFromOpSysTypeComboBoxItemActivated);
     
+    /*
+     * Memory for rows read from dense connectivity files
+     */
+    m_connectivityRowCacheSpinBox = WuQFactory::newSpinBoxWithMinMaxStepSignalInt(0,
+                                                                                  1048576,
+                                                                                  128,
+                                                                                  this,
+                                                                                  SLOT(miscConnectivityRowCacheValueChanged(int)));
+    m_connectivityRowCacheSpinBox->setSuffix(" MB");
+    WuQtUtilities::setWordWrappedToolTip(m_connectivityRowCacheSpinBox,
+                                         "Memory used to keep rows read from dense connectivity files that are not "
+                                         "loaded into memory.  Rows of neighboring and recently identified vertices "
+                                         "are read in the background so that they display without waiting for the "
+                                         "disk.  Zero disables the cache.  Applies to files opened after a change.");
+    m_allWidgets->add(m_connectivityRowCacheSpinBox);
+    
     m_volumeSurfaceOutlineSeparationSpinBox = new QDoubleSpinBox();
     m_volumeSurfaceOutlineSeparationSpinBox->setRange(0.0, 10000.0);
     m_volumeSurfaceOutlineSeparationSpinBox->setSingleStep(0.01);
@@ -647,6 +663,9 @@ PreferencesDialog::createMiscellaneousWidget()
     addWidgetToLayout(gridLayout,
                       "Display Cross at Histology/Volume Center",
                       m_crossAtViewportCenterEnabledComboBox->getWidget());
+    addWidgetToLayout(gridLayout,
+                      "Dense Connectivity Row Cache: ",
+                      m_connectivityRowCacheSpinBox);
     addWidgetsToLayout(gridLayout,
                        new QLabel("Volume Surface Outline Separation"),
                        m_volumeSurfaceOutlineSeparationSpinBox,
@@ -690,6 +709,8 @@ PreferencesDialog::updateMiscellaneousWidget(CaretPreferences* prefs)
     
     m_crossAtViewportCenterEnabledComboBox->setStatus(prefs->isCrossAtViewportCenterEnabled());
     
+    m_connectivityRowCacheSpinBox->setValue(prefs->getConnectivityRowCacheMegabytes());
+    
     updateMiscellaneousSceneSeparationControls();
 }
 
@@ -1618,6 +1639,19 @@ PreferencesDialog::miscFileOpenFromOpSysTypeComboBoxItemActivated()
     CaretPreferences* prefs = SessionManager::get()->getCaretPreferences();
     prefs->setFileOpenFromOpSysType(openType);
 }
+/**
+ * Called when the dense connectivity row cache size is changed.
+ *
+ * @param value
+ *     New size in megabytes.
+ */
+void
+PreferencesDialog::miscConnectivityRowCacheValueChanged(int value)
+{
+    CaretPreferences* prefs = SessionManager::get()->getCaretPreferences();
+    prefs->setConnectivityRowCacheMegabytes(value);
+}
+
 /**
  * Gets called when view files type is changed.
  */
@@ -68,6 +68,7 @@ namespace caret {
         void miscDynamicConnectivityComboBoxChanged(bool value);
         void miscWindowToolBarWidthModeComboBoxItemActivated();
         void miscFileOpenFromOpSysTypeComboBoxItemActivated();
+        void miscConnectivityRowCacheValueChanged(int value);
         void openGLDrawingMethodEnumComboBoxItemActivated();
         void openGLImageCaptureMethodEnumComboBoxItemActivated();
         void openGLGraphicsTimingComboBoxToggled(bool value);
@@ -182,6 +183,7 @@ namespace caret {
         EnumComboBoxTemplate* m_windowToolBarWidthModeComboBox;
         EnumComboBoxTemplate* m_fileOpenFromOpSysTypeComboBox;
         WuQTrueFalseComboBox* m_crossAtViewportCenterEnabledComboBox;
+        QSpinBox* m_connectivityRowCacheSpinBox;
         QDoubleSpinBox* m_volumeSurfaceOutlineSeparationSpinBox;
         QCheckBox* m_volumeSurfaceOutlineSeparationSceneCheckBox;
         
@@ -2904,7 +2904,19 @@ SceneDialog::displayScenePrivateWithErrorMessage(SceneFile* sceneFile,
     
     const AString sceneFileName = sceneFile->getFileName();
     
+    /*
+     * Keep the scene's classes in memory while they are restored
+     */
+    Scene::SceneBeingRestoredScoped sceneBeingRestored(scene);
+    
     const SceneClass* guiManagerClass = scene->getClassWithName("guiManager");
+    if (guiManagerClass == NULL) {
+        errorMessageOut = ("Scene \""
+                           + scene->getName()
+                           + "\" is missing its guiManager class.  The scene file may have been "
+                           "modified or could not be read.");
+        return false;
+    }
     if (guiManagerClass->getName() != "guiManager") {
         errorMessageOut = ("Top level scene class should be guiManager but it is: "
                            + guiManagerClass->getName());
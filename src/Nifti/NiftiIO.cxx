@@ -74,7 +74,7 @@ int NiftiIO::getNumComponents() const
     return m_header.getNumComponents();
 }
 
-int NiftiIO::numBytesPerElem()
+int NiftiIO::numBytesPerElem() const
 {
     switch (m_header.getDataType())
     {
@@ -108,3 +108,53 @@ int NiftiIO::numBytesPerElem()
             throw DataFileException("internal error, report what you did to the developers");
     }
 }
+
+void NiftiIO::readNative(char* dataOut, const int& fullDims, const vector<int64_t>& indexSelect)
+{
+    CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
+    CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());
+    int64_t numElems = getNumComponents();
+    int curDim;
+    for (curDim = 0; curDim < fullDims; ++curDim)
+    {
+        numElems *= m_dims[curDim];
+    }
+    int64_t numDimSkip = numElems, numSkip = 0;
+    for (; curDim < (int)m_dims.size(); ++curDim)
+    {
+        CaretAssert(indexSelect[curDim - fullDims] >= 0 && indexSelect[curDim - fullDims] < m_dims[curDim]);
+        numSkip += indexSelect[curDim - fullDims] * numDimSkip;
+        numDimSkip *= m_dims[curDim];
+    }
+    const int64_t numBytes = numElems * numBytesPerElem();
+    {//no scratch needed, but seek and read must not be interleaved with other threads
+        CaretMutexLocker locked(&m_mutex);
+        m_file.seek(numSkip * numBytesPerElem() + m_header.getDataOffset());
+        int64_t numRead = 0;
+        m_file.read(dataOut, numBytes, &numRead);
+        if (numRead != numBytes)
+        {
+            throw DataFileException("error while reading from nifti file '" + m_file.getFilename() + "'");
+        }
+    }
+    if (m_header.isSwapped())
+    {
+        switch (numBytesPerElem())
+        {
+            case 1:
+                break;
+            case 2:
+                ByteSwapping::swapArray((uint16_t*)dataOut, numElems);
+                break;
+            case 4:
+                ByteSwapping::swapArray((uint32_t*)dataOut, numElems);
+                break;
+            case 8:
+                ByteSwapping::swapArray((uint64_t*)dataOut, numElems);
+                break;
+            default://same as what convertFromScratch does with long double
+                ByteSwapping::swapArray((long double*)dataOut, numElems);
+                break;
+        }
+    }
+}
@@ -30,7 +30,9 @@
 
 #include <QString>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <limits>
 #include <vector>
 
@@ -44,10 +46,13 @@ namespace caret
         std::vector<int64_t> m_dims;
         std::vector<char> m_scratch;//scratch memory for byteswapping, type conversion, etc
         CaretMutex m_mutex;//protect multithreaded calls from each other
-        int numBytesPerElem();//for resizing scratch
         template<typename TO, typename FROM>
         void convertRead(TO* out, FROM* in, const int64_t& count);//for reading from file
         template<typename TO, typename FROM>
+        void convertValues(TO* out, const FROM* in, const int64_t& count) const;//scaling and rounding only, input must already be in machine byte order
+        template<typename T>
+        void convertFromScratch(T* dataOut, const int64_t& numElems);//converts the start of m_scratch based on the header datatype, call with mutex locked
+        template<typename TO, typename FROM>
         void convertWrite(TO* out, const FROM* in, const int64_t& count);//for writing to file
         template<typename TO, typename FROM>
         static TO clamp(const FROM& in);//deal with integer cast being undefined when converting from outside range
@@ -67,6 +72,17 @@ namespace caret
         void readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false);
         template<typename T>
         void writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect);
+        //read count elements starting at element index start, each stride elements apart (indexes treat the data as 1D), for single-component types only
+        //nearby elements are read in batches, so this is much faster than calling readData per element
+        template<typename T>
+        void readStrided(T* dataOut, const int64_t& start, const int64_t& count, const int64_t& stride);
+        //read the same selection as readData, but leave the values in the file's datatype (byteswapped to machine order, not scaled), for keeping large files in memory at their on-disk size
+        //dataOut needs room for the number of elements times numBytesPerElem(), use convertNative to get values
+        void readNative(char* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect);
+        //convert count elements of readNative output to T, applying the header scaling, does not use the file, so it can run concurrently with reading
+        template<typename T>
+        void convertNative(T* dataOut, const char* nativeIn, const int64_t& count) const;
+        int numBytesPerElem() const;
     };
     
     template<typename T>
@@ -98,6 +114,46 @@ namespace caret
         {
             throw DataFileException("error while reading from nifti file '" + m_file.getFilename() + "'");
         }
+        convertFromScratch(dataOut, numElems);
+    }
+    
+    template<typename T>
+    void NiftiIO::readStrided(T* dataOut, const int64_t& start, const int64_t& count, const int64_t& stride)
+    {
+        CaretAssert(getNumComponents() == 1);
+        CaretAssert(start >= 0 && count >= 0 && stride >= 1);
+        if (count == 0) return;
+        const int64_t READ_BUDGET = 1 << 22;//don't read more than 4MB at a time
+        const int64_t MAX_GAP = 1 << 16;//beyond this, seeking past the gap is cheaper than reading it
+        CaretMutexLocker locked(&m_mutex);
+        const int64_t elemBytes = numBytesPerElem(), strideBytes = stride * elemBytes;
+        int64_t perRead = 1;//for large strides, elements are in different pages anyway, so read them separately
+        if (strideBytes <= MAX_GAP)
+        {
+            perRead = std::max(int64_t(1), READ_BUDGET / strideBytes);
+        }
+        m_scratch.resize(((std::min(perRead, count) - 1) * stride + 1) * elemBytes);
+        for (int64_t base = 0; base < count; base += perRead)
+        {
+            const int64_t thisCount = std::min(perRead, count - base), spanBytes = ((thisCount - 1) * stride + 1) * elemBytes;
+            m_file.seek((start + base * stride) * elemBytes + m_header.getDataOffset());
+            int64_t numRead = 0;
+            m_file.read(m_scratch.data(), spanBytes, &numRead);
+            if (numRead != spanBytes)
+            {
+                throw DataFileException("error while reading from nifti file '" + m_file.getFilename() + "'");
+            }
+            for (int64_t i = 1; i < thisCount; ++i)//pack the wanted elements to the front, destination is always before the source
+            {
+                memmove(m_scratch.data() + i * elemBytes, m_scratch.data() + i * strideBytes, elemBytes);
+            }
+            convertFromScratch(dataOut + base, thisCount);
+        }
+    }
+    
+    template<typename T>
+    void NiftiIO::convertFromScratch(T* dataOut, const int64_t& numElems)
+    {
         switch (m_header.getDataType())
         {
             case NIFTI_TYPE_UINT8:
@@ -211,6 +267,54 @@ namespace caret
         m_file.write(m_scratch.data(), m_scratch.size());
     }
     
+    template<typename T>
+    void NiftiIO::convertNative(T* dataOut, const char* nativeIn, const int64_t& count) const
+    {
+        switch (m_header.getDataType())
+        {
+            case NIFTI_TYPE_UINT8:
+            case NIFTI_TYPE_RGB24:
+                convertValues(dataOut, (const uint8_t*)nativeIn, count);
+                break;
+            case NIFTI_TYPE_INT8:
+                convertValues(dataOut, (const int8_t*)nativeIn, count);
+                break;
+            case NIFTI_TYPE_UINT16:
+                convertValues(dataOut, (const uint16_t*)nativeIn, count);
+                break;
+            case NIFTI_TYPE_INT16:
+                convertValues(dataOut, (const int16_t*)nativeIn, count);
+                break;
+            case NIFTI_TYPE_UINT32:
+                convertValues(dataOut, (const uint32_t*)nativeIn, count);
+                break;
+            case NIFTI_TYPE_INT32:
+                convertValues(dataOut, (const int32_t*)nativeIn, count);
+                break;
+            case NIFTI_TYPE_UINT64:
+                convertValues(dataOut, (const uint64_t*)nativeIn, count);
+                break;
+            case NIFTI_TYPE_INT64:
+                convertValues(dataOut, (const int64_t*)nativeIn, count);
+                break;
+            case NIFTI_TYPE_FLOAT32:
+            case NIFTI_TYPE_COMPLEX64:
+                convertValues(dataOut, (const float*)nativeIn, count);
+                break;
+            case NIFTI_TYPE_FLOAT64:
+            case NIFTI_TYPE_COMPLEX128:
+                convertValues(dataOut, (const double*)nativeIn, count);
+                break;
+            case NIFTI_TYPE_FLOAT128:
+            case NIFTI_TYPE_COMPLEX256:
+                convertValues(dataOut, (const long double*)nativeIn, count);
+                break;
+            default:
+                CaretAssert(0);
+                throw DataFileException("internal error, tell the developers what you just tried to do");
+        }
+    }
+    
     template<typename TO, typename FROM>
     void NiftiIO::convertRead(TO* out, FROM* in, const int64_t& count)
     {
@@ -218,6 +322,12 @@ namespace caret
         {
             ByteSwapping::swapArray(in, count);
         }
+        convertValues(out, (const FROM*)in, count);
+    }
+    
+    template<typename TO, typename FROM>
+    void NiftiIO::convertValues(TO* out, const FROM* in, const int64_t& count) const
+    {
         double mult, offset;
         bool doScale = m_header.getDataScaling(mult, offset);
         if (std::numeric_limits<TO>::is_integer)//do round to nearest when integer output type
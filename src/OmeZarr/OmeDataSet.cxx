@@ -235,17 +235,21 @@ OmeDataSet::getNumberOfChannels() const
  *    Type of ZARR driver
  * @param zarrPath
  *    Top level path (could be a directory, zip file, web address, etc.)
+ * @param chunkCache
+ *    Cache for decoded chunks shared by all data sets in the file
  * @return
  *    Result of initialization
  */
 FunctionResult
 OmeDataSet::initializeForReading(const ZarrDriverTypeEnum::Enum driverType,
-                                 const AString& zarrPath)
+                                 const AString& zarrPath,
+                                 const std::shared_ptr<ZarrChunkCache>& chunkCache)
 {
     m_zarrImageReader.reset(new ZarrImageReader());
     const FunctionResult initReaderResult(m_zarrImageReader->initialize(driverType,
                                                                         zarrPath,
-                                                                        m_relativePath));
+                                                                        m_relativePath,
+                                                                        chunkCache));
     if (initReaderResult.isError()) {
         m_zarrImageReader.reset();
         return initReaderResult;
@@ -364,6 +368,38 @@ OmeDataSet::readSlice(const int64_t sliceIndex) const
                                           zarrDataResult.isOk());
 }
 
+/**
+ * Decode, in the background, the data for the given slice so that
+ * reading the slice later does not need to decompress it.
+ * @param sliceIndex
+ *    Index of the slice.  Invalid indices are ignored.
+ */
+void
+OmeDataSet::prefetchSlice(const int64_t sliceIndex) const
+{
+    if ((sliceIndex < 0)
+        || (sliceIndex >= getNumberOfSlices())) {
+        return;
+    }
+    if ( ! m_zarrImageReader) {
+        return;
+    }
+    
+    const std::vector<int64_t> dims(getDimensions());
+    const int32_t numDims(dims.size());
+    std::vector<int64_t> dimOffset(numDims, 0);
+    std::vector<int64_t> dimLengths(numDims, 0);
+    dimLengths[m_dimensionIndices.getIndexForX()] = dims[m_dimensionIndices.getIndexForX()];
+    dimLengths[m_dimensionIndices.getIndexForY()] = dims[m_dimensionIndices.getIndexForY()];
+    dimLengths[m_dimensionIndices.getIndexForChannel()] = dims[m_dimensionIndices.getIndexForChannel()];
+    
+    dimOffset[m_dimensionIndices.getIndexForZ()]  = sliceIndex;
+    dimLengths[m_dimensionIndices.getIndexForZ()] = 1;
+    
+    m_zarrImageReader->prefetchData(dimOffset,
+                                    dimLengths);
+}
+
 /**
  * Read the given pixel from the ZARR file.
  * @param sliceIndex
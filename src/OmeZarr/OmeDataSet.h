@@ -37,6 +37,7 @@
 
 namespace caret {
 
+    class ZarrChunkCache;
     class ZarrImageReader;
     
     class OmeDataSet : public CaretObject {
@@ -81,10 +82,13 @@ namespace caret {
                                     const int64_t pixelK) const;
         
         FunctionResult initializeForReading(const ZarrDriverTypeEnum::Enum driverType,
-                                            const AString& zarrPath);
+                                            const AString& zarrPath,
+                                            const std::shared_ptr<ZarrChunkCache>& chunkCache);
         
         FunctionResultValue<OmeImage*> readSlice(const int64_t sliceIndex) const;
         
+        void prefetchSlice(const int64_t sliceIndex) const;
+        
         FunctionResultValue<std::array<uint8_t, 4>> readSlicePixel(const int64_t sliceIndex,
                                                                    const int64_t pixelI,
                                                                    const int64_t pixelJ) const;
@@ -50,6 +50,7 @@
 #include "CaretAssert.h"
 #include "OmeImage.h"
 #include "OmeAttrsV0p4JsonFile.h"
+#include "ZarrChunkCache.h"
 #include "ZarrHelper.h"
 #include "ZarrV2ArrayJsonFile.h"
 #include "ZarrV2GroupJsonFile.h"
@@ -151,13 +152,15 @@ OmeFileReader::initialize(const AString& omeZarrPath)
      /*
      * Number of data sets in the OME-ZARR file
      */
+    m_chunkCache.reset(new ZarrChunkCache(ZarrChunkCache::getDefaultMaximumBytes()));
     const int32_t numDataSets(m_omeZAttrs->getNumberOfDataSets());
     for (int32_t i = 0; i < numDataSets; i++) {
         OmeDataSet* dataSet(m_omeZAttrs->getDataSet(i));
         const AString relativePath(dataSet->getRelativePath());
                 
         FunctionResult initializeResult(dataSet->initializeForReading(m_driverType,
-                                                                      omeZarrPath));
+                                                                      omeZarrPath,
+                                                                      m_chunkCache));
         if (initializeResult.isError()) {
             return initializeResult;
         }
@@ -38,6 +38,7 @@
 namespace caret {
     class OmeImage;
     class OmeAttrsV0p4JsonFile;
+    class ZarrChunkCache;
     class ZarrV2GroupJsonFile;
     class ZarrImageReader;
 
@@ -79,6 +80,9 @@ namespace caret {
         
         OmeDimensionIndices m_dimensionIndices;
         
+        /** decoded chunks of all data sets (pyramid levels) */
+        std::shared_ptr<ZarrChunkCache> m_chunkCache;
+        
         // ADD_NEW_MEMBERS_HERE
 
     };
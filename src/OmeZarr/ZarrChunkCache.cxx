@@ -0,0 +1,218 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __ZARR_CHUNK_CACHE_DECLARE__
+#include "ZarrChunkCache.h"
+#undef __ZARR_CHUNK_CACHE_DECLARE__
+
+#include <QMutexLocker>
+#include <QThread>
+
+#include "CaretAssert.h"
+
+using namespace caret;
+
+/**
+ * Runs the prefetching loop of a chunk cache.
+ */
+class ZarrChunkCache::PrefetchThread : public QThread
+{
+public:
+    PrefetchThread(ZarrChunkCache* chunkCache)
+    : m_chunkCache(chunkCache) { }
+
+    void run() override {
+        m_chunkCache->runPrefetching();
+    }
+
+    ZarrChunkCache* m_chunkCache;
+};
+
+/**
+ * \class caret::ZarrChunkCache
+ * \brief Least recently used cache of decoded ZARR chunks
+ * \ingroup OmeZarr
+ *
+ * One cache is shared by all of the data sets (pyramid levels) of an
+ * OME-ZARR file so that the memory budget applies to the whole file.
+ * Panning, changing slices, or returning to a pyramid level only
+ * decompresses chunks that are not in the cache.  Chunks may also be
+ * decoded by a background thread before they are needed.  All functions
+ * may be called from any thread.
+ */
+
+/**
+ * Constructor.
+ *
+ * @param maximumBytes
+ *    Memory that may be used by decoded chunks.  The most recently
+ *    used chunk is always kept, even if it exceeds the limit.
+ */
+ZarrChunkCache::ZarrChunkCache(const int64_t maximumBytes)
+: m_chunks("ZARR chunk",
+           maximumBytes)
+{
+}
+
+/**
+ * Destructor.  Waits for any chunks being prefetched to finish decoding.
+ */
+ZarrChunkCache::~ZarrChunkCache()
+{
+    stopPrefetching();
+}
+
+/**
+ * @return Default memory for decoded chunks of a file, which is 1 GB
+ * unless set, in megabytes, with the environment variable
+ * WORKBENCH_OME_ZARR_CHUNK_CACHE_MB.
+ */
+int64_t
+ZarrChunkCache::getDefaultMaximumBytes()
+{
+    return CaretLruCache<ChunkKey, ChunkData>::getMaximumBytesFromEnvironment("WORKBENCH_OME_ZARR_CHUNK_CACHE_MB",
+                                                                              1024);
+}
+
+/**
+ * @return Memory that may be used by decoded chunks.
+ */
+int64_t
+ZarrChunkCache::getMaximumBytes() const
+{
+    return m_chunks.getMaximumBytes();
+}
+
+/**
+ * @return A new identifier for a data set whose chunks are kept in this cache.
+ */
+int32_t
+ZarrChunkCache::newDataSetIdentifier()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_nextDataSetIdentifier++;
+}
+
+/**
+ * Get a chunk from the cache.
+ *
+ * @param dataSetIdentifier
+ *    Identifier of the data set containing the chunk.
+ * @param chunkIndices
+ *    Index of the chunk in each dimension.
+ * @return
+ *    The chunk's data or NULL if the chunk is not in the cache.
+ */
+ZarrChunkCache::ChunkData
+ZarrChunkCache::getChunk(const int32_t dataSetIdentifier,
+                         const std::vector<int64_t>& chunkIndices)
+{
+    return m_chunks.get(ChunkKey(dataSetIdentifier,
+                                 chunkIndices));
+}
+
+/**
+ * Add a chunk to the cache, removing least recently used chunks
+ * if the cache is full.
+ *
+ * @param dataSetIdentifier
+ *    Identifier of the data set containing the chunk.
+ * @param chunkIndices
+ *    Index of the chunk in each dimension.
+ * @param chunkData
+ *    The chunk's data.
+ */
+void
+ZarrChunkCache::addChunk(const int32_t dataSetIdentifier,
+                         const std::vector<int64_t>& chunkIndices,
+                         const ChunkData& chunkData)
+{
+    CaretAssert(chunkData);
+    m_chunks.add(ChunkKey(dataSetIdentifier,
+                          chunkIndices),
+                 chunkData,
+                 static_cast<int64_t>(chunkData->size()));
+}
+
+/**
+ * Request that a task, which decodes chunks and adds them to this cache,
+ * is run by the background thread.  Tasks are run in the order requested.
+ *
+ * @param prefetchTask
+ *    The task, it must not use anything that is destroyed before
+ *    stopPrefetching() is called.
+ */
+void
+ZarrChunkCache::requestPrefetch(const std::function<void()>& prefetchTask)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pendingPrefetchTasks.push_back(prefetchTask);
+    if ( ! m_prefetchThread) {
+        m_prefetchThread.reset(new PrefetchThread(this));
+        m_prefetchThread->start(QThread::LowPriority);
+    }
+    m_prefetchCondition.wakeAll();
+}
+
+/**
+ * Discard prefetch tasks that have not started and wait for a running task to finish.
+ */
+void
+ZarrChunkCache::stopPrefetching()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if ( ! m_prefetchThread) {
+            m_pendingPrefetchTasks.clear();
+            return;
+        }
+        m_stopPrefetchingFlag = true;
+        m_pendingPrefetchTasks.clear();
+        m_prefetchCondition.wakeAll();
+    }
+    m_prefetchThread->wait();
+
+    QMutexLocker locker(&m_mutex);
+    m_prefetchThread.reset();
+    m_stopPrefetchingFlag = false;
+}
+
+/**
+ * Loop run by the prefetch thread until prefetching is stopped.
+ */
+void
+ZarrChunkCache::runPrefetching()
+{
+    QMutexLocker locker(&m_mutex);
+    while ( ! m_stopPrefetchingFlag) {
+        if (m_pendingPrefetchTasks.empty()) {
+            m_prefetchCondition.wait(&m_mutex);
+            continue;
+        }
+
+        std::function<void()> task(m_pendingPrefetchTasks.front());
+        m_pendingPrefetchTasks.pop_front();
+
+        locker.unlock();
+        task();
+        locker.relock();
+    }
+}
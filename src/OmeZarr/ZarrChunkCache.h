@@ -0,0 +1,101 @@
+#ifndef __ZARR_CHUNK_CACHE_H__
+#define __ZARR_CHUNK_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cinttypes>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "CaretLruCache.h"
+
+namespace caret {
+
+    class ZarrChunkCache
+    {
+    public:
+        /** Decoded content of one chunk, in the chunk's row major order */
+        typedef std::shared_ptr<const std::vector<uint8_t>> ChunkData;
+
+        ZarrChunkCache(const int64_t maximumBytes);
+
+        ~ZarrChunkCache();
+
+        ZarrChunkCache(const ZarrChunkCache&) = delete;
+
+        ZarrChunkCache& operator=(const ZarrChunkCache&) = delete;
+
+        int32_t newDataSetIdentifier();
+
+        ChunkData getChunk(const int32_t dataSetIdentifier,
+                           const std::vector<int64_t>& chunkIndices);
+
+        void addChunk(const int32_t dataSetIdentifier,
+                      const std::vector<int64_t>& chunkIndices,
+                      const ChunkData& chunkData);
+
+        void requestPrefetch(const std::function<void()>& prefetchTask);
+
+        void stopPrefetching();
+
+        int64_t getMaximumBytes() const;
+
+        static int64_t getDefaultMaximumBytes();
+
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        class PrefetchThread;
+
+        typedef std::pair<int32_t, std::vector<int64_t>> ChunkKey;
+
+        void runPrefetching();
+
+        CaretLruCache<ChunkKey, ChunkData> m_chunks;
+
+        /** protects all members below, but is not held while a chunk is decoded */
+        QMutex m_mutex;
+
+        QWaitCondition m_prefetchCondition;
+
+        int32_t m_nextDataSetIdentifier = 0;
+
+        std::deque<std::function<void()>> m_pendingPrefetchTasks;
+
+        bool m_stopPrefetchingFlag = false;
+
+        std::unique_ptr<PrefetchThread> m_prefetchThread;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __ZARR_CHUNK_CACHE_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __ZARR_CHUNK_CACHE_DECLARE__
+
+} // namespace
+#endif  //__ZARR_CHUNK_CACHE_H__
@@ -43,11 +43,14 @@
 #include "ZarrImageReader.h"
 #undef __ZARR_IMAGE_READER_DECLARE__
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <string>
-#include <thread>
+#include <typeinfo>
 
 #include "xtensor/xarray.hpp"
 
@@ -59,7 +62,10 @@
 #include "z5/multiarray/xtensor_access.hxx"
 
 #include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "FileInformation.h"
+#include "ZarrChunkCache.h"
 #include "ZarrHelper.h"
 #include "ZarrV2ArrayJsonFile.h"
 
@@ -71,7 +77,9 @@ using namespace caret;
  * \ingroup OmeZarr
  *
  * Reads ZARR data from a directory containing a
- * .zarray file
+ * .zarray file.  The data set is opened once, and data
+ * is assembled from decoded chunks that are kept in
+ * a cache shared with the file's other data sets.
  */
 
 /**
@@ -88,6 +96,12 @@ ZarrImageReader::ZarrImageReader()
  */
 ZarrImageReader::~ZarrImageReader()
 {
+    /*
+     * Prefetching may be using this reader
+     */
+    if (m_chunkCache) {
+        m_chunkCache->stopPrefetching();
+    }
 }
 
 /**
@@ -142,17 +156,23 @@ ZarrImageReader::getDataType() const
  *    Top level path (could be a directory, zip file, web address, etc.)
  * @param relativePath
  *    Path within the zarr path
+ * @param chunkCache
+ *    Cache for decoded chunks
  * @return
  *    Result of initialization
  */
 FunctionResult
 ZarrImageReader::initialize(const ZarrDriverTypeEnum::Enum driverType,
                             const AString& zarrPath,
-                            const AString& relativePath)
+                            const AString& relativePath,
+                            const std::shared_ptr<ZarrChunkCache>& chunkCache)
 {
     m_driverType   = driverType;
     m_zarrPath     = zarrPath;
     m_relativePath = relativePath;
+    m_chunkCache   = chunkCache;
+    CaretAssert(m_chunkCache);
+    m_chunkCacheDataSetIdentifier = m_chunkCache->newDataSetIdentifier();
     
     if (m_driverType == ZarrDriverTypeEnum::INVALID) {
         return FunctionResult::error("Driver type is invalid.");
@@ -187,6 +207,22 @@ ZarrImageReader::initialize(const ZarrDriverTypeEnum::Enum driverType,
         return FunctionResult::error("Data type is unknown.");
     }
     
+    switch (m_driverType) {
+        case ZarrDriverTypeEnum::INVALID:
+            break;
+        case ZarrDriverTypeEnum::LOCAL_FILE:
+        {
+            const FunctionResult openResult(openLocalDataSet());
+            if (openResult.isError()) {
+                m_status = Status::INITIALIZATION_FAILED;
+                return openResult;
+            }
+        }
+            break;
+        case ZarrDriverTypeEnum::LOCAL_ZIP_FILE:
+            break;
+    }
+    
     m_status = Status::INITIALIZATION_SUCCESSFUL;
 
     return FunctionResult::ok();
@@ -245,9 +281,7 @@ ZarrImageReader::readData(const std::vector<int64_t>& dimOffsets,
         case ZarrDriverTypeEnum::INVALID:
             break;
         case ZarrDriverTypeEnum::LOCAL_FILE:
-            result = readLocalFile(m_zarrPath,
-                                   m_relativePath,
-                                   dimOffsets,
+            result = readLocalFile(dimOffsets,
                                    dimLengths);
             break;
         case ZarrDriverTypeEnum::LOCAL_ZIP_FILE:
@@ -287,12 +321,223 @@ ZarrImageReader::readData(const std::vector<int64_t>& dimOffsets,
     return result;
 }
 
+/**
+ * Open the data set in a local ZARR file, which stays open for reading chunks
+ * @return
+ *    Result of opening the data set
+ */
+FunctionResult
+ZarrImageReader::openLocalDataSet()
+{
+    const std::string filePath(m_zarrPath.toStdString()
+                               + "/"
+                               + m_relativePath.toStdString());
+    try {
+        z5::filesystem::handle::File file(m_zarrPath.toStdString());
+        m_dataSet = z5::openDataset(file,
+                                    m_relativePath.toStdString());
+    }
+    catch (const std::exception& re) {
+        m_dataSet.reset();
+        return FunctionResult::error("Opening dataset failed (z5::openDataset execption), path="
+                                     + AString(filePath)
+                                     + AString("  error: ")
+                                     + AString(re.what()));
+    }
+    if ( ! m_dataSet) {
+        return FunctionResult::error("Opening data set failed " + AString(filePath));
+    }
+    
+    try {
+        m_dataSet->checkRequestType(typeid(uint8_t));
+    }
+    catch (const std::exception& re) {
+        m_dataSet.reset();
+        return FunctionResult::error("Only unsigned byte data is supported, path="
+                                     + AString(filePath)
+                                     + AString("  error: ")
+                                     + AString(re.what()));
+    }
+    
+    const z5::types::ShapeType& chunkShape(m_dataSet->defaultChunkShape());
+    m_chunkShape.assign(chunkShape.begin(),
+                        chunkShape.end());
+    if (m_chunkShape.size() != m_shapeSizes.size()) {
+        m_dataSet.reset();
+        return FunctionResult::error("Chunk dimensions are different size than shape sizes, path="
+                                     + AString(filePath));
+    }
+    for (const int64_t cs : m_chunkShape) {
+        if (cs <= 0) {
+            m_dataSet.reset();
+            return FunctionResult::error("Invalid chunk size, path="
+                                         + AString(filePath));
+        }
+    }
+    
+    return FunctionResult::ok();
+}
+
+/**
+ * Find the chunks containing a region of the data
+ * @param dimOffsets
+ *    Starting offset of the region in each of the dimensions
+ * @param dimLengths
+ *    Length of the region in each of the dimensions
+ * @param chunkIndicesOut
+ *    Output with the index, in each dimension, of each chunk
+ * @return
+ *    True if the region is within the data, else false.
+ */
+bool
+ZarrImageReader::getChunksInRegion(const std::vector<int64_t>& dimOffsets,
+                                   const std::vector<int64_t>& dimLengths,
+                                   std::vector<std::vector<int64_t>>& chunkIndicesOut) const
+{
+    chunkIndicesOut.clear();
+    
+    const int32_t numDims(m_shapeSizes.size());
+    CaretAssert(static_cast<int32_t>(m_chunkShape.size()) == numDims);
+    if ((static_cast<int32_t>(dimOffsets.size()) != numDims)
+        || (static_cast<int32_t>(dimLengths.size()) != numDims)) {
+        return false;
+    }
+    
+    std::vector<int64_t> firstChunk(numDims);
+    std::vector<int64_t> lastChunk(numDims);
+    for (int32_t d = 0; d < numDims; d++) {
+        if ((dimOffsets[d] < 0)
+            || (dimLengths[d] < 0)
+            || ((dimOffsets[d] + dimLengths[d]) > m_shapeSizes[d])) {
+            return false;
+        }
+        if (dimLengths[d] == 0) {
+            return true;
+        }
+        firstChunk[d] = dimOffsets[d] / m_chunkShape[d];
+        lastChunk[d]  = (dimOffsets[d] + dimLengths[d] - 1) / m_chunkShape[d];
+    }
+    
+    std::vector<int64_t> chunkIndices(firstChunk);
+    while (true) {
+        chunkIndicesOut.push_back(chunkIndices);
+        int32_t d(numDims - 1);
+        while (d >= 0) {
+            if (chunkIndices[d] < lastChunk[d]) {
+                ++chunkIndices[d];
+                break;
+            }
+            chunkIndices[d] = firstChunk[d];
+            --d;
+        }
+        if (d < 0) {
+            break;
+        }
+    }
+    
+    return true;
+}
+
+/**
+ * Get a decoded chunk, from the cache if it is present, otherwise from the file.
+ * May be called from any thread.
+ * @param chunkIndices
+ *    Index of the chunk in each dimension
+ * @param chunkShapeOut
+ *    Output with the shape of the chunk's data, which is in row major order
+ * @return
+ *    The chunk's data
+ * @throw
+ *    std::exception if there is an error decoding the chunk
+ */
+std::shared_ptr<const std::vector<uint8_t>>
+ZarrImageReader::getChunk(const std::vector<int64_t>& chunkIndices,
+                          std::vector<int64_t>& chunkShapeOut) const
+{
+    CaretAssert(m_dataSet);
+    const z5::types::ShapeType chunkId(chunkIndices.begin(),
+                                       chunkIndices.end());
+    z5::types::ShapeType chunkShape;
+    m_dataSet->getChunkShape(chunkId,
+                             chunkShape);
+    chunkShapeOut.assign(chunkShape.begin(),
+                         chunkShape.end());
+    
+    ZarrChunkCache::ChunkData chunkData(m_chunkCache->getChunk(m_chunkCacheDataSetIdentifier,
+                                                               chunkIndices));
+    if (chunkData) {
+        return chunkData;
+    }
+    
+    int64_t numElements(1);
+    for (const int64_t cs : chunkShapeOut) {
+        numElements *= cs;
+    }
+    std::shared_ptr<std::vector<uint8_t>> data(new std::vector<uint8_t>(numElements));
+    if (m_dataSet->chunkExists(chunkId)) {
+        m_dataSet->readChunk(chunkId,
+                             data->data());
+    }
+    else {
+        /*
+         * Chunks that are all the fill value need not be written
+         */
+        std::fill(data->begin(),
+                  data->end(),
+                  static_cast<uint8_t>(m_zarrayFile->getFillValue()));
+    }
+    m_chunkCache->addChunk(m_chunkCacheDataSetIdentifier,
+                           chunkIndices,
+                           data);
+    return data;
+}
+
+/**
+ * Decode, in the background, the chunks containing a region of the data so
+ * that they are in the cache when the region is read.  Does nothing if
+ * the region is invalid or data is not read from a local file.
+ * @param dimOffsets
+ *    Starting offset for reading from each of the dimensions
+ * @param dimLengths
+ *    Lengths of data to read from each of the dimensions
+ */
+void
+ZarrImageReader::prefetchData(const std::vector<int64_t>& dimOffsets,
+                              const std::vector<int64_t>& dimLengths)
+{
+    if ((m_status != Status::INITIALIZATION_SUCCESSFUL)
+        || ( ! m_dataSet)) {
+        return;
+    }
+    
+    std::vector<std::vector<int64_t>> chunks;
+    if ( ! getChunksInRegion(dimOffsets,
+                             dimLengths,
+                             chunks)) {
+        return;
+    }
+    if (chunks.empty()) {
+        return;
+    }
+    
+    m_chunkCache->requestPrefetch([this, chunks]() {
+        for (const auto& chunkIndices : chunks) {
+            try {
+                std::vector<int64_t> chunkShape;
+                getChunk(chunkIndices,
+                         chunkShape);
+            }
+            catch (const std::exception& e) {
+                CaretLogFine("Prefetching ZARR chunk failed: "
+                             + AString(e.what()));
+                return;
+            }
+        }
+    });
+}
+
 /**
  * Read data from a local ZARR file
- * @param zarrPath
- *    Top level path (could be a directory, zip file, web address, etc.)
- * @param relativePath
- *    Path within the zarr path
  * @param dimOffset
  *    Starting offset for reading from each of the dimensions
  * @param dimLengths
@@ -301,75 +546,139 @@ ZarrImageReader::readData(const std::vector<int64_t>& dimOffsets,
  *    Result containing the data that was read
  */
 FunctionResultValue<xt::xarray<uint8_t>*>
-ZarrImageReader::readLocalFile(const AString& zarrPath,
-                               const AString& relativePath,
-                               const std::vector<int64_t>& dimOffsets,
+ZarrImageReader::readLocalFile(const std::vector<int64_t>& dimOffsets,
                                const std::vector<int64_t>& dimLengths)
 {
-    try {
-        /*
-         * Path to file
-         */
-        const std::string filePath(zarrPath.toStdString()
+    if ( ! m_dataSet) {
+        return readDataErrorResult("Data set is not open "
+                                   + m_zarrPath
                                    + "/"
-                                   + relativePath.toStdString());
-        z5::filesystem::handle::File file(zarrPath.toStdString());
-        
-        /*
-         * Open the data set
-         */
-        std::unique_ptr<z5::Dataset> dataSet;
-        try {
-            dataSet = z5::openDataset(file,
-                                      relativePath.toStdString());
-        }
-        catch (const std::exception& re) {
-            const AString msg("Opening dataset failed (z5::openDataset execption), path="
-                              + AString(filePath)
-                              + AString("  error: ")
-                              + AString(re.what()));
-            return readDataErrorResult(msg);
-        }
-        
-        if ( ! dataSet) {
-            return readDataErrorResult("Opening data set failed " + filePath);
-        }
-        
-        /*
-         * Read all data from the file
-         */
-        z5::types::ShapeType offset;
-        for (const int64_t dimO : dimOffsets) {
-            offset.push_back(dimO);
-        }
-        
-        xt::xarray<int64_t>::shape_type shape;
-        for (const int64_t dl : dimLengths) {
-            shape.push_back(dl);
-        }
+                                   + m_relativePath);
+    }
+    
+    std::vector<std::vector<int64_t>> chunks;
+    if ( ! getChunksInRegion(dimOffsets,
+                             dimLengths,
+                             chunks)) {
+        return readDataErrorResult("Region is outside of data, offsets="
+                                   + AString::fromNumbers(dimOffsets)
+                                   + " lengths="
+                                   + AString::fromNumbers(dimLengths)
+                                   + " shape="
+                                   + AString::fromNumbers(m_shapeSizes));
+    }
+    
+    xt::xarray<uint8_t>::shape_type shape;
+    for (const int64_t dl : dimLengths) {
+        shape.push_back(dl);
+    }
+    std::unique_ptr<xt::xarray<uint8_t>> arrayStorage;
+    try {
+        arrayStorage.reset(new xt::xarray<uint8_t>(shape));
+    }
+    catch (const std::exception& e) {
+        return readDataErrorResult("Allocating memory for ZARR data failed: "
+                                   + AString(e.what()));
+    }
+    uint8_t* outputData(arrayStorage->data());
+    
+    /*
+     * Row major strides of the output
+     */
+    const int32_t numDims(dimLengths.size());
+    std::vector<int64_t> outputStrides(numDims, 1);
+    for (int32_t d = numDims - 2; d >= 0; d--) {
+        outputStrides[d] = outputStrides[d + 1] * dimLengths[d + 1];
+    }
+    
+    /*
+     * Chunks fill separate parts of the output so they are decoded and copied in parallel
+     */
+    const int64_t numChunks(chunks.size());
+    AString errorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t iChunk = 0; iChunk < numChunks; iChunk++) {
         try {
-            const int32_t numThreads(std::thread::hardware_concurrency());
-            std::unique_ptr<xt::xarray<uint8_t>> arrayStorage(new xt::xarray<uint8_t>(shape));
-            z5::multiarray::readSubarray<uint8_t>(dataSet,
-                                                  *arrayStorage.get(),
-                                                  offset.begin(),
-                                                  numThreads);
-            return FunctionResultValue<xt::xarray<uint8_t>*>(arrayStorage.release(),
-                                                             "",
-                                                             true);
+            const std::vector<int64_t>& chunkIndices(chunks[iChunk]);
+            std::vector<int64_t> chunkShape;
+            ZarrChunkCache::ChunkData chunkData(getChunk(chunkIndices,
+                                                         chunkShape));
+            CaretAssert(chunkData);
+            
+            std::vector<int64_t> chunkStrides(numDims, 1);
+            for (int32_t d = numDims - 2; d >= 0; d--) {
+                chunkStrides[d] = chunkStrides[d + 1] * chunkShape[d + 1];
+            }
+            if ((numDims > 0)
+                && (static_cast<int64_t>(chunkData->size()) < (chunkStrides[0] * chunkShape[0]))) {
+                throw std::runtime_error("decoded chunk is smaller than its shape");
+            }
+            
+            /*
+             * Part of the region that is in this chunk
+             */
+            std::vector<int64_t> chunkOrigin(numDims);
+            std::vector<int64_t> first(numDims);
+            std::vector<int64_t> last(numDims);
+            bool emptyFlag(false);
+            for (int32_t d = 0; d < numDims; d++) {
+                chunkOrigin[d] = chunkIndices[d] * m_chunkShape[d];
+                first[d] = std::max(dimOffsets[d], chunkOrigin[d]);
+                last[d]  = std::min(dimOffsets[d] + dimLengths[d],
+                                    chunkOrigin[d] + chunkShape[d]);
+                if (first[d] >= last[d]) {
+                    emptyFlag = true;
+                }
+            }
+            if (emptyFlag) {
+                continue;
+            }
+            
+            /*
+             * Copy contiguous runs along the last dimension
+             */
+            const int32_t lastDim(numDims - 1);
+            const int64_t runLength(last[lastDim] - first[lastDim]);
+            std::vector<int64_t> position(first);
+            while (true) {
+                int64_t chunkOffset(0);
+                int64_t outputOffset(0);
+                for (int32_t d = 0; d < numDims; d++) {
+                    chunkOffset  += (position[d] - chunkOrigin[d]) * chunkStrides[d];
+                    outputOffset += (position[d] - dimOffsets[d]) * outputStrides[d];
+                }
+                std::memcpy(outputData + outputOffset,
+                            chunkData->data() + chunkOffset,
+                            runLength);
+                
+                int32_t d(lastDim - 1);
+                while (d >= 0) {
+                    if ((position[d] + 1) < last[d]) {
+                        ++position[d];
+                        break;
+                    }
+                    position[d] = first[d];
+                    --d;
+                }
+                if (d < 0) {
+                    break;
+                }
+            }
         }
-        catch(const std::exception& re) {
-            const AString msg("Z5::readSubarray exeception: "
-                              + AString(re.what()));
-            return readDataErrorResult(msg);
+        catch (const std::exception& e) {
+#pragma omp critical
+            {
+                errorMessage = ("Exception was thrown by Z5: "
+                                + AString(e.what()));
+            }
         }
     }
-    catch (const std::exception& e) {
-        return readDataErrorResult("Exception was thrown by Z5: "
-                                   + AString(e.what()));
+    
+    if ( ! errorMessage.isEmpty()) {
+        return readDataErrorResult(errorMessage);
     }
-
-    CaretAssert(0);
-    return readDataErrorResult("Should never get here");
+    
+    return FunctionResultValue<xt::xarray<uint8_t>*>(arrayStorage.release(),
+                                                     "",
+                                                     true);
 }
-
@@ -34,9 +34,14 @@
 #include "ZarrDataTypeEnum.h"
 #include "ZarrDriverTypeEnum.h"
 
+namespace z5 {
+    class Dataset;
+}
+
 namespace caret {
 
     class OmeAttrsV0p4JsonFile;
+    class ZarrChunkCache;
     class ZarrV2ArrayJsonFile;
     class ZarrV2GroupJsonFile;
     
@@ -53,7 +58,8 @@ namespace caret {
         
         FunctionResult initialize(const ZarrDriverTypeEnum::Enum driverType,
                                   const AString& zarrPath,
-                                  const AString& relativePath);
+                                  const AString& relativePath,
+                                  const std::shared_ptr<ZarrChunkCache>& chunkCache);
         
         std::vector<int64_t> getShapeSizes() const;
         
@@ -62,6 +68,9 @@ namespace caret {
         FunctionResultValue<xt::xarray<uint8_t>*> readData(const std::vector<int64_t>& dimOffsets,
                                                            const std::vector<int64_t>& dimLengths);
         
+        void prefetchData(const std::vector<int64_t>& dimOffsets,
+                          const std::vector<int64_t>& dimLengths);
+        
         // ADD_NEW_METHODS_HERE
 
         virtual AString toString() const;
@@ -75,11 +84,18 @@ namespace caret {
         
         void copyHelperZarrImageReader(const ZarrImageReader& obj);
 
-        FunctionResultValue<xt::xarray<uint8_t>*> readLocalFile(const AString& zarrPath,
-                                                                const AString& relativePath,
-                                                                const std::vector<int64_t>& dimOffsets,
+        FunctionResultValue<xt::xarray<uint8_t>*> readLocalFile(const std::vector<int64_t>& dimOffsets,
                                                                 const std::vector<int64_t>& dimLengths);
 
+        FunctionResult openLocalDataSet();
+
+        bool getChunksInRegion(const std::vector<int64_t>& dimOffsets,
+                               const std::vector<int64_t>& dimLengths,
+                               std::vector<std::vector<int64_t>>& chunkIndicesOut) const;
+
+        std::shared_ptr<const std::vector<uint8_t>> getChunk(const std::vector<int64_t>& chunkIndices,
+                                                             std::vector<int64_t>& chunkShapeOut) const;
+
         FunctionResultValue<xt::xarray<uint8_t>*> readDataErrorResult(const AString& errorMessage);
         
         ZarrDriverTypeEnum::Enum m_driverType = ZarrDriverTypeEnum::INVALID;
@@ -98,6 +114,17 @@ namespace caret {
         /** data type*/
         ZarrDataTypeEnum::Enum m_dataType;
 
+        /** data set kept open for reading chunks */
+        std::unique_ptr<z5::Dataset> m_dataSet;
+
+        /** shape of a chunk that is not at the edge of the data */
+        std::vector<int64_t> m_chunkShape;
+
+        /** decoded chunks, shared with the other data sets in the file */
+        std::shared_ptr<ZarrChunkCache> m_chunkCache;
+
+        int32_t m_chunkCacheDataSetIdentifier = -1;
+
         // ADD_NEW_MEMBERS_HERE
 
     };
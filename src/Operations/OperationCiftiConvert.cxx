@@ -30,6 +30,7 @@
 #include "GiftiFile.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <fstream>
 #include <cmath>
 #include <string>
@@ -459,14 +460,24 @@ void OperationCiftiConvert::useParameters(OperationParameters* myParams, Progres
                             "-to-nifti' (and spatially-naive processing of the produced 'fake-nifti' file).");
         }
         myCiftiOut->setCiftiXML(outXML);
-        vector<float> rowscratch(numCols);
-        for (int64_t i = 0; i < numRows; ++i)
+        const int64_t BLOCK_FLOATS = 1 << 26;//256MB of scratch at most, read each frame once per block of rows, not once per row, so paged input doesn't thrash
+        const int64_t blockRows = max((int64_t)1, min(numRows, BLOCK_FLOATS / max((int64_t)1, numCols)));
+        vector<float> rowBlock(blockRows * numCols);
+        for (int64_t start = 0; start < numRows; start += blockRows)
         {
+            const int64_t end = min(numRows, start + blockRows);
             for (int64_t j = 0; j < numCols; ++j)
             {
-                rowscratch[j] = myNiftiIn->getFrame(j)[i];
+                const float* frame = myNiftiIn->getFrame(j);
+                for (int64_t i = start; i < end; ++i)
+                {
+                    rowBlock[(i - start) * numCols + j] = frame[i];
+                }
+            }
+            for (int64_t i = start; i < end; ++i)
+            {
+                myCiftiOut->setRow(rowBlock.data() + (i - start) * numCols, i);
             }
-            myCiftiOut->setRow(rowscratch.data(), i);
         }
     }
     if (toText->m_present)
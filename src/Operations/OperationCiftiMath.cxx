@@ -240,8 +240,9 @@ void OperationCiftiMath::useParameters(OperationParameters* myParams, ProgressOb
     }
     if (outXML.getNumberOfDimensions() < 1) throw OperationException("output must have at least 1 dimension");
     myCiftiOut->setCiftiXML(outXML);
-    vector<float> values(numVars), scratchRow(outDims[0]);
-    vector<vector<float> > inputRows(numVars);
+    vector<float> scratchRow(outDims[0]);
+    vector<vector<float> > inputRows(numVars), selectedValues(numVars);//selected values are repeated to the row length
+    vector<const float*> rowPointers(numVars);
     vector<vector<int64_t> > loadedRow(numVars);//to detect and prevent rereading the same row
     for (int v = 0; v < numVars; ++v)
     {
@@ -274,21 +275,25 @@ void OperationCiftiMath::useParameters(OperationParameters* myParams, ProgressOb
                 varCiftiFiles[v]->getRow(inputRows[v].data(), loadedRow[v]);
             }
         }
-        for (int j = 0; j < outDims[0]; ++j)
+        for (int v = 0; v < numVars; ++v)//now we check for select along row
         {
-            for (int v = 0; v < numVars; ++v)//now we check for select along row
+            if (selectInfo[v][0] == -1)
             {
-                if (selectInfo[v][0] == -1)
-                {
-                    values[v] = inputRows[v][j];
-                } else {
-                    values[v] = inputRows[v][selectInfo[v][0]];
-                }
+                rowPointers[v] = inputRows[v].data();
+            } else {
+                selectedValues[v].assign(outDims[0], inputRows[v][selectInfo[v][0]]);
+                rowPointers[v] = selectedValues[v].data();
             }
-            scratchRow[j] = (float)myExpr.evaluate(values);
-            if (nanfix && scratchRow[j] != scratchRow[j])
+        }
+        myExpr.evaluateBlock(rowPointers, outDims[0], scratchRow.data());
+        if (nanfix)
+        {
+            for (int j = 0; j < outDims[0]; ++j)
             {
-                scratchRow[j] = nanfixval;
+                if (scratchRow[j] != scratchRow[j])
+                {
+                    scratchRow[j] = nanfixval;
+                }
             }
         }
         myCiftiOut->setRow(scratchRow.data(), *iter);
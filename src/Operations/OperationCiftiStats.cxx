@@ -21,7 +21,9 @@
 #include "OperationCiftiStats.h"
 #include "OperationException.h"
 
+#include "CaretOMP.h"
 #include "CiftiFile.h"
+#include "ReductionAccumulator.h"
 #include "ReductionOperation.h"
 
 #include <algorithm>
@@ -119,13 +121,65 @@ namespace
             }
         }
         if (toUse.empty()) throw OperationException("roi is empty");
-        sort(toUse.begin(), toUse.end());
-        const float index = percent / 100.0f * (toUse.size() - 1);
-        if (index <= 0) return toUse[0];
-        if (index >= toUse.size() - 1) return toUse.back();
-        float ipart, fpart;
-        fpart = modf(index, &ipart);
-        return (1.0f - fpart) * toUse[(int)ipart] + fpart * toUse[((int)ipart) + 1];
+        return ReductionOperation::percentile(toUse.data(), toUse.size(), percent);
+    }
+    
+    //single pass over the rows of the file for reductions that don't need all values at once, results are [column][roi]
+    void accumulateStats(const CiftiFile* myInput, const ReductionEnum::Enum& myop, const CiftiFile* roiCifti, const bool& matchColumnMode, vector<float>& resultsOut)
+    {
+        const CiftiXML& myXML = myInput->getCiftiXML();
+        const int64_t numCols = myXML.getDimensionLength(CiftiXML::ALONG_ROW);
+        const int64_t colLength = myXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
+        int64_t numRois = 1, roiRowLength = 0;
+        if (roiCifti != NULL)
+        {
+            roiRowLength = roiCifti->getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW);
+            if (!matchColumnMode) numRois = roiRowLength;
+        }
+        const int64_t BLOCK_BYTES = 64 << 20;
+        const int64_t blockSize = max((int64_t)1, min((int64_t)1024, BLOCK_BYTES / ((numCols + roiRowLength) * (int64_t)sizeof(float))));
+        vector<ReductionAccumulator> accumulators(numRois, ReductionAccumulator(myop, numCols));
+        vector<float> blockData(blockSize * numCols), roiBlockData(blockSize * roiRowLength);
+        vector<const float*> rowPointers(blockSize), roiRowPointers(blockSize);
+        vector<float> rowMask(blockSize);
+        for (int64_t k = 0; k < blockSize; ++k)
+        {
+            rowPointers[k] = blockData.data() + k * numCols;
+            roiRowPointers[k] = roiBlockData.data() + k * roiRowLength;
+        }
+        for (int64_t blockStart = 0; blockStart < colLength; blockStart += blockSize)
+        {
+            const int64_t blockCount = min(blockSize, colLength - blockStart);
+            for (int64_t k = 0; k < blockCount; ++k)
+            {
+                myInput->getRow(blockData.data() + k * numCols, blockStart + k);
+                if (roiCifti != NULL) roiCifti->getRow(roiBlockData.data() + k * roiRowLength, blockStart + k);
+            }
+            if (roiCifti == NULL)
+            {
+                accumulators[0].addRows(rowPointers.data(), blockCount);
+            } else if (matchColumnMode) {
+                accumulators[0].addRows(rowPointers.data(), blockCount, roiRowPointers.data());
+            } else {
+                for (int64_t j = 0; j < numRois; ++j)
+                {
+                    for (int64_t k = 0; k < blockCount; ++k)
+                    {
+                        rowMask[k] = roiBlockData[k * roiRowLength + j];
+                    }
+                    accumulators[j].addRows(rowPointers.data(), blockCount, rowMask.data());
+                }
+            }
+        }
+        resultsOut.resize(numCols * numRois);
+        for (int64_t i = 0; i < numCols; ++i)
+        {
+            for (int64_t j = 0; j < numRois; ++j)
+            {
+                if (accumulators[j].getCount(i) == 0) throw OperationException("roi column is empty");
+                resultsOut[i * numRois + j] = accumulators[j].getResult(i);
+            }
+        }
     }
 }
 
@@ -163,7 +217,6 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
         useColumn = columnOpt->getInteger(1) - 1;
         if (useColumn < 0 || useColumn >= numCols) throw OperationException("invalid column specified");
     }
-    vector<float> roiData;
     bool matchColumnMode = false;
     CiftiFile* roiCifti = NULL;
     int64_t numRois = 1;//trick: pretend we have 1 roi map when we don't have an roi file, for fewer special cases
@@ -175,7 +228,6 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
         {
             throw OperationException("roi cifti does not match input cifti along columns");
         }
-        roiData.resize(colLength);
         if (roiOpt->getOptionalParameter(2)->m_present)
         {
             if (myXML.getMap(CiftiXML::ALONG_ROW)->getLength() != roiCifti->getCiftiXML().getMap(CiftiXML::ALONG_ROW)->getLength())
@@ -188,58 +240,75 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
     }
     bool showMapName = myParams->getOptionalParameter(6)->m_present;
     const CiftiMappingType* rowMap = myXML.getMap(CiftiXML::ALONG_ROW);
-    vector<float> colScratch(colLength);
+    const int64_t numResults = (matchColumnMode ? 1 : numRois);
     int64_t columnStart, columnEnd;
-    if (useColumn == -1)
-    {
-        myInput->convertToInMemory();//we will be getting all columns, so read it all in first
-        if (roiCifti != NULL) roiCifti->convertToInMemory();//ditto
+    vector<float> results;//[column][roi], for the columns being output
+    if (useColumn == -1 && reduceOpt->m_present && ReductionAccumulator::canAccumulate(myop))
+    {//stream the rows instead of reading the whole file into memory
         columnStart = 0;
         columnEnd = numCols;
+        accumulateStats(myInput, myop, roiCifti, matchColumnMode, results);
     } else {
-        if (roiCifti != NULL && !matchColumnMode) roiCifti->convertToInMemory();//matching maps with one column selected is the only time we don't need the whole ROI file
-        columnStart = useColumn;
-        columnEnd = useColumn + 1;
+        if (useColumn == -1)
+        {
+            myInput->convertToInMemory();//we will be getting all columns, so read it all in first
+            if (roiCifti != NULL) roiCifti->convertToInMemory();//ditto
+            columnStart = 0;
+            columnEnd = numCols;
+        } else {
+            if (roiCifti != NULL && !matchColumnMode) roiCifti->convertToInMemory();//matching maps with one column selected is the only time we don't need the whole ROI file
+            columnStart = useColumn;
+            columnEnd = useColumn + 1;
+        }
+        results.resize((columnEnd - columnStart) * numResults);
+        int64_t errorIndex = -1;
+        AString errorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t i = columnStart; i < columnEnd; ++i)
+        {//files are in memory whenever there is more than one column, so getColumn can be called from multiple threads
+            try
+            {
+                vector<float> colScratch(colLength), roiScratch(roiCifti == NULL ? 0 : colLength);
+                myInput->getColumn(colScratch.data(), i);
+                for (int64_t j = 0; j < numResults; ++j)
+                {
+                    if (roiCifti != NULL) roiCifti->getColumn(roiScratch.data(), (matchColumnMode ? i : j));
+                    float result;
+                    if (reduceOpt->m_present)
+                    {
+                        result = reduce(colScratch, myop, roiScratch);
+                    } else {
+                        CaretAssert(percentileOpt->m_present);
+                        result = percentile(colScratch, percent, roiScratch);
+                    }
+                    results[(i - columnStart) * numResults + j] = result;
+                }
+            } catch (const CaretException& e) {
+#pragma omp critical
+                {
+                    if (errorIndex == -1 || i < errorIndex)
+                    {
+                        errorIndex = i;
+                        errorMessage = e.whatString();
+                    }
+                }
+            }
+        }
+        if (errorIndex != -1) throw OperationException(errorMessage);
     }
-    for (int i = columnStart; i < columnEnd; ++i)
+    for (int64_t i = columnStart; i < columnEnd; ++i)
     {
-        myInput->getColumn(colScratch.data(), i);
         if (showMapName)
         {
             cout << AString::number(i + 1) << ":\t" << rowMap->getIndexName(i) << ":\t";
         }
-        if (matchColumnMode)
-        {//trick: matchColumn is only true when we have an roi
-            roiCifti->getColumn(roiData.data(), i);
-            float result;
-            if (reduceOpt->m_present)
-            {
-                result = reduce(colScratch, myop, roiData);
-            } else {
-                CaretAssert(percentileOpt->m_present);
-                result = percentile(colScratch, percent, roiData);
-            }
+        for (int64_t j = 0; j < numResults; ++j)
+        {
             stringstream resultsstr;
-            resultsstr << setprecision(7) << result;
-            cout << resultsstr.str() << endl;
-        } else {
-            for (int64_t j = 0; j < numRois; ++j)
-            {
-                if (roiCifti != NULL) roiCifti->getColumn(roiData.data(), j);
-                float result;
-                if (reduceOpt->m_present)
-                {
-                    result = reduce(colScratch, myop, roiData);
-                } else {
-                    CaretAssert(percentileOpt->m_present);
-                    result = percentile(colScratch, percent, roiData);
-                }
-                stringstream resultsstr;
-                resultsstr << setprecision(7) << result;
-                if (j != 0) cout << "\t";
-                cout << resultsstr.str();
-            }
-            cout << endl;
+            resultsstr << setprecision(7) << results[(i - columnStart) * numResults + j];
+            if (j != 0) cout << "\t";
+            cout << resultsstr.str();
         }
+        cout << endl;
     }
 }
@@ -181,7 +181,7 @@ void OperationMetricMath::useParameters(OperationParameters* myParams, ProgressO
     {
         throw OperationException("all -var options used -repeat, there is no file to get number of desired output columns from");
     }
-    vector<float> values(numVars), colScratch(numNodes);
+    vector<float> colScratch(numNodes);
     vector<const float*> columnPointers(numVars);
     myMetricOut->setNumberOfNodesAndColumns(numNodes, numColumns);
     myMetricOut->setStructure(myStructure);
@@ -197,16 +197,15 @@ void OperationMetricMath::useParameters(OperationParameters* myParams, ProgressO
                 columnPointers[v] = varMetrics[v]->getValuePointerForColumn(metricColumns[v]);
             }
         }
-        for (int i = 0; i < numNodes; ++i)
+        myExpr.evaluateBlock(columnPointers, numNodes, colScratch.data());
+        if (nanfix)
         {
-            for (int v = 0; v < numVars; ++v)
+            for (int i = 0; i < numNodes; ++i)
             {
-                values[v] = columnPointers[v][i];
-            }
-            colScratch[i] = (float)myExpr.evaluate(values);
-            if (nanfix && colScratch[i] != colScratch[i])
-            {
-                colScratch[i] = nanfixval;
+                if (colScratch[i] != colScratch[i])
+                {
+                    colScratch[i] = nanfixval;
+                }
             }
         }
         myMetricOut->setValuesForColumn(j, colScratch.data());
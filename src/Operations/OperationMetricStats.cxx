@@ -21,6 +21,7 @@
 #include "OperationMetricStats.h"
 #include "OperationException.h"
 
+#include "CaretOMP.h"
 #include "MetricFile.h"
 #include "ReductionOperation.h"
 
@@ -115,13 +116,7 @@ namespace
             }
         }
         if (toUse.empty()) throw OperationException("roi contains no vertices");
-        sort(toUse.begin(), toUse.end());
-        const float index = percent / 100.0f * (toUse.size() - 1);
-        if (index <= 0) return toUse[0];
-        if (index >= toUse.size() - 1) return toUse.back();
-        float ipart, fpart;
-        fpart = modf(index, &ipart);
-        return (1.0f - fpart) * toUse[(int)ipart] + fpart * toUse[((int)ipart) + 1];
+        return ReductionOperation::percentile(toUse.data(), toUse.size(), percent);
     }
 }
 
@@ -186,28 +181,19 @@ void OperationMetricStats::useParameters(OperationParameters* myParams, Progress
         columnStart = column;
         columnEnd = column + 1;
     }
+    const int numResults = (matchColumnMode ? 1 : numRoiCols);
+    vector<float> results((columnEnd - columnStart) * numResults);//[column][roi]
+    int errorIndex = -1;
+    AString errorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic)
     for (int i = columnStart; i < columnEnd; ++i)
     {
-        if (showMapName) cout << AString::number(i + 1) << ":\t" << input->getMapName(i) << ":\t";
-        if (matchColumnMode)
-        {//trick: matchColumn is only true when we have an roi
-            const float* roiData = myRoi->getValuePointerForColumn(i);
-            float result;
-            if (reduceOpt->m_present)
-            {
-                result = reduce(input->getValuePointerForColumn(i), numNodes, myop, roiData);
-            } else {
-                CaretAssert(percentileOpt->m_present);
-                result = percentile(input->getValuePointerForColumn(i), numNodes, percent, roiData);
-            }
-            stringstream resultsstr;
-            resultsstr << setprecision(7) << result;
-            cout << resultsstr.str();
-        } else {
-            for (int j = 0; j < numRoiCols; ++j)
+        try
+        {
+            for (int j = 0; j < numResults; ++j)
             {
                 const float* roiData = NULL;
-                if (myRoi != NULL) roiData = myRoi->getValuePointerForColumn(j);
+                if (myRoi != NULL) roiData = myRoi->getValuePointerForColumn(matchColumnMode ? i : j);//trick: matchColumn is only true when we have an roi
                 float result;
                 if (reduceOpt->m_present)
                 {
@@ -216,11 +202,29 @@ void OperationMetricStats::useParameters(OperationParameters* myParams, Progress
                     CaretAssert(percentileOpt->m_present);
                     result = percentile(input->getValuePointerForColumn(i), numNodes, percent, roiData);
                 }
-                stringstream resultsstr;
-                resultsstr << setprecision(7) << result;
-                if (j != 0) cout << "\t";
-                cout << resultsstr.str();
+                results[(i - columnStart) * numResults + j] = result;
             }
+        } catch (const CaretException& e) {
+#pragma omp critical
+            {
+                if (errorIndex == -1 || i < errorIndex)
+                {
+                    errorIndex = i;
+                    errorMessage = e.whatString();
+                }
+            }
+        }
+    }
+    if (errorIndex != -1) throw OperationException(errorMessage);
+    for (int i = columnStart; i < columnEnd; ++i)
+    {
+        if (showMapName) cout << AString::number(i + 1) << ":\t" << input->getMapName(i) << ":\t";
+        for (int j = 0; j < numResults; ++j)
+        {
+            stringstream resultsstr;
+            resultsstr << setprecision(7) << results[(i - columnStart) * numResults + j];
+            if (j != 0) cout << "\t";
+            cout << resultsstr.str();
         }
         cout << endl;
     }
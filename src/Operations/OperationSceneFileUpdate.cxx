@@ -274,6 +274,12 @@ OperationSceneFileUpdate::useParameters(OperationParameters* myParams,
      * Restore the scene
      */
     const SceneClass* guiManagerClass = scene->getClassWithName("guiManager");
+    if (guiManagerClass == NULL) {
+        throw OperationException("Scene \""
+                                 + scene->getName()
+                                 + "\" is missing its guiManager class.  The scene file may have been "
+                                 "modified or could not be read.");
+    }
     if (guiManagerClass->getName() != "guiManager") {
         throw OperationException("PROGRAM ERROR: Top level scene class should be guiManager but it is: "
                                  + guiManagerClass->getName());
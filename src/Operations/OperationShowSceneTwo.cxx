@@ -935,9 +935,16 @@ OperationShowSceneTwo::loadSceneFileAndRestoreScene(const AString& sceneFileName
     }
     
     /*
-     * Restore the scene
+     * Restore the scene, keeping its classes in memory while they are restored
      */
+    Scene::SceneBeingRestoredScoped sceneBeingRestored(scene);
     const SceneClass* guiManagerClass = scene->getClassWithName("guiManager");
+    if (guiManagerClass == NULL) {
+        throw OperationException("Scene \""
+                                 + scene->getName()
+                                 + "\" is missing its guiManager class.  The scene file may have been "
+                                 "modified or could not be read.");
+    }
     if (guiManagerClass->getName() != "guiManager") {
         throw OperationException("Top level scene class should be guiManager but it is: "
                                  + guiManagerClass->getName());
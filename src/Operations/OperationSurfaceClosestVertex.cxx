@@ -84,9 +84,10 @@ void OperationSurfaceClosestVertex::useParameters(OperationParameters* myParams,
     {
         throw OperationException("did not find any coordinates in file, make sure you use only whitespace to separate numbers");
     }
-    for (int i = 0; i < (int)coords.size(); i += 3)
+    vector<int32_t> nodes;
+    mySurf->closestNodes(coords.data(), coords.size() / 3, nodes);
+    for (int i = 0; i < (int)nodes.size(); ++i)
     {
-        int node = mySurf->closestNode(coords.data() + i);
-        nodeFile << node << endl;
+        nodeFile << nodes[i] << endl;
     }
 }
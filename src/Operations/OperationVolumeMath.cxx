@@ -200,7 +200,7 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
         throw OperationException("all -var options used -repeat, there is no file to get number of desired output subvolumes from");
     }
     int64_t frameSize = outDims[0] * outDims[1] * outDims[2];
-    vector<float> values(numVars), outFrame(frameSize);
+    vector<float> outFrame(frameSize);
     vector<const float*> inputFrames(numVars);
     if (toClone != NULL)
     {//don't take volume type from the selected volume, because we don't check for or copy label tables, nor do we want to (might be changing all the label keys, splitting label by roi...)
@@ -220,18 +220,16 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
                 inputFrames[v] = varVolumes[v]->getFrame(varSubvolumes[v]);
             }
         }
-        for (int64_t i = 0; i < frameSize; ++i)
+        myExpr.evaluateBlock(inputFrames, frameSize, outFrame.data());
+        if (nanfix)
         {
-            for (int v = 0; v < numVars; ++v)
+            for (int64_t i = 0; i < frameSize; ++i)
             {
-                values[v] = inputFrames[v][i];
-            }
-            float tempf = (float)myExpr.evaluate(values);
-            if (nanfix && tempf != tempf)
-            {
-                tempf = nanfixval;
+                if (outFrame[i] != outFrame[i])
+                {
+                    outFrame[i] = nanfixval;
+                }
             }
-            outFrame[i] = tempf;
         }
         myVolOut->setFrame(outFrame.data(), s);
     }
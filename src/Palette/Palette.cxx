@@ -26,6 +26,7 @@
 #include "Palette.h"
 #undef __PALETTE_DEFINE__
 
+#include "PaletteLookupTable.h"
 #include "PaletteScalarAndColor.h"
 
 using namespace caret;
@@ -483,6 +484,27 @@ Palette::getPaletteColor(
     }
 }
 
+/**
+ * Get a lookup table of this palette's colors for coloring many values.
+ * The table is created the first time it is needed, and again if the
+ * palette's scalars or colors have changed since it was created.
+ *
+ * @param interpolateColorFlag - interpolate the color between scalars.
+ * @return The lookup table, remains valid while held even if the palette changes.
+ */
+std::shared_ptr<const PaletteLookupTable>
+Palette::getLookupTable(const bool interpolateColorFlag) const
+{
+    CaretMutexLocker locker(&m_lookupTablesMutex);
+    std::shared_ptr<const PaletteLookupTable>& table = m_lookupTables[interpolateColorFlag ? 1 : 0];
+    if (( ! table)
+        || ( ! table->isValidFor(*this, interpolateColorFlag))) {
+        table.reset(new PaletteLookupTable(*this,
+                                           interpolateColorFlag));
+    }
+    return table;
+}
+
 /**
  * Set this object has been modified.
  *
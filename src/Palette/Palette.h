@@ -26,12 +26,14 @@
 #include <vector>
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 #include "CaretObject.h"
 #include "TracksModificationInterface.h"
 
 
 namespace caret {
 
+    class PaletteLookupTable;
     class PaletteScalarAndColor;
 
     /**
@@ -97,6 +99,8 @@ namespace caret {
                              const bool interpolateColorFlag,
                              float rgbaOut[4]) const;
         
+        std::shared_ptr<const PaletteLookupTable> getLookupTable(const bool interpolateColorFlag) const;
+        
         void setModified();
         
         void clearModified();
@@ -147,6 +151,12 @@ namespace caret {
         
         /** The inverted palette with negative inverted separate from positive */
         mutable std::unique_ptr<Palette> m_noneSeparateInvertedPalette;
+        
+        /** Lookup tables without [0] and with [1] interpolation, lazily created, DO NOT COPY */
+        mutable std::shared_ptr<const PaletteLookupTable> m_lookupTables[2];
+        
+        /** Protects the lookup tables, coloring may happen in more than one thread */
+        mutable CaretMutex m_lookupTablesMutex;
     };
 
     
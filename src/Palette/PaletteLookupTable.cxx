@@ -0,0 +1,142 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "PaletteLookupTable.h"
+
+#include "CaretAssert.h"
+#include "Palette.h"
+#include "PaletteScalarAndColor.h"
+
+using namespace caret;
+
+/**
+ * Constructor.  Samples the palette at every table position.
+ *
+ * @param palette
+ *    Palette that is sampled.
+ * @param interpolateColorFlag
+ *    Interpolate the color between scalars.
+ */
+PaletteLookupTable::PaletteLookupTable(const Palette& palette,
+                                       const bool interpolateColorFlag)
+{
+    getPaletteSignature(palette,
+                        interpolateColorFlag,
+                        m_signature);
+
+    m_rgbaFloat.resize(NUMBER_OF_ENTRIES * 4);
+    m_rgbaByte.resize(NUMBER_OF_ENTRIES * 4);
+    for (int32_t i = 0; i < NUMBER_OF_ENTRIES; i++) {
+        const float normalizedValue = (float)(i - HALF_RESOLUTION) / HALF_RESOLUTION;
+        float* rgba = &m_rgbaFloat[i * 4];
+        palette.getPaletteColor(normalizedValue,
+                                interpolateColorFlag,
+                                rgba);
+        if ( ! (rgba[3] > 0.0f)) {
+            /*
+             * Coloring never uses the RGB of a color that is not displayed
+             */
+            rgba[0] = 0.0f;
+            rgba[1] = 0.0f;
+            rgba[2] = 0.0f;
+            rgba[3] = 0.0f;
+        }
+        convertColorToByte(rgba,
+                           &m_rgbaByte[i * 4]);
+    }
+}
+
+/**
+ * Is this table still correct for the given palette?  Palettes are small,
+ * so comparing the scalars and colors is much faster than coloring and
+ * also catches changes made to a PaletteScalarAndColor of the palette.
+ *
+ * @param palette
+ *    The palette.
+ * @param interpolateColorFlag
+ *    Interpolate the color between scalars.
+ * @return
+ *    True if the table matches the palette's current scalars and colors.
+ */
+bool
+PaletteLookupTable::isValidFor(const Palette& palette,
+                               const bool interpolateColorFlag) const
+{
+    std::vector<float> signature;
+    getPaletteSignature(palette,
+                        interpolateColorFlag,
+                        signature);
+    return (signature == m_signature);
+}
+
+/**
+ * Convert a color to bytes the same way that node and voxel coloring always has.
+ *
+ * @param rgbaFloat
+ *    RGBA color ranging zero to one.
+ * @param rgbaByteOut
+ *    Output RGBA color ranging zero to 255.
+ */
+void
+PaletteLookupTable::convertColorToByte(const float rgbaFloat[4],
+                                       uint8_t rgbaByteOut[4])
+{
+    rgbaByteOut[0] = rgbaFloat[0] * 255.0;
+    rgbaByteOut[1] = rgbaFloat[1] * 255.0;
+    rgbaByteOut[2] = rgbaFloat[2] * 255.0;
+    if (rgbaFloat[3] > 0.0) {
+        rgbaByteOut[3] = rgbaFloat[3] * 255.0;
+    }
+    else {
+        rgbaByteOut[3] = 0;
+    }
+}
+
+/**
+ * Get everything in a palette that affects its colors.
+ *
+ * @param palette
+ *    The palette.
+ * @param interpolateColorFlag
+ *    Interpolate the color between scalars.
+ * @param signatureOut
+ *    Output with the scalars and colors.
+ */
+void
+PaletteLookupTable::getPaletteSignature(const Palette& palette,
+                                        const bool interpolateColorFlag,
+                                        std::vector<float>& signatureOut)
+{
+    const int32_t numScalarColors = palette.getNumberOfScalarsAndColors();
+    signatureOut.clear();
+    signatureOut.reserve(numScalarColors * 6 + 1);
+    signatureOut.push_back(interpolateColorFlag ? 1.0f : 0.0f);
+    for (int32_t i = 0; i < numScalarColors; i++) {
+        const PaletteScalarAndColor* psac = palette.getScalarAndColor(i);
+        CaretAssert(psac);
+        const float* rgba = psac->getColor();
+        signatureOut.push_back(psac->getScalar());
+        signatureOut.push_back(psac->isNoneColor() ? 1.0f : 0.0f);
+        signatureOut.push_back(rgba[0]);
+        signatureOut.push_back(rgba[1]);
+        signatureOut.push_back(rgba[2]);
+        signatureOut.push_back(rgba[3]);
+    }
+}
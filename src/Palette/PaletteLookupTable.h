@@ -0,0 +1,105 @@
+#ifndef __PALETTE_LOOKUP_TABLE_H__
+#define __PALETTE_LOOKUP_TABLE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+
+    class Palette;
+
+    /**
+     * Colors of a palette sampled at a fixed resolution over the
+     * normalized range [-1, 1], so that coloring many values is
+     * a table lookup instead of a search of the palette.
+     */
+    class PaletteLookupTable {
+
+    public:
+        /** Number of table entries between zero and one (and zero and negative one) */
+        static const int32_t HALF_RESOLUTION = 8192;
+
+        /** Number of entries in the table */
+        static const int32_t NUMBER_OF_ENTRIES = 2 * HALF_RESOLUTION + 1;
+
+        PaletteLookupTable(const Palette& palette,
+                           const bool interpolateColorFlag);
+
+        bool isValidFor(const Palette& palette,
+                        const bool interpolateColorFlag) const;
+
+        /**
+         * Get the index of the entry for a normalized value.  The entry is
+         * sampled at the smallest table position that is not less than the value,
+         * so palette scalars that fall on a table position (such as zero) separate
+         * colors exactly.  Values outside [-1, 1] are clamped, NaN gets the entry
+         * for -1.  There are no branches so that loops calling this vectorize.
+         *
+         * @param normalizedValue
+         *    Value in the range [-1, 1].
+         * @return
+         *    Index in [0, NUMBER_OF_ENTRIES - 1].
+         */
+        inline int32_t getIndex(const float normalizedValue) const {
+            float position = normalizedValue * HALF_RESOLUTION;
+            position = ((position > -HALF_RESOLUTION) ? position : -HALF_RESOLUTION);
+            position = ((position < HALF_RESOLUTION) ? position : HALF_RESOLUTION);
+            const int32_t truncated = (int32_t)position;
+            return HALF_RESOLUTION + truncated + ((position > (float)truncated) ? 1 : 0);
+        }
+
+        /**
+         * @return Pointer to the RGBA (4) float colors, ranging zero to one, of all entries.
+         * An entry with a "none" color is all zeros.
+         */
+        inline const float* getColorsFloat() const { return m_rgbaFloat.data(); }
+
+        /**
+         * @return Pointer to the RGBA (4) byte colors of all entries, as they
+         * would be converted from the float colors.
+         */
+        inline const uint8_t* getColorsByte() const { return m_rgbaByte.data(); }
+
+        static void convertColorToByte(const float rgbaFloat[4],
+                                       uint8_t rgbaByteOut[4]);
+
+    private:
+        PaletteLookupTable(const PaletteLookupTable&);
+
+        PaletteLookupTable& operator=(const PaletteLookupTable&);
+
+        static void getPaletteSignature(const Palette& palette,
+                                        const bool interpolateColorFlag,
+                                        std::vector<float>& signatureOut);
+
+        /** Scalars and colors of the palette when the table was created */
+        std::vector<float> m_signature;
+
+        std::vector<float> m_rgbaFloat;
+
+        std::vector<uint8_t> m_rgbaByte;
+    };
+
+} // namespace
+
+#endif // __PALETTE_LOOKUP_TABLE_H__
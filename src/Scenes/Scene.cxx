@@ -23,14 +23,62 @@
 #include "Scene.h"
 #undef __SCENE_DECLARE__
 
+#include <algorithm>
+#include <list>
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QXmlStreamReader>
+
 #include "CaretAssert.h"
+#include "CaretLogger.h"
 #include "SceneAttributes.h"
 #include "SceneClass.h"
 #include "SceneInfo.h"
+#include "SceneXmlStreamReader.h"
 #include "WuQMacroGroup.h"
 
 using namespace caret;
 
+namespace {
+    /**
+     * Scenes whose classes were read from their scene file when needed,
+     * most recently read at the front.  Classes of the least recently read
+     * scenes are released when the size of their XML exceeds the maximum
+     * and are read again if they are needed.
+     */
+    std::list<Scene*> s_scenesWithContentReadFromFile;
+    
+    /** Size of the XML of the scenes whose classes were read from their scene file */
+    int64_t s_contentBytesReadFromFile = 0;
+    
+    const int64_t MAXIMUM_CONTENT_BYTES_READ_FROM_FILE = 128 * 1024 * 1024;
+    
+    /**
+     * Classes of this many of the most recently read scenes are never released
+     * since they may be in use (scene being restored, compared, etc.)
+     */
+    const size_t MINIMUM_SCENES_WITH_CONTENT_READ_FROM_FILE = 4;
+    
+    /**
+     * Remove a scene from the scenes whose classes were read from their scene file.
+     */
+    void forgetSceneWithContentReadFromFile(Scene* scene,
+                                            const int64_t numberOfBytes)
+    {
+        auto iter = std::find(s_scenesWithContentReadFromFile.begin(),
+                              s_scenesWithContentReadFromFile.end(),
+                              scene);
+        if (iter != s_scenesWithContentReadFromFile.end()) {
+            s_scenesWithContentReadFromFile.erase(iter);
+            s_contentBytesReadFromFile -= numberOfBytes;
+        }
+    }
+}
+
 /**
  * \defgroup Scene  
  */
@@ -245,6 +293,8 @@ Scene::Scene(const SceneTypeEnum::Enum sceneType)
 Scene::Scene(const Scene& rhs)
 :CaretObjectTracksModification()
 {
+    rhs.loadContentFromFile();
+    
     m_sceneAttributes = new SceneAttributes(*(rhs.m_sceneAttributes));
     m_hasFilesWithRemotePaths = rhs.m_hasFilesWithRemotePaths;
     m_sceneInfo = new SceneInfo(*(rhs.m_sceneInfo));
@@ -265,11 +315,16 @@ Scene::Scene(const Scene& rhs)
  */
 Scene::~Scene()
 {
+    if (s_sceneBeingRestored == this) {
+        s_sceneBeingRestored = NULL;
+    }
+    forgetSceneWithContentReadFromFile(this,
+                                       m_contentNumberOfBytes);
+    
     delete m_sceneAttributes;
 
-    const int32_t numberOfSceneClasses = this->getNumberOfClasses();
-    for (int32_t i = 0; i < numberOfSceneClasses; i++) {
-        delete m_sceneClasses[i];
+    for (auto sceneClass : m_sceneClasses) {
+        delete sceneClass;
     }
     m_sceneClasses.clear();
     
@@ -289,6 +344,352 @@ Scene::initializeMacroGroup()
     m_macroGroup->clearModified();
 }
 
+/**
+ * Set the location of the scene's element in its scene file so that
+ * the scene's classes are read from the file only when they are needed.
+ * The scene must not contain any classes.
+ *
+ * @param sceneFileName
+ *    Name of the scene file.
+ * @param byteOffset
+ *    Offset of the scene's start element in the file.
+ * @param numberOfBytes
+ *    Number of bytes from the start through the end of the scene's element.
+ * @param fileSize
+ *    Size of the scene file when it was read.
+ * @param fileLastModifiedMilliseconds
+ *    Modification time of the scene file when it was read.
+ */
+void
+Scene::setContentLocationInFile(const AString& sceneFileName,
+                                const int64_t byteOffset,
+                                const int64_t numberOfBytes,
+                                const int64_t fileSize,
+                                const int64_t fileLastModifiedMilliseconds)
+{
+    CaretAssert(m_sceneClasses.empty());
+    CaretAssert(m_contentFileName.isEmpty());
+    
+    m_contentFileName      = sceneFileName;
+    m_contentByteOffset    = byteOffset;
+    m_contentNumberOfBytes = numberOfBytes;
+    m_contentFileSize      = fileSize;
+    m_contentFileLastModifiedMilliseconds = fileLastModifiedMilliseconds;
+    m_contentHash.clear();
+    m_contentLoadedFlag    = false;
+}
+
+/**
+ * If the scene's classes have not been read from the scene file, read them.
+ */
+void
+Scene::loadContentFromFile() const
+{
+    if ( ! m_contentLoadedFlag) {
+        /*
+         * Classes are part of the scene even if they have not been read
+         */
+        const_cast<Scene*>(this)->readContentFromFile();
+    }
+}
+
+/**
+ * Read the scene's classes, if needed, and keep them in memory from
+ * now on.  Must be called before the scene file is written since the
+ * scene's location in the file is no longer valid.
+ */
+void
+Scene::detachContentFromFile()
+{
+    loadContentFromFile();
+    
+    forgetSceneWithContentReadFromFile(this,
+                                       m_contentNumberOfBytes);
+    m_contentFileName.clear();
+}
+
+/**
+ * Read the scene's classes from the scene's element in the scene file.
+ * If the element cannot be read, the entire scene file is read and the
+ * classes are kept in memory from then on.  Classes of the least recently
+ * read scenes may be released.
+ */
+void
+Scene::readContentFromFile()
+{
+    CaretAssert( ! m_contentLoadedFlag);
+    CaretAssert( ! m_contentFileName.isEmpty());
+    m_contentLoadedFlag = true;
+    
+    AString errorMessage;
+    if ( ! readContentFromLocationInFile(errorMessage)) {
+        CaretLogWarning("Failed to read scene \""
+                        + getName()
+                        + "\" from its location in "
+                        + m_contentFileName
+                        + ": "
+                        + errorMessage
+                        + ".  Reading the entire scene file.");
+        
+        AString fullErrorMessage;
+        if ( ! readContentFromEntireFile(fullErrorMessage)) {
+            CaretLogSevere("Failed to read scene \""
+                           + getName()
+                           + "\" from "
+                           + m_contentFileName
+                           + ": "
+                           + fullErrorMessage);
+        }
+        
+        /*
+         * Location in the file is no longer valid so the
+         * classes can never be released
+         */
+        m_contentFileName.clear();
+        return;
+    }
+    
+    s_scenesWithContentReadFromFile.push_front(this);
+    s_contentBytesReadFromFile += m_contentNumberOfBytes;
+    
+    size_t sceneCount(s_scenesWithContentReadFromFile.size());
+    auto iter = s_scenesWithContentReadFromFile.end();
+    while ((s_contentBytesReadFromFile > MAXIMUM_CONTENT_BYTES_READ_FROM_FILE)
+           && (sceneCount > MINIMUM_SCENES_WITH_CONTENT_READ_FROM_FILE)) {
+        --iter;
+        --sceneCount;
+        Scene* scene = *iter;
+        if (( ! scene->isModified())
+            && (scene != s_sceneBeingRestored)
+            && (scene != s_sceneBeingCreated)) {
+            s_contentBytesReadFromFile -= scene->m_contentNumberOfBytes;
+            iter = s_scenesWithContentReadFromFile.erase(iter);
+            if (scene->isContentFileUnchanged()) {
+                scene->releaseContentReadFromFile();
+            }
+            else {
+                /*
+                 * Classes could not be read again so keep them in memory
+                 */
+                scene->m_contentFileName.clear();
+            }
+        }
+    }
+}
+
+/**
+ * Read the scene's classes from the scene's element at its location in the scene file.
+ *
+ * @param errorMessageOut
+ *    Describes the error if reading fails.
+ * @return
+ *    True if the classes were read, else false.
+ */
+bool
+Scene::readContentFromLocationInFile(AString& errorMessageOut)
+{
+    if ( ! isContentFileUnchanged()) {
+        errorMessageOut = "File was modified after it was opened";
+        return false;
+    }
+    
+    QFile file(m_contentFileName);
+    if ( ! file.open(QFile::ReadOnly)) {
+        errorMessageOut = file.errorString();
+        return false;
+    }
+    if ( ! file.seek(m_contentByteOffset)) {
+        errorMessageOut = file.errorString();
+        return false;
+    }
+    
+    const QByteArray sceneBytes(file.read(m_contentNumberOfBytes));
+    file.close();
+    if (sceneBytes.size() != m_contentNumberOfBytes) {
+        errorMessageOut = ("Read "
+                           + AString::number(sceneBytes.size())
+                           + " bytes but scene contains "
+                           + AString::number(m_contentNumberOfBytes)
+                           + " bytes");
+        return false;
+    }
+    
+    /*
+     * Hash verifies that the scene's element has not changed since it was first read
+     */
+    const QByteArray sceneHash(QCryptographicHash::hash(sceneBytes,
+                                                        QCryptographicHash::Md5));
+    if (( ! m_contentHash.isEmpty())
+        && (sceneHash != m_contentHash)) {
+        errorMessageOut = "Scene's content in file has changed";
+        return false;
+    }
+    
+    QXmlStreamReader xmlReader(sceneBytes);
+    xmlReader.readNextStartElement();
+    if ( ! takeContentFromXml(xmlReader,
+                              false,
+                              errorMessageOut)) {
+        return false;
+    }
+    
+    m_contentHash = sceneHash;
+    
+    return true;
+}
+
+/**
+ * Read the scene's classes by reading the entire scene file and using
+ * the first scene with the same name as this scene.
+ *
+ * @param errorMessageOut
+ *    Describes the error if reading fails.
+ * @return
+ *    True if the classes were read, else false.
+ */
+bool
+Scene::readContentFromEntireFile(AString& errorMessageOut)
+{
+    QFile file(m_contentFileName);
+    if ( ! file.open(QFile::ReadOnly)) {
+        errorMessageOut = file.errorString();
+        return false;
+    }
+    
+    QXmlStreamReader xmlReader(&file);
+    while ( ! xmlReader.atEnd()) {
+        xmlReader.readNext();
+        if (xmlReader.isStartElement()
+            && (xmlReader.name() == SceneXmlStreamReader::ELEMENT_SCENE)) {
+            if ( ! takeContentFromXml(xmlReader,
+                                      true,
+                                      errorMessageOut)) {
+                if (errorMessageOut.isEmpty()) {
+                    continue;
+                }
+                return false;
+            }
+            return true;
+        }
+    }
+    
+    if (xmlReader.hasError()) {
+        errorMessageOut = xmlReader.errorString();
+    }
+    else {
+        errorMessageOut = "No scene named \"" + getName() + "\" was found in the file";
+    }
+    return false;
+}
+
+/**
+ * Read a scene from the given XML stream reader, which must be at the
+ * scene's start element, and take its classes.  Name, description, and
+ * macros were read with the scene file and may have been changed so only
+ * the classes are taken.
+ *
+ * @param xmlReader
+ *    The XML stream reader.
+ * @param requireSameNameFlag
+ *    If true, the classes are taken only if the scene read has the same
+ *    name as this scene.
+ * @param errorMessageOut
+ *    Describes the error if reading fails, empty if the scene was read
+ *    but has a different name.
+ * @return
+ *    True if the classes were taken, else false.
+ */
+bool
+Scene::takeContentFromXml(QXmlStreamReader& xmlReader,
+                          const bool requireSameNameFlag,
+                          AString& errorMessageOut)
+{
+    errorMessageOut.clear();
+    
+    Scene sceneFromFile(m_sceneAttributes->getSceneType());
+    SceneXmlStreamReader sceneReader;
+    sceneReader.readScene(xmlReader,
+                          &sceneFromFile,
+                          m_contentFileName);
+    if (xmlReader.hasError()) {
+        errorMessageOut = xmlReader.errorString();
+        return false;
+    }
+    if (requireSameNameFlag
+        && (sceneFromFile.getName() != getName())) {
+        return false;
+    }
+    
+    for (auto sceneClass : m_sceneClasses) {
+        delete sceneClass;
+    }
+    m_sceneClasses.clear();
+    m_sceneClasses.swap(sceneFromFile.m_sceneClasses);
+    m_hasFilesWithRemotePaths = sceneFromFile.m_hasFilesWithRemotePaths;
+    
+    if ( ! m_releasedContentRestoredFlags.empty()) {
+        const std::vector<SceneObject*> descendants(getDescendants());
+        if (descendants.size() == m_releasedContentRestoredFlags.size()) {
+            for (size_t i = 0; i < descendants.size(); i++) {
+                descendants[i]->setRestored(m_releasedContentRestoredFlags[i]);
+            }
+        }
+        m_releasedContentRestoredFlags.clear();
+    }
+    
+    return true;
+}
+
+/**
+ * @return True if the scene file has the same size and modification time
+ * as when it was read so that the scene's classes can be read again.
+ */
+bool
+Scene::isContentFileUnchanged() const
+{
+    if (m_contentFileName.isEmpty()) {
+        return false;
+    }
+    
+    const QFileInfo fileInfo(m_contentFileName);
+    return (fileInfo.exists()
+            && (fileInfo.size() == m_contentFileSize)
+            && (fileInfo.lastModified().toMSecsSinceEpoch() == m_contentFileLastModifiedMilliseconds));
+}
+
+/**
+ * Delete the scene's classes that were read from the scene file.
+ * They are read again when needed.
+ */
+void
+Scene::releaseContentReadFromFile()
+{
+    CaretAssert(m_contentLoadedFlag);
+    CaretAssert( ! m_contentFileName.isEmpty());
+    
+    /*
+     * Restored status is only kept if any descendant was restored
+     */
+    m_releasedContentRestoredFlags.clear();
+    const std::vector<SceneObject*> descendants(getDescendants());
+    for (auto sceneObject : descendants) {
+        if (sceneObject->isRestored()) {
+            m_releasedContentRestoredFlags.reserve(descendants.size());
+            for (auto so : descendants) {
+                m_releasedContentRestoredFlags.push_back(so->isRestored());
+            }
+            break;
+        }
+    }
+    
+    for (auto sceneClass : m_sceneClasses) {
+        delete sceneClass;
+    }
+    m_sceneClasses.clear();
+    m_hasFilesWithRemotePaths = false;
+    m_contentLoadedFlag = false;
+}
+
 /**
  * @return All descendant SceneClasses (children, grandchildren, etc.) of this instance.
  */
@@ -353,6 +754,8 @@ Scene::getAttributes()
 void
 Scene::addClass(SceneClass* sceneClass)
 {
+    loadContentFromFile();
+    
     if (sceneClass != NULL) {
         m_sceneClasses.push_back(sceneClass);
         setModified();
@@ -366,6 +769,8 @@ Scene::addClass(SceneClass* sceneClass)
 int32_t
 Scene::getNumberOfClasses() const
 {
+    loadContentFromFile();
+    
     return m_sceneClasses.size();
 }
 
@@ -373,11 +778,16 @@ Scene::getNumberOfClasses() const
  * Get the scene class at the given index.
  * @param indx
  *    Index of the scene class.
- * @return Scene class at the given index.
+ * @return Scene class at the given index.  If the scene's classes are read
+ *    from the scene file when needed, the pointer is temporary: it becomes
+ *    invalid when the classes are released after other scenes are read,
+ *    unless this scene is set with setSceneBeingRestored().
  */
 const SceneClass* 
 Scene::getClassAtIndex(const int32_t indx) const
 {
+    loadContentFromFile();
+    
     CaretAssertVectorIndex(m_sceneClasses, indx);
     m_sceneClasses[indx]->setRestored(true);
     return m_sceneClasses[indx];
@@ -388,6 +798,7 @@ Scene::getClassAtIndex(const int32_t indx) const
  * @param sceneClassName
  *    Name of the scene class.
  * @return Scene class with the given name or NULL if not found.
+ *    See getClassAtIndex() for how long the pointer is valid.
  */
 const SceneClass* 
 Scene::getClassWithName(const AString& sceneClassName) const
@@ -473,6 +884,8 @@ Scene::setDescription(const AString& sceneDescription)
 bool
 Scene::hasFilesWithRemotePaths() const
 {
+    loadContentFromFile();
+    
     return m_hasFilesWithRemotePaths;
 }
 
@@ -485,6 +898,8 @@ Scene::hasFilesWithRemotePaths() const
 void
 Scene::setHasFilesWithRemotePaths(const bool hasFilesWithRemotePaths)
 {
+    loadContentFromFile();
+    
     m_hasFilesWithRemotePaths = hasFilesWithRemotePaths;
 }
 
@@ -497,6 +912,39 @@ Scene::setSceneBeingCreated(Scene* scene)
     s_sceneBeingCreated = scene;
 }
 
+/**
+ * Set a static value for the scene that is being restored.  While set,
+ * the scene's classes are never released, so pointers to them remain valid
+ * even if other scenes are read.  Set to NULL when restoration is finished;
+ * SceneBeingRestoredScoped does so even if restoration throws an exception.
+ */
+void
+Scene::setSceneBeingRestored(const Scene* scene)
+{
+    s_sceneBeingRestored = scene;
+}
+
+/**
+ * Constructor sets the scene being restored.
+ *
+ * @param scene
+ *    Scene that is being restored.
+ */
+Scene::SceneBeingRestoredScoped::SceneBeingRestoredScoped(const Scene* scene)
+: m_previousSceneBeingRestored(s_sceneBeingRestored)
+{
+    setSceneBeingRestored(scene);
+}
+
+/**
+ * Destructor resets the scene being restored to its value before
+ * this instance was created.
+ */
+Scene::SceneBeingRestoredScoped::~SceneBeingRestoredScoped()
+{
+    setSceneBeingRestored(m_previousSceneBeingRestored);
+}
+
 /**
  * Set the scene being created to have files with remote paths.
  */
@@ -23,9 +23,13 @@
 
 #include <memory>
 
+#include <QByteArray>
+
 #include "CaretObjectTracksModification.h"
 #include "SceneTypeEnum.h"
 
+class QXmlStreamReader;
+
 namespace caret {
     class SceneAttributes;
     class SceneClass;
@@ -36,6 +40,24 @@ namespace caret {
     class Scene : public CaretObjectTracksModification {
         
     public:
+        /**
+         * Sets the scene being restored for the lifetime of an instance so that
+         * it is reset when restoration finishes, even by an exception.
+         */
+        class SceneBeingRestoredScoped {
+        public:
+            SceneBeingRestoredScoped(const Scene* scene);
+            
+            ~SceneBeingRestoredScoped();
+            
+            SceneBeingRestoredScoped(const SceneBeingRestoredScoped&) = delete;
+            
+            SceneBeingRestoredScoped& operator=(const SceneBeingRestoredScoped&) = delete;
+            
+        private:
+            const Scene* m_previousSceneBeingRestored;
+        };
+        
         Scene(const SceneTypeEnum::Enum sceneType);
         
         Scene(const Scene& rhs);
@@ -89,10 +111,22 @@ namespace caret {
         
         virtual void clearModified() override;
         
+        void setContentLocationInFile(const AString& sceneFileName,
+                                      const int64_t byteOffset,
+                                      const int64_t numberOfBytes,
+                                      const int64_t fileSize,
+                                      const int64_t fileLastModifiedMilliseconds);
+        
+        void loadContentFromFile() const;
+        
+        void detachContentFromFile();
+        
         // ADD_NEW_METHODS_HERE
 
         static void setSceneBeingCreated(Scene* scene);
         
+        static void setSceneBeingRestored(const Scene* scene);
+        
         static void setSceneBeingCreatedHasFilesWithRemotePaths();
         
         WuQMacroGroup* getMacroGroup();
@@ -107,6 +141,20 @@ namespace caret {
 
         void initializeMacroGroup();
         
+        void readContentFromFile();
+        
+        bool readContentFromLocationInFile(AString& errorMessageOut);
+        
+        bool readContentFromEntireFile(AString& errorMessageOut);
+        
+        bool takeContentFromXml(QXmlStreamReader& xmlReader,
+                                const bool requireSameNameFlag,
+                                AString& errorMessageOut);
+        
+        bool isContentFileUnchanged() const;
+        
+        void releaseContentReadFromFile();
+        
         /** Attributes of the scene*/
         SceneAttributes* m_sceneAttributes;
 
@@ -121,15 +169,49 @@ namespace caret {
         
         std::unique_ptr<WuQMacroGroup> m_macroGroup;
         
+        /** 
+         * Name of the scene file containing the scene's classes when they are
+         * read only when needed, empty if the classes are always in memory
+         */
+        AString m_contentFileName;
+        
+        /** Offset of the scene's element in the scene file */
+        int64_t m_contentByteOffset = 0;
+        
+        /** Number of bytes in the scene's element in the scene file */
+        int64_t m_contentNumberOfBytes = 0;
+        
+        /** Size of the scene file when it was read */
+        int64_t m_contentFileSize = 0;
+        
+        /** Modification time of the scene file when it was read */
+        int64_t m_contentFileLastModifiedMilliseconds = 0;
+        
+        /** MD5 of the scene's element, set when it is first read from the scene file */
+        QByteArray m_contentHash;
+        
+        /** True if the scene's classes are in memory */
+        bool m_contentLoadedFlag = true;
+        
+        /**
+         * Restored status of the scene's descendants, in the order of getDescendants(),
+         * kept when the classes are released so it is not lost when they are read again
+         */
+        std::vector<bool> m_releasedContentRestoredFlags;
+        
         /** When a scene is being created, this will be set */
         static Scene* s_sceneBeingCreated;
         
+        /** When a scene is being restored, this will be set and its classes are never released */
+        static const Scene* s_sceneBeingRestored;
+        
         // ADD_NEW_MEMBERS_HERE
 
     };
     
 #ifdef __SCENE_DECLARE__
     Scene* Scene::s_sceneBeingCreated = NULL;
+    const Scene* Scene::s_sceneBeingRestored = NULL;
 #endif // __SCENE_DECLARE__
 
 } // namespace
@@ -97,6 +97,55 @@ void
 SceneXmlStreamReader::readScene(QXmlStreamReader& xmlReader,
                                 Scene* scene,
                                 const AString& sceneFileName)
+{
+    readSceneElement(xmlReader,
+                     scene,
+                     sceneFileName,
+                     true);
+}
+
+/**
+ * Read a scene from the given XML stream reader except for the scene's
+ * classes, which are skipped.  It assumes that the start element for the
+ * scene has already been read and is the current element.  If
+ * xmlReader.hasError() is set after this method is called, there was
+ * an error reading the scene.
+ *
+ * @param xmlReader
+ *    The XML stream reader
+ * @param scene
+ *    The scene
+ * @param sceneFileName
+ *    Name of the scene file
+ */
+void
+SceneXmlStreamReader::readSceneWithoutClasses(QXmlStreamReader& xmlReader,
+                                              Scene* scene,
+                                              const AString& sceneFileName)
+{
+    readSceneElement(xmlReader,
+                     scene,
+                     sceneFileName,
+                     false);
+}
+
+/**
+ * Read a scene from the given XML stream reader.
+ *
+ * @param xmlReader
+ *    The XML stream reader
+ * @param scene
+ *    The scene
+ * @param sceneFileName
+ *    Name of the scene file
+ * @param readClassesFlag
+ *    If true, read the scene's classes, else skip them
+ */
+void
+SceneXmlStreamReader::readSceneElement(QXmlStreamReader& xmlReader,
+                                       Scene* scene,
+                                       const AString& sceneFileName,
+                                       const bool readClassesFlag)
 {
     CaretAssert(scene);
     if (scene == NULL) {
@@ -130,6 +179,10 @@ SceneXmlStreamReader::readScene(QXmlStreamReader& xmlReader,
                         macroGroupReader.readMacroGroup(xmlReader,
                                                         scene->getMacroGroup());
                     }
+                    else if ((xmlReader.name() == ELEMENT_OBJECT)
+                             && ( ! readClassesFlag)) {
+                        xmlReader.skipCurrentElement();
+                    }
                     else if (xmlReader.name() == ELEMENT_OBJECT) {
                         SceneObject* object = readSceneObject(xmlReader);
                         if (object != NULL) {
@@ -52,9 +52,18 @@ namespace caret {
                        Scene* scene,
                        const AString& sceneFileName);
 
+        void readSceneWithoutClasses(QXmlStreamReader& xmlReader,
+                                     Scene* scene,
+                                     const AString& sceneFileName);
+
         // ADD_NEW_METHODS_HERE
 
     private:
+        void readSceneElement(QXmlStreamReader& xmlReader,
+                              Scene* scene,
+                              const AString& sceneFileName,
+                              const bool readClassesFlag);
+        
         SceneObject* readSceneObject(QXmlStreamReader& xmlReader);
         
         SceneObject* readSceneObjectSingle(QXmlStreamReader& xmlReader);
@@ -0,0 +1,184 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "BenchmarkData.h"
+
+#include "CaretAssert.h"
+#include "CiftiBrainModelsMap.h"
+#include "CiftiFile.h"
+#include "CiftiSeriesMap.h"
+#include "SurfaceFile.h"
+#include "VolumeFile.h"
+
+#include <array>
+#include <cmath>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+void BenchmarkData::makeSphereSurface(SurfaceFile& surfOut, const int32_t& frequency, const float& radius)
+{
+    CaretAssert(frequency > 0);
+    const float phi = (1.0f + sqrt(5.0f)) / 2.0f;
+    const float icoVerts[12][3] = { { -1, phi, 0 }, { 1, phi, 0 }, { -1, -phi, 0 }, { 1, -phi, 0 },
+                                    { 0, -1, phi }, { 0, 1, phi }, { 0, -1, -phi }, { 0, 1, -phi },
+                                    { phi, 0, -1 }, { phi, 0, 1 }, { -phi, 0, -1 }, { -phi, 0, 1 } };
+    const int icoFaces[20][3] = { { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+                                  { 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+                                  { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+                                  { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 } };
+    const int32_t n = frequency;
+    //points on shared edges are identified by their integer weights on the icosahedron vertices, so they are exactly merged
+    map<array<int32_t, 6>, int32_t> pointLookup;
+    vector<float> coords;
+    vector<int32_t> triangles;
+    vector<int32_t> facePoints((n + 1) * (n + 1));
+    for (int face = 0; face < 20; ++face)
+    {
+        for (int32_t i = 0; i <= n; ++i)
+        {
+            for (int32_t j = 0; i + j <= n; ++j)
+            {
+                const int32_t weights[3] = { n - i - j, i, j };
+                array<int32_t, 6> key;
+                key.fill(-1);
+                int numKey = 0;
+                for (int v = 0; v < 3; ++v)
+                {//vertices of a face are not sorted, so insert in order of vertex index
+                    if (weights[v] == 0) continue;
+                    int pos = numKey;
+                    while (pos > 0 && key[(pos - 1) * 2] > icoFaces[face][v])
+                    {
+                        key[pos * 2] = key[(pos - 1) * 2];
+                        key[pos * 2 + 1] = key[(pos - 1) * 2 + 1];
+                        --pos;
+                    }
+                    key[pos * 2] = icoFaces[face][v];
+                    key[pos * 2 + 1] = weights[v];
+                    ++numKey;
+                }
+                auto iter = pointLookup.find(key);
+                if (iter == pointLookup.end())
+                {
+                    float point[3] = { 0.0f, 0.0f, 0.0f };
+                    for (int v = 0; v < 3; ++v)
+                    {
+                        for (int axis = 0; axis < 3; ++axis)
+                        {
+                            point[axis] += weights[v] * icoVerts[icoFaces[face][v]][axis];
+                        }
+                    }
+                    const float length = sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+                    const int32_t newIndex = (int32_t)(coords.size() / 3);
+                    for (int axis = 0; axis < 3; ++axis)
+                    {
+                        coords.push_back(point[axis] * radius / length);
+                    }
+                    iter = pointLookup.insert(make_pair(key, newIndex)).first;
+                }
+                facePoints[i * (n + 1) + j] = iter->second;
+            }
+        }
+        for (int32_t i = 0; i < n; ++i)
+        {
+            for (int32_t j = 0; i + j < n; ++j)
+            {
+                triangles.push_back(facePoints[i * (n + 1) + j]);
+                triangles.push_back(facePoints[(i + 1) * (n + 1) + j]);
+                triangles.push_back(facePoints[i * (n + 1) + j + 1]);
+                if (i + j < n - 1)
+                {
+                    triangles.push_back(facePoints[(i + 1) * (n + 1) + j]);
+                    triangles.push_back(facePoints[(i + 1) * (n + 1) + j + 1]);
+                    triangles.push_back(facePoints[i * (n + 1) + j + 1]);
+                }
+            }
+        }
+    }
+    const int32_t numNodes = (int32_t)(coords.size() / 3), numTriangles = (int32_t)(triangles.size() / 3);
+    CaretAssert(numNodes == 10 * n * n + 2);
+    surfOut.setNumberOfNodesAndTriangles(numNodes, numTriangles);
+    surfOut.setCoordinates(coords.data());
+    for (int32_t i = 0; i < numTriangles; ++i)
+    {
+        surfOut.setTriangle(i, triangles.data() + i * 3);
+    }
+    surfOut.setStructure(StructureEnum::CORTEX_LEFT);
+    surfOut.setSurfaceType(SurfaceTypeEnum::SPHERICAL);
+}
+
+void BenchmarkData::makeDenseTimeseries(CiftiFile& ciftiOut, const int64_t& verticesPerHemisphere, const int64_t& timepoints, const uint32_t& seed)
+{
+    CiftiBrainModelsMap denseMap;
+    denseMap.addSurfaceModel(verticesPerHemisphere, StructureEnum::CORTEX_LEFT);
+    denseMap.addSurfaceModel(verticesPerHemisphere, StructureEnum::CORTEX_RIGHT);
+    CiftiSeriesMap seriesMap;
+    seriesMap.setLength(timepoints);
+    seriesMap.setStep(0.72f);
+    seriesMap.setUnit(CiftiSeriesMap::SECOND);
+    CiftiXML myXML;
+    myXML.setNumberOfDimensions(2);
+    myXML.setMap(CiftiXML::ALONG_COLUMN, denseMap);
+    myXML.setMap(CiftiXML::ALONG_ROW, seriesMap);
+    ciftiOut.setCiftiXML(myXML);
+    const int64_t numRows = denseMap.getLength();
+    vector<float> row(timepoints);
+    for (int64_t i = 0; i < numRows; ++i)
+    {
+        fillSignal(row.data(), timepoints, seed + (uint32_t)i);
+        ciftiOut.setRow(row.data(), i);
+    }
+}
+
+void BenchmarkData::makeVolume(VolumeFile& volOut, const int32_t dims[3], const int64_t& frames, const uint32_t& seed)
+{
+    vector<int64_t> volDims(dims, dims + 3);
+    volDims.push_back(frames);
+    vector<vector<float> > sform(3, vector<float>(4, 0.0f));
+    sform[0][0] = -2.0f;
+    sform[1][1] = 2.0f;
+    sform[2][2] = 2.0f;
+    sform[0][3] = dims[0] - 1.0f;//center the volume on the origin
+    sform[1][3] = 1.0f - dims[1];
+    sform[2][3] = 1.0f - dims[2];
+    volOut.reinitialize(volDims, sform);
+    const int64_t frameSize = (int64_t)dims[0] * dims[1] * dims[2];
+    vector<float> frame(frameSize);
+    for (int64_t f = 0; f < frames; ++f)
+    {
+        fillSignal(frame.data(), frameSize, seed + (uint32_t)f);
+        volOut.setFrame(frame.data(), f);
+    }
+}
+
+void BenchmarkData::fillSignal(float* dataOut, const int64_t& count, const uint32_t& seed)
+{
+    mt19937 generator(seed);
+    normal_distribution<float> noise(0.0f, 1.0f);
+    uniform_real_distribution<float> uniform(0.0f, 6.2831853f);
+    const float phase = uniform(generator), freq = 0.01f + uniform(generator) * 0.01f;
+    for (int64_t i = 0; i < count; ++i)
+    {
+        dataOut[i] = 100.0f + 2.0f * sin(freq * i + phase) + noise(generator);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef __BENCHMARK_DATA_H__
+#define __BENCHMARK_DATA_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+
+namespace caret
+{
+
+    class CiftiFile;
+    class SurfaceFile;
+    class VolumeFile;
+
+    ///synthetic inputs for benchmarks, the same seed always gives the same data
+    class BenchmarkData
+    {
+        BenchmarkData();
+    public:
+        ///subdivided icosahedron sphere, frequency 57 gives the vertex count of fs_LR 32k
+        static void makeSphereSurface(SurfaceFile& surfOut, const int32_t& frequency, const float& radius = 100.0f);
+        ///in-memory dtseries with both cortical hemispheres of the given vertex count
+        static void makeDenseTimeseries(CiftiFile& ciftiOut, const int64_t& verticesPerHemisphere, const int64_t& timepoints, const uint32_t& seed);
+        ///4D volume with a 2mm MNI-like sform
+        static void makeVolume(VolumeFile& volOut, const int32_t dims[3], const int64_t& frames, const uint32_t& seed);
+        ///normally distributed values with a per-row sinusoid, so rows are correlated with some structure
+        static void fillSignal(float* dataOut, const int64_t& count, const uint32_t& seed);
+    };
+
+}
+#endif //__BENCHMARK_DATA_H__
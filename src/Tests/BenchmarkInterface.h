@@ -0,0 +1,76 @@
+#ifndef __BENCHMARK_INTERFACE_H__
+#define __BENCHMARK_INTERFACE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+
+#include <stdint.h>
+
+namespace caret
+{
+
+    ///sizes of the synthetic data, shared by all benchmarks so that runs are comparable
+    struct BenchmarkSettings
+    {
+        int32_t m_meshFrequency;//icosahedron subdivision, 57 gives 32492 vertices like fs_LR 32k
+        int32_t m_timepoints;//length of dtseries rows and of the vectors for dot products
+        int32_t m_volumeDims[3];
+        int32_t m_volumeFrames;
+        int32_t m_smoothingColumns;
+        uint32_t m_seed;
+        BenchmarkSettings()
+        {
+            m_meshFrequency = 57;
+            m_timepoints = 300;
+            m_volumeDims[0] = 91;
+            m_volumeDims[1] = 109;
+            m_volumeDims[2] = 91;
+            m_volumeFrames = 20;
+            m_smoothingColumns = 32;
+            m_seed = 1;
+        }
+    };
+
+    class BenchmarkInterface
+    {
+        AString m_identifier;
+        BenchmarkInterface();//deny construction without arguments
+        BenchmarkInterface& operator=(const BenchmarkInterface& right);//deny assignment
+    protected:
+        BenchmarkInterface(const AString& identifier) : m_identifier(identifier) { }
+    public:
+        const AString& getIdentifier() const { return m_identifier; }
+        ///false if the benchmark can't run in this build (unsupported SIMD, etc), checked after setUp
+        virtual bool isAvailable() const { return true; }
+        ///create the input data, not timed
+        virtual void setUp(const BenchmarkSettings& settings) = 0;
+        ///the timed work, must give the same work for every call
+        virtual void runIteration() = 0;
+        ///free the input data, not timed
+        virtual void tearDown() { }
+        ///number of elements (rows, vertices, voxels...) processed per iteration, for throughput
+        virtual int64_t getItemsPerIteration() const = 0;
+        virtual ~BenchmarkInterface();
+    };
+
+}
+#endif //__BENCHMARK_INTERFACE_H__
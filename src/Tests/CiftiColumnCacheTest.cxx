@@ -0,0 +1,131 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CiftiColumnCacheTest.h"
+#include "CiftiFile.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    void writeTestCifti(const AString& fileName, const int64_t& numRows, const int64_t& numCols)
+    {
+        CiftiBrainModelsMap denseMap;
+        denseMap.addSurfaceModel(numRows, StructureEnum::CORTEX_LEFT);
+        CiftiXML myXML;
+        myXML.setNumberOfDimensions(2);
+        myXML.setMap(CiftiXML::ALONG_COLUMN, denseMap);
+        myXML.setMap(CiftiXML::ALONG_ROW, CiftiScalarsMap(numCols));
+        CiftiFile writer;
+        writer.setWritingFile(fileName);
+        writer.setCiftiXML(myXML);
+        vector<float> row(numCols);
+        for (int64_t i = 0; i < numRows; ++i)
+        {
+            for (int64_t j = 0; j < numCols; ++j)
+            {
+                row[j] = (rand() % 20000) / 100.0f - 100.0f;
+            }
+            writer.setRow(row.data(), i);
+        }
+        writer.writeFile(fileName);
+    }
+}
+
+CiftiColumnCacheTest::CiftiColumnCacheTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void CiftiColumnCacheTest::compareColumns(const AString& ciftiFileName, const AString& cacheFileName)
+{
+    CiftiFile direct(ciftiFileName), cached(ciftiFileName);
+    if (!cached.enableColumnCache(cacheFileName))
+    {
+        setFailed("unable to enable column cache for '" + ciftiFileName + "'");
+        return;
+    }
+    const int64_t numRows = direct.getNumberOfRows(), numCols = direct.getNumberOfColumns();
+    vector<float> directColumn(numRows), cachedColumn(numRows);
+    for (int64_t j = 0; j < numCols; ++j)
+    {
+        direct.getColumn(directColumn.data(), j);
+        cached.getColumn(cachedColumn.data(), j);
+        if (j == 0 && !QFile::exists(cacheFileName))
+        {
+            setFailed("column cache file was not created by reading a column");
+            return;
+        }
+        for (int64_t i = 0; i < numRows; ++i)
+        {
+            if (directColumn[i] != cachedColumn[i])
+            {
+                setFailed("column " + AString::number(j) + ", row " + AString::number(i) + " is " + AString::number(cachedColumn[i]) +
+                          " through the column cache, but " + AString::number(directColumn[i]) + " from the file");
+                return;
+            }
+        }
+    }
+}
+
+void CiftiColumnCacheTest::execute()
+{
+    QTemporaryDir tempDir;
+    if (!tempDir.isValid())
+    {
+        setFailed("unable to create temporary directory");
+        return;
+    }
+    QDir myDir(tempDir.path());
+    const AString firstCifti = myDir.filePath("first.dscalar.nii"), secondCifti = myDir.filePath("second.dscalar.nii");
+    const AString firstCache = myDir.filePath("wb_first.colcache"), secondCache = myDir.filePath("wb_second.colcache");
+    writeTestCifti(firstCifti, 37, 11);
+    {
+        CiftiFile lazy(firstCifti);
+        lazy.enableColumnCache(firstCache);
+        if (QFile::exists(firstCache))
+        {
+            setFailed("column cache file was built before any column was read");
+            return;
+        }
+    }
+    compareColumns(firstCifti, firstCache);
+    if (failed()) return;
+    compareColumns(firstCifti, firstCache);//reuses the existing cache file
+    if (failed()) return;
+    writeTestCifti(firstCifti, 37, 13);//a modified file must rebuild its cache, not use the stale one
+    compareColumns(firstCifti, firstCache);
+    if (failed()) return;
+    const int64_t previousLimit = CiftiFile::getColumnCacheLimit();
+    CiftiFile::setColumnCacheLimit(QFileInfo(firstCache).size() + 1);//room for only one of the cache files
+    writeTestCifti(secondCifti, 29, 7);
+    compareColumns(secondCifti, secondCache);
+    CiftiFile::setColumnCacheLimit(previousLimit);
+    if (failed()) return;
+    if (QFile::exists(firstCache) || !QFile::exists(secondCache))
+    {
+        setFailed("least recently used column cache file was not removed when over the size limit");
+    }
+}
@@ -20,6 +20,8 @@
 
 #include "CiftiFileTest.h"
 #include "CiftiFile.h"
+#include "CiftiXMLCache.h"
+#include "GiftiLabelTable.h"
 using namespace caret;
 CiftiFileTest::CiftiFileTest(const AString &identifier) : TestInterface(identifier)
 {
@@ -29,6 +31,8 @@ void CiftiFileTest::execute()
 {
     testObjectCreateDestroy();
     if(this->failed()) return;
+    testCiftiXMLCacheRoundTrip();
+    if(this->failed()) return;
     testCiftiRead();
     if(this->failed()) return;
     testCiftiReadWriteInMemory();
@@ -49,6 +53,69 @@ void CiftiFileTest::testObjectCreateDestroy()
     delete ciftiFile;
 }
 
+void CiftiFileTest::testCiftiXMLCacheRoundTrip()
+{
+    std::cout << "Testing Cifti XML cache serialization." << std::endl;
+    const int64_t dims[3] = { 4, 5, 6 };
+    const float sform[12] = { -2.0f, 0.0f, 0.0f, 90.0f, 0.0f, 2.0f, 0.0f, -126.0f, 0.0f, 0.0f, 2.0f, -72.0f };
+    CiftiBrainModelsMap denseMap;
+    denseMap.setVolumeSpace(VolumeSpace(dims, sform));
+    std::vector<int64_t> nodes;
+    nodes.push_back(0);
+    nodes.push_back(3);
+    nodes.push_back(7);
+    denseMap.addSurfaceModel(10, StructureEnum::CORTEX_LEFT, nodes);
+    std::vector<int64_t> voxels;
+    for (int64_t i = 0; i < 3; ++i)
+    {
+        voxels.push_back(i);
+        voxels.push_back(i + 1);
+        voxels.push_back(i + 2);
+    }
+    denseMap.addVolumeModel(StructureEnum::THALAMUS_LEFT, voxels);
+    CiftiParcelsMap parcelMap;
+    parcelMap.setVolumeSpace(VolumeSpace(dims, sform));
+    parcelMap.addSurface(10, StructureEnum::CORTEX_LEFT);
+    CiftiParcelsMap::Parcel myParcel;
+    myParcel.m_name = "parcel";
+    myParcel.m_surfaceNodes[StructureEnum::CORTEX_LEFT].insert(5);
+    myParcel.m_voxelIndices.insert(VoxelIJK(3, 4, 5));
+    parcelMap.addParcel(myParcel);
+    CiftiLabelsMap labelMap;
+    labelMap.setLength(2);
+    labelMap.setMapName(1, "second");
+    labelMap.getMapMetadata(0)->set("Description", "labels");
+    labelMap.getMapLabelTable(1)->setLabel(3, "label", 0.25f, 0.5f, 0.75f, 1.0f);
+    CiftiScalarsMap scalarMap(3);
+    scalarMap.setMapName(2, "third");
+    CiftiXML myXML;
+    myXML.setNumberOfDimensions(5);
+    myXML.setMap(0, denseMap);
+    myXML.setMap(1, parcelMap);
+    myXML.setMap(2, labelMap);
+    myXML.setMap(3, scalarMap);
+    myXML.setMap(4, CiftiSeriesMap(7, 1.5f, 0.72f, CiftiSeriesMap::SECOND));
+    myXML.getFileMetaData()->set("Provenance", "test");
+    QByteArray serialized = CiftiXMLCache::serialize(myXML);
+    CiftiXML readBack;
+    if (!CiftiXMLCache::deserialize(serialized.constData(), serialized.size(), readBack))
+    {
+        setFailed("failed to deserialize cached Cifti XML");
+        return;
+    }
+    if (readBack != myXML)
+    {
+        setFailed("cached Cifti XML does not match the original");
+        return;
+    }
+    if (CiftiXMLCache::deserialize(serialized.constData(), serialized.size() - 1, readBack))
+    {
+        setFailed("truncated Cifti XML cache data was accepted");
+        return;
+    }
+    std::cout << "Cifti XML cache serialization round trip successful." << std::endl;
+}
+
 void CiftiFileTest::testCiftiRead()
 {
     //warning the data set for this is HUGE, and it will take a few minutes to run
@@ -29,6 +29,7 @@ public:
     CiftiFileTest(const AString &identifier);
     void execute();
     void testObjectCreateDestroy();
+    void testCiftiXMLCacheRoundTrip();
     void testCiftiRead();
     void testCiftiReadWriteInMemory();
     void testCiftiReadWriteOnDisk();
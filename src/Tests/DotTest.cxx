@@ -21,6 +21,7 @@
 
 #include "CaretAssert.h"
 #include "dot_wrapper.h"
+#include "DotBlockKernel.h"
 
 #include <cmath>
 #include <cstdlib>
@@ -199,4 +200,34 @@ void DotTest::execute()
     } else {
         cout << "skipping AVX512FMA, not supported" << endl;
     }
+    //blocked kernel, odd sizes so that the edge handling gets used, compared against naive dsdot
+    dot_set_impl(DOT_NAIVE);
+    const float* blockRows[] = { rand1.data(), rand2.data(), rand3.data(), lowsnrA.data(), lowsnrB.data(), midsnrA.data(), midsnrB.data() };
+    const int NUM_BLOCK_ROWS = 7, BLOCK_LENGTH = 1003;
+    vector<double> blockNaive(NUM_BLOCK_ROWS * NUM_BLOCK_ROWS), blockOut(NUM_BLOCK_ROWS * NUM_BLOCK_ROWS);
+    for (int i = 0; i < NUM_BLOCK_ROWS; ++i)
+    {
+        for (int j = 0; j < NUM_BLOCK_ROWS; ++j)
+        {
+            blockNaive[i * NUM_BLOCK_ROWS + j] = dsdot(blockRows[i], blockRows[j], BLOCK_LENGTH);
+        }
+    }
+    vector<DotSIMDEnum::Enum> blockImpls = DotSIMDEnum::getAllEnums();
+    for (int impl = 0; impl < (int)blockImpls.size(); ++impl)
+    {
+        DotSIMDEnum::Enum blockInUse = DotBlockKernel::setImplementation(blockImpls[impl]);
+        if (blockInUse != blockImpls[impl])
+        {
+            cout << "block kernel " << DotSIMDEnum::toName(blockImpls[impl]) << " using " << DotSIMDEnum::toName(blockInUse) << endl;
+        }
+        DotBlockKernel::compute(blockRows, NUM_BLOCK_ROWS, blockRows + 1, NUM_BLOCK_ROWS - 1, BLOCK_LENGTH, blockOut.data(), NUM_BLOCK_ROWS);
+        for (int i = 0; i < NUM_BLOCK_ROWS; ++i)
+        {
+            for (int j = 0; j < NUM_BLOCK_ROWS - 1; ++j)
+            {
+                checkVal(blockNaive[i * NUM_BLOCK_ROWS + j + 1], blockOut[i * NUM_BLOCK_ROWS + j], "block " + DotSIMDEnum::toName(blockImpls[impl]) + " dot");
+            }
+        }
+    }
+    DotBlockKernel::setImplementation(DOT_AUTO);
 }
@@ -0,0 +1,591 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "KernelBenchmarks.h"
+
+#include "AlgorithmMetricTFCE.h"
+#include "AlgorithmVolumeAffineResample.h"
+#include "AlgorithmVolumeTFCE.h"
+#include "BenchmarkData.h"
+#include "CaretAssert.h"
+#include "CaretMathExpression.h"
+#include "CaretOMP.h"
+#include "CiftiFile.h"
+#include "DotBlockKernel.h"
+#include "FastStatistics.h"
+#include "FloatMatrix.h"
+#include "GeodesicHelper.h"
+#include "MetricFile.h"
+#include "MetricSmoothingObject.h"
+#include "NodeAndVoxelColoring.h"
+#include "PaletteColorMapping.h"
+#include "SurfaceFile.h"
+#include "VolumeFile.h"
+
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    //results are accumulated here so that the compiler can't discard the work
+    volatile double benchmarkSink = 0.0;
+    
+    const int64_t NUM_DOT_ROWS = 2048;
+    const int64_t DOT_PAIRS_PER_ROW = 256;
+    const int DOT_TILE = 64;
+    const int NUM_GEODESIC_STARTS = 256;
+    const float GEODESIC_DISTANCE = 20.0f;
+    const float SMOOTHING_KERNEL = 4.0f;
+    const int64_t NUM_EXPRESSION_ELEMENTS = 1 << 22;
+    const int64_t EXPRESSION_BLOCK = 4096;
+    const int64_t NUM_PALETTE_SCALARS = 1 << 22;
+}
+
+DotBenchmark::DotBenchmark(const DotSIMDEnum::Enum& impl) : BenchmarkInterface("dsdot-" + DotSIMDEnum::toName(impl).toLower())
+{
+    m_impl = impl;
+    m_available = false;
+    m_numRows = 0;
+    m_length = 0;
+}
+
+void DotBenchmark::setUp(const BenchmarkSettings& settings)
+{
+    m_available = (dot_set_impl(m_impl) == m_impl);
+    m_numRows = NUM_DOT_ROWS;
+    m_length = settings.m_timepoints;
+    m_data.resize(m_numRows * m_length);
+    for (int64_t i = 0; i < m_numRows; ++i)
+    {
+        BenchmarkData::fillSignal(m_data.data() + i * m_length, m_length, settings.m_seed + (uint32_t)i);
+    }
+}
+
+void DotBenchmark::runIteration()
+{
+    double total = 0.0;
+#pragma omp CARET_PARFOR schedule(static) reduction(+:total)
+    for (int64_t i = 0; i < m_numRows; ++i)
+    {
+        const float* first = m_data.data() + i * m_length;
+        for (int64_t j = 1; j <= DOT_PAIRS_PER_ROW; ++j)
+        {
+            total += dsdot(first, m_data.data() + ((i + j) % m_numRows) * m_length, (int)m_length);
+        }
+    }
+    benchmarkSink = benchmarkSink + total;
+}
+
+void DotBenchmark::tearDown()
+{
+    vector<float>().swap(m_data);
+    dot_set_impl(DOT_AUTO);
+}
+
+int64_t DotBenchmark::getItemsPerIteration() const
+{
+    return m_numRows * DOT_PAIRS_PER_ROW;
+}
+
+DotBlockBenchmark::DotBlockBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+    m_numRows = 0;
+    m_length = 0;
+}
+
+void DotBlockBenchmark::setUp(const BenchmarkSettings& settings)
+{
+    m_numRows = NUM_DOT_ROWS;
+    m_length = settings.m_timepoints;
+    m_data.resize(m_numRows * m_length);
+    for (int64_t i = 0; i < m_numRows; ++i)
+    {
+        BenchmarkData::fillSignal(m_data.data() + i * m_length, m_length, settings.m_seed + (uint32_t)i);
+    }
+}
+
+void DotBlockBenchmark::runIteration()
+{
+    const int64_t numTiles = m_numRows / DOT_TILE;
+    double total = 0.0;
+#pragma omp CARET_PARFOR schedule(dynamic) reduction(+:total)
+    for (int64_t tile = 0; tile < numTiles * numTiles; ++tile)
+    {
+        const int64_t tileRow = tile / numTiles, tileCol = tile % numTiles;
+        const float* aRows[DOT_TILE];
+        const float* bRows[DOT_TILE];
+        for (int i = 0; i < DOT_TILE; ++i)
+        {
+            aRows[i] = m_data.data() + (tileRow * DOT_TILE + i) * m_length;
+            bRows[i] = m_data.data() + (tileCol * DOT_TILE + i) * m_length;
+        }
+        vector<double> out(DOT_TILE * DOT_TILE);
+        DotBlockKernel::compute(aRows, DOT_TILE, bRows, DOT_TILE, (int)m_length, out.data(), DOT_TILE);
+        total += out[0];
+    }
+    benchmarkSink = benchmarkSink + total;
+}
+
+void DotBlockBenchmark::tearDown()
+{
+    vector<float>().swap(m_data);
+}
+
+int64_t DotBlockBenchmark::getItemsPerIteration() const
+{
+    return (m_numRows / DOT_TILE) * (m_numRows / DOT_TILE) * DOT_TILE * DOT_TILE;
+}
+
+GeodesicBenchmark::GeodesicBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+}
+
+GeodesicBenchmark::~GeodesicBenchmark()
+{
+}
+
+void GeodesicBenchmark::setUp(const BenchmarkSettings& settings)
+{
+    m_surface.grabNew(new SurfaceFile());
+    BenchmarkData::makeSphereSurface(*m_surface, settings.m_meshFrequency);
+    const int32_t numNodes = m_surface->getNumberOfNodes();
+    m_startNodes.resize(NUM_GEODESIC_STARTS);
+    for (int i = 0; i < NUM_GEODESIC_STARTS; ++i)
+    {
+        m_startNodes[i] = (int32_t)(((int64_t)i * 7919 + settings.m_seed) % numNodes);
+    }
+    m_surface->getGeodesicHelper();//build the shared neighbor lists outside of the timing
+}
+
+void GeodesicBenchmark::runIteration()
+{
+    int64_t total = 0;
+#pragma omp CARET_PAR
+    {
+        CaretPointer<GeodesicHelper> myHelper = m_surface->getGeodesicHelper();
+        vector<int32_t> nodes;
+        vector<float> dists;
+#pragma omp CARET_FOR schedule(dynamic) reduction(+:total)
+        for (int i = 0; i < (int)m_startNodes.size(); ++i)
+        {
+            myHelper->getNodesToGeoDist(m_startNodes[i], GEODESIC_DISTANCE, nodes, dists);
+            total += (int64_t)nodes.size();
+        }
+    }
+    benchmarkSink = benchmarkSink + total;
+}
+
+void GeodesicBenchmark::tearDown()
+{
+    m_surface.grabNew(NULL);
+}
+
+int64_t GeodesicBenchmark::getItemsPerIteration() const
+{
+    return (int64_t)m_startNodes.size();
+}
+
+MetricSmoothingBenchmark::MetricSmoothingBenchmark(const AString& identifier, const bool& weightsOnly) : BenchmarkInterface(identifier)
+{
+    m_weightsOnly = weightsOnly;
+}
+
+MetricSmoothingBenchmark::~MetricSmoothingBenchmark()
+{
+}
+
+void MetricSmoothingBenchmark::setUp(const BenchmarkSettings& settings)
+{
+    m_surface.grabNew(new SurfaceFile());
+    BenchmarkData::makeSphereSurface(*m_surface, settings.m_meshFrequency);
+    const int32_t numNodes = m_surface->getNumberOfNodes();
+    m_input.grabNew(new MetricFile());
+    m_output.grabNew(new MetricFile());
+    m_input->setNumberOfNodesAndColumns(numNodes, settings.m_smoothingColumns);
+    m_input->setStructure(m_surface->getStructure());
+    vector<float> column(numNodes);
+    for (int32_t i = 0; i < settings.m_smoothingColumns; ++i)
+    {
+        BenchmarkData::fillSignal(column.data(), numNodes, settings.m_seed + (uint32_t)i);
+        m_input->setValuesForColumn(i, column.data());
+    }
+    if (!m_weightsOnly)
+    {
+        m_smoother.grabNew(new MetricSmoothingObject(m_surface, SMOOTHING_KERNEL));
+    }
+}
+
+void MetricSmoothingBenchmark::runIteration()
+{
+    if (m_weightsOnly)
+    {
+        MetricSmoothingObject mySmoother(m_surface, SMOOTHING_KERNEL);
+    } else {
+        m_smoother->smoothMetric(m_input, m_output);
+    }
+}
+
+void MetricSmoothingBenchmark::tearDown()
+{
+    m_smoother.grabNew(NULL);
+    m_output.grabNew(NULL);
+    m_input.grabNew(NULL);
+    m_surface.grabNew(NULL);
+}
+
+int64_t MetricSmoothingBenchmark::getItemsPerIteration() const
+{
+    if (m_weightsOnly) return m_input->getNumberOfNodes();
+    return (int64_t)m_input->getNumberOfNodes() * m_input->getNumberOfColumns();
+}
+
+CiftiRowBenchmark::CiftiRowBenchmark(const AString& identifier, const bool& writing) : BenchmarkInterface(identifier)
+{
+    m_writing = writing;
+}
+
+CiftiRowBenchmark::~CiftiRowBenchmark()
+{
+}
+
+void CiftiRowBenchmark::setUp(const BenchmarkSettings& settings)
+{
+    m_tempDir.grabNew(new QTemporaryDir());
+    m_memoryFile.grabNew(new CiftiFile());
+    BenchmarkData::makeDenseTimeseries(*m_memoryFile, 10 * (int64_t)settings.m_meshFrequency * settings.m_meshFrequency + 2, settings.m_timepoints, settings.m_seed);
+    if (!m_writing)
+    {
+        const AString fileName = m_tempDir->path() + "/read.dtseries.nii";
+        m_memoryFile->writeFile(fileName);
+        m_diskFile.grabNew(new CiftiFile());
+        m_diskFile->openFile(fileName);
+    }
+}
+
+void CiftiRowBenchmark::runIteration()
+{
+    if (m_writing)
+    {
+        const AString fileName = m_tempDir->path() + "/write.dtseries.nii";
+        CiftiFile writer;
+        writer.setCiftiXML(m_memoryFile->getCiftiXML());
+        writer.setWritingFile(fileName);
+        const int64_t numRows = m_memoryFile->getNumberOfRows(), rowLength = m_memoryFile->getNumberOfColumns();
+        vector<float> row(rowLength);
+        for (int64_t i = 0; i < numRows; ++i)
+        {
+            m_memoryFile->getRow(row.data(), i);
+            writer.setRow(row.data(), i);
+        }
+        writer.writeFile(fileName);
+        return;
+    }
+    const int64_t numRows = m_diskFile->getNumberOfRows(), rowLength = m_diskFile->getNumberOfColumns();
+    double total = 0.0;
+#pragma omp CARET_PAR
+    {
+        vector<float> row(rowLength);
+#pragma omp CARET_FOR schedule(static) reduction(+:total)
+        for (int64_t i = 0; i < numRows; ++i)
+        {
+            m_diskFile->getRow(row.data(), i);
+            total += row[0];
+        }
+    }
+    benchmarkSink = benchmarkSink + total;
+}
+
+void CiftiRowBenchmark::tearDown()
+{
+    m_diskFile.grabNew(NULL);
+    m_memoryFile.grabNew(NULL);
+    m_tempDir.grabNew(NULL);
+}
+
+int64_t CiftiRowBenchmark::getItemsPerIteration() const
+{
+    return m_memoryFile->getNumberOfRows();
+}
+
+NiftiConversionBenchmark::NiftiConversionBenchmark(const AString& identifier, const int16_t& datatype, const bool& writing) : BenchmarkInterface(identifier)
+{
+    m_datatype = datatype;
+    m_writing = writing;
+}
+
+NiftiConversionBenchmark::~NiftiConversionBenchmark()
+{
+}
+
+void NiftiConversionBenchmark::setUp(const BenchmarkSettings& settings)
+{
+    m_tempDir.grabNew(new QTemporaryDir());
+    m_fileName = m_tempDir->path() + "/volume.nii";
+    m_volume.grabNew(new VolumeFile());
+    BenchmarkData::makeVolume(*m_volume, settings.m_volumeDims, settings.m_volumeFrames, settings.m_seed);
+    m_volume->setWritingDataTypeAndScaling(m_datatype, 90.0, 110.0);
+    m_volume->writeFile(m_fileName);
+}
+
+void NiftiConversionBenchmark::runIteration()
+{
+    if (m_writing)
+    {
+        m_volume->writeFile(m_fileName);
+    } else {
+        VolumeFile reader;
+        reader.readFile(m_fileName);
+    }
+}
+
+void NiftiConversionBenchmark::tearDown()
+{
+    m_volume.grabNew(NULL);
+    m_tempDir.grabNew(NULL);
+}
+
+int64_t NiftiConversionBenchmark::getItemsPerIteration() const
+{
+    const vector<int64_t>& dims = m_volume->getOriginalDimensions();
+    int64_t ret = 1;
+    for (size_t i = 0; i < dims.size(); ++i)
+    {
+        ret *= dims[i];
+    }
+    return ret;
+}
+
+MathExpressionBenchmark::MathExpressionBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+}
+
+MathExpressionBenchmark::~MathExpressionBenchmark()
+{
+}
+
+void MathExpressionBenchmark::setUp(const BenchmarkSettings& settings)
+{
+    m_expression.grabNew(new CaretMathExpression("sin(x) * y + exp(-abs(x)) / (1 + y^2)"));
+    m_x.resize(NUM_EXPRESSION_ELEMENTS);
+    m_y.resize(NUM_EXPRESSION_ELEMENTS);
+    m_out.resize(NUM_EXPRESSION_ELEMENTS);
+    BenchmarkData::fillSignal(m_x.data(), NUM_EXPRESSION_ELEMENTS, settings.m_seed);
+    BenchmarkData::fillSignal(m_y.data(), NUM_EXPRESSION_ELEMENTS, settings.m_seed + 1);
+}
+
+void MathExpressionBenchmark::runIteration()
+{
+    const vector<AString> varNames = m_expression->getVarNames();
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t start = 0; start < NUM_EXPRESSION_ELEMENTS; start += EXPRESSION_BLOCK)
+    {
+        vector<const float*> variableData(varNames.size());
+        for (size_t v = 0; v < varNames.size(); ++v)
+        {
+            variableData[v] = (varNames[v] == "x" ? m_x.data() : m_y.data()) + start;
+        }
+        m_expression->evaluateBlock(variableData, min(EXPRESSION_BLOCK, NUM_EXPRESSION_ELEMENTS - start), m_out.data() + start);
+    }
+}
+
+void MathExpressionBenchmark::tearDown()
+{
+    m_expression.grabNew(NULL);
+    vector<float>().swap(m_x);
+    vector<float>().swap(m_y);
+    vector<float>().swap(m_out);
+}
+
+int64_t MathExpressionBenchmark::getItemsPerIteration() const
+{
+    return NUM_EXPRESSION_ELEMENTS;
+}
+
+PaletteColoringBenchmark::PaletteColoringBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+}
+
+PaletteColoringBenchmark::~PaletteColoringBenchmark()
+{
+}
+
+void PaletteColoringBenchmark::setUp(const BenchmarkSettings& settings)
+{
+    m_scalars.resize(NUM_PALETTE_SCALARS);
+    BenchmarkData::fillSignal(m_scalars.data(), NUM_PALETTE_SCALARS, settings.m_seed);
+    for (int64_t i = 0; i < NUM_PALETTE_SCALARS; ++i)
+    {
+        m_scalars[i] -= 100.0f;//both signs, so positive and negative mappings are used
+    }
+    m_rgba.resize(NUM_PALETTE_SCALARS * 4);
+    m_mapping.grabNew(new PaletteColorMapping());
+    m_statistics.grabNew(new FastStatistics(m_scalars.data(), NUM_PALETTE_SCALARS));
+}
+
+void PaletteColoringBenchmark::runIteration()
+{
+    NodeAndVoxelColoring::colorScalarsWithPalette(m_statistics, m_mapping, m_scalars.data(), m_mapping, m_scalars.data(),
+                                                  NUM_PALETTE_SCALARS, m_rgba.data());
+}
+
+void PaletteColoringBenchmark::tearDown()
+{
+    m_statistics.grabNew(NULL);
+    m_mapping.grabNew(NULL);
+    vector<float>().swap(m_scalars);
+    vector<uint8_t>().swap(m_rgba);
+}
+
+int64_t PaletteColoringBenchmark::getItemsPerIteration() const
+{
+    return NUM_PALETTE_SCALARS;
+}
+
+VolumeResampleBenchmark::VolumeResampleBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+}
+
+VolumeResampleBenchmark::~VolumeResampleBenchmark()
+{
+}
+
+void VolumeResampleBenchmark::setUp(const BenchmarkSettings& settings)
+{
+    m_input.grabNew(new VolumeFile());
+    BenchmarkData::makeVolume(*m_input, settings.m_volumeDims, settings.m_volumeFrames, settings.m_seed);
+}
+
+void VolumeResampleBenchmark::runIteration()
+{
+    FloatMatrix myAffine = FloatMatrix::identity(4);
+    const float angle = 0.1f;//small rotation and shift, so every output voxel needs interpolation
+    myAffine[0][0] = cos(angle);
+    myAffine[0][1] = -sin(angle);
+    myAffine[1][0] = sin(angle);
+    myAffine[1][1] = cos(angle);
+    myAffine[0][3] = 0.7f;
+    myAffine[2][3] = -1.3f;
+    const vector<int64_t>& dims = m_input->getOriginalDimensions();
+    const int64_t refDims[3] = { dims[0], dims[1], dims[2] };
+    VolumeFile output;
+    AlgorithmVolumeAffineResample(NULL, m_input, myAffine, refDims, m_input->getSform(), VolumeFile::CUBIC, &output);
+}
+
+void VolumeResampleBenchmark::tearDown()
+{
+    m_input.grabNew(NULL);
+}
+
+int64_t VolumeResampleBenchmark::getItemsPerIteration() const
+{
+    const vector<int64_t>& dims = m_input->getOriginalDimensions();
+    int64_t ret = 1;
+    for (size_t i = 0; i < dims.size(); ++i)
+    {
+        ret *= dims[i];
+    }
+    return ret;
+}
+
+TfceBenchmark::TfceBenchmark(const AString& identifier, const bool& volume) : BenchmarkInterface(identifier)
+{
+    m_volume = volume;
+}
+
+TfceBenchmark::~TfceBenchmark()
+{
+}
+
+void TfceBenchmark::setUp(const BenchmarkSettings& settings)
+{//fillSignal is centered on 100, remove that so there are many clusters of each sign
+    if (m_volume)
+    {
+        m_volumeFile.grabNew(new VolumeFile());
+        BenchmarkData::makeVolume(*m_volumeFile, settings.m_volumeDims, settings.m_volumeFrames, settings.m_seed);
+        const vector<int64_t>& dims = m_volumeFile->getOriginalDimensions();
+        const int64_t frameSize = dims[0] * dims[1] * dims[2];
+        vector<float> frame(frameSize);
+        for (int64_t f = 0; f < settings.m_volumeFrames; ++f)
+        {
+            const float* inFrame = m_volumeFile->getFrame(f);
+            for (int64_t i = 0; i < frameSize; ++i)
+            {
+                frame[i] = inFrame[i] - 100.0f;
+            }
+            m_volumeFile->setFrame(frame.data(), f);
+        }
+    } else {
+        m_surface.grabNew(new SurfaceFile());
+        BenchmarkData::makeSphereSurface(*m_surface, settings.m_meshFrequency);
+        const int32_t numNodes = m_surface->getNumberOfNodes();
+        m_metric.grabNew(new MetricFile());
+        m_metric->setNumberOfNodesAndColumns(numNodes, settings.m_smoothingColumns);
+        m_metric->setStructure(m_surface->getStructure());
+        vector<float> column(numNodes);
+        for (int32_t i = 0; i < settings.m_smoothingColumns; ++i)
+        {
+            BenchmarkData::fillSignal(column.data(), numNodes, settings.m_seed + (uint32_t)i);
+            for (int32_t j = 0; j < numNodes; ++j)
+            {
+                column[j] -= 100.0f;
+            }
+            m_metric->setValuesForColumn(i, column.data());
+        }
+    }
+}
+
+void TfceBenchmark::runIteration()
+{
+    if (m_volume)
+    {
+        VolumeFile output;
+        AlgorithmVolumeTFCE(NULL, m_volumeFile, &output);
+    } else {
+        MetricFile output;
+        AlgorithmMetricTFCE(NULL, m_surface, m_metric, &output);
+    }
+}
+
+void TfceBenchmark::tearDown()
+{
+    m_volumeFile.grabNew(NULL);
+    m_metric.grabNew(NULL);
+    m_surface.grabNew(NULL);
+}
+
+int64_t TfceBenchmark::getItemsPerIteration() const
+{
+    if (m_volume)
+    {
+        const vector<int64_t>& dims = m_volumeFile->getOriginalDimensions();
+        int64_t ret = 1;
+        for (size_t i = 0; i < dims.size(); ++i)
+        {
+            ret *= dims[i];
+        }
+        return ret;
+    }
+    return (int64_t)m_metric->getNumberOfNodes() * m_metric->getNumberOfColumns();
+}
@@ -0,0 +1,193 @@
+#ifndef __KERNEL_BENCHMARKS_H__
+#define __KERNEL_BENCHMARKS_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "BenchmarkInterface.h"
+
+#include "CaretPointer.h"
+#include "dot_wrapper.h"
+
+#include <vector>
+
+class QTemporaryDir;
+
+namespace caret
+{
+
+    class CaretMathExpression;
+    class CiftiFile;
+    class FastStatistics;
+    class MetricFile;
+    class MetricSmoothingObject;
+    class PaletteColorMapping;
+    class SurfaceFile;
+    class VolumeFile;
+
+    ///dsdot between pairs of rows, with one SIMD implementation
+    class DotBenchmark : public BenchmarkInterface
+    {
+        DotSIMDEnum::Enum m_impl;
+        bool m_available;
+        int64_t m_numRows, m_length;
+        std::vector<float> m_data;
+    public:
+        DotBenchmark(const DotSIMDEnum::Enum& impl);
+        bool isAvailable() const { return m_available; }
+        void setUp(const BenchmarkSettings& settings);
+        void runIteration();
+        void tearDown();
+        int64_t getItemsPerIteration() const;
+    };
+
+    ///tiles of an all-pairs dot product matrix, as done by correlation
+    class DotBlockBenchmark : public BenchmarkInterface
+    {
+        int64_t m_numRows, m_length;
+        std::vector<float> m_data;
+    public:
+        DotBlockBenchmark(const AString& identifier);
+        void setUp(const BenchmarkSettings& settings);
+        void runIteration();
+        void tearDown();
+        int64_t getItemsPerIteration() const;
+    };
+
+    class GeodesicBenchmark : public BenchmarkInterface
+    {
+        CaretPointer<SurfaceFile> m_surface;
+        std::vector<int32_t> m_startNodes;
+    public:
+        GeodesicBenchmark(const AString& identifier);
+        ~GeodesicBenchmark();
+        void setUp(const BenchmarkSettings& settings);
+        void runIteration();
+        void tearDown();
+        int64_t getItemsPerIteration() const;
+    };
+
+    ///either the weight computation (construction) or the smoothing of a multi-column metric
+    class MetricSmoothingBenchmark : public BenchmarkInterface
+    {
+        bool m_weightsOnly;
+        CaretPointer<SurfaceFile> m_surface;
+        CaretPointer<MetricFile> m_input, m_output;
+        CaretPointer<MetricSmoothingObject> m_smoother;
+    public:
+        MetricSmoothingBenchmark(const AString& identifier, const bool& weightsOnly);
+        ~MetricSmoothingBenchmark();
+        void setUp(const BenchmarkSettings& settings);
+        void runIteration();
+        void tearDown();
+        int64_t getItemsPerIteration() const;
+    };
+
+    ///reads every row of an on-disk dtseries, or writes every row of a new one
+    class CiftiRowBenchmark : public BenchmarkInterface
+    {
+        bool m_writing;
+        CaretPointer<QTemporaryDir> m_tempDir;
+        CaretPointer<CiftiFile> m_memoryFile, m_diskFile;
+    public:
+        CiftiRowBenchmark(const AString& identifier, const bool& writing);
+        ~CiftiRowBenchmark();
+        void setUp(const BenchmarkSettings& settings);
+        void runIteration();
+        void tearDown();
+        int64_t getItemsPerIteration() const;
+    };
+
+    ///reads or writes a scaled NIfTI volume, timing the datatype conversion along with the I/O
+    class NiftiConversionBenchmark : public BenchmarkInterface
+    {
+        int16_t m_datatype;
+        bool m_writing;
+        CaretPointer<QTemporaryDir> m_tempDir;
+        CaretPointer<VolumeFile> m_volume;
+        AString m_fileName;
+    public:
+        NiftiConversionBenchmark(const AString& identifier, const int16_t& datatype, const bool& writing);
+        ~NiftiConversionBenchmark();
+        void setUp(const BenchmarkSettings& settings);
+        void runIteration();
+        void tearDown();
+        int64_t getItemsPerIteration() const;
+    };
+
+    class MathExpressionBenchmark : public BenchmarkInterface
+    {
+        CaretPointer<CaretMathExpression> m_expression;
+        std::vector<float> m_x, m_y, m_out;
+    public:
+        MathExpressionBenchmark(const AString& identifier);
+        ~MathExpressionBenchmark();
+        void setUp(const BenchmarkSettings& settings);
+        void runIteration();
+        void tearDown();
+        int64_t getItemsPerIteration() const;
+    };
+
+    class PaletteColoringBenchmark : public BenchmarkInterface
+    {
+        CaretPointer<PaletteColorMapping> m_mapping;
+        CaretPointer<FastStatistics> m_statistics;
+        std::vector<float> m_scalars;
+        std::vector<uint8_t> m_rgba;
+    public:
+        PaletteColoringBenchmark(const AString& identifier);
+        ~PaletteColoringBenchmark();
+        void setUp(const BenchmarkSettings& settings);
+        void runIteration();
+        void tearDown();
+        int64_t getItemsPerIteration() const;
+    };
+
+    ///affine resampling of a 4D volume with cubic interpolation
+    class VolumeResampleBenchmark : public BenchmarkInterface
+    {
+        CaretPointer<VolumeFile> m_input;
+    public:
+        VolumeResampleBenchmark(const AString& identifier);
+        ~VolumeResampleBenchmark();
+        void setUp(const BenchmarkSettings& settings);
+        void runIteration();
+        void tearDown();
+        int64_t getItemsPerIteration() const;
+    };
+
+    ///TFCE of every column of a metric on a sphere, or every frame of a volume, with both signs present
+    class TfceBenchmark : public BenchmarkInterface
+    {
+        bool m_volume;
+        CaretPointer<SurfaceFile> m_surface;
+        CaretPointer<MetricFile> m_metric;
+        CaretPointer<VolumeFile> m_volumeFile;
+    public:
+        TfceBenchmark(const AString& identifier, const bool& volume);
+        ~TfceBenchmark();
+        void setUp(const BenchmarkSettings& settings);
+        void runIteration();
+        void tearDown();
+        int64_t getItemsPerIteration() const;
+    };
+
+}
+#endif //__KERNEL_BENCHMARKS_H__
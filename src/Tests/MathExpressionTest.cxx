@@ -55,4 +55,28 @@ void MathExpressionTest::execute()
     {
         setFailed("output value incorrect, expected " + AString::number(correctresult) + ", got " + AString::number(testresult));
     }
+    CaretMathExpression blockExpr("x > 0.5 && y <= 2 || !(x == y) * mod(x, y) + min(x, 3) ^ 2 - round(y / 3)");//test block evaluation against the per-element results
+    const int BLOCK_TEST_SIZE = 1000;
+    vector<float> xvals(BLOCK_TEST_SIZE), yvals(BLOCK_TEST_SIZE), blockOut(BLOCK_TEST_SIZE);
+    for (int i = 0; i < BLOCK_TEST_SIZE; ++i)
+    {
+        xvals[i] = (i % 37) * 0.25f - 4.0f;
+        yvals[i] = (i % 5 == 0) ? xvals[i] : (i % 23) * 0.5f - 5.0f;
+    }
+    vector<const float*> blockVars(2);
+    bool xfirst = (blockExpr.getVarNames()[0] == "x");
+    blockVars[0] = xfirst ? xvals.data() : yvals.data();
+    blockVars[1] = xfirst ? yvals.data() : xvals.data();
+    blockExpr.evaluateBlock(blockVars, BLOCK_TEST_SIZE, blockOut.data());
+    for (int i = 0; i < BLOCK_TEST_SIZE; ++i)
+    {
+        vars[0] = blockVars[0][i];
+        vars[1] = blockVars[1][i];
+        float single = (float)blockExpr.evaluate(vars);
+        if (!(single == blockOut[i]) && !(single != single && blockOut[i] != blockOut[i]))
+        {
+            setFailed("block evaluation differs from single evaluation at element " + AString::number(i) + ", expected " + AString::number(single) + ", got " + AString::number(blockOut[i]));
+            break;
+        }
+    }
 }
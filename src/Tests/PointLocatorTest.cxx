@@ -0,0 +1,83 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "PointLocatorTest.h"
+#include "CaretPointLocator.h"
+#include "MathFunctions.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace caret;
+using namespace std;
+
+PointLocatorTest::PointLocatorTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void PointLocatorTest::execute()
+{
+    const int NUM_POINTS = 5000, NUM_TARGETS = 200, K = 5;
+    vector<float> coords(NUM_POINTS * 3), targets(NUM_TARGETS * 3);
+    for (int i = 0; i < NUM_POINTS * 3; ++i)
+    {
+        coords[i] = (rand() % 20000) / 100.0f - 100.0f;
+    }
+    for (int i = 0; i < NUM_TARGETS * 3; ++i)
+    {
+        targets[i] = (rand() % 24000) / 100.0f - 120.0f;
+    }
+    CaretPointLocator dynamicLocator(coords.data(), NUM_POINTS);
+    CaretPointLocator staticLocator(coords.data(), NUM_POINTS, CaretPointLocator::STATIC_TREE);
+    vector<int64_t> dynamicClosest(NUM_TARGETS), staticClosest(NUM_TARGETS), staticNearest(NUM_TARGETS * K);
+    vector<float> staticNearestDist(NUM_TARGETS * K);
+    dynamicLocator.closestPoints(targets.data(), NUM_TARGETS, dynamicClosest.data());
+    staticLocator.closestPoints(targets.data(), NUM_TARGETS, staticClosest.data());
+    staticLocator.kNearestPoints(targets.data(), NUM_TARGETS, K, staticNearest.data(), staticNearestDist.data());
+    for (int i = 0; i < NUM_TARGETS; ++i)
+    {
+        const float* target = targets.data() + i * 3;
+        vector<float> dists(NUM_POINTS);
+        for (int j = 0; j < NUM_POINTS; ++j)
+        {
+            dists[j] = sqrt(MathFunctions::distanceSquared3D(coords.data() + j * 3, target));
+        }
+        vector<float> sorted = dists;
+        partial_sort(sorted.begin(), sorted.begin() + K, sorted.end());
+        if (dists[dynamicClosest[i]] != sorted[0]) setFailed("dynamic tree closest point wrong for target " + AString::number(i));
+        if (dists[staticClosest[i]] != sorted[0]) setFailed("static tree closest point wrong for target " + AString::number(i));
+        for (int k = 0; k < K; ++k)
+        {
+            if (staticNearest[i * K + k] < 0 || dists[staticNearest[i * K + k]] != sorted[k] || abs(staticNearestDist[i * K + k] - sorted[k]) > 0.0001f)
+            {
+                setFailed("static tree k nearest wrong for target " + AString::number(i));
+            }
+        }
+        const float range = 10.0f;
+        vector<LocatorInfo> dynamicRange = dynamicLocator.pointsInRange(target, range), staticRange = staticLocator.pointsInRange(target, range);
+        sort(dynamicRange.begin(), dynamicRange.end());
+        sort(staticRange.begin(), staticRange.end());
+        if (dynamicRange != staticRange) setFailed("points in range differ for target " + AString::number(i));
+        if ((staticLocator.closestPointLimited(target, range) == -1) != staticRange.empty()) setFailed("static tree limited search wrong for target " + AString::number(i));
+    }
+    int64_t tooFew[K];
+    CaretPointLocator smallLocator(coords.data(), 2, CaretPointLocator::STATIC_TREE);
+    smallLocator.kNearestPoints(targets.data(), 1, K, tooFew);
+    if (tooFew[1] == -1 || tooFew[2] != -1) setFailed("k nearest didn't mark missing points");
+}
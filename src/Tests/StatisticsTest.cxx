@@ -23,6 +23,8 @@
 
 #include "FastStatistics.h"
 #include "DescriptiveStatistics.h"
+#include "ReductionAccumulator.h"
+#include "ReductionOperation.h"
 
 using namespace caret;
 using namespace std;
@@ -76,4 +78,31 @@ void StatisticsTest::execute()
     {
         setFailed(AString("mismatch in 90% negative percentile, full: ") + AString::number(myFullStats.getNegativePercentile(90.0f)) + ", fast: " + AString::number(myFastStats.getApproxNegativePercentile(90.0f)));
     }
+    const int NUM_COLUMNS = 64, NUM_ROWS = NUM_ELEMENTS / NUM_COLUMNS;//reinterpret the data as rows, and check each column against ReductionOperation
+    vector<const float*> rowPointers(NUM_ROWS);
+    for (int i = 0; i < NUM_ROWS; ++i)
+    {
+        rowPointers[i] = myData.data() + i * NUM_COLUMNS;
+    }
+    const ReductionEnum::Enum testReductions[] = { ReductionEnum::MEAN, ReductionEnum::SAMPSTDEV, ReductionEnum::MAX, ReductionEnum::INDEXMIN, ReductionEnum::L2NORM };
+    for (ReductionEnum::Enum myReduce : testReductions)
+    {
+        ReductionAccumulator myAccumulator(myReduce, NUM_COLUMNS);
+        myAccumulator.addRows(rowPointers.data(), NUM_ROWS / 2);//in two blocks, as if streamed from a file
+        myAccumulator.addRows(rowPointers.data() + NUM_ROWS / 2, NUM_ROWS - NUM_ROWS / 2);
+        vector<float> column(NUM_ROWS);
+        for (int j = 0; j < NUM_COLUMNS; ++j)
+        {
+            for (int i = 0; i < NUM_ROWS; ++i)
+            {
+                column[i] = myData[i * NUM_COLUMNS + j];
+            }
+            float expected = ReductionOperation::reduce(column.data(), NUM_ROWS, myReduce), accumulated = myAccumulator.getResult(j);
+            if (abs(expected - accumulated) > abs(expected) * 0.000001f)
+            {
+                setFailed("mismatch in accumulated " + ReductionEnum::toName(myReduce) + " of column " + AString::number(j) + ", reduce: " + AString::number(expected) + ", accumulator: " + AString::number(accumulated));
+                break;
+            }
+        }
+    }
 }
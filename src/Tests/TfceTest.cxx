@@ -0,0 +1,235 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "TfceTest.h"
+#include "TfceMergeTree.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    //TFCE by sweeping the threshold over every distinct data value: between consecutive values, the clusters don't change, so each step integrates exactly
+    vector<double> bruteForceTfce(const vector<int64_t>& offsets, const vector<int64_t>& neighbors, const vector<float>& measure,
+                                  const vector<float>& data, const float* roiData, const double& param_e, const double& param_h)
+    {
+        const int64_t numElements = (int64_t)measure.size();
+        vector<double> ret(numElements, 0.0);
+        for (int sign = 1; sign >= -1; sign -= 2)
+        {
+            vector<double> values(numElements, -1.0);//-1 means not part of any cluster for this sign
+            vector<double> thresholds;
+            for (int64_t i = 0; i < numElements; ++i)
+            {
+                if (roiData != NULL && !(roiData[i] > 0.0f)) continue;
+                const double value = sign * (double)data[i];
+                if (value > 0.0)//also excludes NaN
+                {
+                    values[i] = value;
+                    thresholds.push_back(value);
+                }
+            }
+            sort(thresholds.begin(), thresholds.end());
+            thresholds.erase(unique(thresholds.begin(), thresholds.end()), thresholds.end());
+            double lastThreshold = 0.0;
+            for (size_t t = 0; t < thresholds.size(); ++t)
+            {
+                const double threshold = thresholds[t];
+                const double heightIntegral = (pow(threshold, param_h + 1.0) - pow(lastThreshold, param_h + 1.0)) / (param_h + 1.0);
+                vector<int64_t> cluster(numElements, -1);
+                for (int64_t start = 0; start < numElements; ++start)
+                {
+                    if (values[start] < threshold || cluster[start] != -1) continue;
+                    vector<int64_t> members(1, start);
+                    cluster[start] = start;
+                    double clusterMeasure = 0.0;
+                    for (size_t m = 0; m < members.size(); ++m)
+                    {
+                        const int64_t elem = members[m];
+                        clusterMeasure += measure[elem];
+                        for (int64_t n = offsets[elem]; n < offsets[elem + 1]; ++n)
+                        {
+                            const int64_t neigh = neighbors[n];
+                            if (values[neigh] >= threshold && cluster[neigh] == -1)
+                            {
+                                cluster[neigh] = start;
+                                members.push_back(neigh);
+                            }
+                        }
+                    }
+                    const double contribution = pow(clusterMeasure, param_e) * heightIntegral;
+                    for (size_t m = 0; m < members.size(); ++m)
+                    {
+                        ret[members[m]] += sign * contribution;
+                    }
+                }
+                lastThreshold = threshold;
+            }
+        }
+        return ret;
+    }
+    
+    //random values from a small set so there are many ties, with zeros, mixed signs and some NaN
+    vector<float> randomData(const int64_t& numElements, const bool& continuous)
+    {
+        vector<float> ret(numElements);
+        for (int64_t i = 0; i < numElements; ++i)
+        {
+            const int choice = rand() % 10;
+            if (choice == 0)
+            {
+                ret[i] = numeric_limits<float>::quiet_NaN();
+            } else if (choice == 1) {
+                ret[i] = 0.0f;
+            } else if (continuous) {
+                ret[i] = (rand() % 20001) / 1000.0f - 10.0f;
+            } else {
+                ret[i] = (rand() % 9 - 4) * 0.75f;
+            }
+        }
+        return ret;
+    }
+    
+    vector<float> randomRoi(const int64_t& numElements)
+    {
+        vector<float> ret(numElements);
+        for (int64_t i = 0; i < numElements; ++i)
+        {
+            ret[i] = (rand() % 4 == 0) ? 0.0f : 1.0f;
+        }
+        return ret;
+    }
+}
+
+TfceTest::TfceTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void TfceTest::checkMap(const TfceMergeTree& myTree, const vector<int64_t>& offsets, const vector<int64_t>& neighbors, const vector<float>& measure,
+                        const vector<float>& data, const float* roiData, const float& param_e, const float& param_h, const AString& description)
+{
+    const int64_t numElements = (int64_t)measure.size();
+    vector<float> result(numElements);
+    myTree.compute(data.data(), result.data(), roiData, param_e, param_h);
+    vector<double> expected = bruteForceTfce(offsets, neighbors, measure, data, roiData, param_e, param_h);
+    for (int64_t i = 0; i < numElements; ++i)
+    {
+        const bool excluded = (roiData != NULL && !(roiData[i] > 0.0f)) || !(data[i] > 0.0f || data[i] < 0.0f);
+        const bool bad = excluded ? (result[i] != 0.0f) : !(abs(result[i] - expected[i]) <= 1e-4 * max(1.0, abs(expected[i])));
+        if (bad)
+        {
+            setFailed(description + ": element " + AString::number(i) + " with value " + AString::number(data[i]) + " has TFCE " + AString::number(result[i]) +
+                      ", brute force threshold sweep gives " + AString::number(expected[i]));
+            return;
+        }
+    }
+}
+
+void TfceTest::execute()
+{
+    const float paramE[3] = { 0.5f, 1.0f, 2.0f }, paramH[2] = { 1.0f, 2.0f };
+    for (int trial = 0; trial < 100 && !failed(); ++trial)
+    {//random graphs, symmetric like surface neighbors
+        const int64_t numElements = 1 + rand() % 40;
+        vector<vector<int64_t> > neighborLists(numElements);
+        const int edgeChance = 1 + rand() % 5;
+        for (int64_t i = 0; i < numElements; ++i)
+        {
+            for (int64_t j = i + 1; j < numElements; ++j)
+            {
+                if (rand() % numElements < edgeChance)
+                {
+                    neighborLists[i].push_back(j);
+                    neighborLists[j].push_back(i);
+                }
+            }
+        }
+        vector<int64_t> offsets(1, 0), neighbors;
+        vector<float> measure(numElements);
+        for (int64_t i = 0; i < numElements; ++i)
+        {
+            neighbors.insert(neighbors.end(), neighborLists[i].begin(), neighborLists[i].end());
+            offsets.push_back((int64_t)neighbors.size());
+            measure[i] = 0.1f + (rand() % 1000) / 500.0f;
+        }
+        TfceMergeTree myTree(offsets, neighbors, measure);
+        const vector<float> data = randomData(numElements, trial % 2 == 0);
+        const vector<float> roi = randomRoi(numElements);
+        const float param_e = paramE[trial % 3], param_h = paramH[trial % 2];
+        const AString description = "graph trial " + AString::number(trial);
+        checkMap(myTree, offsets, neighbors, measure, data, NULL, param_e, param_h, description);
+        checkMap(myTree, offsets, neighbors, measure, data, roi.data(), param_e, param_h, description + " with roi");
+    }
+    for (int trial = 0; trial < 50 && !failed(); ++trial)
+    {//grids, face neighbors, i fastest
+        int64_t dims[3];
+        for (int d = 0; d < 3; ++d)
+        {
+            dims[d] = 1 + rand() % 5;
+        }
+        const int64_t numElements = dims[0] * dims[1] * dims[2];
+        const float voxelMeasure = 0.5f + (rand() % 100) / 40.0f;
+        vector<int64_t> offsets(1, 0), neighbors;
+        for (int64_t k = 0; k < dims[2]; ++k)
+        {
+            for (int64_t j = 0; j < dims[1]; ++j)
+            {
+                for (int64_t i = 0; i < dims[0]; ++i)
+                {
+                    if (i > 0) neighbors.push_back(i - 1 + dims[0] * (j + dims[1] * k));
+                    if (i < dims[0] - 1) neighbors.push_back(i + 1 + dims[0] * (j + dims[1] * k));
+                    if (j > 0) neighbors.push_back(i + dims[0] * (j - 1 + dims[1] * k));
+                    if (j < dims[1] - 1) neighbors.push_back(i + dims[0] * (j + 1 + dims[1] * k));
+                    if (k > 0) neighbors.push_back(i + dims[0] * (j + dims[1] * (k - 1)));
+                    if (k < dims[2] - 1) neighbors.push_back(i + dims[0] * (j + dims[1] * (k + 1)));
+                    offsets.push_back((int64_t)neighbors.size());
+                }
+            }
+        }
+        vector<float> measure(numElements, voxelMeasure);
+        TfceMergeTree myTree(dims, voxelMeasure);
+        const vector<float> data = randomData(numElements, trial % 2 == 0);
+        const vector<float> roi = randomRoi(numElements);
+        const float param_e = paramE[trial % 3], param_h = paramH[trial % 2];
+        const AString description = "grid trial " + AString::number(trial);
+        checkMap(myTree, offsets, neighbors, measure, data, NULL, param_e, param_h, description);
+        checkMap(myTree, offsets, neighbors, measure, data, roi.data(), param_e, param_h, description + " with roi");
+    }
+    if (failed()) return;
+    {//every value tied, so there is a single threshold step
+        const int64_t dims[3] = { 4, 3, 2 };
+        const int64_t numElements = dims[0] * dims[1] * dims[2];
+        TfceMergeTree myTree(dims, 1.0f);
+        vector<float> data(numElements, 2.0f), result(numElements);
+        myTree.compute(data.data(), result.data(), NULL, 0.5f, 2.0f);
+        const double expected = pow((double)numElements, 0.5) * pow(2.0, 3.0) / 3.0;
+        for (int64_t i = 0; i < numElements; ++i)
+        {
+            if (!(abs(result[i] - expected) <= 1e-4 * expected))
+            {
+                setFailed("tied grid: element " + AString::number(i) + " has TFCE " + AString::number(result[i]) + ", expected " + AString::number(expected));
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef __TFCETEST_H__
+#define __TFCETEST_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "TestInterface.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace caret
+{
+
+    class TfceMergeTree;
+
+    class TfceTest : public TestInterface
+    {
+        void checkMap(const TfceMergeTree& myTree, const std::vector<int64_t>& offsets, const std::vector<int64_t>& neighbors, const std::vector<float>& measure,
+                      const std::vector<float>& data, const float* roiData, const float& param_e, const float& param_h, const AString& description);
+    public:
+        TfceTest(const AString& identifier);
+        virtual void execute();
+    };
+
+}
+#endif // __TFCETEST_H__
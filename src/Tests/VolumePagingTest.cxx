@@ -0,0 +1,122 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "VolumePagingTest.h"
+#include "AlgorithmCiftiCreateDenseTimeseries.h"
+#include "CaretPointer.h"
+#include "CiftiFile.h"
+#include "FloatMatrix.h"
+#include "GiftiLabelTable.h"
+#include "VolumeFile.h"
+#include <QTemporaryDir>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+VolumePagingTest::VolumePagingTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void VolumePagingTest::execute()
+{
+    QTemporaryDir tempDir;
+    if (!tempDir.isValid())
+    {
+        setFailed("unable to create temporary directory");
+        return;
+    }
+    const AString volumeFileName = tempDir.path() + "/paging_test.nii";
+    const int64_t xdim = 7, ydim = 6, zdim = 5, tdim = 40;
+    vector<int64_t> dims(4);
+    dims[0] = xdim; dims[1] = ydim; dims[2] = zdim; dims[3] = tdim;
+    const vector<vector<float> > sform = FloatMatrix::identity(4).getMatrix();
+    {
+        VolumeFile dataVol(dims, sform);
+        for (int64_t t = 0; t < tdim; ++t)
+        {
+            for (int64_t k = 0; k < zdim; ++k)
+            {
+                for (int64_t j = 0; j < ydim; ++j)
+                {
+                    for (int64_t i = 0; i < xdim; ++i)
+                    {
+                        dataVol.setValue((rand() % 20000) / 100.0f - 100.0f, i, j, k, t);
+                    }
+                }
+            }
+        }
+        dataVol.writeFile(volumeFileName);
+    }
+    vector<int64_t> labelDims(dims.begin(), dims.begin() + 3);
+    VolumeFile labelVol(labelDims, sform, 1, SubvolumeAttributes::LABEL);
+    const int32_t labelKey = labelVol.getMapLabelTable(0)->addLabel("THALAMUS_LEFT", 1.0f, 0.0f, 0.0f);
+    for (int64_t k = 0; k < zdim; ++k)
+    {
+        for (int64_t j = 0; j < ydim; ++j)
+        {
+            for (int64_t i = 0; i < xdim; ++i)
+            {//skip some voxels so the rows aren't a simple copy of the frame layout
+                labelVol.setValue(((i + j + k) % 3 == 0) ? 0.0f : labelKey, i, j, k);
+            }
+        }
+    }
+    const int64_t previousLimit = VolumeFile::getPagedReadingMemoryLimit();
+    CiftiFile unpagedCifti, pagedCifti;
+    {
+        VolumeFile::setPagedReadingMemoryLimit(0);
+        VolumeFile unpagedVol;
+        unpagedVol.readFile(volumeFileName);
+        AlgorithmCiftiCreateDenseTimeseries(NULL, &unpagedCifti, &unpagedVol, &labelVol);
+    }
+    {
+        VolumeFile::setPagedReadingMemoryLimit(xdim * ydim * zdim * sizeof(float) * 4);//much less than the whole file, so frames are read again when they are evicted
+        VolumeFile pagedVol;
+        pagedVol.readFile(volumeFileName);
+        VolumeFile::setPagedReadingMemoryLimit(previousLimit);
+        if (!pagedVol.isPaged())
+        {
+            setFailed("volume was not paged with a small memory limit");
+            return;
+        }
+        AlgorithmCiftiCreateDenseTimeseries(NULL, &pagedCifti, &pagedVol, &labelVol);
+    }
+    const int64_t numRows = unpagedCifti.getNumberOfRows(), numCols = unpagedCifti.getNumberOfColumns();
+    if (numRows != pagedCifti.getNumberOfRows() || numCols != pagedCifti.getNumberOfColumns() || numCols != tdim)
+    {
+        setFailed("paged and unpaged outputs have different dimensions");
+        return;
+    }
+    vector<float> unpagedRow(numCols), pagedRow(numCols);
+    for (int64_t row = 0; row < numRows; ++row)
+    {
+        unpagedCifti.getRow(unpagedRow.data(), row);
+        pagedCifti.getRow(pagedRow.data(), row);
+        for (int64_t col = 0; col < numCols; ++col)
+        {
+            if (unpagedRow[col] != pagedRow[col])
+            {
+                setFailed("row " + AString::number(row) + ", column " + AString::number(col) + " is " + AString::number(pagedRow[col]) +
+                          " from the paged volume, but " + AString::number(unpagedRow[col]) + " from the unpaged volume");
+                return;
+            }
+        }
+    }
+}
@@ -33,6 +33,7 @@
 #include "CaretException.h"
 
 //tests
+#include "CiftiColumnCacheTest.h"
 #include "CiftiFileTest.h"
 #include "DotTest.h"
 #include "GeodesicHelperTest.h"
@@ -41,13 +42,16 @@
 #include "LookupTest.h"
 #include "MathExpressionTest.h"
 #include "NiftiTest.h"
+#include "PointLocatorTest.h"
 #include "PointerTest.h"
 #include "ProgressTest.h"
 #include "QuatTest.h"
 #include "StatisticsTest.h"
+#include "TfceTest.h"
 #include "TimerTest.h"
 #include "TopologyHelperTest.h"
 #include "VolumeFileTest.h"
+#include "VolumePagingTest.h"
 #include "XnatTest.h"
 
 using namespace std;
@@ -69,6 +73,7 @@ int main(int argc, char** argv)
         caret_global_commandLine_init(argc, argv);
         SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
         vector<TestInterface*> mytests;
+        mytests.push_back(new CiftiColumnCacheTest("cifticolumncache"));
         mytests.push_back(new CiftiFileTest("ciftifile"));
         mytests.push_back(new DotTest("dotsimd"));
         mytests.push_back(new GeodesicHelperTest("geohelp"));
@@ -78,13 +83,16 @@ int main(int argc, char** argv)
         mytests.push_back(new MathExpressionTest("mathexpression"));
         mytests.push_back(new NiftiFileTest("niftifile"));
         mytests.push_back(new NiftiHeaderTest("niftiheader"));
+        mytests.push_back(new PointLocatorTest("pointlocator"));
         mytests.push_back(new PointerTest("pointer"));
         mytests.push_back(new ProgressTest("progress"));
         mytests.push_back(new QuatTest("quaternion"));
         mytests.push_back(new StatisticsTest("statistics"));
+        mytests.push_back(new TfceTest("tfce"));
         mytests.push_back(new TimerTest("timer"));
         mytests.push_back(new TopologyHelperTest("topohelp"));
         mytests.push_back(new VolumeFileTest("volumefile"));
+        mytests.push_back(new VolumePagingTest("volumepaging"));
         mytests.push_back(new XnatTest("xnat"));
         if (argc < 2)
         {
@@ -0,0 +1,297 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2024 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//program for timing the performance-critical kernels on synthetic data, writes JSON
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+#include "ApplicationInformation.h"
+#include "BenchmarkInterface.h"
+#include "CaretCommandLine.h"
+#include "CaretException.h"
+#include "CaretHttpManager.h"
+#include "CaretOMP.h"
+#include "ElapsedTimer.h"
+#include "KernelBenchmarks.h"
+#include "SessionManager.h"
+#include "nifti1.h"
+
+using namespace std;
+using namespace caret;
+
+namespace
+{
+    void freeBenchmarkList(vector<BenchmarkInterface*>& mylist)
+    {
+        for (int i = 0; i < (int)mylist.size(); ++i)
+        {
+            delete mylist[i];
+        }
+    }
+    
+    void printUsage(const vector<BenchmarkInterface*>& mylist)
+    {
+        cout << "usage: wb_bench [options] <benchmark>... | all" << endl
+             << "options:" << endl
+             << "   -threads <n,n,...>      thread counts to sweep (default: 1 and the maximum)" << endl
+             << "   -repeats <n>            timed iterations per thread count (default: 5)" << endl
+             << "   -output <file>          write the JSON to a file instead of standard output" << endl
+             << "   -mesh-frequency <n>     sphere subdivision, 57 is fs_LR 32k (default: 57)" << endl
+             << "   -timepoints <n>         dtseries row length (default: 300)" << endl
+             << "   -volume-dims <i> <j> <k> (default: 91 109 91)" << endl
+             << "   -volume-frames <n>      (default: 20)" << endl
+             << "   -smoothing-columns <n>  (default: 32)" << endl
+             << "   -seed <n>               (default: 1)" << endl
+             << "benchmarks:" << endl;
+        for (int i = 0; i < (int)mylist.size(); ++i)
+        {
+            cout << "   " << mylist[i]->getIdentifier().toStdString() << endl;
+        }
+    }
+    
+    int parsePositive(const vector<AString>& args, size_t& index)
+    {
+        if (index + 1 >= args.size()) throw CaretException("option '" + args[index] + "' requires a value");
+        ++index;
+        bool ok = false;
+        const int ret = args[index].toInt(&ok);
+        if (!ok || ret < 1) throw CaretException("invalid value '" + args[index] + "' for option '" + args[index - 1] + "'");
+        return ret;
+    }
+    
+    QJsonObject runBenchmark(BenchmarkInterface* myBench, const BenchmarkSettings& settings, const vector<int>& threadCounts, const int& repeats)
+    {
+        QJsonObject ret;
+        ret["benchmark"] = myBench->getIdentifier();
+        myBench->setUp(settings);
+        if (!myBench->isAvailable())
+        {
+            ret["available"] = false;
+            myBench->tearDown();
+            return ret;
+        }
+        ret["available"] = true;
+        ret["items_per_iteration"] = (double)myBench->getItemsPerIteration();
+        QJsonArray sweep;
+        for (size_t t = 0; t < threadCounts.size(); ++t)
+        {
+#ifdef CARET_OMP
+            omp_set_num_threads(threadCounts[t]);
+#endif
+            myBench->runIteration();//warm up caches and lazily built helpers
+            vector<double> seconds(repeats);
+            for (int r = 0; r < repeats; ++r)
+            {
+                ElapsedTimer myTimer;
+                myTimer.start();
+                myBench->runIteration();
+                seconds[r] = myTimer.getElapsedTimeSeconds();
+            }
+            QJsonArray allSeconds;
+            double sum = 0.0;
+            for (int r = 0; r < repeats; ++r)
+            {
+                allSeconds.append(seconds[r]);
+                sum += seconds[r];
+            }
+            sort(seconds.begin(), seconds.end());
+            const double median = (repeats % 2 == 1 ? seconds[repeats / 2] : (seconds[repeats / 2 - 1] + seconds[repeats / 2]) / 2.0);
+            QJsonObject thisRun;
+            thisRun["threads"] = threadCounts[t];
+            thisRun["seconds"] = allSeconds;
+            thisRun["min_seconds"] = seconds[0];
+            thisRun["median_seconds"] = median;
+            thisRun["mean_seconds"] = sum / repeats;
+            thisRun["items_per_second"] = (median > 0.0 ? myBench->getItemsPerIteration() / median : 0.0);
+            sweep.append(thisRun);
+            cerr << myBench->getIdentifier().toStdString() << ": " << threadCounts[t] << " thread(s), median " << median << " s" << endl;
+        }
+        ret["runs"] = sweep;
+        myBench->tearDown();
+        return ret;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int failCount = 0;
+    {
+        QCoreApplication myApp(argc, argv);
+        caret_global_commandLine_init(argc, argv);
+        SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
+        vector<BenchmarkInterface*> mybenches;
+        const vector<DotSIMDEnum::Enum> dotImpls = DotSIMDEnum::getAllEnums();
+        for (size_t i = 0; i < dotImpls.size(); ++i)
+        {
+            if (dotImpls[i] != DOT_AUTO) mybenches.push_back(new DotBenchmark(dotImpls[i]));
+        }
+        mybenches.push_back(new DotBlockBenchmark("dot-block-kernel"));
+        mybenches.push_back(new GeodesicBenchmark("geodesic-distance"));
+        mybenches.push_back(new MetricSmoothingBenchmark("metric-smoothing-weights", true));
+        mybenches.push_back(new MetricSmoothingBenchmark("metric-smoothing", false));
+        mybenches.push_back(new CiftiRowBenchmark("cifti-row-read", false));
+        mybenches.push_back(new CiftiRowBenchmark("cifti-row-write", true));
+        mybenches.push_back(new NiftiConversionBenchmark("nifti-read-int16", NIFTI_TYPE_INT16, false));
+        mybenches.push_back(new NiftiConversionBenchmark("nifti-write-int16", NIFTI_TYPE_INT16, true));
+        mybenches.push_back(new MathExpressionBenchmark("math-expression"));
+        mybenches.push_back(new PaletteColoringBenchmark("palette-coloring"));
+        mybenches.push_back(new VolumeResampleBenchmark("volume-resample-cubic"));
+        mybenches.push_back(new TfceBenchmark("metric-tfce", false));
+        mybenches.push_back(new TfceBenchmark("volume-tfce", true));
+        BenchmarkSettings settings;
+        vector<int> threadCounts;
+        int repeats = 5;
+        AString outputFileName;
+        vector<AString> selected;
+        try
+        {
+            vector<AString> args;
+            for (int i = 1; i < argc; ++i)
+            {
+                args.push_back(AString(argv[i]));
+            }
+            for (size_t i = 0; i < args.size(); ++i)
+            {
+                if (args[i] == "-threads")
+                {
+                    if (i + 1 >= args.size()) throw CaretException("option '-threads' requires a value");
+                    ++i;
+                    const QStringList counts = args[i].split(",");
+                    for (int j = 0; j < counts.size(); ++j)
+                    {
+                        bool ok = false;
+                        const int count = counts[j].toInt(&ok);
+                        if (!ok || count < 1) throw CaretException("invalid thread count '" + counts[j] + "'");
+                        threadCounts.push_back(count);
+                    }
+                } else if (args[i] == "-repeats") {
+                    repeats = parsePositive(args, i);
+                } else if (args[i] == "-output") {
+                    if (i + 1 >= args.size()) throw CaretException("option '-output' requires a value");
+                    outputFileName = args[++i];
+                } else if (args[i] == "-mesh-frequency") {
+                    settings.m_meshFrequency = parsePositive(args, i);
+                } else if (args[i] == "-timepoints") {
+                    settings.m_timepoints = parsePositive(args, i);
+                } else if (args[i] == "-volume-dims") {
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        settings.m_volumeDims[j] = parsePositive(args, i);
+                    }
+                } else if (args[i] == "-volume-frames") {
+                    settings.m_volumeFrames = parsePositive(args, i);
+                } else if (args[i] == "-smoothing-columns") {
+                    settings.m_smoothingColumns = parsePositive(args, i);
+                } else if (args[i] == "-seed") {
+                    settings.m_seed = (uint32_t)parsePositive(args, i);
+                } else if (args[i].startsWith("-")) {
+                    throw CaretException("unrecognized option '" + args[i] + "'");
+                } else {
+                    selected.push_back(args[i]);
+                }
+            }
+        } catch (CaretException& e) {
+            cerr << e.whatString() << endl;
+            selected.clear();
+        }
+        if (selected.empty())
+        {//still go through the cleanup below
+            printUsage(mybenches);
+            ++failCount;
+        } else {
+            int maxThreads = 1;
+#ifdef CARET_OMP
+            maxThreads = omp_get_max_threads();
+#endif
+            if (threadCounts.empty())
+            {
+                threadCounts.push_back(1);
+                if (maxThreads > 1) threadCounts.push_back(maxThreads);
+            }
+            QJsonObject settingsObject;
+            settingsObject["mesh_frequency"] = settings.m_meshFrequency;
+            settingsObject["timepoints"] = settings.m_timepoints;
+            settingsObject["volume_dims"] = QJsonArray({ settings.m_volumeDims[0], settings.m_volumeDims[1], settings.m_volumeDims[2] });
+            settingsObject["volume_frames"] = settings.m_volumeFrames;
+            settingsObject["smoothing_columns"] = settings.m_smoothingColumns;
+            settingsObject["seed"] = (double)settings.m_seed;
+            settingsObject["repeats"] = repeats;
+            QJsonArray results;
+            for (size_t i = 0; i < selected.size(); ++i)
+            {
+                bool found = false;
+                for (int j = 0; j < (int)mybenches.size(); ++j)
+                {
+                    if (mybenches[j]->getIdentifier() == selected[i] || "all" == selected[i])
+                    {
+                        found = true;
+                        try
+                        {
+                            results.append(runBenchmark(mybenches[j], settings, threadCounts, repeats));
+                        } catch (CaretException& e) {
+                            ++failCount;
+                            cerr << "Benchmark " << mybenches[j]->getIdentifier().toStdString() << " failed, exception: " << e.whatString() << endl;
+                            mybenches[j]->tearDown();
+                        }
+                    }
+                }
+                if (!found)
+                {
+                    ++failCount;
+                    cerr << "unknown benchmark '" << selected[i].toStdString() << "'" << endl;
+                }
+            }
+            QJsonObject root;
+            root["workbench_version"] = ApplicationInformation().getVersion();
+            root["max_threads"] = maxThreads;
+            root["settings"] = settingsObject;
+            root["results"] = results;
+            const QByteArray json = QJsonDocument(root).toJson();
+            if (outputFileName.isEmpty())
+            {
+                cout << json.constData();
+            } else {
+                QFile outFile(outputFileName);
+                if (outFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+                {
+                    outFile.write(json);
+                } else {
+                    ++failCount;
+                    cerr << "unable to write '" << outputFileName.toStdString() << "'" << endl;
+                }
+            }
+        }
+        freeBenchmarkList(mybenches);
+        SessionManager::deleteSessionManager();
+        CaretHttpManager::deleteHttpManager();
+        myApp.processEvents();
+    }
+    return (failCount == 0 ? 0 : 1);
+}